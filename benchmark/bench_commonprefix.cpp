@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "cli/detail/commonprefix.h"
+#include <string>
+#include <vector>
+
+using namespace cli::detail;
+
+// state.range(0) strings sharing a prefix of state.range(1) chars
+static void CommonPrefix(benchmark::State& state)
+{
+    const std::string prefix(static_cast<std::size_t>(state.range(1)), 'x');
+    std::vector<std::string> v;
+    for (int64_t i = 0; i < state.range(0); ++i)
+        v.push_back(prefix + std::to_string(i));
+    for (auto _: state)
+        benchmark::DoNotOptimize(CommonPrefixLength(v));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(CommonPrefix)->Args({10, 8})->Args({1000, 8})->Args({1000, 64})->Args({100000, 8});
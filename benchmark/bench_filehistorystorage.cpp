@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "cli/filehistorystorage.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace cli;
+
+namespace
+{
+
+const char* const fileName = "cli_benchmark_history.txt";
+
+std::vector<std::string> Commands(std::size_t n)
+{
+    std::vector<std::string> cmds;
+    for (std::size_t i = 0; i < n; ++i)
+        cmds.push_back("command " + std::to_string(i));
+    return cmds;
+}
+
+// the store of the history of a session with state.range(0) commands
+void Store(benchmark::State& state)
+{
+    std::remove(fileName);
+    const auto cmds = Commands(static_cast<std::size_t>(state.range(0)));
+    {
+        FileHistoryStorage storage(fileName, 1000);
+        for (auto _: state)
+            storage.Store(cmds);
+    }
+    std::remove(fileName);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the load of a file with state.range(0) commands
+void Load(benchmark::State& state)
+{
+    std::remove(fileName);
+    const auto size = static_cast<std::size_t>(state.range(0));
+    {
+        FileHistoryStorage storage(fileName, size);
+        storage.Store(Commands(size));
+        for (auto _: state)
+            benchmark::DoNotOptimize(storage.Commands());
+    }
+    std::remove(fileName);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(Store)->Arg(10)->Arg(100);
+BENCHMARK(Load)->Arg(100)->Arg(1000);
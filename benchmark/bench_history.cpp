@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "cli/detail/history.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace cli::detail;
+
+namespace
+{
+
+std::vector<std::string> Commands(std::size_t n)
+{
+    std::vector<std::string> cmds;
+    for (std::size_t i = 0; i < n; ++i)
+        cmds.push_back("command " + std::to_string(i));
+    return cmds;
+}
+
+// a full history, with state.range(0) items
+void NewCommand(benchmark::State& state)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    History history(size);
+    history.LoadCommands(Commands(size));
+    const auto cmds = Commands(64);
+    std::size_t i = 0;
+    for (auto _: state)
+        history.NewCommand(cmds[i++ % cmds.size()]);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void Browse(benchmark::State& state)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    History history(size);
+    history.LoadCommands(Commands(size));
+    for (auto _: state)
+    {
+        for (int i = 0; i < 10; ++i)
+            benchmark::DoNotOptimize(history.Previous("line").data());
+        for (int i = 0; i < 10; ++i)
+            benchmark::DoNotOptimize(history.Next().data());
+    }
+    state.SetItemsProcessed(state.iterations() * 20);
+}
+
+// the history of a new session, from the snapshot of the global one
+void LoadSnapshot(benchmark::State& state)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    const auto snapshot = std::make_shared<const std::vector<std::string>>(Commands(size));
+    for (auto _: state)
+    {
+        History history(size);
+        history.LoadCommands(snapshot);
+        benchmark::DoNotOptimize(history.Size());
+    }
+}
+
+} // namespace
+
+BENCHMARK(NewCommand)->Arg(100)->Arg(10000);
+BENCHMARK(Browse)->Arg(100)->Arg(10000);
+BENCHMARK(LoadSnapshot)->Arg(100)->Arg(10000);
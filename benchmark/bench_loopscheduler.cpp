@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "cli/loopscheduler.h"
+#include <atomic>
+
+using namespace cli;
+
+namespace
+{
+
+LoopScheduler scheduler;
+std::atomic<int64_t> executed{0};
+
+// every thread posts tasks and executes the tasks pending
+void PostAndExec(benchmark::State& state)
+{
+    for (auto _: state)
+    {
+        scheduler.Post([](){ ++executed; });
+        scheduler.PollOne();
+    }
+    if (state.thread_index() == 0)
+    {
+        // the tasks left by the other threads
+        while (scheduler.PollOne()) {}
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// a batch of posts, then the execution of the whole batch
+void PostBatch(benchmark::State& state)
+{
+    LoopScheduler s;
+    const auto n = state.range(0);
+    for (auto _: state)
+    {
+        for (int64_t i = 0; i < n; ++i)
+            s.Post([](){ ++executed; });
+        while (s.PollOne()) {}
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+} // namespace
+
+BENCHMARK(PostAndExec)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(PostBatch)->Arg(1000);
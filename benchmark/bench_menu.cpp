@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "cli/cli.h"
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cli;
+
+namespace
+{
+
+// a root menu with state.range(0) commands, plus a submenu with 10 commands
+std::unique_ptr<Menu> MakeTree(int64_t n)
+{
+    auto root = std::make_unique<Menu>("cli");
+    for (int64_t i = 0; i < n; ++i)
+        root->Insert("cmd" + std::to_string(i), [](std::ostream&, int){}, "help");
+    auto sub = std::make_unique<Menu>("sub");
+    for (int i = 0; i < 10; ++i)
+        sub->Insert("subcmd" + std::to_string(i), [](std::ostream&){}, "help");
+    root->Insert(std::move(sub));
+    return root;
+}
+
+void ScanCmds(benchmark::State& state)
+{
+    const auto n = state.range(0);
+    Cli cli(MakeTree(n));
+    cli.CollectMetrics(false);
+    std::ostringstream out;
+    CliSession session(cli, out);
+    Menu* root = session.Current();
+    const std::vector<std::string> hit{"cmd" + std::to_string(n / 2), "1"};
+    const std::vector<std::string> sub{"sub", "subcmd5"};
+    const std::vector<std::string> miss{"nocmd", "1"};
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(root->ScanCmds(hit, session));
+        benchmark::DoNotOptimize(root->ScanCmds(sub, session));
+        session.Current(root);
+        benchmark::DoNotOptimize(root->ScanCmds(miss, session));
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+
+void Completions(benchmark::State& state)
+{
+    Cli cli(MakeTree(state.range(0)));
+    std::ostringstream out;
+    CliSession session(cli, out);
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(session.GetCompletions("cmd1"));
+        benchmark::DoNotOptimize(session.GetCompletions("sub sub"));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+void Feed(benchmark::State& state)
+{
+    Cli cli(MakeTree(state.range(0)));
+    cli.CollectMetrics(state.range(1) != 0);
+    std::ostringstream out;
+    CliSession session(cli, out);
+    const std::string line = "cmd" + std::to_string(state.range(0) / 2) + " 1";
+    for (auto _: state)
+        session.Feed(line);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void Help(benchmark::State& state)
+{
+    Cli cli(MakeTree(state.range(0)));
+    std::ostringstream out;
+    CliSession session(cli, out);
+    for (auto _: state)
+    {
+        out.str({});
+        session.Help();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(out.str().size()));
+}
+
+// removes and inserts again a command among state.range(0) others, in random order
+void Churn(benchmark::State& state)
+{
+    const auto n = state.range(0);
+    Menu menu("cli");
+    std::vector<CmdHandler> handlers;
+    for (int64_t i = 0; i < n; ++i)
+        handlers.push_back(menu.Insert("cmd" + std::to_string(i), [](std::ostream&){}, "help"));
+    std::size_t next = 0;
+    for (auto _: state)
+    {
+        next = (next * 7919 + 1) % handlers.size();
+        handlers[next].Remove();
+        handlers[next] = menu.Insert("cmd" + std::to_string(next), [](std::ostream&){}, "help");
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(ScanCmds)->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK(Completions)->Arg(10)->Arg(1000)->Arg(100000);
+// the whole command line, without and with the metrics
+BENCHMARK(Feed)->Args({1000, 0})->Args({1000, 1});
+BENCHMARK(Help)->Arg(10)->Arg(1000);
+BENCHMARK(Churn)->Arg(10)->Arg(1000)->Arg(100000);
@@ -0,0 +1,274 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_ARGUMENTCOMPLETER_H_
+#define CLI_ARGUMENTCOMPLETER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+
+namespace detail
+{
+    // Incremented when an argument completer gets new values
+    // (so that the sessions compute their completions again).
+    // The changes of the menus are counted by each tree (see Menu::Changes).
+    inline std::atomic<std::size_t>& CompletionsVersion()
+    {
+        static std::atomic<std::size_t> version{ 0 };
+        return version;
+    }
+} // namespace detail
+
+/**
+ * @brief The completion of an argument of a command (e.g., the interface names),
+ * given by a provider that can be slow (e.g., a query to a database).
+ *
+ * The provider is called with the prefix typed, and answers (from any thread)
+ * through a Reply. The answer is cached for a time to live: meanwhile the
+ * completions of the prefixes starting with the one answered are taken
+ * from the cache. When a completion is not in the cache, the session waits
+ * the provider up to the deadline: then it uses the values answered so far
+ * (see Reply::Add) together with the expired ones, if any, so that the keys
+ * typed never wait longer. The answer coming later is used by the next completion.
+ * The provider is called again only after the previous call for the same prefix
+ * has answered. It must not need the thread of the session to answer in time.
+ *
+ * @code
+ * auto setIf = menu->Insert("ifconfig", [](std::ostream&, const std::string& name, int mtu){ ... }, "", {"name", "mtu"});
+ * setIf.CompleteArgument(0, cli::ArgumentCompleter([&db](const std::string& prefix, cli::ArgumentCompleter::Reply reply)
+ * {
+ *     db.AsyncInterfaces(prefix, [reply](std::vector<std::string> names){ reply(std::move(names)); });
+ * }, std::chrono::minutes(1)));
+ * @endcode
+ */
+class ArgumentCompleter
+{
+    struct State;
+    struct Request;
+
+public:
+    using Values = std::vector<std::string>;
+
+    // The answer of a provider: it can be given from any thread, also after the deadline
+    class Reply
+    {
+    public:
+        // Adds values to the answer (e.g., the first ones found)
+        void Add(Values values) const
+        {
+            std::lock_guard<std::mutex> lock(request->state->mtx);
+            if (request->done)
+                return;
+            request->values.insert(request->values.end(), std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+        }
+
+        // Ends the answer: its values are cached for the time to live.
+        // Only the first call has effect.
+        void Done() const { request->state->Answer(*request); }
+
+        // Add(values) and Done()
+        void operator()(Values values) const
+        {
+            Add(std::move(values));
+            Done();
+        }
+
+    private:
+        friend class ArgumentCompleter;
+        explicit Reply(std::shared_ptr<Request> r) : request(std::move(r)) {}
+        std::shared_ptr<Request> request;
+    };
+
+    // Called with the prefix of the argument: the values answered can also not start with it
+    // (they're filtered)
+    using Provider = std::function<void(const std::string& prefix, Reply reply)>;
+
+    explicit ArgumentCompleter(
+        Provider provider,
+        std::chrono::steady_clock::duration ttl = std::chrono::seconds(30),
+        std::chrono::steady_clock::duration deadline = std::chrono::milliseconds(50)) :
+        state(std::make_shared<State>(std::move(provider), ttl, deadline))
+    {}
+
+    // The completer of a provider returning the values at once
+    static ArgumentCompleter Immediate(
+        std::function<Values(const std::string& prefix)> f,
+        std::chrono::steady_clock::duration ttl = std::chrono::seconds(30))
+    {
+        return ArgumentCompleter([f](const std::string& prefix, Reply reply){ reply(f(prefix)); }, ttl);
+    }
+
+    // The values starting with prefix, sorted
+    Values Get(const std::string& prefix) const
+    {
+        return state->Get(prefix);
+    }
+
+private:
+
+    struct Entry
+    {
+        Values values; // sorted, without duplicates
+        std::chrono::steady_clock::time_point time;
+    };
+
+    struct Request
+    {
+        Request(std::shared_ptr<State> s, std::string p) : state(std::move(s)), prefix(std::move(p)) {}
+        std::shared_ptr<State> state; // guarded by state->mtx:
+        const std::string prefix;
+        Values values;
+        bool done = false;
+    };
+
+    struct State : std::enable_shared_from_this<State>
+    {
+        State(Provider p, std::chrono::steady_clock::duration t, std::chrono::steady_clock::duration d) :
+            provider(std::move(p)), ttl(t), deadline(d)
+        {}
+
+        Values Get(const std::string& prefix)
+        {
+            using Clock = std::chrono::steady_clock;
+            const auto start = Clock::now();
+            std::unique_lock<std::mutex> lock(mtx);
+            const Entry* cached = Lookup(prefix);
+            if (cached != nullptr && start - cached->time < ttl)
+                return Filter(cached->values, prefix);
+
+            auto& pending = inFlight[prefix];
+            const bool ask = !pending;
+            if (ask)
+                pending = std::make_shared<Request>(shared_from_this(), prefix);
+            const auto request = pending;
+            if (ask)
+            {
+                lock.unlock();
+                try
+                {
+                    provider(prefix, Reply(request));
+                }
+                catch(...)
+                {
+                    Reply(request).Done();
+                }
+                lock.lock();
+            }
+            cv.wait_until(lock, start + deadline, [&request](){ return request->done; });
+            if (request->done)
+                return Filter(request->values, prefix);
+
+            // the partial answer and the values expired
+            Values values = request->values;
+            cached = Lookup(prefix);
+            if (cached != nullptr)
+                values.insert(values.end(), cached->values.begin(), cached->values.end());
+            SortUnique(values);
+            return Filter(values, prefix);
+        }
+
+        void Answer(Request& request)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (request.done)
+                    return;
+                request.done = true;
+                SortUnique(request.values);
+                const auto now = std::chrono::steady_clock::now();
+                inFlight.erase(request.prefix);
+                // the expired entries, then the oldest ones, leave room to the new one
+                for (auto i = cache.begin(); i != cache.end();)
+                    i = (now - i->second.time >= ttl) ? cache.erase(i) : std::next(i);
+                while (cache.size() >= max_entries)
+                    cache.erase(std::min_element(cache.begin(), cache.end(),
+                        [](const std::pair<const std::string, Entry>& a, const std::pair<const std::string, Entry>& b){ return a.second.time < b.second.time; }));
+                cache[request.prefix] = Entry{ request.values, now };
+            }
+            cv.notify_all();
+            ++detail::CompletionsVersion();
+        }
+
+        // The entry of the longest prefix of prefix
+        // (the values of "et" contain the ones of "eth")
+        const Entry* Lookup(const std::string& prefix) const
+        {
+            for (std::size_t len = prefix.size() + 1; len-- > 0;)
+            {
+                auto i = cache.find(prefix.substr(0, len));
+                if (i != cache.end())
+                    return &i->second;
+            }
+            return nullptr;
+        }
+
+        static void SortUnique(Values& values)
+        {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+
+        // the values (sorted) starting with prefix
+        static Values Filter(const Values& values, const std::string& prefix)
+        {
+            const auto first = std::lower_bound(values.begin(), values.end(), prefix);
+            auto last = first;
+            while (last != values.end() && last->compare(0, prefix.size(), prefix) == 0)
+                ++last;
+            return Values(first, last);
+        }
+
+        enum { max_entries = 64 };
+        const Provider provider;
+        const std::chrono::steady_clock::duration ttl;
+        const std::chrono::steady_clock::duration deadline;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::map<std::string, Entry> cache; // by prefix
+        std::map<std::string, std::shared_ptr<Request>> inFlight; // by prefix
+    };
+
+    std::shared_ptr<State> state; // shared by the copies
+};
+
+} // namespace cli
+
+#endif // CLI_ARGUMENTCOMPLETER_H_
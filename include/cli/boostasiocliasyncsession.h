@@ -35,6 +35,7 @@
 
 
 namespace cli { using BoostAsioCliAsyncSession = detail::GenericCliAsyncSession<detail::BoostAsioLib>; }
+namespace cli { using BoostAsioCliAsyncTerminalSession = detail::GenericCliAsyncTerminalSession<detail::BoostAsioLib>; }
 
 #endif // CLI_BOOSTASIOCLIASYNCSESSION_H_
 
@@ -34,6 +34,7 @@
 #include "detail/genericasioremotecli.h"
 
 namespace cli { using BoostAsioCliTelnetServer = detail::CliGenericTelnetServer<detail::BoostAsioLib>; }
+namespace cli { using BoostAsioCliRawServer = detail::CliGenericRawServer<detail::BoostAsioLib>; }
 
 #endif // CLI_BOOSTASIOREMOTECLI_H_
 
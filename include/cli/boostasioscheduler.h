@@ -31,8 +31,13 @@
 #define CLI_BOOSTASIOSCHEDULER_H_
 
 #include "detail/genericasioscheduler.h"
+#include "detail/genericasioschedulergroup.h"
 #include "detail/boostasiolib.h"
 
-namespace cli { using BoostAsioScheduler = detail::GenericAsioScheduler<detail::BoostAsioLib>; }
+namespace cli
+{
+using BoostAsioScheduler = detail::GenericAsioScheduler<detail::BoostAsioLib>;
+using BoostAsioSchedulerGroup = detail::GenericAsioSchedulerGroup<detail::BoostAsioLib>;
+}
 
 #endif // CLI_BOOSTASIOSCHEDULER_H_
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_CANCELLATION_H_
+#define CLI_CANCELLATION_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "detail/watchdog.h"
+
+namespace cli
+{
+
+/**
+ * @brief Tells a command that it has been cancelled,
+ * by the user (ctrl+C), because its deadline has passed
+ * or because the rest of its output is not needed (e.g., "| head 5").
+ *
+ * A long command handler can check Cancelled() to stop early:
+ *
+ * @code
+ * menu->Insert("show", [](std::ostream& out){
+ *     const auto token = cli::CliSession::Cancellation();
+ *     for (const auto& row: table)
+ *     {
+ *         if (token.Cancelled()) return;
+ *         out << row << '\n';
+ *     }
+ * });
+ * @endcode
+ *
+ * The copies of a CancellationToken share the same state,
+ * and all its methods can be called from any thread.
+ */
+class CancellationToken
+{
+public:
+    CancellationToken() : state(std::make_shared<State>()) {}
+
+    bool Cancelled() const { return state->cancelled; }
+
+    // True if the token has been cancelled by its deadline
+    bool TimedOut() const { return state->timedOut; }
+
+    void Cancel() const { Cancel(state, false, nullptr); }
+
+    // Cancel the token because the rest of the output of the command is not needed:
+    // the command can stop, but the session doesn't report it as cancelled
+    void Stop() const { Cancel(state, true, nullptr); }
+
+    // True if the token has been cancelled by Stop
+    bool Stopped() const { return state->stopped; }
+
+    // f is called once, by the thread cancelling the token
+    // (directly, if the token is already cancelled)
+    void OnCancel(std::function<void()> f) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (!state->cancelled)
+            {
+                state->callbacks.push_back(std::move(f));
+                return;
+            }
+        }
+        f();
+    }
+
+    // Cancel the token after the time given, replacing the previous deadline
+    void CancelAfter(std::chrono::steady_clock::duration timeout) const
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        unsigned generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            generation = ++state->deadlines;
+        }
+        std::weak_ptr<State> s = state;
+        detail::Watchdog::Instance().At(deadline, [s, generation]()
+        {
+            if (auto p = s.lock())
+                Cancel(p, false, &generation);
+        });
+    }
+
+    // Make this token a new one, not cancelled and without deadline, that doesn't
+    // share its state with the copies of the old one. The state is reused
+    // (without allocating memory) if there are no such copies, e.g., for the
+    // next command of a session.
+    void Renew()
+    {
+        if (state.use_count() != 1)
+        {
+            state = std::make_shared<State>();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->cancelled = false;
+        state->timedOut = false;
+        state->stopped = false;
+        ++state->deadlines; // the pending ones are no longer valid
+        state->callbacks.clear();
+    }
+
+private:
+    struct State
+    {
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> timedOut{false};
+        std::atomic<bool> stopped{false};
+        unsigned deadlines = 0; // the number of deadlines set, so that only the last one is valid (guarded by mtx)
+        std::mutex mtx;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    // deadline is the generation of the deadline cancelling the token, if any
+    static void Cancel(const std::shared_ptr<State>& s, bool stop, const unsigned* deadline)
+    {
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(s->mtx);
+            if (s->cancelled || (deadline && *deadline != s->deadlines))
+                return;
+            s->timedOut = (deadline != nullptr);
+            s->stopped = stop;
+            s->cancelled = true;
+            callbacks.swap(s->callbacks);
+        }
+        for (auto& f: callbacks)
+            f();
+    }
+
+    std::shared_ptr<State> state;
+};
+
+} // namespace cli
+
+#endif // CLI_CANCELLATION_H_
@@ -32,18 +32,46 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <list>
+#include <deque>
+#include <mutex>
 #include <memory>
+#include <atomic>
 #include <functional>
 #include <algorithm>
 #include <cctype> // std::isspace
 #include <type_traits>
+#include <tuple>
+#include <initializer_list>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib> // std::strtod
+#include <cstring> // std::strncmp
+#include <iterator>
 #include "colorprofile.h"
+#include "cancellation.h"
+#include "argumentcompleter.h"
+#include "completion.h"
+#include "paged.h"
+#include "streamed.h"
+#include "metrics.h"
+#include "commandtrace.h"
+#include "record.h"
+#include "memoryresource.h"
 #include "detail/history.h"
+#include "detail/historyindex.h"
 #include "detail/split.h"
+#include "detail/outputfilter.h"
+#include "detail/bktree.h"
 #include "detail/fromstring.h"
+#include "detail/interned.h"
+#include "detail/transientbuf.h"
 #include "historystorage.h"
 #include "volatilehistorystorage.h"
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <utility>
 
 namespace cli
@@ -72,7 +100,20 @@ namespace cli
 
     // ********************************************************************
 
+    // Receives the output written on the global output stream without
+    // blocking the writer (e.g., it queues the output of a remote session).
+    class CoutSink
+    {
+    public:
+        virtual ~CoutSink() = default;
+        // Called by the thread writing on Cli::cout(), with the text written
+        // since the previous call. The same buffer is shared by all the sinks.
+        virtual void Write(std::shared_ptr<const std::string> data) = 0;
+    };
+
     // this class provides a global output stream
+    // (the ostreams registered are written synchronously by the writer thread,
+    // while the sinks get the text as a shared buffer at every newline or flush)
     class OutStream : public std::basic_ostream<char>, public std::streambuf
     {
     public:
@@ -83,29 +124,89 @@ namespace cli
         // std::streambuf overrides
         std::streamsize xsputn(const char* s, std::streamsize n) override
         {
+            std::lock_guard<std::mutex> lock(mtx);
             for (auto os: ostreams)
                 os->rdbuf()->sputn(s, n);
+            if (!sinks.empty())
+            {
+                buffer.append(s, static_cast<std::size_t>(n));
+                if (std::find(s, s+n, '\n') != s+n)
+                    Publish();
+            }
             return n;
         }
         int overflow(int c) override
         {
+            std::lock_guard<std::mutex> lock(mtx);
             for (auto os: ostreams)
                 *os << static_cast<char>(c);
+            if (!sinks.empty())
+            {
+                buffer += static_cast<char>(c);
+                if (c == '\n')
+                    Publish();
+            }
             return c;
-        }            
+        }
+        int sync() override
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (auto os: ostreams)
+                os->flush();
+            Publish();
+            return 0;
+        }
 
+        // Register and UnRegister can be called by sessions running on different threads
         void Register(std::ostream& o)
         {
+            std::lock_guard<std::mutex> lock(mtx);
             ostreams.push_back(&o);
         }
         void UnRegister(std::ostream& o)
         {
+            std::lock_guard<std::mutex> lock(mtx);
             ostreams.erase(std::remove(ostreams.begin(), ostreams.end(), &o), ostreams.end());
         }
+        // The sink is unregistered when it's destroyed
+        void Register(const std::shared_ptr<CoutSink>& sink)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            sinks.push_back(sink);
+        }
+        void UnRegister(const CoutSink* sink)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            sinks.erase(
+                std::remove_if(sinks.begin(), sinks.end(), [sink](const std::weak_ptr<CoutSink>& s){ auto p = s.lock(); return !p || p.get() == sink; }),
+                sinks.end());
+        }
 
     private:
 
+        // gives the text written so far to every sink (with mtx locked)
+        void Publish()
+        {
+            if (buffer.empty())
+                return;
+            const auto data = std::make_shared<const std::string>(std::move(buffer));
+            buffer.clear();
+            for (auto i = sinks.begin(); i != sinks.end();)
+            {
+                if (auto sink = i->lock())
+                {
+                    sink->Write(data);
+                    ++i;
+                }
+                else
+                    i = sinks.erase(i);
+            }
+        }
+
+        std::mutex mtx;
         std::vector<std::ostream*> ostreams;
+        std::vector<std::weak_ptr<CoutSink>> sinks;
+        std::string buffer; // text not given to the sinks yet
     };
     
     // forward declarations
@@ -180,8 +281,97 @@ namespace cli
         void WrongCommandHandler(const std::function< void(std::ostream&, const std::string& cmd) >& handler)
         {
             wrongCmdHandler = handler;
+            suggestingHandler = nullptr;
+        }
+
+        /**
+         * @brief Add an handler that will be called when the user enter a wrong command,
+         * with the command lines most similar to it (see @c CliSession::Suggestions),
+         * e.g., to print "did you mean...".
+         *
+         * @param handler the function to be called, taking a @c std::ostream& parameter to write on that session console,
+         * the command entered and the suggestions (from the most similar, possibly none).
+         * @param maxSuggestions the max number of suggestions.
+         */
+        void WrongCommandHandler(
+            const std::function< void(std::ostream&, const std::string& cmd, const std::vector<std::string>& suggestions) >& handler,
+            std::size_t maxSuggestions = 3)
+        {
+            suggestingHandler = handler;
+            suggestions = maxSuggestions;
+            wrongCmdHandler = nullptr;
+        }
+
+        /**
+         * @brief Set the time a command can run before being cancelled (see @c CancellationToken).
+         * A command can override it with @c CmdHandler::Timeout.
+         *
+         * @param timeout the maximum duration of the commands, or zero (the default) for no limit.
+         */
+        void CommandTimeout(std::chrono::steady_clock::duration timeout) { commandTimeout = timeout; }
+
+        /**
+         * @brief Enable or disable the metrics of the commands (disabled by default).
+         * It must be called before starting the sessions.
+         */
+        void CollectMetrics(bool enable) { collectMetrics = enable; }
+
+        /**
+         * @brief Set the resource giving the memory of the output of the commands in framed mode
+         * (see @c CliSession::FrameMemory) to the sessions started afterwards.
+         * The rest (the menu tree, the tokens, the filters, the completions and the strings
+         * and vectors given to the handlers) uses the global heap.
+         *
+         * @param resource the resource, that must outlive the sessions (by default, @c NewDeleteResource()).
+         */
+        void FrameMemory(MemoryResource* resource) { frameMemory = resource; }
+
+        /**
+         * @brief Get the metrics of the commands executed by all the sessions so far
+         * (shown by the @c stats command), if enabled with @c CollectMetrics.
+         * The commands are identified by the path of the menu where they've been found
+         * and their name (e.g., "cli/device42/show"), the built-in ones by their name,
+         * and the wrong ones are collected under the name "(wrong command)".
+         *
+         * @return the metrics of each command, sorted by name.
+         */
+        std::vector<CommandStats> Metrics() const { return metrics->Get(); }
+
+        /**
+         * @brief Clear the metrics of the commands.
+         */
+        void ResetMetrics() { metrics->Reset(); }
+
+        /**
+         * @brief Keep a trace of the last command lines executed by all the sessions
+         * (see @c CommandRecord), shown by the @c debug command (see @c DebugCommands).
+         * It must be called before starting the sessions.
+         *
+         * @param capacity the number of commands kept, or zero (the default) for no trace.
+         */
+        void TraceCommands(std::size_t capacity)
+        {
+            trace = capacity == 0 ? nullptr : std::make_unique<detail::CommandTraceRing>(capacity);
+        }
+
+        /**
+         * @brief Get the last command lines executed by all the sessions (see @c TraceCommands).
+         *
+         * @return the commands still in the trace, the oldest first.
+         */
+        std::vector<CommandRecord> RecentCommands() const
+        {
+            return trace ? trace->Records() : std::vector<CommandRecord>{};
         }
 
+        /**
+         * @brief Add (or remove) the @c debug command to every menu (disabled by default):
+         * "debug trace" shows the last commands (see @c TraceCommands),
+         * and "debug trace chrome" or "debug trace otel" writes them
+         * in the Chrome trace event format or as OpenTelemetry spans (OTLP/JSON).
+         */
+        void DebugCommands(bool enable) { debugCommands = enable; }
+
         /**
          * @brief Get a global out stream object that can be used to print on every session currently connected (local and remote)
          * 
@@ -192,6 +382,21 @@ namespace cli
             return *CoutPtr();
         }
 
+        /**
+         * @brief Get the out stream of a topic, that prints only on the sessions subscribed to it
+         * (with the command "subscribe topic" or @c CliSession::Subscribe), unlike @c cout.
+         * The remote sessions get the text queued, as the one of @c cout.
+         * Writing on a topic without subscribers costs just the lookup of the topic.
+         * Only the topics created by the application can be subscribed.
+         *
+         * @param name the name of the topic, created by the first call
+         * @return OutStream& the reference to the out stream of the topic, valid until the program ends
+         */
+        static OutStream& Topic(const std::string& name)
+        {
+            return *TopicPtr(name, true);
+        }
+
     private:
         friend class CliSession;
 
@@ -201,6 +406,21 @@ namespace cli
             return s;
         }
 
+        // The topic, created only if create is true (the names typed by
+        // the users can't make the table grow): nullptr if it doesn't exist
+        static std::shared_ptr<OutStream> TopicPtr(const std::string& name, bool create)
+        {
+            static std::mutex mtx;
+            static std::map<std::string, std::shared_ptr<OutStream>> topics;
+            std::lock_guard<std::mutex> lock(mtx);
+            auto i = topics.find(name);
+            if (i != topics.end())
+                return i->second;
+            if (!create)
+                return nullptr;
+            return topics.emplace(name, std::make_shared<OutStream>()).first->second;
+        }
+
         Menu* RootMenu() { return rootMenu.get(); }
 
         void EnterAction(std::ostream& out)
@@ -234,6 +454,8 @@ namespace cli
         void StoreCommands(const std::vector<std::string>& cmds)
         {
             globalHistoryStorage->Store(cmds);
+            // the snapshots taken before this point are stale
+            ++*storedGeneration;
         }
 
         std::vector<std::string> GetCommands() const
@@ -241,21 +463,81 @@ namespace cli
             return globalHistoryStorage->Commands();
         }
 
+        // The commands of the global history, shared by the sessions started
+        // before the next StoreCommands.
+        // It never waits for a session storing its commands: a stale snapshot
+        // is rebuilt by the first session that finds it, and it's published
+        // only if no newer one has been published in the meantime.
+        std::shared_ptr<const std::vector<std::string>> CommandsSnapshot() const
+        {
+            auto current = std::atomic_load(&commandsSnapshot);
+            const auto generation = storedGeneration->load();
+            if (current && current->generation == generation)
+                return current->commands;
+
+            auto fresh = std::make_shared<const Snapshot>(
+                generation,
+                std::make_shared<const std::vector<std::string>>(GetCommands())
+            );
+            while (!current || current->generation < generation)
+                if (std::atomic_compare_exchange_weak(&commandsSnapshot, &current, fresh))
+                    break;
+            return fresh->commands;
+        }
+
+        // The index of a snapshot of the global history, built the first time it's needed
+        std::shared_ptr<const detail::HistoryIndex> SearchIndex(const std::shared_ptr<const std::vector<std::string>>& snapshot) const
+        {
+            auto index = std::atomic_load(&searchIndex);
+            if (!index || index->Commands() != snapshot)
+            {
+                index = std::make_shared<const detail::HistoryIndex>(snapshot);
+                std::atomic_store(&searchIndex, index);
+            }
+            return index;
+        }
+
     private:
+        struct Snapshot
+        {
+            Snapshot(std::size_t g, std::shared_ptr<const std::vector<std::string>> c) :
+                generation(g), commands(std::move(c)) {}
+            std::size_t generation; // the value of storedGeneration before reading the storage
+            std::shared_ptr<const std::vector<std::string>> commands;
+        };
         std::unique_ptr<HistoryStorage> globalHistoryStorage;
+        // behind a pointer, so that Cli can be moved
+        std::unique_ptr<std::atomic<std::size_t>> storedGeneration = std::make_unique<std::atomic<std::size_t>>(0);
+        mutable std::shared_ptr<const Snapshot> commandsSnapshot;
+        mutable std::shared_ptr<const detail::HistoryIndex> searchIndex;
         std::unique_ptr<Menu> rootMenu; // just to keep it alive
         std::function<void(std::ostream&)> enterAction;
         std::function<void(std::ostream&)> exitAction;
         std::function<void(std::ostream&, const std::string& cmd, const std::exception& )> exceptionHandler;
         std::function<void(std::ostream&, const std::string& cmd)> wrongCmdHandler;
+        std::function<void(std::ostream&, const std::string& cmd, const std::vector<std::string>& suggestions)> suggestingHandler;
+        std::size_t suggestions = 0;
+        std::chrono::steady_clock::duration commandTimeout{}; // zero for no limit
+        bool collectMetrics = false;
+        MemoryResource* frameMemory = NewDeleteResource(); // see FrameMemory
+        std::unique_ptr<detail::MetricsStore> metrics = std::make_unique<detail::MetricsStore>(); // see storedGeneration
+        std::unique_ptr<detail::CommandTraceRing> trace; // nullptr for no trace
+        bool debugCommands = false;
     };
 
     // ********************************************************************
 
+    namespace detail
+    {
+        // Tells menu and the menus above it that their commands changed
+        // (see Menu::Changes), if menu is not nullptr
+        inline void MenuChanged(Menu* menu);
+    }
+
     class Command
     {
     public:
-        explicit Command(std::string _name) : name(std::move(_name)), enabled(true) {}
+        explicit Command(const std::string& _name) : name(_name), enabled(true) {}
         virtual ~Command() noexcept = default;
 
         // disable copy and move semantics
@@ -264,33 +546,415 @@ namespace cli
         Command& operator=(const Command&) = delete;
         Command& operator=(Command&&) = delete;
 
-        virtual void Enable() { enabled = true; }
-        virtual void Disable() { enabled = false; }
+        virtual void Enable() { enabled = true; detail::MenuChanged(owner); }
+        virtual void Disable() { enabled = false; detail::MenuChanged(owner); }
+        // Mark the command as independent from the others,
+        // so that it can be executed concurrently (see CliFileSession::StartParallel)
+        void Parallel(bool p) { parallel = p; }
+        // Cancel the command when it runs longer than timeout
+        // (zero for the timeout of the Cli, see Cli::CommandTimeout)
+        void Timeout(std::chrono::steady_clock::duration t) { timeout = t.count(); }
+        // Complete the argument at index (0 is the first after the name) with completer.
+        // Unlike the other settings, it must be done before the sessions run.
+        void CompleteArgument(std::size_t index, ArgumentCompleter completer)
+        {
+            completers.erase(index);
+            completers.emplace(index, std::move(completer));
+            detail::MenuChanged(owner);
+        }
+        // Returns true if the command line (whose first token is Name())
+        // can be executed concurrently with other parallel commands.
+        virtual bool IsParallel(const std::vector<std::string>& /*cmdLine*/) const { return !enabled || parallel; }
         virtual bool Exec(const std::vector<std::string>& cmdLine, CliSession& session) = 0;
         virtual void Help(std::ostream& out) const = 0;
         // Returns the collection of completions relatives to this command.
         // For simple commands, provides a base implementation that use the name of the command
         // for aggregate commands (i.e., Menu), the function is redefined to give the menu command
-        // and the subcommand recursively
+        // and the subcommand recursively.
+        // The menu containing this command only calls it when line starts with Name()
+        // or Name() starts with line.
         virtual std::vector<std::string> GetCompletionRecursive(const std::string& line) const
         {
             if (!enabled) return {};
-            if (name.rfind(line, 0) == 0) return {name}; // name starts_with line
-            return {};
+            if (name->rfind(line, 0) == 0) return {*name}; // name starts_with line
+            return ArgumentCompletions(line);
         }
-    protected:
-        const std::string& Name() const { return name; }
+        // Appends to result the command lines starting with prefix + Name()
+        // similar to cmdLine (whose token before pos is Name()), with their edit distance
+        // (at most maxDistance). Returns false if the command has nothing to look for
+        // in the following tokens (i.e., it's not a menu).
+        virtual bool SimilarRecursive(const std::vector<std::string>& /*cmdLine*/, std::size_t /*pos*/, const std::string& /*prefix*/,
+                                      std::size_t /*maxDistance*/, std::vector<std::pair<std::size_t, std::string>>& /*result*/) const
+        {
+            return false;
+        }
+        // The menu containing this command only calls Exec with command lines
+        // whose first token is equal to Name().
+        // The name is interned: the commands having the same name share its storage.
+        const std::string& Name() const { return *name; }
         bool IsEnabled() const { return enabled; }
+    protected:
+        std::chrono::steady_clock::duration Timeout() const { return std::chrono::steady_clock::duration(timeout); }
+
+        // The completions of the argument being typed in line (after Name() and a blank),
+        // given by its completer (see CompleteArgument)
+        std::vector<std::string> ArgumentCompletions(const std::string& line) const
+        {
+            if (completers.empty() || line.size() <= name->size() || line.compare(0, name->size(), *name) != 0 ||
+                !std::isspace(static_cast<unsigned char>(line[name->size()])))
+                return {};
+            // the argument being typed starts after the last blank
+            const std::size_t begin = line.find_last_of(" \t") + 1;
+            std::vector<std::string> args;
+            detail::split(args, line.substr(name->size(), begin - name->size()));
+            const auto completer = completers.find(args.size());
+            if (completer == completers.end())
+                return {};
+            std::vector<std::string> result;
+            for (const auto& value: completer->second.Get(line.substr(begin)))
+                result.push_back(line.substr(0, begin) + value);
+            return result;
+        }
+    private:
+        friend class Menu;
+        const detail::Interned<std::string> name;
+        Menu* owner = nullptr; // the menu holding the command (see Menu::Insert)
+        // atomic, because a CmdHandler can change them while the sessions run the command
+        std::atomic<bool> enabled;
+        std::atomic<bool> parallel{ false };
+        std::atomic<std::chrono::steady_clock::rep> timeout{ 0 };
+        std::map<std::size_t, ArgumentCompleter> completers; // by the index of the argument
+    };
+
+    // ********************************************************************
+
+    // The commands of a menu.
+    // Keeps the commands in slots reused after removal, linked in insertion order
+    // (for help and completion), and indexed by name, so that a command line
+    // is dispatched only to the commands having the same name as its first token,
+    // and a completion only visits the commands that can complete the line.
+    // Add returns a handle to remove the command in constant time
+    // (plus the lookup of its name in the index).
+    class CommandSet
+    {
+    private:
+        static constexpr std::size_t None() { return static_cast<std::size_t>(-1); }
+        struct Slot
+        {
+            std::shared_ptr<Command> cmd; // empty when the slot is free
+            std::size_t generation;
+            std::size_t prev;
+            std::size_t next;
+        };
+    public:
+        // Identifies a command in the set.
+        // A handle of a removed command never matches the command
+        // later stored in the same slot.
+        struct Handle
+        {
+            std::size_t slot = None();
+            std::size_t generation = 0;
+        };
+
+        // Iterates the commands in insertion order
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::shared_ptr<Command>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type*;
+            using reference = const value_type&;
+
+            const_iterator(const std::vector<Slot>* _slots, std::size_t _pos) : slots(_slots), pos(_pos) {}
+            reference operator*() const { return (*slots)[pos].cmd; }
+            pointer operator->() const { return &(*slots)[pos].cmd; }
+            const_iterator& operator++() { pos = (*slots)[pos].next; return *this; }
+            const_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+            bool operator==(const const_iterator& other) const { return pos == other.pos; }
+            bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+        private:
+            const std::vector<Slot>* slots;
+            std::size_t pos;
+        };
+
+        Handle Add(std::shared_ptr<Command> cmd)
+        {
+            const std::size_t slot = FreeSlot();
+            const std::size_t generation = ++lastGeneration;
+            index[&cmd->Name()].push_back({ generation, cmd.get() });
+            names.Insert(cmd->Name());
+            slots[slot] = Slot{ std::move(cmd), generation, tail, None() };
+            ++version;
+            if (tail == None())
+                head = slot;
+            else
+                slots[tail].next = slot;
+            tail = slot;
+            return { slot, generation };
+        }
+
+        // Removes all the commands (the handles stay valid, see Remove)
+        void Clear()
+        {
+            while (head != None())
+                Remove({ head, slots[head].generation });
+        }
+
+        // The number of commands
+        std::size_t Size() const
+        {
+            return static_cast<std::size_t>(std::count_if(slots.begin(), slots.end(), [](const Slot& slot){ return slot.cmd != nullptr; }));
+        }
+
+        // Does nothing if the command of h has already been removed
+        void Remove(Handle h)
+        {
+            if (h.slot >= slots.size() || !slots[h.slot].cmd || slots[h.slot].generation != h.generation)
+                return;
+            Slot& s = slots[h.slot];
+
+            auto entry = index.find(s.cmd->Name());
+            assert(entry != index.end());
+            auto& overloads = entry->second;
+            overloads.erase(
+                std::find_if(overloads.begin(), overloads.end(), [&s](const Entry& e){ return e.seq == s.generation; })
+            );
+            if (overloads.empty())
+                index.erase(entry);
+            names.Erase(s.cmd->Name());
+
+            if (s.prev == None()) head = s.next; else slots[s.prev].next = s.next;
+            if (s.next == None()) tail = s.prev; else slots[s.next].prev = s.prev;
+            s.cmd.reset();
+            freeSlots.push_back(h.slot);
+            ++version;
+
+            // compaction: the free slots at the end are released
+            // (no command moves, so the other handles stay valid)
+            while (!slots.empty() && !slots.back().cmd)
+                slots.pop_back();
+        }
+
+        // Try the commands named as cmdLine[0], in insertion order,
+        // until one of them accepts the command line
+        bool Exec(const std::vector<std::string>& cmdLine, CliSession& session) const
+        {
+            assert(!cmdLine.empty());
+            auto entry = index.find(cmdLine[0]);
+            if (entry == index.end())
+                return false;
+            for (const auto& overload: entry->second)
+                if (overload.cmd->Exec(cmdLine, session))
+                    return true;
+            return false;
+        }
+
+        // Returns true if all the commands named as cmdLine[0] (if any)
+        // can execute cmdLine concurrently
+        bool IsParallel(const std::vector<std::string>& cmdLine) const
+        {
+            assert(!cmdLine.empty());
+            auto entry = index.find(cmdLine[0]);
+            if (entry == index.end())
+                return true;
+            return std::all_of(entry->second.begin(), entry->second.end(), [&](const Entry& e){ return e.cmd->IsParallel(cmdLine); });
+        }
+
+        // Returns the completions of line given by the commands of this set,
+        // in insertion order.
+        // Only the commands whose name starts with line (the command itself)
+        // or is a prefix of line (menus and commands completing their arguments)
+        // are asked for completions, so the cost depends on the length
+        // of line and the number of results rather than on the number of commands.
+        std::vector<std::string> GetCompletions(const std::string& line) const
+        {
+            std::vector<Entry> candidates;
+            StartingWith(line, candidates);
+
+            // names that are a proper prefix of line
+            std::string prefix;
+            for (std::size_t len = 0; len < line.size(); ++len)
+            {
+                prefix.assign(line, 0, len);
+                auto i = index.find(prefix);
+                if (i != index.end())
+                    candidates.insert(candidates.end(), i->second.begin(), i->second.end());
+            }
+
+            std::sort(candidates.begin(), candidates.end(), [](const Entry& e1, const Entry& e2){ return e1.seq < e2.seq; });
+
+            std::vector<std::string> result;
+            for (const auto& c: candidates)
+            {
+                auto cs = c.cmd->GetCompletionRecursive(line);
+                result.insert(result.end(), std::make_move_iterator(cs.begin()), std::make_move_iterator(cs.end()));
+            }
+            return result;
+        }
+
+        // Writes the help of the commands whose name starts with prefix, in insertion order
+        void Help(const std::string& prefix, std::ostream& out) const
+        {
+            std::vector<Entry> matches;
+            StartingWith(prefix, matches);
+            std::sort(matches.begin(), matches.end(), [](const Entry& e1, const Entry& e2){ return e1.seq < e2.seq; });
+            for (const auto& m: matches)
+                m.cmd->Help(out);
+        }
+
+        // Appends to result the names of the enabled commands within maxDistance from word,
+        // with their edit distance
+        void Similar(const std::string& word, std::size_t maxDistance, std::vector<std::pair<std::size_t, std::string>>& result) const
+        {
+            const auto first = static_cast<std::ptrdiff_t>(result.size());
+            names.Find(word, maxDistance, result);
+            result.erase(
+                std::remove_if(result.begin() + first, result.end(), [this](const std::pair<std::size_t, std::string>& s)
+                {
+                    const auto& overloads = index.find(s.second)->second;
+                    return std::none_of(overloads.begin(), overloads.end(), [](const Entry& e){ return e.cmd->IsEnabled(); });
+                }),
+                result.end());
+        }
+
+        // The commands named name, in insertion order
+        std::vector<Command*> Named(const std::string& name) const
+        {
+            std::vector<Command*> result;
+            auto entry = index.find(name);
+            if (entry != index.end())
+                for (const auto& e: entry->second)
+                    result.push_back(e.cmd);
+            return result;
+        }
+
+        // Changes at every Add and Remove
+        std::size_t Version() const { return version; }
+
+        const_iterator begin() const { return { &slots, head }; }
+        const_iterator end() const { return { &slots, None() }; }
+
+    private:
+        struct Entry;
+
+        // Appends the entries whose name starts with prefix
+        // (they are contiguous in the index)
+        void StartingWith(const std::string& prefix, std::vector<Entry>& result) const
+        {
+            for (auto i = index.lower_bound(prefix); i != index.end() && i->first->compare(0, prefix.size(), prefix) == 0; ++i)
+                result.insert(result.end(), i->second.begin(), i->second.end());
+        }
+
+        // Returns a free slot, reusing the ones freed by Remove
+        std::size_t FreeSlot()
+        {
+            while (!freeSlots.empty())
+            {
+                const std::size_t slot = freeSlots.back();
+                freeSlots.pop_back();
+                // the slots released by the compaction are skipped
+                // (the vector grows only when freeSlots is empty, so they can't be reused)
+                if (slot < slots.size())
+                    return slot;
+            }
+            slots.emplace_back();
+            return slots.size() - 1;
+        }
+
+        struct Entry
+        {
+            std::size_t seq; // the generation of the slot, increasing with the insertion order
+            Command* cmd;
+        };
+        std::vector<Slot> slots;
+        std::vector<std::size_t> freeSlots;
+        std::size_t head = None();
+        std::size_t tail = None();
+        std::size_t lastGeneration = 0;
+        std::size_t version = 0;
+        // Orders the interned names of the index, and looks them up by a token
+        struct NameLess
+        {
+            using is_transparent = void;
+            bool operator()(const std::string* a, const std::string* b) const { return *a < *b; }
+            bool operator()(const std::string* a, const std::string& b) const { return *a < b; }
+            bool operator()(const std::string& a, const std::string* b) const { return a < *b; }
+        };
+        // an ordered map, so that lookup stays logarithmic in the number of names
+        // and commands starting with a given prefix are contiguous.
+        // The keys point to the interned names of the commands (see Command::Name),
+        // so that the index (copied by each snapshot) doesn't copy them.
+        std::map<const std::string*, std::vector<Entry>, NameLess> index;
+        detail::BkTree names; // of the commands, to find the ones similar to a wrong name
+    };
+
+    // ********************************************************************
+
+    // The commands of a menu, shared by the writers (Menu::Insert, CmdHandler)
+    // and the readers (dispatch, completion, help), possibly in different threads.
+    // The readers work on an immutable snapshot that keeps its commands alive,
+    // loaded without locks while there are no changes.
+    // The writers modify a working copy under a mutex, that the next reader
+    // publishes as the new snapshot: a burst of changes costs one copy.
+    class SharedCommandSet
+    {
+    public:
+        explicit SharedCommandSet(Menu* _owner) : owner(_owner), snapshot(std::make_shared<const CommandSet>()) {}
+
+        std::shared_ptr<const CommandSet> Snapshot() const
+        {
+            if (dirty.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (dirty.load(std::memory_order_relaxed))
+                {
+                    std::atomic_store(&snapshot, std::make_shared<const CommandSet>(working));
+                    dirty.store(false, std::memory_order_release);
+                }
+            }
+            return std::atomic_load(&snapshot);
+        }
+
+        CommandSet::Handle Add(std::shared_ptr<Command> cmd)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            const auto h = working.Add(std::move(cmd));
+            dirty.store(true, std::memory_order_release);
+            detail::MenuChanged(owner);
+            return h;
+        }
+
+        void Remove(CommandSet::Handle h)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            working.Remove(h);
+            dirty.store(true, std::memory_order_release);
+            detail::MenuChanged(owner);
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            working.Clear();
+            dirty.store(true, std::memory_order_release);
+            detail::MenuChanged(owner);
+        }
+
     private:
-        const std::string name;
-        bool enabled;
+        Menu* const owner;
+        mutable std::mutex mtx;
+        CommandSet working; // guarded by mtx
+        mutable std::atomic<bool> dirty{ false }; // working differs from snapshot
+        mutable std::shared_ptr<const CommandSet> snapshot; // accessed with atomic_load and atomic_store
     };
 
     // ********************************************************************
 
     // free utility function to get completions from a list of commands and the current line
+    template <typename Cmds>
     inline std::vector<std::string> GetCompletions(
-        const std::shared_ptr<std::vector<std::shared_ptr<Command>>>& cmds,
+        const std::shared_ptr<Cmds>& cmds,
         const std::string& currentLine)
     {
         std::vector<std::string> result;
@@ -308,13 +972,102 @@ namespace cli
         return result;
     }
 
+    // overload for the commands of a menu, that uses the name index
+    inline std::vector<std::string> GetCompletions(
+        const std::shared_ptr<CommandSet>& cmds,
+        const std::string& currentLine)
+    {
+        return cmds->GetCompletions(currentLine);
+    }
+
     // ********************************************************************
 
+    class LazyMenuBudget;
+
+    namespace detail
+    {
+        template <typename H>
+        void RunHandler(CliSession& session, const H& h);
+
+        // The state of a lazy menu (see Menu::Lazy)
+        struct LazyMenuState
+        {
+            LazyMenuState(std::function<void(Menu&)> f, std::shared_ptr<LazyMenuBudget> b) :
+                factory(std::move(f)), budget(std::move(b)) {}
+            const std::function<void(Menu&)> factory;
+            const std::shared_ptr<LazyMenuBudget> budget; // nullptr for no limit
+            std::mutex mtx; // held while the factory runs, or the commands are removed
+            std::atomic<bool> materialized{ false };
+            std::atomic<std::size_t> visitors{ 0 }; // the sessions in the menu (or in a submenu of it)
+            // guarded by the mutex of the budget
+            std::list<Menu*>::iterator lru;
+            bool listed = false;
+            std::size_t weight = 0;
+        };
+    }
+
+    /**
+     * @brief The budget of the commands of the lazy menus (see @c Menu::Lazy).
+     *
+     * When the lazy menus built hold more commands than the budget,
+     * the least recently used ones that no session is in lose their commands,
+     * until they're needed again. The budget should exceed the commands
+     * of the menus used at the same time: a menu emptied while a command line
+     * is looking into it from outside (e.g., "device42 show status" from the root)
+     * can make that line fail.
+     */
+    class LazyMenuBudget
+    {
+    public:
+        explicit LazyMenuBudget(std::size_t _maxCommands) : maxCommands(_maxCommands) {}
+
+        // The commands of the lazy menus built (the submenus count as one)
+        std::size_t Commands() const
+        {
+            std::lock_guard<std::recursive_mutex> lock(mtx);
+            return commands;
+        }
+
+        // The number of lazy menus built
+        std::size_t Menus() const
+        {
+            std::lock_guard<std::recursive_mutex> lock(mtx);
+            return lru.size();
+        }
+
+    private:
+        friend class Menu;
+
+        // the menu has been built, with weight commands
+        void Built(Menu& menu, detail::LazyMenuState& state, std::size_t weight);
+        // the menu has been used: returns false if it isn't built anymore
+        bool Used(detail::LazyMenuState& state);
+        // the menu is being destroyed
+        void Forget(detail::LazyMenuState& state);
+
+        const std::size_t maxCommands;
+        // recursive, because emptying a menu can destroy the lazy menus inside it
+        mutable std::recursive_mutex mtx;
+        std::list<Menu*> lru; // the least recently used first
+        std::size_t commands = 0;
+    };
+
     class CliSession
     {
     public:
         CliSession(Cli& _cli, std::ostream& _out, std::size_t historySize = 100);
-        virtual ~CliSession() noexcept { coutPtr->UnRegister(out); }
+        virtual ~CliSession() noexcept
+        {
+            if (filter)
+                out.rdbuf(filter->Target());
+            if (frame && frame->saved)
+                out.rdbuf(frame->saved);
+            coutPtr->UnRegister(out);
+            for (const auto& topic: topics)
+                topic.second->UnRegister(out);
+            for (const auto& lazy: lazyPath)
+                --lazy->visitors;
+        }
 
         // disable value semantics
         CliSession(const CliSession&) = delete;
@@ -323,16 +1076,34 @@ namespace cli
         CliSession(CliSession&&) = delete;
         CliSession& operator = (CliSession&&) = delete;
 
-        void Feed(const std::string& cmd);
+        // Execute a command line.
+        // Returns false if the command is wrong or its handler threw an exception.
+        //
+        // The line can end with a chain of filters of the output of the command,
+        // each after a '|' (outside quotes): "include text" and "exclude text"
+        // (the lines containing text, or not), "head [n]" (the first n lines, 10 by default:
+        // then the command is stopped, see CancellationToken::Stop) and "count"
+        // (the number of lines), e.g., "show log | include error | head 5".
+        // Otherwise the '|' is part of the command line.
+        bool Feed(const std::string& cmd);
 
         void Prompt();
 
-        void Current(Menu* menu) { current = menu; }
+        void Current(Menu* menu);
+
+        Menu* Current() const { return current; }
+
+        // Returns true if the command line can be executed concurrently
+        // with the other parallel ones, in the current menu (see Command::Parallel)
+        bool IsParallel(const std::string& cmd) const;
 
         std::ostream& OutStream() { return out; }
 
         void Help() const;
 
+        // The help of the commands whose name starts with prefix
+        void Help(const std::string& prefix) const;
+
         void Enter() 
         {
             cli.EnterAction(out);
@@ -364,50 +1135,417 @@ namespace cli
 
         void ShowHistory() const { history.Show(out); }
 
-        std::string PreviousCmd(const std::string& line)
+        // The references returned are valid until the history is modified
+        const std::string& PreviousCmd(const std::string& line)
         {
             return history.Previous(line);
         }
 
-        std::string NextCmd()
+        const std::string& NextCmd()
         {
             return history.Next();
         }
 
+        // The command lines most similar to cmd (at most max), from the most similar,
+        // with a name of command (or submenu) in place of the first token that isn't one.
+        // Empty when all the names of cmd exist (e.g., when its parameters are wrong).
+        std::vector<std::string> Suggestions(const std::string& cmd, std::size_t max = 3) const;
+
+        // The completions of a command line, sorted.
+        // The last ones are kept: when the line is extended by chars that are not blanks
+        // (e.g., typing) they are narrowed instead of computed again,
+        // as long as the current menu and the commands don't change.
         std::vector<std::string> GetCompletions(std::string currentLine) const;
 
-    private:
+        // Called by a command whose handler returned a Completion.
+        // Without an asynchronous continuation (see ResumeAsync)
+        // it waits for the completion and writes the epilogue.
+        void Async(Completion completion);
 
-        Cli& cli;
-        std::shared_ptr<cli::OutStream> coutPtr;
-        Menu* current;
-        std::unique_ptr<Menu> globalScopeMenu;
-        std::ostream& out;
-        std::function< void(std::ostream&)> enterAction = []( std::ostream& ) noexcept {};
-        std::function< void(std::ostream&)> exitAction = []( std::ostream& ) noexcept {};
-        detail::History history;
-        bool exit{ false }; // to prevent the prompt after exit command
-    };
+        // Make the asynchronous commands not block the session:
+        // Feed returns while the command is running, and resume is called
+        // (from any thread) when it completes. Then the session must call EndAsync
+        // from its own thread.
+        void ResumeAsync(std::function<void()> resume) { resumeAsync = std::move(resume); }
 
-    // ********************************************************************
+        // True while an asynchronous command is running (see ResumeAsync)
+        bool Running() const { return running; }
 
-    class CmdHandler
-    {
-    public:
-        using CmdVec = std::vector<std::shared_ptr<Command>>;
-        CmdHandler() : descriptor(std::make_shared<Descriptor>()) {}
-        CmdHandler(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v) :
-            descriptor(std::make_shared<Descriptor>(c, v))
-        {}
-        void Enable() { if (descriptor) descriptor->Enable(); }
-        void Disable() { if (descriptor) descriptor->Disable(); }
-        void Remove() { if (descriptor) descriptor->Remove(); }
-    private:
-        struct Descriptor
+        // Ends the asynchronous command completed, writing its epilogue
+        void EndAsync();
+
+        // The cancellation token of the command running on the calling thread
+        // (a token never cancelled, outside command handlers)
+        static CancellationToken Cancellation()
         {
-            Descriptor() = default;
-            Descriptor(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v) :
-                cmd(std::move(c)), cmds(std::move(v))
+            const auto* t = CurrentToken();
+            return t ? *t : CancellationToken{};
+        }
+
+        // Cancel the command being executed or running asynchronously
+        // (the asynchronous one completes at once, without epilogue)
+        void Cancel() { token.Cancel(); }
+
+        // True if the last command has been cancelled
+        // (not stopped by a filter of its output, see Feed)
+        bool Cancelled() const { return token.Cancelled() && !token.Stopped(); }
+
+        // True if the last command has been cancelled by its timeout
+        bool TimedOut() const { return token.TimedOut(); }
+
+        // Cancel the command in execution after timeout,
+        // replacing the timeout of the Cli (see Cli::CommandTimeout)
+        void CancelAfter(std::chrono::steady_clock::duration timeout) { token.CancelAfter(timeout); }
+
+        // Throw away the output not sent yet (if any), after a command has been cancelled
+        virtual void DiscardOutput() {}
+
+        // True when the output waiting to be sent is too much
+        // to generate more of a streamed command (see Stream)
+        virtual bool OutputBacklogged() const { return false; }
+
+        // Show the metrics of the commands (see Cli::Metrics)
+        void ShowStats() const;
+
+        // Show the last commands (see Cli::RecentCommands), in a table,
+        // or in the format given: "chrome" (see WriteChromeTrace) or "otel" (see WriteOtlpTrace).
+        // Returns false if the format is unknown.
+        bool ShowTrace(const std::string& format = {}) const;
+
+        // The number of the session, unique in the process (starting from 1)
+        std::uint64_t Id() const { return id; }
+
+        /**
+         * @brief Enable or disable the framed mode, for the automation clients.
+         *
+         * In framed mode there is no prompt and no echo, and the output of each
+         * command line is written as a frame: a header line
+         * "#<id> <status> <length>" followed by length bytes of output, where:
+         * - id is the request id given by the client starting the line with "@id "
+         *   (e.g., "@17 show interfaces"), or the position of the line in the session;
+         * - status is "ok", "wrong" (no such command), "error" (the handler threw
+         *   an exception, reported in the output by the exception handler)
+         *   or "cancelled" (ctrl+C or timeout, without output);
+         * - length counts the bytes written by the command (over telnet, the NVT
+         *   encoding adds a CR before each LF and doubles the byte 255).
+         * The blank lines are ignored. The mode changes after the current command
+         * line (the global command "framing on|off" negotiates it from a connection).
+         * The handlers can use cli::RecordWriter to write machine readable fields.
+         */
+        void Framed(bool f)
+        {
+            framed = f;
+            if (f && !frame)
+                frame = std::make_unique<Frame>(&frameArena);
+            out.iword(detail::FramedIndex()) = f;
+        }
+
+        bool Framed() const { return framed; }
+
+        // The output of each command line in framed mode (see Framed) is collected
+        // in a buffer taken from resource, that is given back at once when the frame
+        // is written (see MonotonicBufferResource): after the first commands,
+        // the resource is used only by the outputs larger than the previous ones.
+        // It can be changed between the commands (by default, the one of Cli::FrameMemory).
+        void FrameMemory(MemoryResource* resource) { frameArena.Upstream(resource); }
+
+        // The size of the window of the client, in chars (0 when unknown),
+        // e.g., negotiated by telnet (NAWS)
+        void WindowSize(unsigned short width, unsigned short height)
+        {
+            windowWidth = width;
+            windowHeight = height;
+        }
+        unsigned short WindowWidth() const { return windowWidth; }
+        unsigned short WindowHeight() const { return windowHeight; }
+
+        // Enable the pager for the output of the commands returning a Paged
+        // (the global command "pager on|off" sets it from a connection).
+        // The pager is never used in framed mode.
+        void Pager(bool on) { pager = on; }
+        bool Pager() const { return pager; }
+
+        // Called by a command whose handler returned a Paged
+        void Page(Paged paged);
+
+        // Receive the text written on Cli::Topic(topic), until Unsubscribe
+        // (the global commands "subscribe topic" and "unsubscribe topic" call them).
+        // The sessions not receiving Cli::cout() (e.g., CliReplaySession) get nothing.
+        // Return false if the application never created the topic.
+        bool Subscribe(const std::string& topic);
+        void Unsubscribe(const std::string& topic);
+        // The topics subscribed, sorted by name
+        std::vector<std::string> Subscriptions() const;
+
+        // True while the pager waits for the user
+        bool Paging() const { return static_cast<bool>(paging); }
+
+        // Show lines more of the output being paged
+        void PageMore(std::size_t lines);
+
+        // The lines shown by the pager at once: a screen, less the line of "--More--"
+        std::size_t PageLines() const { return windowHeight > 2 ? windowHeight - 1u : 23u; }
+
+        // Stop the paged command, without generating the rest of its output
+        void EndPaging();
+
+        // Called by a command whose handler returned a Streamed.
+        // With an asynchronous continuation (see ResumeAsync) the command
+        // runs until the end of the stream, generated while the output is sent
+        // (see StreamMore), and completes like an asynchronous one.
+        void Stream(Streamed streamed);
+
+        // Generate more of the command being streamed, if the output
+        // waiting to be sent is under the limit (see OutputBacklogged).
+        // The sessions sending their output asynchronously call it
+        // when some output has been sent.
+        void StreamMore();
+
+        /**
+         * @brief Called by the global command "watch <seconds> <command line>".
+         *
+         * The interactive sessions (see ResumeAsync) execute the command line
+         * every interval, showing only the lines of its output that change
+         * (see detail::CommandProcessor), until a key is pressed.
+         * The other sessions, and the framed mode, execute it once.
+         *
+         * @param interval the time between the end of an execution and the next one.
+         * @param line the command line in execution: the one watched is the text after
+         * its first two tokens, as typed (with its quotes and its filters, see Feed).
+         */
+        void Watch(std::chrono::steady_clock::duration interval, const std::string& line);
+
+        // True while a command line is watched (see Watch)
+        bool Watching() const { return static_cast<bool>(watching); }
+
+        // The command line watched, and the time between its executions
+        const std::string& WatchLine() const { return watching->line; }
+        std::chrono::steady_clock::duration WatchInterval() const { return watching->interval; }
+
+        // Execute the command line watched, without storing it in the history,
+        // and get its output (the asynchronous commands are waited for, and the pager is not used)
+        std::string WatchOutput();
+
+        // Stop watching the command line
+        void EndWatch() { watching.reset(); }
+
+        // The command line in execution (see Feed), or nullptr
+        const std::string* Feeding() const { return feeding; }
+
+        /**
+         * @brief Search the newest command containing a string, in the session history
+         * and then in the global one.
+         *
+         * @param query the string to search
+         * @param pos the position to start from, included (0 is the newest command):
+         * it's updated with the position of the command found
+         * @param result the command found
+         * @return true if a command has been found
+         */
+        bool SearchHistory(const std::string& query, std::size_t& pos, std::string& result) const
+        {
+            if (query.empty())
+                return false;
+            if (pos < history.Size())
+            {
+                const auto i = history.Find(query, pos);
+                if (i != std::string::npos)
+                {
+                    pos = i;
+                    result = history.At(i);
+                    return true;
+                }
+                pos = history.Size();
+            }
+            // the older commands of the global history
+            const auto first = history.SnapshotFirst();
+            const auto skip = pos - history.Size();
+            if (skip >= first)
+                return false;
+            if (!searchIndex)
+                searchIndex = cli.SearchIndex(globalCommands);
+            const auto i = searchIndex->FindBefore(query, first - skip);
+            if (i == std::string::npos)
+                return false;
+            pos = history.Size() + (first - 1 - i);
+            result = (*searchIndex->Commands())[i];
+            return true;
+        }
+
+    protected:
+
+        // If registerOut is false, the output stream of the session does not receive
+        // the text written on Cli::cout(): the session can get it with RegisterCout.
+        CliSession(Cli& _cli, std::ostream& _out, std::size_t historySize, bool registerOut);
+
+        // The sink gets the text written on Cli::cout() (and on the topics subscribed)
+        // until it's destroyed
+        void RegisterCout(const std::shared_ptr<CoutSink>& sink);
+
+        // The text written before the output of the wrong command and exception
+        // handlers (e.g., the position of the command in a script)
+        void ErrorLocation(std::string location) { errorLocation = std::move(location); }
+
+        Cli& GetCli() const { return cli; }
+
+    private:
+
+        friend class Menu;
+        template <typename H>
+        friend void detail::RunHandler(CliSession& session, const H& h);
+
+        // Execute a command line (see Feed), stored in the history if record is true.
+        // wrong is set to true if the command does not exist.
+        bool Execute(const std::string& cmd, bool& wrong, bool record = true);
+
+        // Execute the command line split in strs.
+        // wrong is set to true if the command does not exist.
+        bool Dispatch(const std::vector<std::string>& strs, const std::string& cmd, bool& wrong);
+
+        // Write the rest of the output of the filters of the command, and remove them.
+        // When the command failed, the lines of the filters for the end (e.g., a count) are not written,
+        // and when it's been cancelled, nothing is.
+        void EndFilter(bool failed = false);
+
+        bool CollectMetrics() const { return cli.collectMetrics; }
+
+        // The command of the line in execution has been found in menu (see Cli::Metrics):
+        // the innermost menu is the first to tell it
+        void Resolved(const Menu& menu, const std::string& name)
+        {
+            if (resolvedMenu != nullptr) return;
+            resolvedMenu = &menu;
+            resolvedName = name;
+        }
+
+        // The position of the output stream (i.e., the number of chars written on it),
+        // or -1 if the stream can't tell it
+        std::streamoff OutputPosition() const
+        {
+            auto* buf = out.rdbuf();
+            return buf ? static_cast<std::streamoff>(buf->pubseekoff(0, std::ios_base::cur, std::ios_base::out)) : -1;
+        }
+
+        static std::uint64_t NextId()
+        {
+            static std::atomic<std::uint64_t> last{0};
+            return ++last;
+        }
+
+        // the token of the command running on this thread
+        static const CancellationToken*& CurrentToken()
+        {
+            static thread_local const CancellationToken* t = nullptr;
+            return t;
+        }
+
+        // makes token the current one of this thread, while it's alive
+        struct CurrentCancellation
+        {
+            explicit CurrentCancellation(const CancellationToken& token) : previous(CurrentToken()) { CurrentToken() = &token; }
+            ~CurrentCancellation() { CurrentToken() = previous; }
+            CurrentCancellation(const CurrentCancellation&) = delete;
+            CurrentCancellation& operator = (const CurrentCancellation&) = delete;
+            const CancellationToken* previous;
+        };
+
+        Cli& cli;
+        const std::uint64_t id;
+        std::shared_ptr<cli::OutStream> coutPtr;
+        const bool registerOut; // out gets the text of Cli::cout(), otherwise coutSink (if any)
+        std::weak_ptr<CoutSink> coutSink; // see RegisterCout
+        std::map<std::string, std::shared_ptr<cli::OutStream>> topics; // subscribed, see Subscribe
+        Menu* current;
+        // the lazy menus that hold the current one, kept even if the menus are destroyed
+        std::vector<std::shared_ptr<detail::LazyMenuState>> lazyPath;
+        std::ostream& out;
+        std::function< void(std::ostream&)> enterAction = []( std::ostream& ) noexcept {};
+        std::function< void(std::ostream&)> exitAction = []( std::ostream& ) noexcept {};
+        detail::History history;
+        std::shared_ptr<const std::vector<std::string>> globalCommands; // the snapshot loaded in history
+        mutable std::shared_ptr<const detail::HistoryIndex> searchIndex;
+        // The last completions (see GetCompletions)
+        struct CompletionCache
+        {
+            std::string line;
+            const Menu* menu = nullptr;
+            std::size_t completionsVersion = 0; // see detail::CompletionsVersion
+            std::size_t changes = 0; // of the menu tree (see Menu::Changes)
+            bool prefixed = false; // all the completions start with line
+            std::vector<std::string> completions;
+        };
+        mutable CompletionCache completionCache;
+        std::string errorLocation;
+        std::function<void()> resumeAsync;
+        const std::string* feeding = nullptr; // the command line in execution
+        Completion asyncCmd; // the asynchronous command running
+        std::string asyncLine; // the command line of asyncCmd
+        bool running = false;
+        CancellationToken token; // of the last command
+        std::chrono::steady_clock::time_point handlerStart; // of the command in execution (see Cli::Metrics)
+        const Menu* resolvedMenu = nullptr; // where the command in execution has been found (see Resolved)
+        std::string resolvedName; // its name
+        std::string metricName; // the path of the command, reused by each line
+        std::deque<std::vector<std::string>> tokens; // of the command lines in execution, for each level (see Execute)
+        std::size_t depth = 0; // the command lines in execution
+        bool exit{ false }; // to prevent the prompt after exit command
+
+        // The frame of the command line in execution (see Framed)
+        struct Frame
+        {
+            explicit Frame(MemoryResource* resource) : payload(resource) {}
+            detail::TransientBuf payload; // gets the output, in place of the buffer of out
+            std::streambuf* saved = nullptr; // the buffer of out, while a frame is open
+            std::string id;
+            std::size_t lines = 0; // the command lines framed
+            const char* asyncStatus = nullptr; // set by EndAsync
+        };
+        void OpenFrame(std::string id);
+        void CloseFrame(const char* status);
+        bool framed = false;
+        MonotonicBufferResource frameArena; // see FrameMemory
+        std::unique_ptr<Frame> frame; // allocated by the first Framed(true)
+        std::unique_ptr<detail::OutputFilter> filter; // of the output of the command in execution (see Feed)
+
+        unsigned short windowWidth = 0;
+        unsigned short windowHeight = 0;
+        bool pager = false;
+        std::unique_ptr<Paged> paging; // the output waiting for the user (see Page)
+        std::unique_ptr<Streamed> streaming; // the output waiting to be sent (see Stream)
+        std::string pagingLine; // the command line of paging
+        bool morePrompt = false; // "--More--" is shown
+
+        // The command line watched (see Watch)
+        struct WatchState
+        {
+            std::string line;
+            std::chrono::steady_clock::duration interval;
+        };
+        std::unique_ptr<WatchState> watching;
+    };
+
+    // ********************************************************************
+
+    class CmdHandler
+    {
+    public:
+        using CmdVec = SharedCommandSet;
+        CmdHandler() : descriptor(std::make_shared<Descriptor>()) {}
+        CmdHandler(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v, CommandSet::Handle h) :
+            descriptor(std::make_shared<Descriptor>(c, v, h))
+        {}
+        void Enable() { if (descriptor) descriptor->Enable(); }
+        void Disable() { if (descriptor) descriptor->Disable(); }
+        void Remove() { if (descriptor) descriptor->Remove(); }
+        void Parallel(bool p = true) { if (descriptor) descriptor->Parallel(p); }
+        void Timeout(std::chrono::steady_clock::duration t) { if (descriptor) descriptor->Timeout(t); }
+        void CompleteArgument(std::size_t index, ArgumentCompleter completer) { if (descriptor) descriptor->CompleteArgument(index, std::move(completer)); }
+    private:
+        struct Descriptor
+        {
+            Descriptor() = default;
+            Descriptor(std::weak_ptr<Command> c, std::weak_ptr<CmdVec> v, CommandSet::Handle h) :
+                cmd(std::move(c)), cmds(std::move(v)), handle(h)
             {}
             void Enable()
             {
@@ -419,29 +1557,65 @@ namespace cli
                 if(auto c = cmd.lock())
                     c->Disable();
             }
+            void Parallel(bool p)
+            {
+                if(auto c = cmd.lock())
+                    c->Parallel(p);
+            }
+            void Timeout(std::chrono::steady_clock::duration t)
+            {
+                if(auto c = cmd.lock())
+                    c->Timeout(t);
+            }
+            void CompleteArgument(std::size_t index, ArgumentCompleter completer)
+            {
+                if(auto c = cmd.lock())
+                    c->CompleteArgument(index, std::move(completer));
+            }
             void Remove()
             {
-                auto scmd = cmd.lock();
-                auto scmds = cmds.lock();
-                if (scmd && scmds)
-                {
-                    auto i = std::find_if(
-                        scmds->begin(),
-                        scmds->end(),
-                        [&](const auto& c){ return c.get() == scmd.get(); }
-                    );
-                    if (i != scmds->end())
-                        scmds->erase(i);
-                }
+                if (auto scmds = cmds.lock())
+                    scmds->Remove(handle);
             }
             std::weak_ptr<Command> cmd;
             std::weak_ptr<CmdVec> cmds;
+            CommandSet::Handle handle;
         };
         std::shared_ptr<Descriptor> descriptor;
     };
 
     // ********************************************************************
 
+    struct StaticMenu;
+
+    // An entry of a static menu: a command or a submenu.
+    // It's a literal type, so that a table of entries can be constexpr:
+    // it's built at compile time, without allocations at startup.
+    // Use StaticCmd and StaticSubmenu to fill it.
+    struct StaticCommand
+    {
+        const char* name;
+        const char* help;
+        const char* parDesc; // the names of the parameters separated by spaces, or nullptr to show their types
+        bool (*exec)(const std::vector<std::string>& cmdLine, CliSession& session); // nullptr for a submenu
+        void (*typeDesc)(std::ostream& out); // nullptr for a submenu
+        const StaticMenu* menu; // nullptr for a command
+        bool parallel; // the command can be executed concurrently (see Command::Parallel)
+    };
+
+    // A menu defined at compile time: a name and a table of entries.
+    // Use MakeStaticMenu to build it.
+    struct StaticMenu
+    {
+        const char* name;
+        const char* description;
+        const char* prompt; // nullptr to use the name
+        const StaticCommand* cmds;
+        std::size_t size;
+    };
+
+    // ********************************************************************
+
     class Menu : public Command
     {
     public:
@@ -451,16 +1625,60 @@ namespace cli
         Menu(Menu&&) = delete;
         Menu& operator = (Menu&&) = delete;
 
-        Menu() : Command({}), parent(nullptr), description(), cmds(std::make_shared<Cmds>()) {}
+        Menu() : Command({}), parent(nullptr), description(std::string()), prompt(std::string()), cmds(std::make_shared<Cmds>(this)) {}
 
         explicit Menu(const std::string& _name, std::string desc = "(menu)", const std::string& _prompt="") :
             Command(_name),
             parent(nullptr),
             description(std::move(desc)),
             prompt(_prompt.empty() ? _name : _prompt),
-            cmds(std::make_shared<Cmds>())
+            cmds(std::make_shared<Cmds>(this))
         {}
 
+        // A menu having the name, the prompt and the commands of a static menu
+        explicit Menu(const StaticMenu& menu) :
+            Command(menu.name),
+            parent(nullptr),
+            description(menu.description),
+            prompt(menu.prompt == nullptr ? menu.name : menu.prompt),
+            cmds(std::make_shared<Cmds>(this))
+        {
+            Insert(menu);
+        }
+
+        /**
+         * @brief Create a menu whose commands are inserted by factory when they're first needed:
+         * when the menu is entered, completed into, asked for help, or one of its commands
+         * is executed. Until then, the menu costs just its name.
+         *
+         * The factory gets the menu, and inserts the commands (and the submenus, that can be lazy too)
+         * with the Insert methods of the commands inserted dynamically: with a budget,
+         * the commands can be removed and inserted again by factory later (see @c LazyMenuBudget).
+         * The factory runs on the thread of the session needing the menu.
+         *
+         * @param name the name of the menu
+         * @param factory the function inserting the commands in the menu
+         * @param desc the description of the menu
+         * @param budget the budget shared by the lazy menus, or nullptr for no limit
+         * @param prompt the prompt of the menu (its name, if empty)
+         */
+        static std::unique_ptr<Menu> Lazy(const std::string& name, std::function<void(Menu&)> factory, std::string desc = "(menu)",
+                                          std::shared_ptr<LazyMenuBudget> budget = nullptr, const std::string& prompt = "")
+        {
+            auto menu = std::make_unique<Menu>(name, std::move(desc), prompt);
+            menu->lazy = std::make_shared<detail::LazyMenuState>(std::move(factory), std::move(budget));
+            return menu;
+        }
+
+        ~Menu() override
+        {
+            if (lazy && lazy->budget)
+                lazy->budget->Forget(*lazy);
+        }
+
+        // True if the commands of the menu are there (always, for a menu that is not lazy)
+        bool Built() const { return !lazy || lazy->materialized.load(); }
+
         template <typename R, typename ... Args>
         CmdHandler Insert(const std::string& cmdName, R (*f)(std::ostream&, Args...), const std::string& help, const std::vector<std::string>& parDesc={});
         
@@ -481,59 +1699,160 @@ namespace cli
         CmdHandler Insert(std::unique_ptr<Command>&& cmd)
         {
             std::shared_ptr<Command> scmd(std::move(cmd));
-            CmdHandler c(scmd, cmds);
-            cmds->push_back(scmd);
-            return c;
+            std::weak_ptr<Command> wcmd(scmd);
+            scmd->owner = this;
+            const auto h = cmds->Add(std::move(scmd));
+            return CmdHandler(wcmd, cmds, h);
         }
 
         CmdHandler Insert(std::unique_ptr<Menu>&& menu)
         {
             std::shared_ptr<Menu> smenu(std::move(menu));
-            CmdHandler c(smenu, cmds);
+            std::weak_ptr<Command> wmenu(smenu);
             smenu->parent = this;
-            cmds->push_back(smenu);
-            return c;
+            smenu->owner = this;
+            const auto h = cmds->Add(std::move(smenu));
+            return CmdHandler(wmenu, cmds, h);
+        }
+
+        // Add the entries of a static menu to the commands of this menu.
+        // The table is not copied, so it must outlive the menu
+        // (typically, it's a constexpr variable).
+        // The commands inserted dynamically are tried first,
+        // then the static tables in insertion order.
+        // The static commands can't be disabled or removed.
+        // Only its submenus are allocated, once.
+        void Insert(const StaticMenu& menu)
+        {
+            StaticTable table{ &menu, std::vector<std::unique_ptr<Menu>>(menu.size) };
+            for (std::size_t i = 0; i < menu.size; ++i)
+                if (menu.cmds[i].menu != nullptr)
+                {
+                    table.submenus[i] = std::make_unique<Menu>(*menu.cmds[i].menu);
+                    table.submenus[i]->parent = this;
+                }
+            statics.push_back(std::move(table));
+            // the entries with the same name stay in insertion order
+            for (std::size_t i = 0; i < menu.size; ++i)
+                staticIndex.push_back({ menu.cmds[i].name, statics.size() - 1, i });
+            std::stable_sort(staticIndex.begin(), staticIndex.end(), [](const StaticEntry& a, const StaticEntry& b){
+                return std::strcmp(a.name, b.name) < 0;
+            });
+            std::atomic_store(&helpCache, std::shared_ptr<const HelpText>());
+            detail::MenuChanged(this);
         }
 
         bool Exec(const std::vector<std::string>& cmdLine, CliSession& session) override
         {
-            return HandleCommand({Name()}, cmdLine, session);
+            return HandleCommand(false, cmdLine, session);
         }
 
         bool ExecParent(const std::vector<std::string>& cmdLine, CliSession& session)
         {
-            return HandleCommand({Name(), ParentShortcut()}, cmdLine, session);
+            return HandleCommand(true, cmdLine, session);
         }
 
         bool ScanCmds(const std::vector<std::string>& cmdLine, CliSession& session)
         {
             if (!IsEnabled())
                 return false;
-            for (auto& cmd: *cmds)
-                if (cmd->Exec(cmdLine, session))
-                    return true;
             assert(!cmdLine.empty());
+            Build();
+            if (ExecCmds(cmdLine, session))
+                return true;
             return (parent && parent->ExecParent(cmdLine, session));
         }
 
+        // Returns true if ScanCmds would execute cmdLine only with commands
+        // marked parallel (or with no command at all),
+        // so that it can run concurrently and doesn't change the current menu
+        bool ScanParallel(const std::vector<std::string>& cmdLine) const
+        {
+            if (!IsEnabled())
+                return true;
+            assert(!cmdLine.empty());
+            Build();
+            return CmdsParallel(cmdLine) && (!parent || parent->HandleParallel(true, cmdLine));
+        }
+
+        bool IsParallel(const std::vector<std::string>& cmdLine) const override
+        {
+            return HandleParallel(false, cmdLine);
+        }
+
         std::string Prompt() const
         {
-            return prompt;
+            return *prompt;
+        }
+
+        // Writes in buf the names of the menus from the root to this one, separated by '/'
+        // (truncated to size chars, without a terminator), and returns its length
+        std::size_t Path(char* buf, std::size_t size) const
+        {
+            std::size_t length = 0;
+            if (parent != nullptr)
+            {
+                length = parent->Path(buf, size);
+                if (length < size)
+                    buf[length++] = '/';
+            }
+            const std::size_t n = std::min(Name().size(), size - length);
+            std::copy_n(Name().data(), n, buf + length);
+            return length + n;
+        }
+
+        // Appends to path the names of the menus from the root to this one, separated by '/'
+        void Path(std::string& path) const
+        {
+            if (parent != nullptr)
+            {
+                parent->Path(path);
+                path += '/';
+            }
+            path += Name();
+        }
+
+        // The bytes of the whole prompt (colors and "> " included)
+        const std::string& FullPrompt(bool color) const
+        {
+            return color ? *colorPrompt : *plainPrompt;
         }
 
-        void MainHelp(std::ostream& out)
+        // Writes the help of the commands of this menu, rendered once
+        // and cached until the commands change (Insert, Remove, Enable, Disable),
+        // followed by the help of the parent menu
+        void MainHelp(std::ostream& out) const
         {
             if (!IsEnabled()) return;
-            for (const auto& cmd: *cmds)
-                cmd->Help(out);
+            Build();
+            const auto help = RenderedHelp();
+            out.write(help->text.data(), static_cast<std::streamsize>(help->text.size()));
             if (parent != nullptr)
                 parent->Help(out);
         }
 
+        // Like MainHelp, only for the commands whose name starts with prefix
+        void MainHelp(std::ostream& out, const std::string& prefix) const
+        {
+            if (!IsEnabled()) return;
+            Build();
+            cmds->Snapshot()->Help(prefix, out);
+            for (const StaticEntry* e: StaticsStartingWith(prefix))
+            {
+                const auto& submenu = statics[e->table].submenus[e->pos];
+                if (submenu)
+                    submenu->Help(out);
+                else
+                    StaticHelp(statics[e->table].menu->cmds[e->pos], out);
+            }
+            if (parent != nullptr && parent->Name().compare(0, prefix.size(), prefix) == 0)
+                parent->Help(out);
+        }
+
         void Help(std::ostream& out) const override
         {
             if (!IsEnabled()) return;
-            out << " - " << Name() << "\n\t" << description << "\n";
+            out << " - " << Name() << "\n\t" << *description << "\n";
         }
 
         // returns:
@@ -542,7 +1861,7 @@ namespace cli
         // - the recursive completions of parent menu
         std::vector<std::string> GetCompletions(const std::string& currentLine) const
         {
-            auto result = cli::GetCompletions(cmds, currentLine);
+            auto result = CmdsCompletions(currentLine);
             if (parent != nullptr)
             {
                 auto c = parent->GetCompletionWithParent(currentLine);
@@ -568,7 +1887,7 @@ namespace cli
          */
         std::vector<std::string> GetCompletionRecursive(const std::string& line) const override
         {
-            if (line.rfind(Name(), 0) == 0) // line starts_with Name()
+            if (StartsWithToken(line, Name()))
             {
                 return GetCompletionRecursiveHelper(line, Name());
             }
@@ -576,6 +1895,75 @@ namespace cli
             return Command::GetCompletionRecursive(line);
         }
 
+        bool SimilarRecursive(const std::vector<std::string>& cmdLine, std::size_t pos, const std::string& prefix,
+                              std::size_t maxDistance, std::vector<std::pair<std::size_t, std::string>>& result) const override
+        {
+            if (!IsEnabled())
+                return false;
+            Similar(cmdLine, pos, prefix + Name() + ' ', maxDistance, result);
+            return true;
+        }
+
+        /**
+         * Appends to result the command lines similar to cmdLine, with their edit distance
+         * up to maxDistance (e.g., to suggest them for a wrong command).
+         *
+         * The tokens naming a submenu (or the parent) are followed, and the token at pos
+         * is compared with the names of the commands of this menu, using the index
+         * of the names kept by each menu: the similar names replace it in cmdLine,
+         * with the tokens before pos replaced by prefix.
+         */
+        void Similar(const std::vector<std::string>& cmdLine, std::size_t pos, const std::string& prefix,
+                     std::size_t maxDistance, std::vector<std::pair<std::size_t, std::string>>& result) const
+        {
+            assert(pos < cmdLine.size());
+            Build();
+            const std::string& word = cmdLine[pos];
+            if (pos + 1 < cmdLine.size())
+            {
+                // the similar commands of the submenu (or the parent) named by the token
+                bool found = false;
+                for (const Command* c: cmds->Snapshot()->Named(word))
+                    found = c->SimilarRecursive(cmdLine, pos + 1, prefix, maxDistance, result) || found;
+                const auto named = StaticsNamed(word.data(), word.size());
+                for (auto e = named.first; e != named.second; ++e)
+                    if (const auto& submenu = statics[e->table].submenus[e->pos])
+                        found = submenu->SimilarRecursive(cmdLine, pos + 1, prefix, maxDistance, result) || found;
+                if (parent != nullptr && (word == parent->Name() || word == ParentShortcut()))
+                {
+                    parent->Similar(cmdLine, pos + 1, prefix + word + ' ', maxDistance, result);
+                    found = true;
+                }
+                if (found)
+                    return;
+            }
+
+            // the longer the word, the more the chars that can be wrong
+            maxDistance = std::min(maxDistance, detail::MaxTypos(word));
+            std::vector<std::pair<std::size_t, std::string>> names;
+            cmds->Snapshot()->Similar(word, maxDistance, names);
+            for (const auto& table: statics)
+                for (std::size_t i = 0; i < table.menu->size; ++i)
+                {
+                    const std::size_t d = detail::EditDistance(word, table.menu->cmds[i].name);
+                    if (d <= maxDistance && (!table.submenus[i] || table.submenus[i]->IsEnabled()))
+                        names.emplace_back(d, table.menu->cmds[i].name);
+                }
+            if (parent != nullptr)
+                for (const std::string* name: { &parent->Name(), &ParentShortcut() })
+                {
+                    const std::size_t d = detail::EditDistance(word, *name);
+                    if (d <= maxDistance)
+                        names.emplace_back(d, *name);
+                }
+
+            std::string rest; // the tokens after pos
+            for (std::size_t i = pos + 1; i < cmdLine.size(); ++i)
+                rest += ' ' + cmdLine[i];
+            for (auto& n: names)
+                result.emplace_back(n.first, prefix + n.second + rest);
+        }
+
     private:
 
         /**
@@ -592,12 +1980,12 @@ namespace cli
          */
         std::vector<std::string> GetCompletionWithParent(const std::string& line) const
         {
-            if (line.rfind(Name(), 0) == 0) // line starts_with Name()
+            if (StartsWithToken(line, Name()))
             {
                 return GetCompletionRecursiveHelper(line, Name());
             }
 
-            if (line.rfind(ParentShortcut(), 0) == 0) // line starts_with ..
+            if (StartsWithToken(line, ParentShortcut())) // line starts_with ..
             {
                 return GetCompletionRecursiveHelper(line, ParentShortcut());
             }
@@ -605,6 +1993,13 @@ namespace cli
             return Command::GetCompletionRecursive(line);
         }
 
+        // True if the first token of line is name (so "subx" doesn't complete the commands of "sub")
+        static bool StartsWithToken(const std::string& line, const std::string& name)
+        {
+            return line.rfind(name, 0) == 0 &&
+                (line.size() == name.size() || std::isspace(static_cast<unsigned char>(line[name.size()])));
+        }
+
         std::vector<std::string> GetCompletionRecursiveHelper(const std::string& line, const std::string& prefix) const
         {
             auto rest = line;
@@ -612,12 +2007,8 @@ namespace cli
             // trim_left(rest);
             rest.erase(rest.begin(), std::find_if(rest.begin(), rest.end(), [](int ch) { return !std::isspace(ch); }));
             std::vector<std::string> result;
-            for (const auto& cmd: *cmds)
-            {
-                auto cs = cmd->GetCompletionRecursive(rest);
-                for (const auto& c: cs)
-                    result.push_back(prefix + ' ' + c); // concat submenu with command
-            }
+            for (const auto& c: CmdsCompletions(rest))
+                result.push_back(prefix + ' ' + c); // concat submenu with command
             if (parent != nullptr)
             {
                 auto cs = parent->GetCompletionWithParent(rest);
@@ -630,14 +2021,15 @@ namespace cli
         /**
          * Handles a command from the user input.
          *
-         * This function checks if the first element of the `cmdLine` vector matches any of the
-         * valid commands listed in `cmdNames`. If it does, it performs the following actions:
+         * This function checks if the first element of the `cmdLine` vector matches the name
+         * of this menu (or the parent shortcut, when `parentShortcut` is true).
+         * If it does, it performs the following actions:
          *   - If the `cmdLine` is of length 1 (only the command itself), it sets the current
          *     session to this object (`session.Current(this)`) and returns true.
-         *   - If the `cmdLine` is longer (includes subcommands), it iterates through registered
-         *     subcommands (`*cmds`) and calls their `Exec` function with the subcommand arguments
-         *     (`subCmdLine`) and the session (`session`). If any subcommand successfully handles
-         *     the command, it returns true.
+         *   - If the `cmdLine` is longer (includes subcommands), it looks up the registered
+         *     subcommands (`*cmds`) having the name of the first subcommand token and calls their
+         *     `Exec` function with the subcommand arguments (`subCmdLine`) and the session (`session`).
+         *     If any subcommand successfully handles the command, it returns true.
          *   - If no subcommand handles the command and a parent object (`parent`) is set, it
          *     calls the parent's `ExecParent` function with the subcommand arguments and the
          *     session.
@@ -645,20 +2037,21 @@ namespace cli
          * The function returns false if the command is not found, not enabled, or no subcommand or
          * parent can handle it.
          *
-         * @param cmdNames  - List of valid command names.
+         * @param parentShortcut - true if the parent shortcut is a valid name for this menu.
          * @param cmdLine   - User input divided into tokens (command and arguments).
          * @param session   - Reference to the current CliSession object.
          * @return true if the command is handled successfully, false otherwise.
          */
-        bool HandleCommand(const std::vector<std::string>& cmdNames, const std::vector<std::string>& cmdLine, CliSession& session)
+        bool HandleCommand(bool parentShortcut, const std::vector<std::string>& cmdLine, CliSession& session)
         {
             if (!IsEnabled())
                 return false;
 
             assert(!cmdLine.empty());
 
-            if (std::find(cmdNames.begin(), cmdNames.end(), cmdLine[0]) != cmdNames.end())
+            if (cmdLine[0] == Name() || (parentShortcut && cmdLine[0] == ParentShortcut()))
             {
+                Build();
                 if (cmdLine.size() == 1)
                 {
                     session.Current(this);
@@ -668,72 +2061,374 @@ namespace cli
                 {
                     // check also for subcommands
                     std::vector<std::string > subCmdLine(cmdLine.begin()+1, cmdLine.end());
-                    for (auto& cmd: *cmds)
-                        if (cmd->Exec( subCmdLine, session )) return true;
+                    if (ExecCmds( subCmdLine, session )) return true;
                     return (parent && parent->ExecParent(subCmdLine, session));
                 }
             }
             return false;
         }
 
-        static std::string ParentShortcut()
+        // Exec the command line with the commands inserted dynamically,
+        // then with the static ones
+        bool ExecCmds(const std::vector<std::string>& cmdLine, CliSession& session)
         {
-            return "..";
+            bool found = false;
+            try
+            {
+                found = cmds->Snapshot()->Exec(cmdLine, session);
+                if (!found)
+                {
+                    const auto named = StaticsNamed(cmdLine[0].data(), cmdLine[0].size());
+                    for (auto e = named.first; !found && e != named.second; ++e)
+                    {
+                        const auto& submenu = statics[e->table].submenus[e->pos];
+                        found = submenu ? submenu->Exec(cmdLine, session) : statics[e->table].menu->cmds[e->pos].exec(cmdLine, session);
+                    }
+                }
+            }
+            catch (...)
+            {
+                // the command has been found, and has failed
+                if (session.CollectMetrics())
+                    session.Resolved(*this, cmdLine[0]);
+                throw;
+            }
+            if (found && session.CollectMetrics())
+                session.Resolved(*this, cmdLine[0]);
+            return found;
         }
 
-        template <typename F, typename R, typename ... Args>
-        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, Args...) const);
-
-        template <typename F, typename R>
-        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, const std::vector<std::string>&) const);
-
-        template <typename F, typename R>
-        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, std::vector<std::string>) const);
+        // Mirrors HandleCommand: returns true if cmdLine would be executed
+        // only by commands marked parallel (or by none)
+        bool HandleParallel(bool parentShortcut, const std::vector<std::string>& cmdLine) const
+        {
+            if (!IsEnabled())
+                return true;
+            if (cmdLine[0] == Name() || (parentShortcut && cmdLine[0] == ParentShortcut()))
+            {
+                if (cmdLine.size() == 1)
+                    return false; // changes the current menu
+                Build();
+                std::vector<std::string> subCmdLine(cmdLine.begin()+1, cmdLine.end());
+                return CmdsParallel(subCmdLine) && (!parent || parent->HandleParallel(true, subCmdLine));
+            }
+            return true;
+        }
 
-        Menu* parent{ nullptr };
-        const std::string description;
-        const std::string prompt;
-        // using shared_ptr instead of unique_ptr to get a weak_ptr
-        // for the CmdHandler::Descriptor
-        using Cmds = std::vector<std::shared_ptr<Command>>;
-        std::shared_ptr<Cmds> cmds;
-    };
+        // Returns true if all the commands that ExecCmds could use for cmdLine are parallel
+        bool CmdsParallel(const std::vector<std::string>& cmdLine) const
+        {
+            if (!cmds->Snapshot()->IsParallel(cmdLine))
+                return false;
+            const auto named = StaticsNamed(cmdLine[0].data(), cmdLine[0].size());
+            return std::all_of(named.first, named.second, [&](const StaticEntry& e){
+                const auto& submenu = statics[e.table].submenus[e.pos];
+                return submenu ? submenu->IsParallel(cmdLine) : statics[e.table].menu->cmds[e.pos].parallel;
+            });
+        }
 
-    // ********************************************************************
+        // the completions of the commands inserted dynamically and of the static ones
+        std::vector<std::string> CmdsCompletions(const std::string& line) const
+        {
+            Build();
+            auto result = cmds->Snapshot()->GetCompletions(line);
+            if (staticIndex.empty())
+                return result;
+            // the entries whose name starts with line, and the submenu
+            // named by the first token of line, completing the rest
+            auto candidates = StaticsStartingWith(line);
+            const std::size_t token = line.find_first_of(" \t");
+            if (token != std::string::npos)
+            {
+                const auto named = StaticsNamed(line.data(), token);
+                for (auto e = named.first; e != named.second; ++e)
+                    candidates.push_back(&*e);
+                std::sort(candidates.begin(), candidates.end(), InsertionOrder);
+            }
+            for (const StaticEntry* e: candidates)
+            {
+                if (const auto& submenu = statics[e->table].submenus[e->pos])
+                {
+                    auto c = submenu->GetCompletionRecursive(line);
+                    result.insert(result.end(), std::make_move_iterator(c.begin()), std::make_move_iterator(c.end()));
+                }
+                else if (token == std::string::npos)
+                    result.emplace_back(e->name);
+            }
+            return result;
+        }
 
-    template <typename ... Args>
-    struct Select;
+        struct HelpText
+        {
+            std::size_t version; // of the command set
+            std::size_t changes; // see Changes
+            std::string text;
+        };
 
-    template <typename P, typename ... Args>
-    struct Select<P, Args...>
-    {
-        template <typename F, typename InputIt>
-        static void Exec(const F& f, InputIt first, InputIt last)
+        // Returns the help of the commands of this menu, rendering it
+        // if the commands changed since the last time
+        std::shared_ptr<const HelpText> RenderedHelp() const
         {
-            assert( first != last );
-            assert( std::distance(first, last) == 1+sizeof...(Args) );
-            const P p = detail::from_string<typename std::decay<P>::type>(*first);
-            auto g = [&](auto ... pars){ f(p, pars...); };
-            Select<Args...>::Exec(g, std::next(first), last);
+            const auto snapshot = cmds->Snapshot();
+            // read before rendering: a change during the rendering makes the next call render again
+            const std::size_t changed = Changes();
+            auto cached = std::atomic_load(&helpCache);
+            if (cached && cached->version == snapshot->Version() && cached->changes == changed)
+                return cached;
+
+            std::ostringstream text;
+            for (const auto& cmd: *snapshot)
+                cmd->Help(text);
+            for (const auto& table: statics)
+                for (std::size_t i = 0; i < table.menu->size; ++i)
+                    if (table.submenus[i])
+                        table.submenus[i]->Help(text);
+                    else
+                        StaticHelp(table.menu->cmds[i], text);
+            auto fresh = std::make_shared<const HelpText>(HelpText{ snapshot->Version(), changed, text.str() });
+            std::atomic_store(&helpCache, fresh);
+            return fresh;
         }
-    };
 
-    template <>
-    struct Select<>
+        static void StaticHelp(const StaticCommand& cmd, std::ostream& out)
+        {
+            out << " - " << cmd.name;
+            if (cmd.parDesc == nullptr)
+                cmd.typeDesc(out);
+            else
+            {
+                std::vector<std::string> pars;
+                detail::split(pars, cmd.parDesc);
+                for (const auto& par: pars)
+                    out << " <" << par << '>';
+            }
+            out << "\n\t" << cmd.help << "\n";
+        }
+
+        static const std::string& ParentShortcut()
+        {
+            static const std::string shortcut{".."};
+            return shortcut;
+        }
+
+        friend class CliSession;
+        friend class LazyMenuBudget;
+        friend void detail::MenuChanged(Menu* menu);
+
+        // The number of changes of the commands of this menu and of the menus below it
+        // (inserted, removed, enabled, disabled or given a completer), for the caches of the
+        // help and of the completions: a change in a tree doesn't touch the caches of the others
+        std::size_t Changes() const { return changes.load(); }
+
+        // Inserts the commands of a lazy menu, if they aren't there
+        void Build() const
+        {
+            if (!lazy)
+                return;
+            if (lazy->materialized.load(std::memory_order_acquire) && (!lazy->budget || lazy->budget->Used(*lazy)))
+                return;
+            Menu& self = const_cast<Menu&>(*this); // building doesn't change what the menu is
+            std::size_t weight = 0;
+            {
+                std::lock_guard<std::mutex> lock(lazy->mtx);
+                if (lazy->materialized.load(std::memory_order_relaxed))
+                    return;
+                try
+                {
+                    lazy->factory(self);
+                }
+                catch (...)
+                {
+                    cmds->Clear(); // the next time, from scratch
+                    throw;
+                }
+                weight = std::max<std::size_t>(cmds->Snapshot()->Size(), 1);
+                lazy->materialized.store(true, std::memory_order_release);
+            }
+            if (lazy->budget)
+                lazy->budget->Built(self, *lazy, weight);
+        }
+
+        // Removes the commands of a lazy menu (see LazyMenuBudget)
+        void Unbuild()
+        {
+            std::lock_guard<std::mutex> lock(lazy->mtx);
+            lazy->materialized.store(false, std::memory_order_release);
+            cmds->Clear();
+        }
+
+        // Appends the states of the lazy menus holding this one (itself included)
+        void LazyPath(std::vector<std::shared_ptr<detail::LazyMenuState>>& path) const
+        {
+            for (const Menu* m = this; m != nullptr; m = m->parent)
+                if (m->lazy)
+                    path.push_back(m->lazy);
+        }
+
+        template <typename F, typename R, typename ... Args>
+        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, Args...) const);
+
+        template <typename F, typename R>
+        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, const std::vector<std::string>&) const);
+
+        template <typename F, typename R>
+        CmdHandler Insert(const std::string& name, const std::string& help, const std::vector<std::string>& parDesc, F& f, R (F::*)(std::ostream& out, std::vector<std::string>) const);
+
+        Menu* parent{ nullptr };
+        // interned, as the names (see Command::Name)
+        const detail::Interned<std::string> description;
+        const detail::Interned<std::string> prompt;
+        // rendered once, so that a prompt is a single write
+        const detail::Interned<std::string> plainPrompt{ *prompt + "> " };
+        const detail::Interned<std::string> colorPrompt{ detail::Codes().prompt + *prompt + detail::Codes().reset + "> " };
+        // using shared_ptr instead of unique_ptr to get a weak_ptr
+        // for the CmdHandler::Descriptor
+        using Cmds = SharedCommandSet;
+        std::shared_ptr<Cmds> cmds;
+        struct StaticTable
+        {
+            const StaticMenu* menu;
+            std::vector<std::unique_ptr<Menu>> submenus; // the menus of the submenu entries
+        };
+        std::vector<StaticTable> statics;
+        // The entries of the static tables sorted by name (in insertion order when equal),
+        // so that a token is looked for without visiting the others
+        struct StaticEntry
+        {
+            const char* name;
+            std::size_t table; // in statics
+            std::size_t pos; // in the table
+        };
+        std::vector<StaticEntry> staticIndex;
+        using StaticIt = std::vector<StaticEntry>::const_iterator;
+
+        // Compares name with the n chars at s, like strcmp
+        static int CompareName(const char* name, const char* s, std::size_t n)
+        {
+            const int r = std::strncmp(name, s, n);
+            return r != 0 ? r : (name[n] == '\0' ? 0 : 1);
+        }
+
+        static bool InsertionOrder(const StaticEntry* a, const StaticEntry* b)
+        {
+            return a->table < b->table || (a->table == b->table && a->pos < b->pos);
+        }
+
+        // The entries named as the n chars at s
+        std::pair<StaticIt, StaticIt> StaticsNamed(const char* s, std::size_t n) const
+        {
+            const auto first = std::lower_bound(staticIndex.begin(), staticIndex.end(), s, [n](const StaticEntry& e, const char* key){
+                return CompareName(e.name, key, n) < 0;
+            });
+            auto last = first;
+            while (last != staticIndex.end() && CompareName(last->name, s, n) == 0)
+                ++last;
+            return { first, last };
+        }
+
+        // The entries whose name starts with prefix, in insertion order
+        std::vector<const StaticEntry*> StaticsStartingWith(const std::string& prefix) const
+        {
+            std::vector<const StaticEntry*> result;
+            auto e = std::lower_bound(staticIndex.begin(), staticIndex.end(), prefix.data(), [&prefix](const StaticEntry& entry, const char* key){
+                return CompareName(entry.name, key, prefix.size()) < 0;
+            });
+            for (; e != staticIndex.end() && std::strncmp(e->name, prefix.data(), prefix.size()) == 0; ++e)
+                result.push_back(&*e);
+            std::sort(result.begin(), result.end(), InsertionOrder);
+            return result;
+        }
+
+        mutable std::shared_ptr<const HelpText> helpCache; // accessed with atomic_load and atomic_store
+        std::atomic<std::size_t> changes{ 0 }; // see Changes
+        std::shared_ptr<detail::LazyMenuState> lazy; // nullptr if the menu is not lazy
+    };
+
+    namespace detail
+    {
+        inline void MenuChanged(Menu* menu)
+        {
+            for (; menu != nullptr; menu = menu->parent)
+                ++menu->changes;
+        }
+    } // namespace detail
+
+    // ********************************************************************
+
+    // Converts all the parameters before calling the function,
+    // so that a parameter that doesn't match makes Exec return false
+    // without calling anything (and without exceptions)
+    template <typename ... Args>
+    struct Select
     {
         template <typename F, typename InputIt>
-        static void Exec(const F& f, InputIt first, InputIt last)
+        static bool Exec(const F& f, InputIt first, InputIt last)
         {
             // silence the unused warning in release mode when assert is disabled
-            static_cast<void>(first);
             static_cast<void>(last);
 
-            assert(first == last);
-            
-            f();
+            assert( std::distance(first, last) == sizeof...(Args) );
+            return Exec(f, first, std::index_sequence_for<Args...>{});
+        }
+
+    private:
+        template <typename F, typename InputIt, std::size_t ... I>
+        static bool Exec(const F& f, InputIt first, std::index_sequence<I...>)
+        {
+            std::tuple<typename std::decay<Args>::type...> values;
+            bool converted = true;
+            // the parameters are converted left to right, stopping at the first failure
+            static_cast<void>( std::initializer_list<bool>{
+                (converted = converted && detail::try_from_string(*std::next(first, I), std::get<I>(values)))...
+            } );
+            static_cast<void>(first);
+            if (!converted)
+                return false;
+            f(std::get<I>(values)...);
+            return true;
         }
     };
 
+    namespace detail
+    {
+        // The results of a handler that the session must take over
+        template <typename T> struct IsSessionResult : std::false_type {};
+        template <> struct IsSessionResult<Completion> : std::true_type {};
+        template <> struct IsSessionResult<Paged> : std::true_type {};
+        template <> struct IsSessionResult<Streamed> : std::true_type {};
+
+        inline void TakeResult(CliSession& session, Completion completion) { session.Async(std::move(completion)); }
+        inline void TakeResult(CliSession& session, Paged paged) { session.Page(std::move(paged)); }
+        inline void TakeResult(CliSession& session, Streamed streamed) { session.Stream(std::move(streamed)); }
+
+        // Call a command handler (wrapped in a function without parameters),
+        // starting the asynchronous command if it returns a Completion
+        // or the pager if it returns a Paged
+        template <typename H>
+        inline void RunHandler(CliSession&, const H& h, std::false_type) { h(); }
+
+        template <typename H>
+        inline void RunHandler(CliSession& session, const H& h, std::true_type) { TakeResult(session, h()); }
+
+        template <typename H>
+        inline void RunHandler(CliSession& session, const H& h)
+        {
+            // the handler runs until the end of Feed (see Cli::Metrics)
+            if (session.CollectMetrics())
+                session.handlerStart = std::chrono::steady_clock::now();
+            RunHandler(session, h, IsSessionResult<typename std::decay<decltype(h())>::type>{});
+        }
+
+        // the same, for a command with its own timeout (zero for the one of the Cli)
+        template <typename H>
+        inline void RunHandler(CliSession& session, std::chrono::steady_clock::duration timeout, const H& h)
+        {
+            if (timeout != std::chrono::steady_clock::duration::zero())
+                session.CancelAfter(timeout);
+            RunHandler(session, h);
+        }
+    } // namespace detail
+
     template <typename ... Args>
     struct PrintDesc;
 
@@ -769,7 +2464,7 @@ namespace cli
             std::string desc,
             std::vector<std::string> parDesc
         )
-            : Command(_name), func(std::move(fun)), description(std::move(desc)), parameterDesc(std::move(parDesc))
+            : Command(_name), func(std::move(fun)), description(desc), parameterDesc(parDesc)
         {
         }
 
@@ -780,16 +2475,8 @@ namespace cli
             if (cmdLine.size() != paramSize+1) return false;
             if (Name() == cmdLine[0])
             {
-                try
-                {
-                    auto g = [&](auto ... pars){ func( session.OutStream(), pars... ); };
-                    Select<Args...>::Exec(g, std::next(cmdLine.begin()), cmdLine.end());
-                }
-                catch (std::bad_cast&)
-                {
-                    return false;
-                }
-                return true;
+                auto g = [&](auto ... pars){ detail::RunHandler(session, Timeout(), [&](){ return func( session.OutStream(), pars... ); }); };
+                return Select<Args...>::Exec(g, std::next(cmdLine.begin()), cmdLine.end());
             }
             return false;
         }
@@ -798,18 +2485,19 @@ namespace cli
         {
             if (!IsEnabled()) return;
             out << " - " << Name();
-            if (parameterDesc.empty())
+            if (parameterDesc->empty())
                 PrintDesc<Args...>::Dump(out);
-            for (auto& s: parameterDesc)
+            for (auto& s: *parameterDesc)
                 out << " <" << s << '>';
-            out << "\n\t" << description << "\n";
+            out << "\n\t" << *description << "\n";
         }
 
     private:
 
         const F func;
-        const std::string description;
-        const std::vector<std::string> parameterDesc;
+        // interned, as the names (see Command::Name)
+        const detail::Interned<std::string> description;
+        const detail::Interned<std::vector<std::string>> parameterDesc;
     };
 
 
@@ -827,7 +2515,7 @@ namespace cli
             std::string desc,
             std::vector<std::string> parDesc
         )
-            : Command(_name), func(std::move(fun)), description(std::move(desc)), parameterDesc(std::move(parDesc))
+            : Command(_name), func(std::move(fun)), description(desc), parameterDesc(parDesc)
         {
         }
 
@@ -837,7 +2525,8 @@ namespace cli
             assert(!cmdLine.empty());
             if (Name() == cmdLine[0])
             {
-                func(session.OutStream(), std::vector<std::string>(std::next(cmdLine.begin()), cmdLine.end()));
+                const std::vector<std::string> args(std::next(cmdLine.begin()), cmdLine.end());
+                detail::RunHandler(session, Timeout(), [&](){ return func(session.OutStream(), args); });
                 return true;
             }
             return false;
@@ -846,109 +2535,995 @@ namespace cli
         {
             if (!IsEnabled()) return;
             out << " - " << Name();
-            if (parameterDesc.empty())
+            if (parameterDesc->empty())
                 PrintDesc<std::vector<std::string>>::Dump(out);            
-            for (auto& s: parameterDesc)
+            for (auto& s: *parameterDesc)
                 out << " <" << s << '>';
-            out << "\n\t" << description << "\n";
+            out << "\n\t" << *description << "\n";
         }
 
     private:
 
         const F func;
-        const std::string description;
-        const std::vector<std::string> parameterDesc;
+        // interned, as the names (see Command::Name)
+        const detail::Interned<std::string> description;
+        const detail::Interned<std::vector<std::string>> parameterDesc;
     };
 
 
     // ********************************************************************
 
+    namespace detail
+    {
+        // the functions of the entry of a static menu calling f
+        template <typename F, F f>
+        struct StaticCall;
+
+        template <typename R, typename ... Args, R (*f)(std::ostream&, Args...)>
+        struct StaticCall<R (*)(std::ostream&, Args...), f>
+        {
+            static bool Exec(const std::vector<std::string>& cmdLine, CliSession& session)
+            {
+                if (cmdLine.size() != sizeof...(Args)+1) return false;
+                auto g = [&](auto ... pars){ RunHandler(session, [&](){ return f( session.OutStream(), pars... ); }); };
+                return Select<Args...>::Exec(g, std::next(cmdLine.begin()), cmdLine.end());
+            }
+            static void TypeDesc(std::ostream& out) { PrintDesc<Args...>::Dump(out); }
+        };
+
+        template <typename R, R (*f)(std::ostream&, const std::vector<std::string>&)>
+        struct StaticCall<R (*)(std::ostream&, const std::vector<std::string>&), f>
+        {
+            static bool Exec(const std::vector<std::string>& cmdLine, CliSession& session)
+            {
+                const std::vector<std::string> args(std::next(cmdLine.begin()), cmdLine.end());
+                RunHandler(session, [&](){ return f(session.OutStream(), args); });
+                return true;
+            }
+            static void TypeDesc(std::ostream& out) { PrintDesc<std::vector<std::string>>::Dump(out); }
+        };
+
+        template <typename R, R (*f)(std::ostream&, std::vector<std::string>)>
+        struct StaticCall<R (*)(std::ostream&, std::vector<std::string>), f>
+        {
+            static bool Exec(const std::vector<std::string>& cmdLine, CliSession& session)
+            {
+                const std::vector<std::string> args(std::next(cmdLine.begin()), cmdLine.end());
+                RunHandler(session, [&](){ return f(session.OutStream(), args); });
+                return true;
+            }
+            static void TypeDesc(std::ostream& out) { PrintDesc<std::vector<std::string>>::Dump(out); }
+        };
+    } // namespace detail
+
+    // A static menu entry for the free function f:
+    //     constexpr StaticCommand cmd = StaticCmd<decltype(&Foo), &Foo>("foo", "help of foo");
+    template <typename F, F f>
+    constexpr StaticCommand StaticCmd(const char* name, const char* help = "", const char* parDesc = nullptr)
+    {
+        return { name, help, parDesc, &detail::StaticCall<F, f>::Exec, &detail::StaticCall<F, f>::TypeDesc, nullptr, false };
+    }
+
+    // A static menu entry marked parallel (see Command::Parallel):
+    //     constexpr StaticCommand cmd = Parallel(StaticCmd<decltype(&Foo), &Foo>("foo"));
+    constexpr StaticCommand Parallel(StaticCommand cmd)
+    {
+        cmd.parallel = true;
+        return cmd;
+    }
+
+    // A static menu entry for a submenu
+    constexpr StaticCommand StaticSubmenu(const StaticMenu& menu)
+    {
+        return { menu.name, menu.description, nullptr, nullptr, nullptr, &menu, false };
+    }
+
+    // A static menu, having a constexpr table of entries
+    template <std::size_t N>
+    constexpr StaticMenu MakeStaticMenu(const char* name, const StaticCommand (&cmds)[N], const char* description = "(menu)", const char* prompt = nullptr)
+    {
+        return { name, description, prompt, cmds, N };
+    }
+
+    // ********************************************************************
+
+    namespace detail
+    {
+        // The commands available in every menu.
+        // They get the session from Exec, so that a single static menu serves all the sessions.
+
+        inline bool HelpCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 1) return false;
+            session.Help();
+            return true;
+        }
+
+        inline bool HelpPrefixCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 2) return false;
+            session.Help(cmdLine[1]);
+            return true;
+        }
+
+        inline bool ExitCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 1) return false;
+            session.Exit();
+            return true;
+        }
+
+        inline bool StatsCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 1) return false;
+            session.ShowStats();
+            return true;
+        }
+
+#ifdef CLI_HISTORY_CMD
+        inline bool HistoryCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 1) return false;
+            session.ShowHistory();
+            return true;
+        }
+#endif
+
+        inline bool FramingCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 2) return false;
+            if (cmdLine[1] == "on")
+                session.Framed(true);
+            else if (cmdLine[1] == "off")
+                session.Framed(false);
+            else
+                return false;
+            return true;
+        }
+
+        inline bool PagerCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 2) return false;
+            if (cmdLine[1] == "on")
+                session.Pager(true);
+            else if (cmdLine[1] == "off")
+                session.Pager(false);
+            else
+                return false;
+            return true;
+        }
+
+        inline bool WatchCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() < 3 || session.Feeding() == nullptr) return false;
+            // the interval, in seconds (up to a day)
+            char* end = nullptr;
+            const double seconds = std::strtod(cmdLine[1].c_str(), &end);
+            if (end == cmdLine[1].c_str() || *end != '\0' || !(seconds > 0 && seconds <= 86400))
+                return false;
+            const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+            session.Watch(interval, *session.Feeding());
+            return true;
+        }
+
+        // "subscribe" alone shows the topics subscribed
+        inline bool SubscribeCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() > 2) return false;
+            if (cmdLine.size() == 2)
+            {
+                if (!session.Subscribe(cmdLine[1]))
+                    session.OutStream() << "unknown topic: " << cmdLine[1] << '\n';
+            }
+            else
+                for (const auto& topic: session.Subscriptions())
+                    session.OutStream() << topic << '\n';
+            return true;
+        }
+
+        inline bool UnsubscribeCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() != 2) return false;
+            session.Unsubscribe(cmdLine[1]);
+            return true;
+        }
+
+        inline bool DebugCmd(const std::vector<std::string>& cmdLine, CliSession& session)
+        {
+            if (cmdLine.size() < 2 || cmdLine.size() > 3 || cmdLine[1] != "trace") return false;
+            return session.ShowTrace(cmdLine.size() == 3 ? cmdLine[2] : std::string{});
+        }
+
+        inline void NoParameters(std::ostream&) {}
+
+        // The menu is immutable after its construction,
+        // so that it can be used by the sessions running on any thread
+        inline Menu& GlobalScopeMenu()
+        {
+            static constexpr StaticCommand cmds[] = {
+                { "help", "This help message", nullptr, &HelpCmd, &NoParameters, nullptr, false },
+                { "exit", "Quit the session", nullptr, &ExitCmd, &NoParameters, nullptr, false },
+#ifdef CLI_HISTORY_CMD
+                { "history", "Show the history", nullptr, &HistoryCmd, &NoParameters, nullptr, false },
+#endif
+            };
+            static constexpr StaticMenu table = MakeStaticMenu("", cmds);
+            static Menu menu(table);
+            return menu;
+        }
+
+        // The built-in commands looked for after the ones of the menus,
+        // so that they don't hide the commands of the application with the same name
+        inline Menu& FallbackScopeMenu()
+        {
+            static constexpr StaticCommand cmds[] = {
+                { "help", "The commands starting with the prefix", "prefix", &HelpPrefixCmd, &NoParameters, nullptr, false },
+                { "stats", "Show the latency of the commands", nullptr, &StatsCmd, &NoParameters, nullptr, false },
+                { "framing", "Frame the output of the commands, for the automation clients", "on|off", &FramingCmd, &NoParameters, nullptr, false },
+                { "pager", "Show the long outputs a screen at a time", "on|off", &PagerCmd, &NoParameters, nullptr, false },
+                { "watch", "Execute a command every few seconds, showing the changes (a key stops it)", "seconds command", &WatchCmd, &NoParameters, nullptr, false },
+                { "subscribe", "Show the text written on the topic (without a topic, the topics subscribed)", "[topic]", &SubscribeCmd, &NoParameters, nullptr, false },
+                { "unsubscribe", "Stop showing the text written on the topic", "topic", &UnsubscribeCmd, &NoParameters, nullptr, false },
+            };
+            static constexpr StaticMenu table = MakeStaticMenu("", cmds);
+            static Menu menu(table);
+            return menu;
+        }
+
+        // The commands added to every menu by Cli::DebugCommands
+        inline Menu& DebugScopeMenu()
+        {
+            static constexpr StaticCommand cmds[] = {
+                { "debug", "Show the last commands (\"trace\"), or export them (\"trace chrome\" or \"trace otel\")", "trace [format]", &DebugCmd, &NoParameters, nullptr, false },
+            };
+            static constexpr StaticMenu table = MakeStaticMenu("", cmds);
+            static Menu menu(table);
+            return menu;
+        }
+    } // namespace detail
+
+    // LazyMenuBudget implementation
+
+    inline void LazyMenuBudget::Built(Menu& menu, detail::LazyMenuState& state, std::size_t weight)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mtx);
+        if (!state.listed)
+        {
+            state.lru = lru.insert(lru.end(), &menu);
+            state.listed = true;
+            state.weight = weight;
+            commands += weight;
+        }
+        // the least recently used menus with no sessions in them are emptied,
+        // from the start again after each one (emptying a menu can destroy others)
+        while (commands > maxCommands)
+        {
+            const auto victim = std::find_if(lru.begin(), lru.end(), [&menu](const Menu* m){
+                return m != &menu && m->lazy->visitors.load() == 0;
+            });
+            if (victim == lru.end())
+                break;
+            Menu* m = *victim;
+            detail::LazyMenuState& s = *m->lazy;
+            lru.erase(victim);
+            s.listed = false;
+            commands -= s.weight;
+            m->Unbuild();
+        }
+    }
+
+    inline bool LazyMenuBudget::Used(detail::LazyMenuState& state)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mtx);
+        if (!state.listed)
+            return false;
+        lru.splice(lru.end(), lru, state.lru);
+        return true;
+    }
+
+    inline void LazyMenuBudget::Forget(detail::LazyMenuState& state)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mtx);
+        if (!state.listed)
+            return;
+        lru.erase(state.lru);
+        state.listed = false;
+        commands -= state.weight;
+    }
+
     // CliSession implementation
 
+    inline void CliSession::Current(Menu* menu)
+    {
+        // the lazy menus entered first, so that the ones still holding the session are never left
+        std::vector<std::shared_ptr<detail::LazyMenuState>> path;
+        menu->LazyPath(path);
+        for (const auto& lazy: path)
+            ++lazy->visitors;
+        for (const auto& lazy: lazyPath)
+            --lazy->visitors;
+        lazyPath.swap(path);
+        current = menu;
+    }
+
     inline CliSession::CliSession(Cli& _cli, std::ostream& _out, std::size_t historySize) :
+            CliSession(_cli, _out, historySize, true)
+        {
+        }
+
+    inline CliSession::CliSession(Cli& _cli, std::ostream& _out, std::size_t historySize, bool _registerOut) :
             cli(_cli),
+            id(NextId()),
             coutPtr(Cli::CoutPtr()),
+            registerOut(_registerOut),
             current(cli.RootMenu()),
-            globalScopeMenu(std::make_unique< Menu >()),
             out(_out),
             history(historySize)
         {
-            history.LoadCommands(cli.GetCommands());
+            Current(current); // the lazy menus holding the root, if any
+            frameArena.Upstream(cli.frameMemory);
+            globalCommands = cli.CommandsSnapshot();
+            history.LoadCommands(globalCommands);
 
-            coutPtr->Register(out);
-            globalScopeMenu->Insert(
-                "help",
-                [this](std::ostream&){ Help(); },
-                "This help message"
-            );
-            globalScopeMenu->Insert(
-                "exit",
-                [this](std::ostream&){ Exit(); },
-                "Quit the session"
-            );
-#ifdef CLI_HISTORY_CMD
-            globalScopeMenu->Insert(
-                "history",
-                [this](std::ostream&){ ShowHistory(); },
-                "Show the history"
-            );
-#endif
+            if (registerOut)
+                coutPtr->Register(out);
         }
 
-    inline void CliSession::Feed(const std::string& cmd)
+    inline void CliSession::RegisterCout(const std::shared_ptr<CoutSink>& sink)
     {
-        std::vector<std::string> strs;
-        detail::split(strs, cmd);
-        if (strs.empty()) return; // just hit enter
+        coutPtr->Register(sink);
+        coutSink = sink;
+        for (const auto& topic: topics)
+            topic.second->Register(sink);
+    }
+
+    inline bool CliSession::Subscribe(const std::string& topic)
+    {
+        if (topics.count(topic) != 0)
+            return true; // already subscribed
+        auto stream = Cli::TopicPtr(topic, false);
+        if (!stream)
+            return false;
+        topics.emplace(topic, stream);
+        if (registerOut)
+            stream->Register(out);
+        else if (auto sink = coutSink.lock())
+            stream->Register(sink);
+        return true;
+    }
+
+    inline void CliSession::Unsubscribe(const std::string& topic)
+    {
+        auto i = topics.find(topic);
+        if (i == topics.end())
+            return;
+        if (registerOut)
+            i->second->UnRegister(out);
+        else if (auto sink = coutSink.lock())
+            i->second->UnRegister(sink.get());
+        topics.erase(i);
+    }
+
+    inline std::vector<std::string> CliSession::Subscriptions() const
+    {
+        std::vector<std::string> result;
+        for (const auto& topic: topics)
+            result.push_back(topic.first);
+        return result;
+    }
+
+    inline bool CliSession::Feed(const std::string& cmd)
+    {
+        bool wrong = false;
+        if (!framed)
+            return Execute(cmd, wrong);
+
+        static const char* const blanks = " \t";
+        auto begin = cmd.find_first_not_of(blanks);
+        if (begin == std::string::npos)
+            return true; // blank line: no frame
+
+        ++frame->lines;
+        std::string id;
+        if (cmd[begin] == '@')
+        {
+            const auto end = cmd.find_first_of(blanks, begin);
+            id = cmd.substr(begin + 1, end == std::string::npos ? std::string::npos : end - begin - 1);
+            begin = cmd.find_first_not_of(blanks, end);
+        }
+        else
+            id = std::to_string(frame->lines);
+
+        OpenFrame(std::move(id));
+        if (begin == std::string::npos)
+        {
+            // just the request id
+            CloseFrame("ok");
+            return true;
+        }
+        const bool ok = Execute(cmd.substr(begin), wrong);
+        if (running)
+            return ok; // EndAsync closes the frame
+        if (Cancelled())
+            CloseFrame("cancelled");
+        else if (!ok)
+            CloseFrame(wrong ? "wrong" : "error");
+        else
+            CloseFrame(frame->asyncStatus ? frame->asyncStatus : "ok");
+        return ok;
+    }
+
+    inline void CliSession::OpenFrame(std::string id)
+    {
+        frame->id = std::move(id);
+        frame->asyncStatus = nullptr;
+        frame->saved = out.rdbuf(&frame->payload);
+    }
+
+    inline void CliSession::CloseFrame(const char* status)
+    {
+        out.rdbuf(frame->saved);
+        frame->saved = nullptr;
+        if (Cancelled())
+            frame->payload.Clear();
+        out << '#' << frame->id << ' ' << status << ' ' << frame->payload.Size() << '\n';
+        frame->payload.WriteTo(out);
+        out.flush();
+        frame->payload.Clear();
+        frameArena.Release();
+    }
+
+    inline bool CliSession::Execute(const std::string& cmd, bool& wrong, bool record)
+    {
+        using Clock = std::chrono::steady_clock;
+        const bool measure = cli.collectMetrics;
+        detail::CommandTraceRing* const trace = cli.trace.get();
+        const auto start = (measure || trace) ? Clock::now() : Clock::time_point{};
+
+        EndPaging(); // a new command ends the paged one
+
+        // the filters of the output, if any, are not part of the command
+        std::string command;
+        auto filtered = detail::OutputFilter::Parse(cmd, command);
+        const std::string& line = filtered ? command : cmd;
+
+        // the tokens reuse the memory of the ones of the previous commands
+        // (a command line executed by a command, see Watch, has its own)
+        if (depth == tokens.size())
+            tokens.emplace_back();
+        std::vector<std::string>& strs = tokens[depth];
+        detail::split(strs, line);
+        if (strs.empty()) return true; // just hit enter
+
+        const auto tokenized = measure ? Clock::now() : Clock::time_point{};
+
+        if (record)
+            history.NewCommand(cmd); // add anyway to history
+
+        feeding = &cmd;
+        struct Fed { const std::string*& f; std::size_t& d; ~Fed() { f = nullptr; --d; } } fed{feeding, ++depth};
 
-        history.NewCommand(cmd); // add anyway to history
+        token.Renew();
+        if (cli.commandTimeout != std::chrono::steady_clock::duration::zero())
+            token.CancelAfter(cli.commandTimeout);
+        const CurrentCancellation currentCancellation(token);
 
+        if (filtered)
+        {
+            // when no other line can pass, the command can stop
+            const auto t = token;
+            filter = std::move(filtered);
+            filter->Attach(out, [t](){ t.Stop(); });
+        }
+
+        if (!measure && !trace)
+        {
+            const bool ok = Dispatch(strs, line, wrong);
+            if (!running)
+                EndFilter();
+            return ok;
+        }
+
+        // the menu where the command has been typed (Dispatch can change it)
+        char menuPath[detail::CommandTraceRing::menuSize];
+        const std::size_t menuLength = trace ? current->Path(menuPath, sizeof(menuPath)) : 0;
+
+        handlerStart = Clock::time_point{};
+        resolvedMenu = nullptr;
+        const auto before = OutputPosition();
+        const bool ok = Dispatch(strs, line, wrong);
+        if (!running)
+            EndFilter();
+        const auto after = OutputPosition();
+        const auto end = Clock::now();
+        const auto dispatched = handlerStart == Clock::time_point{} ? end : handlerStart;
+        const std::uint64_t outputBytes = (before >= 0 && after > before) ? static_cast<std::uint64_t>(after - before) : 0;
+
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+        if (trace)
+        {
+            const CommandOutcome outcome = wrong ? CommandOutcome::wrong :
+                                           !ok ? CommandOutcome::exception :
+                                           running ? CommandOutcome::async : CommandOutcome::ok;
+            trace->Record(id, menuPath, menuLength, cmd, start, duration_cast<nanoseconds>(end - start), outputBytes, outcome);
+        }
+        if (!measure)
+            return ok;
+
+        detail::CommandSample sample;
+        sample.tokenize = duration_cast<nanoseconds>(tokenized - start);
+        sample.dispatch = duration_cast<nanoseconds>(dispatched - tokenized);
+        sample.handler = duration_cast<nanoseconds>(end - dispatched);
+        sample.outputBytes = outputBytes;
+        sample.error = !ok;
+        // the menu and the name of the command (the built-in menus have no name)
+        metricName.clear();
+        if (wrong || resolvedMenu == nullptr)
+            metricName = wrong ? "(wrong command)" : strs[0];
+        else
+        {
+            resolvedMenu->Path(metricName);
+            if (!metricName.empty())
+                metricName += '/';
+            metricName += resolvedName;
+        }
+        resolvedMenu = nullptr; // for the command line executing this one, if any (see Watch)
+        cli.metrics->Record(metricName, sample);
+        return ok;
+    }
+
+    inline bool CliSession::Dispatch(const std::vector<std::string>& strs, const std::string& cmd, bool& wrong)
+    {
         try
         {
 
             // global cmds check
-            bool found = globalScopeMenu->ScanCmds(strs, *this);
+            bool found = detail::GlobalScopeMenu().ScanCmds(strs, *this);
+            if (!found && cli.debugCommands) found = detail::DebugScopeMenu().ScanCmds(strs, *this);
 
             // root menu recursive cmds check
             if (!found) found = current->ScanCmds(strs, *this);
 
-            if (!found) // wrong command handler if not found
+            // built-in cmds not hiding the ones of the menus
+            if (!found) found = detail::FallbackScopeMenu().ScanCmds(strs, *this);
+
+            if (found)
+                return true;
+
+            // wrong command handler if not found
+            wrong = true;
+            EndFilter(true);
+            out << errorLocation;
+            if (cli.suggestingHandler)
+                cli.suggestingHandler(out, cmd, Suggestions(cmd, cli.suggestions));
+            else
                 cli.WrongCommandHandler(out, cmd);
         }
         catch(const std::exception& e)
         {
+            EndFilter(true);
+            out << errorLocation;
             cli.StdExceptionHandler(out, cmd, e);
         }
         catch(...)
         {
-            out << "Cli. Unknown exception caught handling command line \""
+            EndFilter(true);
+            out << errorLocation
+                << "Cli. Unknown exception caught handling command line \""
                 << cmd
                 << "\"\n";
         }
+        return false;
+    }
+
+    inline void CliSession::EndFilter(bool failed)
+    {
+        if (!filter)
+            return;
+        if (!Cancelled())
+        {
+            filter->Flush();
+            if (!failed)
+                filter->End();
+        }
+        filter->Detach(out);
+        filter.reset();
+    }
+
+    inline void CliSession::Async(Completion completion)
+    {
+        assert(!running);
+        asyncCmd = std::move(completion);
+        asyncLine = feeding ? *feeding : std::string{};
+        running = true;
+        // cancelling the command completes it
+        auto c = asyncCmd;
+        token.OnCancel([c](){ c.Complete(); });
+        if (resumeAsync)
+        {
+            asyncCmd.Then(resumeAsync);
+            return;
+        }
+        asyncCmd.Wait();
+        EndAsync();
+    }
+
+    inline void CliSession::EndAsync()
+    {
+        if (!running)
+            return;
+        running = false;
+        streaming.reset();
+        const char* status = "ok";
+        auto epilogue = asyncCmd.TakeEpilogue();
+        if (Cancelled())
+            status = "cancelled";
+        else if (epilogue)
+        {
+            const CurrentCancellation currentCancellation(token);
+            try
+            {
+                epilogue(out);
+            }
+            catch(const std::exception& e)
+            {
+                status = "error";
+                EndFilter(true);
+                out << errorLocation;
+                cli.StdExceptionHandler(out, asyncLine, e);
+            }
+            catch(...)
+            {
+                status = "error";
+                EndFilter(true);
+                out << errorLocation
+                    << "Cli. Unknown exception caught handling command line \""
+                    << asyncLine
+                    << "\"\n";
+            }
+        }
+        EndFilter();
+        if (frame && frame->saved)
+        {
+            frame->asyncStatus = status;
+            // when the command completes during Feed, Feed closes the frame
+            if (feeding == nullptr)
+                CloseFrame(status);
+        }
+    }
+
+    inline void CliSession::Page(Paged paged)
+    {
+        // the lines filtered (see Feed) are not paged
+        if (!pager || framed || filter)
+        {
+            Stream(Streamed([paged](std::ostream& o){ return paged(o); }));
+            return;
+        }
+        paging = std::make_unique<Paged>(std::move(paged));
+        pagingLine = feeding ? *feeding : std::string{};
+        morePrompt = false;
+        PageMore(PageLines());
+    }
+
+    inline void CliSession::PageMore(std::size_t lines)
+    {
+        if (!paging)
+            return;
+        if (morePrompt)
+            out << "\r        \r"; // erase "--More--"
+        bool more = true;
+        try
+        {
+            for (std::size_t i = 0; more && i < lines; ++i)
+                more = (*paging)(out);
+        }
+        catch(const std::exception& e)
+        {
+            more = false;
+            out << errorLocation;
+            cli.StdExceptionHandler(out, pagingLine, e);
+        }
+        catch(...)
+        {
+            more = false;
+            out << errorLocation
+                << "Cli. Unknown exception caught handling command line \""
+                << pagingLine
+                << "\"\n";
+        }
+        morePrompt = more;
+        if (more)
+            out << "--More--";
+        else
+            paging.reset();
+        out.flush();
+    }
+
+    inline void CliSession::EndPaging()
+    {
+        if (!paging)
+            return;
+        if (morePrompt)
+            out << "\r        \r" << std::flush;
+        morePrompt = false;
+        paging.reset();
+    }
+
+    inline void CliSession::Stream(Streamed streamed)
+    {
+        assert(!running);
+        // the first chunks from the handler (the exceptions go to the dispatcher)
+        const bool all = framed || !resumeAsync;
+        bool more = true;
+        while (more && !token.Cancelled() && (all || !OutputBacklogged()))
+            more = streamed(out);
+        out.flush();
+        if (!more || token.Cancelled())
+            return;
+        // the rest as the output is sent: the stream completes the command
+        streaming = std::make_unique<Streamed>(std::move(streamed));
+        Async(Completion{});
+    }
+
+    inline void CliSession::StreamMore()
+    {
+        if (!streaming || token.Cancelled() || OutputBacklogged())
+            return;
+        const CurrentCancellation currentCancellation(token);
+        bool more = true;
+        try
+        {
+            while (more && !token.Cancelled() && !OutputBacklogged())
+                more = (*streaming)(out);
+        }
+        catch(const std::exception& e)
+        {
+            more = false;
+            EndFilter(true);
+            out << errorLocation;
+            cli.StdExceptionHandler(out, asyncLine, e);
+        }
+        catch(...)
+        {
+            more = false;
+            EndFilter(true);
+            out << errorLocation
+                << "Cli. Unknown exception caught handling command line \""
+                << asyncLine
+                << "\"\n";
+        }
+        out.flush();
+        if (more)
+            return;
+        streaming.reset();
+        asyncCmd.Complete(); // EndAsync comes from the continuation
+    }
+
+    inline void CliSession::Watch(std::chrono::steady_clock::duration interval, const std::string& line)
+    {
+        // the line after "watch <seconds>"
+        static const char* const blanks = " \t";
+        std::size_t pos = 0;
+        for (int i = 0; i < 2 && pos != std::string::npos; ++i)
+            pos = line.find_first_of(blanks, line.find_first_not_of(blanks, pos));
+        if (pos != std::string::npos)
+            pos = line.find_first_not_of(blanks, pos);
+        if (pos == std::string::npos)
+            return;
+        std::string watched = line.substr(pos);
+
+        // the filters of the line apply to the command watched
+        if (filter)
+        {
+            filter->Detach(out);
+            filter.reset();
+        }
+
+        if (!resumeAsync || framed)
+        {
+            bool wrong = false;
+            Execute(watched, wrong, false);
+            return;
+        }
+        watching = std::make_unique<WatchState>(WatchState{ std::move(watched), interval });
+    }
+
+    inline std::string CliSession::WatchOutput()
+    {
+        assert(watching);
+        // like a session without asynchronous continuation and pager
+        std::stringbuf buffer;
+        auto* saved = out.rdbuf(&buffer);
+        auto resume = std::move(resumeAsync);
+        resumeAsync = nullptr;
+        const bool paged = pager;
+        pager = false;
+        const std::string line = watching->line; // the command could end the watch
+        bool wrong = false;
+        Execute(line, wrong, false);
+        pager = paged;
+        resumeAsync = std::move(resume);
+        out.rdbuf(saved);
+        return buffer.str();
+    }
+
+    inline bool CliSession::IsParallel(const std::string& cmd) const
+    {
+        std::string command; // without the filters of the output
+        const auto filtered = detail::OutputFilter::Parse(cmd, command);
+        std::vector<std::string> strs;
+        detail::split(strs, filtered ? command : cmd);
+        if (strs.empty()) return true; // just hit enter
+        return detail::GlobalScopeMenu().ScanParallel(strs) &&
+               detail::FallbackScopeMenu().ScanParallel(strs) &&
+               (!cli.debugCommands || detail::DebugScopeMenu().ScanParallel(strs)) &&
+               current->ScanParallel(strs);
     }
 
     inline void CliSession::Prompt()
     {
-        if (exit) return;
-        out << beforePrompt
-            << current->Prompt()
-            << afterPrompt
-            << "> "
-            << std::flush;
+        if (exit || framed) return;
+        if (detail::AnsiColors())
+        {
+            const std::string& prompt = current->FullPrompt(Color());
+            out.write(prompt.data(), static_cast<std::streamsize>(prompt.size()));
+            out.flush();
+        }
+        else
+            out << beforePrompt
+                << current->Prompt()
+                << afterPrompt
+                << "> "
+                << std::flush;
     }
 
     inline void CliSession::Help() const
     {
         out << "Commands available:\n";
-        globalScopeMenu->MainHelp(out);
+        detail::GlobalScopeMenu().MainHelp(out);
+        detail::FallbackScopeMenu().MainHelp(out);
+        if (cli.debugCommands)
+            detail::DebugScopeMenu().MainHelp(out);
         current -> MainHelp( out );
     }
 
+    inline void CliSession::Help(const std::string& prefix) const
+    {
+        out << "Commands available:\n";
+        detail::GlobalScopeMenu().MainHelp(out, prefix);
+        detail::FallbackScopeMenu().MainHelp(out, prefix);
+        if (cli.debugCommands)
+            detail::DebugScopeMenu().MainHelp(out, prefix);
+        current -> MainHelp( out, prefix );
+    }
+
+    namespace detail
+    {
+        // Write a duration with 3 significant digits (e.g., "12.3us")
+        inline void PrintDuration(std::ostream& out, std::chrono::nanoseconds d)
+        {
+            static const char* const units[] = { "ns", "us", "ms", "s" };
+            double value = static_cast<double>(d.count());
+            std::size_t unit = 0;
+            while (value >= 1000.0 && unit < 3)
+            {
+                value /= 1000.0;
+                ++unit;
+            }
+            std::ostringstream s;
+            s.precision(value < 10.0 ? 2 : value < 100.0 ? 1 : 0);
+            s << std::fixed << value << units[unit];
+            out << std::setw(10) << s.str();
+        }
+    } // namespace detail
+
+    inline void CliSession::ShowStats() const
+    {
+        if (!cli.collectMetrics)
+        {
+            out << "The metrics are disabled\n";
+            return;
+        }
+        const auto stats = cli.Metrics();
+        if (stats.empty())
+        {
+            out << "No commands executed\n";
+            return;
+        }
+        const auto flags = out.flags();
+        out << std::left << std::setw(20) << "command" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "errors"
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max"
+            << std::setw(12) << "output" << '\n';
+        for (const auto& s: stats)
+        {
+            out << std::left << std::setw(20) << s.name << std::right
+                << std::setw(10) << s.Count() << std::setw(10) << s.errors;
+            detail::PrintDuration(out, s.total.Quantile(0.5));
+            detail::PrintDuration(out, s.total.Quantile(0.99));
+            detail::PrintDuration(out, s.total.Max());
+            out << std::setw(12) << s.outputBytes << '\n';
+        }
+        out.flags(flags);
+    }
+
+    inline bool CliSession::ShowTrace(const std::string& format) const
+    {
+        if (format == "chrome")
+            WriteChromeTrace(out, cli.RecentCommands());
+        else if (format == "otel")
+            WriteOtlpTrace(out, cli.RecentCommands());
+        else if (!format.empty())
+            return false;
+        else
+        {
+            const auto records = cli.RecentCommands();
+            if (records.empty())
+            {
+                out << (cli.trace ? "No commands executed\n" : "The trace of the commands is disabled\n");
+                return true;
+            }
+            const auto flags = out.flags();
+            out << std::right << std::setw(8) << "#" << std::setw(8) << "session" << "  "
+                << std::left << std::setw(16) << "menu" << std::right
+                << std::setw(10) << "time" << std::setw(12) << "output" << std::setw(11) << "outcome"
+                << "  " << "command" << '\n';
+            for (const auto& r: records)
+            {
+                out << std::right << std::setw(8) << r.sequence << std::setw(8) << r.session << "  "
+                    << std::left << std::setw(16) << r.menu << std::right;
+                detail::PrintDuration(out, r.duration);
+                out << std::setw(12) << r.outputBytes << std::setw(11) << ToString(r.outcome)
+                    << "  " << r.command << '\n';
+            }
+            out.flags(flags);
+        }
+        return true;
+    }
+
     inline std::vector<std::string> CliSession::GetCompletions(std::string currentLine) const
     {
         // trim_left(currentLine);
         currentLine.erase(currentLine.begin(), std::find_if(currentLine.begin(), currentLine.end(), [](int ch) { return !std::isspace(ch); }));
-        auto v1 = globalScopeMenu->GetCompletions(currentLine);
+
+        // read before computing: a change meanwhile makes the next call compute again
+        const std::size_t completionsVersion = detail::CompletionsVersion();
+        const std::size_t changes = cli.RootMenu()->Changes();
+        const auto startsWithLine = [&currentLine](const std::string& c){ return c.compare(0, currentLine.size(), currentLine) == 0; };
+        auto& cache = completionCache;
+        if (cache.menu == current && cache.completionsVersion == completionsVersion && cache.changes == changes)
+        {
+            if (cache.line == currentLine)
+                return cache.completions;
+            if (cache.prefixed &&
+                currentLine.size() > cache.line.size() &&
+                currentLine.compare(0, cache.line.size(), cache.line) == 0 &&
+                std::none_of(currentLine.begin() + static_cast<std::ptrdiff_t>(cache.line.size()), currentLine.end(), [](int ch) { return std::isspace(ch); }))
+            {
+                // the completions of the longer line are the ones of the line starting with it,
+                // unless it has become the name of a command, that may complete more
+                // (e.g., a menu, or a parent shortcut when nothing is left)
+                std::vector<std::string> narrowed;
+                std::copy_if(cache.completions.begin(), cache.completions.end(), std::back_inserter(narrowed), startsWithLine);
+                if (!narrowed.empty() && !std::binary_search(narrowed.begin(), narrowed.end(), currentLine))
+                {
+                    cache.line = currentLine;
+                    cache.completions = std::move(narrowed);
+                    return cache.completions;
+                }
+            }
+        }
+
+        auto v1 = detail::GlobalScopeMenu().GetCompletions(currentLine);
+        auto v0 = detail::FallbackScopeMenu().GetCompletions(currentLine);
+        v1.insert(v1.end(), std::make_move_iterator(v0.begin()), std::make_move_iterator(v0.end()));
+        if (cli.debugCommands)
+        {
+            auto v2 = detail::DebugScopeMenu().GetCompletions(currentLine);
+            v1.insert(v1.end(), std::make_move_iterator(v2.begin()), std::make_move_iterator(v2.end()));
+        }
         auto v3 = current->GetCompletions(currentLine);
         v1.insert(v1.end(), std::make_move_iterator(v3.begin()), std::make_move_iterator(v3.end()));
 
@@ -957,9 +3532,46 @@ namespace cli
         auto ip = std::unique(v1.begin(), v1.end());
         v1.resize(static_cast<std::size_t>(std::distance(v1.begin(), ip)));
 
+        cache.line = currentLine;
+        cache.menu = current;
+        cache.completionsVersion = completionsVersion;
+        cache.changes = changes;
+        cache.prefixed = std::all_of(v1.begin(), v1.end(), startsWithLine);
+        cache.completions = v1;
         return v1;
     }
 
+    inline std::vector<std::string> CliSession::Suggestions(const std::string& cmd, std::size_t max) const
+    {
+        std::vector<std::string> strs;
+        detail::split(strs, cmd);
+        if (strs.empty() || max == 0)
+            return {};
+        // the closest names are looked for first, since they're often enough
+        std::size_t maxDistance = 0;
+        for (const auto& s: strs)
+            maxDistance = std::max(maxDistance, detail::MaxTypos(s));
+        std::vector<std::pair<std::size_t, std::string>> similar;
+        for (std::size_t distance = 1; distance <= maxDistance && similar.size() < max; ++distance)
+        {
+            similar.clear();
+            detail::GlobalScopeMenu().Similar(strs, 0, {}, distance, similar);
+            detail::FallbackScopeMenu().Similar(strs, 0, {}, distance, similar);
+            if (cli.debugCommands)
+                detail::DebugScopeMenu().Similar(strs, 0, {}, distance, similar);
+            current->Similar(strs, 0, {}, distance, similar);
+            if (std::any_of(similar.begin(), similar.end(), [](const std::pair<std::size_t, std::string>& s){ return s.first == 0; }))
+                return {};
+        }
+        // by distance, then by name
+        std::sort(similar.begin(), similar.end());
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < similar.size() && result.size() < max; ++i)
+            if (std::find(result.begin(), result.end(), similar[i].second) == result.end())
+                result.push_back(std::move(similar[i].second));
+        return result;
+    }
+
     // Menu implementation
 
     template <typename R, typename ... Args>
@@ -30,10 +30,14 @@
 #ifndef CLI_CLIFILESESSION_H
 #define CLI_CLIFILESESSION_H
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 #include <iostream>
 #include <stdexcept> // std::invalid_argument
+#include <vector>
 #include "cli.h" // CliSession
+#include "detail/parallelexecutor.h"
 
 namespace cli
 {
@@ -74,7 +78,152 @@ public:
         }
     }
 
+    struct BatchResult
+    {
+        std::size_t lines = 0; // the lines executed
+        std::size_t errors = 0; // the lines having a wrong command or a command that threw
+        std::size_t firstError = 0; // the number of the first line with an error (starting from 1), or 0
+    };
+
+    /**
+     * @brief Execute the commands of the input stream, without prompts.
+     *
+     * The input is read in large blocks and the output is flushed only at the end,
+     * so that long scripts are not slowed down by the I/O.
+     * The output of the wrong command and exception handlers is preceded by "line N: ".
+     *
+     * @param stopAtFirstError if true, the session stops at the first line with an error
+     * @return the number of lines executed and the errors
+     */
+    BatchResult StartBatch(bool stopAtFirstError = false)
+    {
+        Enter();
+
+        BatchResult result;
+        ReadLines([&](const std::string& line)
+        {
+            ++result.lines;
+            ErrorLocation("line " + std::to_string(result.lines) + ": ");
+            if (!Feed(line))
+                return Error(result, result.lines, stopAtFirstError);
+            return true;
+        });
+        ErrorLocation({});
+
+        if (!exit)
+            Exit();
+        OutStream().flush();
+        return result;
+    }
+
+    /**
+     * @brief Execute the commands of the input stream like StartBatch,
+     * running the consecutive lines marked parallel (see CmdHandler::Parallel)
+     * concurrently on a pool of threads.
+     *
+     * Every parallel line is executed in the current menu of the session
+     * at that point of the script, and its output is written in input order.
+     * A line that is not parallel waits for the previous ones to complete.
+     * When stopAtFirstError is true, the parallel lines following the error
+     * may have been executed, but their output is discarded.
+     *
+     * @param threads the number of threads executing the parallel lines
+     * @param stopAtFirstError if true, the session stops at the first line with an error
+     * @return the number of lines executed and the errors
+     */
+    BatchResult StartParallel(std::size_t threads, bool stopAtFirstError = false)
+    {
+        Enter();
+
+        BatchResult result;
+        bool stop = false;
+        std::size_t lineNumber = 0;
+        const std::size_t maxPending = 4 * std::max<std::size_t>(threads, 1);
+        detail::ParallelExecutor executor(GetCli(), threads);
+
+        // write the output of the oldest parallel line
+        auto collect = [&]()
+        {
+            auto job = executor.Next();
+            if (stop)
+                return; // discarded
+            ++result.lines;
+            OutStream() << job.output;
+            if (!job.ok)
+                stop = !Error(result, result.lines, stopAtFirstError);
+        };
+
+        ReadLines([&](const std::string& line)
+        {
+            ++lineNumber;
+            const auto location = "line " + std::to_string(lineNumber) + ": ";
+            if (IsParallel(line))
+            {
+                while (executor.Pending() >= maxPending)
+                    collect();
+                executor.Submit(Current(), line, location);
+                return !stop;
+            }
+            while (!stop && executor.Pending() > 0)
+                collect();
+            if (stop)
+                return false;
+            ++result.lines;
+            ErrorLocation(location);
+            if (!Feed(line))
+                return Error(result, result.lines, stopAtFirstError);
+            return true;
+        });
+        while (executor.Pending() > 0)
+            collect();
+        ErrorLocation({});
+
+        if (!exit)
+            Exit();
+        OutStream().flush();
+        return result;
+    }
+
 private:
+    // Call f with every line of the input stream (read in large blocks),
+    // until the end of the input, the exit command or f returning false
+    template <typename F>
+    void ReadLines(F f)
+    {
+        std::vector<char> block(64 * 1024);
+        std::string line;
+        bool stop = false;
+        auto* buf = in.rdbuf();
+        while (!exit && !stop)
+        {
+            const auto size = buf->sgetn(block.data(), static_cast<std::streamsize>(block.size()));
+            if (size <= 0)
+                break;
+            const char* first = block.data();
+            const char* const last = first + size;
+            while (!exit && !stop)
+            {
+                const char* eol = std::find(first, last, '\n');
+                line.append(first, eol);
+                if (eol == last)
+                    break; // the line continues in the next block
+                first = eol + 1;
+                stop = !f(line);
+                line.clear();
+            }
+        }
+        if (!exit && !stop && !line.empty())
+            f(line); // the last line has no newline
+    }
+
+    // Record an error at the line given. Returns false if the session must stop.
+    static bool Error(BatchResult& result, std::size_t line, bool stopAtFirstError)
+    {
+        if (result.errors++ == 0)
+            result.firstError = line;
+        return !stopAtFirstError;
+    }
+
     bool exit;
     std::istream& in;
 };
@@ -35,6 +35,7 @@
 #include "cli.h" // CliSession
 #include "detail/keyboard.h"
 #include "detail/screen.h"
+#include "detail/keylog.h"
 
 namespace cli
 {
@@ -69,6 +70,9 @@ public:
         Prompt();
     }
 
+    // Record the keys typed in log, for CliReplaySession (nullptr stops)
+    void Record(std::shared_ptr<std::ostream> log) { detail::RecordKeys(kb, std::move(log)); }
+
 private:
     detail::Keyboard kb;
     detail::CommandProcessor<detail::LocalScreen> ih;
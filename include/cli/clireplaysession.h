@@ -0,0 +1,200 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_CLIREPLAYSESSION_H
+#define CLI_CLIREPLAYSESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept> // std::invalid_argument
+#include <streambuf>
+#include <thread>
+#include <vector>
+#include "cli.h" // CliSession
+#include "loopscheduler.h"
+#include "detail/commandprocessor.h"
+#include "detail/keylog.h"
+#include "detail/telnetscreen.h"
+
+namespace cli
+{
+
+// How fast CliReplaySession feeds the keys of a log
+enum class ReplaySpeed
+{
+    recorded, // with the pauses of the recording
+    fastest // each batch as soon as the previous one has been processed
+};
+
+// The processing of a batch of keys of a log (see CliReplaySession::Replay)
+struct ReplayEvent
+{
+    std::chrono::microseconds offset; // from the start of the recording
+    std::size_t keys; // the number of keys in the batch
+    std::chrono::nanoseconds latency; // the time to process them (asynchronous commands excluded)
+    std::uint64_t outputBytes; // the bytes written meanwhile
+};
+
+namespace detail
+{
+    // The output of a replay: counts the bytes, and passes them to the sink (if any)
+    class CountingBuffer : public std::streambuf
+    {
+    public:
+        explicit CountingBuffer(std::streambuf* _sink) : sink(_sink) {}
+        std::uint64_t Count() const { return count; }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+            ++count;
+            return sink ? sink->sputc(traits_type::to_char_type(c)) : c;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            count += static_cast<std::uint64_t>(n);
+            return sink ? sink->sputn(s, n) : n;
+        }
+
+        int sync() override { return sink ? sink->pubsync() : 0; }
+
+        // tells the position, for the metrics of the commands (see CliSession::OutputPosition)
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+        {
+            if (off != 0 || dir != std::ios_base::cur || (which & std::ios_base::out) == 0)
+                return pos_type(off_type(-1));
+            return pos_type(static_cast<off_type>(count));
+        }
+
+    private:
+        std::streambuf* sink;
+        std::uint64_t count = 0;
+    };
+
+    // An input device whose keys come from a log
+    class ReplayDevice : public InputDevice
+    {
+    public:
+        using InputDevice::InputDevice;
+        void Deliver(KeyEvents keys) { Notify(std::move(keys)); }
+    };
+
+    // The members a CliReplaySession needs before its CliSession
+    struct ReplayBase
+    {
+        explicit ReplayBase(std::ostream* sink) :
+            buffer(sink ? sink->rdbuf() : nullptr),
+            stream(&buffer),
+            device(scheduler)
+        {}
+        LoopScheduler scheduler;
+        CountingBuffer buffer;
+        std::ostream stream;
+        ReplayDevice device;
+    };
+} // namespace detail
+
+/**
+ * @brief A session fed with the keys recorded by a session (see
+ * @c CliLocalTerminalSession::Record and @c BoostAsioCliTelnetServer::RecordSessions),
+ * to benchmark the processing of real traffic against a menu:
+ * the keys go through the line editing, the history and the completion
+ * of the interactive sessions, and the output (escape sequences included)
+ * is counted and written on the sink, if any.
+ * The handlers of the commands run on the thread calling @c Replay.
+ *
+ * @code
+ * std::ifstream log("operator.keys", std::ios::binary);
+ * CliReplaySession session(cli);
+ * for (const auto& e: session.Replay(log))
+ *     histogram.Record(e.latency);
+ * @endcode
+ */
+class CliReplaySession : private detail::ReplayBase, public CliSession
+{
+public:
+    /// @param sink where the output is written, or nullptr to discard it
+    explicit CliReplaySession(Cli& _cli, std::ostream* sink = nullptr, std::size_t historySize = 100) :
+        detail::ReplayBase(sink),
+        CliSession(_cli, stream, historySize, false),
+        processor(*this, device)
+    {
+        ExitAction([this](std::ostream&) noexcept { exited = true; });
+        Enter();
+        Prompt();
+    }
+
+    /**
+     * @brief Feed the keys of a log, until its end or the end of the session.
+     *
+     * @return the latency and the output of each batch of keys
+     * @throw std::invalid_argument if @c log doesn't hold a key log
+     */
+    std::vector<ReplayEvent> Replay(std::istream& log, ReplaySpeed speed = ReplaySpeed::fastest)
+    {
+        detail::KeyLogReader reader(log);
+        if (!reader.Valid()) throw std::invalid_argument("not a key log");
+
+        using Clock = std::chrono::steady_clock;
+        std::vector<ReplayEvent> events;
+        std::chrono::microseconds offset{0};
+        detail::InputDevice::KeyEvents keys;
+        const auto start = Clock::now();
+        while (!exited && reader.Next(offset, keys))
+        {
+            if (speed == ReplaySpeed::recorded)
+                std::this_thread::sleep_until(start + offset);
+            const auto before = buffer.Count();
+            const auto t0 = Clock::now();
+            const std::size_t n = keys.size();
+            device.Deliver(std::move(keys));
+            while (scheduler.PollOne()) {}
+            const auto t1 = Clock::now();
+            events.push_back({ offset, n, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0), buffer.Count() - before });
+            keys.clear();
+        }
+        return events;
+    }
+
+    // True if the session has ended (e.g., with the command exit)
+    bool Exited() const { return exited; }
+
+private:
+    detail::CommandProcessor<detail::TelnetScreen> processor;
+    bool exited = false;
+};
+
+} // namespace cli
+
+#endif // CLI_CLIREPLAYSESSION_H
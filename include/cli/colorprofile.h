@@ -31,6 +31,9 @@
 #define CLI_COLORPROFILE_H_
 
 #include "detail/rang.h"
+#include <initializer_list>
+#include <sstream>
+#include <string>
 
 namespace cli
 {
@@ -45,27 +48,76 @@ enum AfterPrompt { afterPrompt };
 enum BeforeInput { beforeInput };
 enum AfterInput { afterInput };
 
+namespace detail
+{
+
+// The escape sequences of the color profile, rendered once:
+// the manipulators of rang read the environment and check the terminal at every use.
+struct ColorCodes
+{
+    std::string prompt; // before the prompt
+    std::string input; // before the input
+    std::string reset; // after the prompt and the input
+};
+
+template <typename ... T>
+inline std::string RenderColor(T ... manipulators)
+{
+    std::ostringstream os;
+    os << rang::control::forceColor;
+    static_cast<void>(std::initializer_list<int>{ (os << manipulators, 0)... });
+    return os.str();
+}
+
+inline const ColorCodes& Codes()
+{
+    static const ColorCodes codes{
+        RenderColor(rang::fg::green, rang::style::bold),
+        RenderColor(rang::fgB::gray),
+        RenderColor(rang::style::reset)
+    };
+    return codes;
+}
+
+// True if the colors are written as escape sequences.
+// The legacy Windows consoles are colored through the console API instead.
+inline bool AnsiColors()
+{
+#ifdef _WIN32
+    static const bool ansi = IsWindowsVersionOrGreater(10, 0, 0);
+    return ansi;
+#else
+    return true;
+#endif
+}
+
+} // namespace detail
+
 inline std::ostream& operator<<(std::ostream& os, BeforePrompt)
 {
-    if ( Color() ) { os << detail::rang::control::forceColor << detail::rang::fg::green << detail::rang::style::bold; }
-    return os;
+    if ( !Color() ) return os;
+    if ( detail::AnsiColors() ) return os << detail::Codes().prompt;
+    return os << detail::rang::control::forceColor << detail::rang::fg::green << detail::rang::style::bold;
 }
 
 inline std::ostream& operator<<(std::ostream& os, AfterPrompt)
 {
-    os << detail::rang::style::reset;
+    if ( !detail::AnsiColors() ) return os << detail::rang::style::reset;
+    if ( Color() ) os << detail::Codes().reset;
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, BeforeInput)
 {
-    if ( Color() ) { os << detail::rang::control::forceColor << detail::rang::fgB::gray; }
-    return os;
+    if ( !Color() ) return os;
+    if ( detail::AnsiColors() ) return os << detail::Codes().input;
+    return os << detail::rang::control::forceColor << detail::rang::fgB::gray;
 }
 
 inline std::ostream& operator<<(std::ostream& os, AfterInput)
 {
-    os << detail::rang::style::reset;
+    if ( !detail::AnsiColors() ) return os << detail::rang::style::reset;
+    if ( Color() ) os << detail::Codes().reset;
     return os;
 }
 
@@ -0,0 +1,303 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_COMMANDTRACE_H_
+#define CLI_COMMANDTRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cli
+{
+
+// How a command line ended (see CommandRecord)
+enum class CommandOutcome
+{
+    ok,
+    wrong, // no command matches the line
+    exception, // the handler threw
+    async // an asynchronous command, still running when the line was executed
+};
+
+inline const char* ToString(CommandOutcome outcome)
+{
+    switch (outcome)
+    {
+        case CommandOutcome::ok: return "ok";
+        case CommandOutcome::wrong: return "wrong";
+        case CommandOutcome::exception: return "exception";
+        case CommandOutcome::async: return "async";
+    }
+    return "";
+}
+
+// A command line executed by a session (see Cli::TraceCommands)
+struct CommandRecord
+{
+    std::uint64_t sequence; // the number of the command, among the ones of all the sessions
+    std::uint64_t session; // see CliSession::Id
+    std::string menu; // the path of the current menu, from the root (truncated to 32 chars)
+    std::string command; // as typed, filters included (truncated to 96 chars)
+    std::chrono::system_clock::time_point start;
+    std::chrono::nanoseconds duration; // just the synchronous part, for the asynchronous commands
+    std::uint64_t outputBytes; // only counted when the output stream tells its position
+    CommandOutcome outcome;
+};
+
+namespace detail
+{
+
+/**
+ * A fixed size ring of the last commands executed, written by all the sessions.
+ * Like TraceRingBuffer, a writer never blocks and never allocates: it reserves
+ * a slot with an atomic increment, and publishes it with a per-slot sequence number,
+ * so that the readers can skip the slots being overwritten. The texts are copied
+ * in fixed size fields, so a record costs a few tens of nanoseconds.
+ */
+class CommandTraceRing
+{
+public:
+    enum : std::size_t { menuSize = 32, commandSize = 96 };
+
+    explicit CommandTraceRing(std::size_t _capacity) :
+        capacity(std::max<std::size_t>(_capacity, 1)),
+        slots(new Slot[capacity]),
+        steadyOrigin(std::chrono::steady_clock::now()),
+        systemOrigin(std::chrono::system_clock::now())
+    {}
+
+    std::size_t Capacity() const { return capacity; }
+
+    void Record(std::uint64_t session, const char* menu, std::size_t menuLength, const std::string& command,
+                std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration,
+                std::uint64_t outputBytes, CommandOutcome outcome) noexcept
+    {
+        std::uint64_t text[textWords] = {};
+        std::memcpy(text, menu, std::min<std::size_t>(menuLength, menuSize));
+        std::memcpy(reinterpret_cast<char*>(text) + menuSize, command.data(), std::min<std::size_t>(command.size(), commandSize));
+
+        const std::uint64_t seq = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[seq % capacity];
+        slot.seq.store(2*seq + 1, std::memory_order_relaxed); // odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.session.store(session, std::memory_order_relaxed);
+        slot.start.store(static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start - steadyOrigin).count()), std::memory_order_relaxed);
+        slot.duration.store(static_cast<std::int64_t>(duration.count()), std::memory_order_relaxed);
+        slot.outputBytes.store(outputBytes, std::memory_order_relaxed);
+        slot.outcome.store(static_cast<int>(outcome), std::memory_order_relaxed);
+        for (std::size_t i = 0; i < textWords; ++i)
+            slot.text[i].store(text[i], std::memory_order_relaxed);
+        slot.seq.store(2*seq + 2, std::memory_order_release);
+    }
+
+    // Returns the records still in the ring, the oldest first
+    std::vector<CommandRecord> Records() const
+    {
+        std::vector<CommandRecord> result;
+        const std::uint64_t last = head.load(std::memory_order_acquire);
+        const std::uint64_t first = (last > capacity ? last - capacity : 0);
+        for (std::uint64_t seq = first; seq < last; ++seq)
+        {
+            const Slot& slot = slots[seq % capacity];
+            const std::uint64_t before = slot.seq.load(std::memory_order_acquire);
+            if (before != 2*seq + 2)
+                continue; // not yet written or already overwritten
+            std::uint64_t text[textWords];
+            for (std::size_t i = 0; i < textWords; ++i)
+                text[i] = slot.text[i].load(std::memory_order_relaxed);
+            CommandRecord r;
+            r.sequence = seq;
+            r.session = slot.session.load(std::memory_order_relaxed);
+            const std::chrono::nanoseconds start(slot.start.load(std::memory_order_relaxed));
+            r.start = systemOrigin + std::chrono::duration_cast<std::chrono::system_clock::duration>(start);
+            r.duration = std::chrono::nanoseconds(slot.duration.load(std::memory_order_relaxed));
+            r.outputBytes = slot.outputBytes.load(std::memory_order_relaxed);
+            r.outcome = static_cast<CommandOutcome>(slot.outcome.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != before)
+                continue;
+            const char* chars = reinterpret_cast<const char*>(text);
+            r.menu.assign(chars, Length(chars, menuSize));
+            r.command.assign(chars + menuSize, Length(chars + menuSize, commandSize));
+            result.push_back(std::move(r));
+        }
+        return result;
+    }
+
+private:
+    enum : std::size_t { textWords = (menuSize + commandSize) / sizeof(std::uint64_t) };
+
+    static std::size_t Length(const char* s, std::size_t max)
+    {
+        const void* end = std::memchr(s, '\0', max);
+        return end ? static_cast<std::size_t>(static_cast<const char*>(end) - s) : max;
+    }
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<std::uint64_t> session{0};
+        std::atomic<std::int64_t> start{0}; // ns from steadyOrigin
+        std::atomic<std::int64_t> duration{0}; // ns
+        std::atomic<std::uint64_t> outputBytes{0};
+        std::atomic<int> outcome{0};
+        std::atomic<std::uint64_t> text[textWords] = {}; // the menu, then the command
+    };
+
+    const std::size_t capacity;
+    std::unique_ptr<Slot[]> slots;
+    const std::chrono::steady_clock::time_point steadyOrigin;
+    const std::chrono::system_clock::time_point systemOrigin;
+    std::atomic<std::uint64_t> head{0};
+};
+
+inline void WriteJsonString(std::ostream& out, const std::string& s)
+{
+    out << '"';
+    for (const char c: s)
+    {
+        switch (c)
+        {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out << escaped;
+                }
+                else
+                    out << c;
+        }
+    }
+    out << '"';
+}
+
+inline std::int64_t UnixNanos(std::chrono::system_clock::time_point t)
+{
+    return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+}
+
+// Write a number of microseconds given in ns, with 3 decimals
+inline void WriteMicros(std::ostream& out, std::int64_t ns)
+{
+    char s[32];
+    std::snprintf(s, sizeof(s), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+    out << s;
+}
+
+inline void WriteHex(std::ostream& out, std::uint64_t value, int digits)
+{
+    char s[24];
+    std::snprintf(s, sizeof(s), "%0*llx", digits, static_cast<unsigned long long>(value));
+    out << s;
+}
+
+} // namespace detail
+
+/**
+ * @brief Write the records in the Chrome trace event format
+ * (a complete event for each command, with a thread for each session),
+ * that chrome://tracing and Perfetto can load.
+ */
+inline void WriteChromeTrace(std::ostream& out, const std::vector<CommandRecord>& records)
+{
+    out << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        const auto& r = records[i];
+        if (i != 0)
+            out << ',';
+        out << "\n{\"name\":";
+        detail::WriteJsonString(out, r.command);
+        out << ",\"cat\":\"cli\",\"ph\":\"X\",\"ts\":";
+        detail::WriteMicros(out, detail::UnixNanos(r.start));
+        out << ",\"dur\":";
+        detail::WriteMicros(out, static_cast<std::int64_t>(r.duration.count()));
+        out << ",\"pid\":1,\"tid\":" << r.session << ",\"args\":{\"menu\":";
+        detail::WriteJsonString(out, r.menu);
+        out << ",\"output\":" << r.outputBytes << ",\"outcome\":\"" << ToString(r.outcome) << "\"}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+/**
+ * @brief Write the records as OpenTelemetry spans, in the OTLP/JSON encoding
+ * (the body of an ExportTraceServiceRequest): a span for each command,
+ * named by its first word, and a trace for each session.
+ */
+inline void WriteOtlpTrace(std::ostream& out, const std::vector<CommandRecord>& records)
+{
+    out << "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":\"cli\"}}]},"
+           "\"scopeSpans\":[{\"scope\":{\"name\":\"cli\"},\"spans\":[";
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        const auto& r = records[i];
+        if (i != 0)
+            out << ',';
+        const auto begin = r.command.find_first_not_of(' ');
+        const auto end = r.command.find(' ', begin == std::string::npos ? 0 : begin);
+        const std::string name = begin == std::string::npos ? std::string{} : r.command.substr(begin, end - begin);
+        const auto start = detail::UnixNanos(r.start);
+        out << "\n{\"traceId\":\"";
+        detail::WriteHex(out, 0, 16);
+        detail::WriteHex(out, r.session, 16);
+        out << "\",\"spanId\":\"";
+        detail::WriteHex(out, r.sequence + 1, 16);
+        out << "\",\"name\":";
+        detail::WriteJsonString(out, name);
+        out << ",\"kind\":1,\"startTimeUnixNano\":\"" << start
+            << "\",\"endTimeUnixNano\":\"" << start + static_cast<std::int64_t>(r.duration.count())
+            << "\",\"attributes\":[{\"key\":\"cli.command\",\"value\":{\"stringValue\":";
+        detail::WriteJsonString(out, r.command);
+        out << "}},{\"key\":\"cli.menu\",\"value\":{\"stringValue\":";
+        detail::WriteJsonString(out, r.menu);
+        out << "}},{\"key\":\"cli.session\",\"value\":{\"intValue\":\"" << r.session
+            << "\"}},{\"key\":\"cli.output_bytes\",\"value\":{\"intValue\":\"" << r.outputBytes
+            << "\"}},{\"key\":\"cli.outcome\",\"value\":{\"stringValue\":\"" << ToString(r.outcome)
+            << "\"}}],\"status\":{\"code\":" << (r.outcome == CommandOutcome::ok || r.outcome == CommandOutcome::async ? 1 : 2) << "}}";
+    }
+    out << "\n]}]}]}\n";
+}
+
+} // namespace cli
+
+#endif // CLI_COMMANDTRACE_H_
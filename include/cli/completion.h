@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_COMPLETION_H_
+#define CLI_COMPLETION_H_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <utility>
+
+namespace cli
+{
+
+/**
+ * @brief The completion of an asynchronous command.
+ *
+ * A command handler returning a Completion is asynchronous: the command
+ * ends when Complete is called, from any thread.
+ * In the meantime, the interactive sessions keep reading the keyboard
+ * and the scheduler can serve the other sessions.
+ * The other sessions (e.g., CliFileSession) wait for the completion.
+ *
+ * @code
+ * menu->Insert("ping", [](std::ostream&, const std::string& host)
+ * {
+ *     cli::Completion done;
+ *     device.AsyncPing(host, [done](bool ok){
+ *         done.Complete([ok](std::ostream& out){ out << (ok ? "alive\n" : "unreachable\n"); });
+ *     });
+ *     return done;
+ * });
+ * @endcode
+ */
+class Completion
+{
+public:
+    // Writes the output of the command, on the thread of the session
+    using Epilogue = std::function<void(std::ostream&)>;
+
+    Completion() : state(std::make_shared<State>()) {}
+
+    // Ends the command. The epilogue (if any) is called by the session
+    // with its output stream. Only the first call has effect.
+    void Complete(Epilogue epilogue = {}) const
+    {
+        std::function<void()> continuation;
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (state->completed)
+                return;
+            state->completed = true;
+            state->epilogue = std::move(epilogue);
+            continuation = std::move(state->continuation);
+        }
+        state->cv.notify_all();
+        if (continuation)
+            continuation();
+    }
+
+    bool Completed() const
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        return state->completed;
+    }
+
+private:
+    friend class CliSession;
+
+    // f is called once when the command is completed
+    // (directly, if it's already completed), by the thread calling Complete
+    void Then(std::function<void()> f) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (!state->completed)
+            {
+                state->continuation = std::move(f);
+                return;
+            }
+        }
+        f();
+    }
+
+    void Wait() const
+    {
+        std::unique_lock<std::mutex> lock(state->mtx);
+        state->cv.wait(lock, [this](){ return state->completed; });
+    }
+
+    Epilogue TakeEpilogue() const
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        return std::move(state->epilogue);
+    }
+
+    struct State
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool completed = false;
+        Epilogue epilogue;
+        std::function<void()> continuation;
+    };
+    std::shared_ptr<State> state;
+};
+
+} // namespace cli
+
+#endif // CLI_COMPLETION_H_
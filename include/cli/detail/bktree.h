@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_BKTREE_H_
+#define CLI_DETAIL_BKTREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// The edit distance (Levenshtein) between a and b:
+// the number of chars to insert, delete or replace to change a into b,
+// or a number greater than limit, if the distance is.
+// row is the memory for a row of the matrix, reused by the calls.
+inline std::size_t EditDistance(const std::string& a, const std::string& b, std::size_t limit, std::vector<std::size_t>& row)
+{
+    if (a.size() < b.size())
+        return EditDistance(b, a, limit, row);
+    if (a.size() - b.size() > limit)
+        return limit + 1;
+    // the row of the matrix, for the chars of the shorter string
+    row.resize(b.size() + 1);
+    std::iota(row.begin(), row.end(), std::size_t{0});
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        std::size_t diagonal = row[0];
+        row[0] = i + 1;
+        std::size_t least = row[0];
+        for (std::size_t j = 0; j < b.size(); ++j)
+        {
+            const std::size_t above = row[j + 1];
+            row[j + 1] = std::min({ above + 1, row[j] + 1, diagonal + (a[i] == b[j] ? 0u : 1u) });
+            diagonal = above;
+            least = std::min(least, row[j + 1]);
+        }
+        // the values never decrease along the following rows
+        if (least > limit)
+            return limit + 1;
+    }
+    return row.back();
+}
+
+inline std::size_t EditDistance(const std::string& a, const std::string& b)
+{
+    std::vector<std::size_t> row;
+    return EditDistance(a, b, std::max(a.size(), b.size()), row);
+}
+
+// The max edit distance of the words considered similar to word
+inline std::size_t MaxTypos(const std::string& word)
+{
+    return word.size() <= 2 ? 1 : (word.size() <= 5 ? 2 : 3);
+}
+
+// A BK-tree of words, to find the ones close to a word (by EditDistance)
+// without computing the distance from all of them: the children of a node
+// are kept by their distance from it, and the triangle inequality tells
+// the children that can be close to the word.
+// A word can be inserted more times, and is found until it's erased as many times.
+// The nodes are in a vector (each with its first child and next sibling),
+// so that a copy of the tree costs a single allocation plus the words.
+class BkTree
+{
+public:
+    void Insert(const std::string& word)
+    {
+        bool created = false;
+        const std::size_t n = Lookup(word, &created);
+        if (nodes[n].count++ > 0)
+            return;
+        ++live;
+        if (!created)
+            --dead; // the node of a word erased before
+
+    }
+
+    void Erase(const std::string& word)
+    {
+        const std::size_t n = Lookup(word, nullptr);
+        if (n == None() || nodes[n].count == 0)
+            return;
+        if (--nodes[n].count > 0)
+            return;
+        --live;
+        ++dead;
+        // the nodes of the erased words are dropped when they're the most
+        if (dead > live)
+            Rebuild();
+    }
+
+    std::size_t Size() const { return live; }
+
+    // Appends to result the words within maxDistance from word, with their distance
+    void Find(const std::string& word, std::size_t maxDistance, std::vector<std::pair<std::size_t, std::string>>& result) const
+    {
+        if (nodes.empty())
+            return;
+        std::vector<std::size_t> row;
+        std::vector<std::size_t> pending{ 0 };
+        while (!pending.empty())
+        {
+            const Node& node = nodes[pending.back()];
+            pending.pop_back();
+            // the distance is needed up to the one of the farthest child that can be close
+            const std::size_t d = EditDistance(word, node.word, node.farthest + maxDistance, row);
+            if (d <= maxDistance && node.count > 0)
+                result.emplace_back(d, node.word);
+            for (std::size_t c = node.child; c != None(); c = nodes[c].sibling)
+                if (nodes[c].distance + maxDistance >= d && nodes[c].distance <= d + maxDistance)
+                    pending.push_back(c);
+        }
+    }
+
+private:
+    static constexpr std::size_t None() { return static_cast<std::size_t>(-1); }
+
+    struct Node
+    {
+        std::string word;
+        std::size_t count; // 0 when erased
+        std::size_t distance; // from the parent
+        std::size_t farthest; // the max distance of the children
+        std::size_t child;
+        std::size_t sibling;
+    };
+
+    // The node of word: if it's not in the tree, a new one (setting *created)
+    // or None() when created is null
+    std::size_t Lookup(const std::string& word, bool* created)
+    {
+        if (nodes.empty())
+        {
+            if (created == nullptr)
+                return None();
+            *created = true;
+            nodes.push_back(Node{ word, 0, 0, 0, None(), None() });
+            return 0;
+        }
+        std::vector<std::size_t> row;
+        std::size_t n = 0;
+        for (;;)
+        {
+            const std::size_t d = EditDistance(word, nodes[n].word, std::max(word.size(), nodes[n].word.size()), row);
+            if (d == 0)
+                return n;
+            std::size_t c = nodes[n].child;
+            while (c != None() && nodes[c].distance != d)
+                c = nodes[c].sibling;
+            if (c == None())
+            {
+                if (created == nullptr)
+                    return None();
+                *created = true;
+                nodes.push_back(Node{ word, 0, d, 0, None(), nodes[n].child });
+                nodes[n].child = nodes.size() - 1;
+                nodes[n].farthest = std::max(nodes[n].farthest, d);
+                return nodes.size() - 1;
+            }
+            n = c;
+        }
+    }
+
+    void Rebuild()
+    {
+        std::vector<Node> old;
+        old.swap(nodes);
+        live = 0;
+        dead = 0;
+        for (const auto& node: old)
+            for (std::size_t i = 0; i < node.count; ++i)
+                Insert(node.word);
+    }
+
+    std::vector<Node> nodes; // nodes[0] is the root
+    std::size_t live = 0; // the words in the tree
+    std::size_t dead = 0; // the nodes of the words erased
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_BKTREE_H_
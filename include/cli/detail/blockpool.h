@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_BLOCKPOOL_H_
+#define CLI_DETAIL_BLOCKPOOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// Keeps the memory of freed objects of one size, to give it to the next ones.
+// The size is fixed by the first allocation: the other sizes go to
+// the global allocator.
+class BlockPool
+{
+public:
+    explicit BlockPool(std::size_t _maxFree) : maxFree(_maxFree)
+    {
+        freeBlocks.reserve(maxFree);
+    }
+
+    ~BlockPool() noexcept
+    {
+        for (void* b: freeBlocks)
+            ::operator delete(b);
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* Allocate(std::size_t size)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (blockSize == 0)
+                blockSize = size;
+            if (size == blockSize && !freeBlocks.empty())
+            {
+                void* b = freeBlocks.back();
+                freeBlocks.pop_back();
+                ++reused;
+                return b;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void Deallocate(void* p, std::size_t size) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            // maxFree is reserved: push_back does not allocate
+            if (size == blockSize && freeBlocks.size() < maxFree)
+            {
+                freeBlocks.push_back(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    // The number of freed blocks kept (0 disables the pool)
+    void MaxFree(std::size_t n)
+    {
+        std::vector<void*> exceeding;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            while (freeBlocks.size() > n)
+            {
+                exceeding.push_back(freeBlocks.back());
+                freeBlocks.pop_back();
+            }
+            freeBlocks.reserve(n);
+            maxFree = n;
+        }
+        for (void* b: exceeding)
+            ::operator delete(b);
+    }
+
+    std::size_t Free() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return freeBlocks.size();
+    }
+
+    // The number of allocations served by a freed block
+    std::size_t Reused() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return reused;
+    }
+
+private:
+    mutable std::mutex mtx;
+    std::size_t maxFree;
+    std::size_t blockSize = 0;
+    std::size_t reused = 0;
+    std::vector<void*> freeBlocks;
+};
+
+// Standard allocator on a BlockPool, to use with std::allocate_shared.
+// Every copy shares the pool, so that it outlives the objects.
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<BlockPool> _pool) : pool(std::move(_pool)) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : pool(other.pool) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(pool->Allocate(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) noexcept { pool->Deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept { return pool == other.pool; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const noexcept { return pool != other.pool; }
+
+private:
+    template <typename> friend class PoolAllocator;
+    std::shared_ptr<BlockPool> pool;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_BLOCKPOOL_H_
@@ -30,8 +30,13 @@
 #ifndef CLI_DETAIL_COMMANDPROCESSOR_H_
 #define CLI_DETAIL_COMMANDPROCESSOR_H_
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 #include "terminal.h"
 #include "inputdevice.h"
 #include "../cli.h" // CliSession
@@ -67,20 +72,93 @@ public:
         terminal(session.OutStream()),
         kb(_kb)
     {
-        kb.Register( [this](auto key){ this->Keypressed(key); } );
+        kb.Register( [this](const auto& keys){ this->Keypressed(keys); } );
+        // the asynchronous commands are ended by a task of the keyboard scheduler,
+        // if this object still exists
+        std::weak_ptr<CommandProcessor*> self = alive;
+        Scheduler& scheduler = kb.EventScheduler();
+        session.ResumeAsync( [self, &scheduler]()
+        {
+            scheduler.Post( Priority::interactive, [self]()
+            {
+                if (auto p = self.lock())
+                    (*p)->EndAsync();
+            });
+        });
     }
 
+    ~CommandProcessor() { session.ResumeAsync({}); }
+
+    // disable value semantics
+    CommandProcessor(const CommandProcessor&) = delete;
+    CommandProcessor& operator = (const CommandProcessor&) = delete;
+
+    /**
+     * @brief Set the max length of the command line typed by the user.
+     *
+     * @param length The max number of chars (0 means no limit).
+     */
+    void MaxLineLength(std::size_t length) { terminal.MaxLineLength(length); }
+
 private:
 
     /**
-     * @brief Handle a keypress event.
+     * @brief Handle a batch of keypress events.
      *
-     * @param k The key that was pressed.
+     * The echo of the keys is flushed once at the end of the batch,
+     * or before a command is processed.
+     *
+     * @param keys The keys that were pressed, in order.
      */
-    void Keypressed(std::pair<KeyType, char> k)
+    void Keypressed(const InputDevice::KeyEvents& keys)
     {
-        const std::pair<Symbol,std::string> s = terminal.Keypressed(k);
-        NewCommand(s);
+        terminal.Echo(!session.Framed());
+        for (auto i = keys.begin(); i != keys.end(); ++i)
+        {
+            const auto& k = *i;
+            if (session.Watching())
+            {
+                // any key ends the watch
+                EndWatch();
+                continue;
+            }
+            if (session.Paging())
+            {
+                Page(k);
+                continue;
+            }
+            if (k.first == KeyType::interrupt && session.Running())
+            {
+                // the command completes at once, and the keys held are dropped
+                held.clear();
+                session.Cancel();
+                continue;
+            }
+            if (session.Running() && Hold(k))
+            {
+                const auto interrupt = std::find_if(i, keys.end(), [](const InputDevice::KeyEvent& e){ return e.first == KeyType::interrupt; });
+                if (interrupt != keys.end())
+                {
+                    held.clear();
+                    i = interrupt;
+                    session.Cancel();
+                    continue;
+                }
+                // the rest is handled when the command completes
+                held.insert(held.end(), i, keys.end());
+                break;
+            }
+            if (searching && Search(k))
+                continue;
+            const std::pair<Symbol,std::string> s = terminal.Keypressed(k);
+            if (s.first == Symbol::nothing)
+                continue;
+            terminal.Flush();
+            NewCommand(s);
+            if (s.first == Symbol::eof)
+                return;
+        }
+        terminal.Flush();
     }
 
     /**
@@ -105,10 +183,28 @@ private:
             {
                 kb.DeactivateInput();
                 session.Feed(s.second);
-                session.Prompt();
+                terminal.Echo(!session.Framed()); // the command may have changed the mode
+                if (session.Watching())
+                    StartWatch();
+                else if (!session.Running() && !session.Paging())
+                {
+                    if (session.Cancelled())
+                        Cancelled();
+                    session.Prompt();
+                }
                 kb.ActivateInput();
                 break;
             }
+            case Symbol::interrupt:
+            {
+                // like a shell: the line is dropped, with the output not sent yet
+                session.DiscardOutput();
+                if (!session.Framed())
+                    session.OutStream() << "^C\r\n";
+                session.Prompt();
+                terminal.ResetCursor();
+                break;
+            }
             case Symbol::down:
             {
                 terminal.SetLine(session.NextCmd());
@@ -133,16 +229,17 @@ private:
                     break;
                 }
 
-                auto commonPrefix = CommonPrefix(completions);
-                if (commonPrefix.size() > line.size())
+                const auto commonPrefixLength = CommonPrefixLength(completions);
+                if (commonPrefixLength > line.size())
                 {
-                    terminal.SetLine(commonPrefix);
+                    terminal.SetLine(completions[0].substr(0, commonPrefixLength));
                     break;
                 }
-                session.OutStream() << '\n';
-                std::string items;
-                std::for_each( completions.begin(), completions.end(), [&items](auto& cmd){ items += '\t' + cmd; } );
-                session.OutStream() << items << '\n';
+                auto& out = session.OutStream();
+                out << '\n';
+                for (const auto& cmd: completions)
+                    out << '\t' << cmd;
+                out << '\n';
                 session.Prompt();
                 terminal.ResetCursor();
                 terminal.SetLine( line );
@@ -157,13 +254,270 @@ private:
                 terminal.SetLine(currentLine);
                 break;
             }
+            case Symbol::search:
+            {
+                searching = true;
+                savedLine = terminal.GetLine();
+                query.clear();
+                match.clear();
+                matchPos = 0;
+                failed = false;
+                ShowSearch();
+                break;
+            }
         }
 
     }
 
+    /**
+     * @brief Handle a key while the pager waits for the user, like more(1):
+     * space shows the next screen, enter (or down) the next line,
+     * and q (or ctrl+C, or ctrl+D) ends the command.
+     *
+     * @param k The key pressed.
+     */
+    void Page(const InputDevice::KeyEvent& k)
+    {
+        switch (k.first)
+        {
+            case KeyType::ascii:
+                if (k.second == ' ')
+                    session.PageMore(session.PageLines());
+                else if (k.second == 'q' || k.second == 'Q')
+                    session.EndPaging();
+                break;
+            case KeyType::ret:
+            case KeyType::down:
+                session.PageMore(1);
+                break;
+            case KeyType::interrupt:
+            case KeyType::eof:
+                session.EndPaging();
+                break;
+            default:
+                break;
+        }
+        if (!session.Paging())
+            session.Prompt();
+    }
+
+    /**
+     * @brief Start showing the command line watched (see CliSession::Watch), like watch(1):
+     * a header on the top row of the screen cleared, and the output below.
+     */
+    void StartWatch()
+    {
+        SCREEN::Clear(session.OutStream());
+        shown.clear();
+        Refresh(++watchGeneration);
+    }
+
+    /**
+     * @brief Execute the command line watched and show its output, rewriting
+     * only the rows that changed, and schedule the next execution.
+     * The output is cut to fit the screen.
+     *
+     * @param generation The watch that scheduled the refresh (a refresh of the previous ones is ignored).
+     */
+    void Refresh(std::size_t generation)
+    {
+        if (!session.Watching() || generation != watchGeneration)
+            return;
+
+        std::vector<std::string> rows;
+        std::ostringstream header;
+        header << "Every " << std::chrono::duration<double>(session.WatchInterval()).count() << "s: " << session.WatchLine();
+        rows.push_back(header.str());
+        std::istringstream output(session.WatchOutput());
+        const std::size_t height = session.WindowHeight() > 1 ? session.WindowHeight() - 1u : 23u; // a row for the cursor
+        for (std::string row; rows.size() < height && std::getline(output, row); )
+            rows.push_back(std::move(row));
+        if (session.WindowWidth() > 0)
+            for (auto& row: rows)
+                if (row.size() > session.WindowWidth())
+                    row.resize(session.WindowWidth());
+        if (!session.Watching())
+            return; // the command ended the watch
+
+        auto& out = session.OutStream();
+        auto erase = [&out](std::size_t n)
+        {
+            std::string buffer;
+            SCREEN::EraseToEnd(buffer, n);
+            out << buffer;
+        };
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            if (i < shown.size() && shown[i] == rows[i])
+                continue;
+            SCREEN::CursorTo(out, i);
+            out << rows[i];
+            if (i < shown.size() && shown[i].size() > rows[i].size())
+                erase(shown[i].size() - rows[i].size());
+        }
+        for (std::size_t i = rows.size(); i < shown.size(); ++i)
+        {
+            SCREEN::CursorTo(out, i);
+            erase(shown[i].size());
+        }
+        shown.swap(rows);
+        SCREEN::CursorTo(out, shown.size());
+        out.flush();
+
+        // the next execution, by a task of the keyboard scheduler if this object still exists
+        std::weak_ptr<CommandProcessor*> self = alive;
+        kb.EventScheduler().PostAfter(session.WatchInterval(), [self, generation]()
+        {
+            if (auto p = self.lock())
+                (*p)->Refresh(generation);
+        });
+    }
+
+    // Stop watching the command line, and show the prompt below its output
+    void EndWatch()
+    {
+        session.EndWatch();
+        ++watchGeneration;
+        shown.clear();
+        session.Prompt();
+    }
+
+    /**
+     * @brief While an asynchronous command runs, the line can be edited,
+     * but the keys that would need the prompt (e.g., return) are held
+     * until the command completes, with the keys following them.
+     *
+     * @param k The key that was pressed.
+     * @return true if the key must be held.
+     */
+    bool Hold(std::pair<KeyType, char> k) const
+    {
+        if (!held.empty())
+            return true;
+        switch (k.first)
+        {
+            case KeyType::ascii: return k.second == '\t';
+            case KeyType::backspace:
+            case KeyType::canc:
+            case KeyType::left:
+            case KeyType::right:
+            case KeyType::home:
+            case KeyType::end:
+            case KeyType::ignored: return false;
+            default: return true;
+        }
+    }
+
+    // The asynchronous command is completed: write its output and the prompt
+    // after the line typed in the meantime, and handle the keys held
+    void EndAsync()
+    {
+        const auto line = terminal.GetLine();
+        if (session.Cancelled())
+            Cancelled();
+        else
+            terminal.SetLine({});
+        session.EndAsync();
+        session.Prompt();
+        terminal.ResetCursor();
+        terminal.SetLine(line);
+        InputDevice::KeyEvents keys;
+        keys.swap(held);
+        if (!keys.empty())
+            Keypressed(keys);
+    }
+
+    // The command has been cancelled: its output not sent yet is dropped,
+    // and the prompt goes on a new line (the screen may have lost the end of the line).
+    // In framed mode, the frame of the command tells it.
+    void Cancelled()
+    {
+        if (session.Framed())
+            return;
+        session.DiscardOutput();
+        session.OutStream() << (session.TimedOut() ? "\r\n" : "^C\r\n");
+    }
+
+    /**
+     * @brief Handle a key pressed in the reverse search mode (started by ctrl+R).
+     *
+     * The chars typed are added to the string to search, ctrl+R looks for
+     * an older match, ctrl+D restores the line as it was before the search.
+     * The other keys leave the search mode with the command found in the line,
+     * and then are handled as usual.
+     *
+     * @param k The key that was pressed.
+     * @return true if the key has been handled.
+     */
+    bool Search(std::pair<KeyType, char> k)
+    {
+        switch (k.first)
+        {
+            case KeyType::ascii:
+                if (k.second == '\t')
+                    break;
+                query += k.second;
+                Find(matchPos);
+                return true;
+            case KeyType::backspace:
+                if (!query.empty())
+                    query.pop_back();
+                Find(0);
+                return true;
+            case KeyType::search:
+                Find(failed ? matchPos : matchPos + 1);
+                return true;
+            case KeyType::eof:
+                searching = false;
+                terminal.SetLine(savedLine);
+                return true;
+            case KeyType::interrupt:
+                searching = false;
+                return false;
+            default:
+                break;
+        }
+        searching = false;
+        terminal.SetLine(match);
+        return false;
+    }
+
+    void Find(std::size_t from)
+    {
+        std::size_t pos = from;
+        std::string result;
+        failed = !session.SearchHistory(query, pos, result);
+        if (!failed)
+        {
+            matchPos = pos;
+            match = result;
+        }
+        ShowSearch();
+    }
+
+    void ShowSearch()
+    {
+        terminal.SetLine(std::string(failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`") + query + "': " + match);
+    }
+
     CliSession& session;
     Terminal<SCREEN> terminal;
     InputDevice& kb;
+    std::shared_ptr<CommandProcessor*> alive = std::make_shared<CommandProcessor*>(this);
+    InputDevice::KeyEvents held; // the keys typed while an asynchronous command runs
+
+    // watch state
+    std::size_t watchGeneration = 0; // incremented by each watch (see Refresh)
+    std::vector<std::string> shown; // the rows of the screen shown by the watch
+
+    // reverse search state
+    bool searching = false;
+    bool failed = false; // the last search found nothing
+    std::string savedLine; // the line before the search
+    std::string query;
+    std::string match;
+    std::size_t matchPos = 0; // see CliSession::SearchHistory
+
 };
 
 } // namespace detail
@@ -31,6 +31,9 @@
 #define CLI_DETAIL_COMMONPREFIX_H_
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -40,28 +43,40 @@ namespace cli
 namespace detail
 {
 
-inline std::string CommonPrefix(const std::vector<std::string>& v)
+// Returns the length of the common prefix of the n chars starting from s1 and s2.
+// Compares a machine word at a time, then the remaining chars one by one.
+inline std::size_t CommonPrefixLength(const char* s1, const char* s2, std::size_t n)
 {
-    assert(!v.empty());
-    std::string prefix;
-
-    // find the shorter string
-    auto smin = std::min_element(v.begin(), v.end(),
-                [] (const std::string& s1, const std::string& s2)
-                {
-                    return s1.size() < s2.size();
-                });
-
-    for (std::size_t i = 0; i < smin->size(); ++i)
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= n; i += sizeof(std::uint64_t))
     {
-        // check if i-th element is equal in each input string
-        const char c = (*smin)[i];
-        for (auto& x: v)
-            if (x[i] != c) return prefix;
-        prefix += c;
+        std::uint64_t w1;
+        std::uint64_t w2;
+        std::memcpy(&w1, s1 + i, sizeof(w1));
+        std::memcpy(&w2, s2 + i, sizeof(w2));
+        if (w1 != w2)
+            break;
     }
+    while (i < n && s1[i] == s2[i])
+        ++i;
+    return i;
+}
+
+// Returns the length of the longest prefix shared by all the strings of v.
+inline std::size_t CommonPrefixLength(const std::vector<std::string>& v)
+{
+    assert(!v.empty());
+    const std::string& first = v.front();
+    std::size_t len = first.size();
+    for (auto i = std::next(v.begin()); i != v.end() && len > 0; ++i)
+        len = CommonPrefixLength(first.data(), i->data(), std::min(len, i->size()));
+    return len;
+}
 
-    return prefix;
+inline std::string CommonPrefix(const std::vector<std::string>& v)
+{
+    assert(!v.empty());
+    return v.front().substr(0, CommonPrefixLength(v));
 }
 
 } // namespace detail
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_CONSOLEKEYDECODER_H_
+#define CLI_DETAIL_CONSOLEKEYDECODER_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include "inputdevice.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// The fields of a KEY_EVENT_RECORD of the windows console used by ConsoleKeyDecoder,
+// so that the decoding doesn't depend on windows.h
+struct ConsoleKeyEvent
+{
+    bool keyDown;
+    unsigned short repeatCount;
+    unsigned short virtualKeyCode;
+    char16_t unicodeChar; // 0 for the keys without a char
+};
+
+// The virtual key codes of the windows console (VK_UP, ...) decoded by ConsoleKeyDecoder
+enum ConsoleVirtualKey : unsigned short
+{
+    consolePrior = 0x21,
+    consoleNext = 0x22,
+    consoleEnd = 0x23,
+    consoleHome = 0x24,
+    consoleLeft = 0x25,
+    consoleUp = 0x26,
+    consoleRight = 0x27,
+    consoleDown = 0x28,
+    consoleInsert = 0x2D,
+    consoleDelete = 0x2E
+};
+
+// Decodes the key events of the windows console (read by ReadConsoleInputW)
+// into the key events of the library, with the chars in the encoding
+// of the console as _getch gave them.
+class ConsoleKeyDecoder
+{
+public:
+    // Converts a char of one or two UTF-16 units (a surrogate pair) into bytes
+    using Encoder = std::function<std::string(const char16_t* units, std::size_t length)>;
+
+    // By default the chars are encoded in UTF-8
+    explicit ConsoleKeyDecoder(Encoder _encoder = Utf8) : encoder(std::move(_encoder)) {}
+
+    // Appends to keys the key events of e (none for a key up)
+    void Decode(const ConsoleKeyEvent& e, InputDevice::KeyEvents& keys)
+    {
+        if (!e.keyDown)
+            return;
+        for (unsigned short i = 0; i < e.repeatCount; ++i)
+            DecodeKey(e.virtualKeyCode, e.unicodeChar, keys);
+    }
+
+    static std::string Utf8(const char16_t* units, std::size_t length)
+    {
+        char32_t cp = units[0];
+        if (length == 2)
+            cp = 0x10000 + ((static_cast<char32_t>(units[0]) - 0xD800) << 10) + (static_cast<char32_t>(units[1]) - 0xDC00);
+        std::string bytes;
+        if (cp < 0x80)
+            bytes += static_cast<char>(cp);
+        else if (cp < 0x800)
+        {
+            bytes += static_cast<char>(0xC0 | (cp >> 6));
+            bytes += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            bytes += static_cast<char>(0xE0 | (cp >> 12));
+            bytes += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            bytes += static_cast<char>(0xF0 | (cp >> 18));
+            bytes += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            bytes += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return bytes;
+    }
+
+private:
+
+    void DecodeKey(unsigned short virtualKey, char16_t c, InputDevice::KeyEvents& keys)
+    {
+        if (c == 0)
+        {
+            // a key without a char: the keys _getch returned after 224
+            switch (virtualKey)
+            {
+                case consoleUp: keys.push_back(std::make_pair(KeyType::up, ' ')); break;
+                case consoleDown: keys.push_back(std::make_pair(KeyType::down, ' ')); break;
+                case consoleLeft: keys.push_back(std::make_pair(KeyType::left, ' ')); break;
+                case consoleRight: keys.push_back(std::make_pair(KeyType::right, ' ')); break;
+                case consoleHome: keys.push_back(std::make_pair(KeyType::home, ' ')); break;
+                case consoleEnd: keys.push_back(std::make_pair(KeyType::end, ' ')); break;
+                case consoleDelete: keys.push_back(std::make_pair(KeyType::canc, ' ')); break;
+                case consoleInsert:
+                case consolePrior:
+                case consoleNext: keys.push_back(std::make_pair(KeyType::ignored, ' ')); break;
+                default: break; // shift, ctrl, alt, ...
+            }
+            return;
+        }
+        if (c >= 0xD800 && c <= 0xDBFF)
+        {
+            highSurrogate = c; // the char ends with the next key
+            return;
+        }
+        switch (c)
+        {
+            case 4:  // EOT ie CTRL-D
+            case 26: // CTRL-Z
+                keys.push_back(std::make_pair(KeyType::eof, ' ')); break;
+            case 3: keys.push_back(std::make_pair(KeyType::interrupt, ' ')); break; // CTRL-C
+            case 8: keys.push_back(std::make_pair(KeyType::backspace, '\b')); break;
+            case 12: keys.push_back(std::make_pair(KeyType::clear, ' ')); break; // CTRL-L
+            case 18: keys.push_back(std::make_pair(KeyType::search, ' ')); break; // CTRL-R
+            case 13: keys.push_back(std::make_pair(KeyType::ret, '\r')); break;
+            default:
+                if (c < 0x80)
+                    keys.push_back(std::make_pair(KeyType::ascii, static_cast<char>(c)));
+                else if (c < 0xDC00 || c > 0xDFFF || highSurrogate != 0) // not the end of a char whose start has been lost
+                {
+                    char16_t units[2] = { c, 0 };
+                    std::size_t length = 1;
+                    if (c >= 0xDC00 && c <= 0xDFFF)
+                    {
+                        units[0] = highSurrogate;
+                        units[1] = c;
+                        length = 2;
+                    }
+                    for (char b: encoder(units, length))
+                        keys.push_back(std::make_pair(KeyType::ascii, b));
+                }
+        }
+        highSurrogate = 0;
+    }
+
+    const Encoder encoder;
+    char16_t highSurrogate = 0;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_CONSOLEKEYDECODER_H_
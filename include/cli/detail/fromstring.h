@@ -32,6 +32,14 @@
 
 // #define CLI_FROMSTRING_USE_BOOST
 
+// try_from_string converts a string into a value of type T,
+// returning false (without throwing) if the string doesn't represent a T.
+// from_string does the same, but throws bad_conversion on failure.
+
+#include <exception>
+#include <string>
+#include <typeinfo>
+
 #ifdef CLI_FROMSTRING_USE_BOOST
 
 #include <boost/lexical_cast.hpp>
@@ -42,10 +50,9 @@ namespace detail
 {
 
 template <typename T>
-inline
-T from_string(const std::string& s)
+inline bool try_from_string(const std::string& s, T& result)
 {
-    return boost::lexical_cast<T>(s);
+    return boost::conversion::try_lexical_convert(s, result);
 }
 
 } // namespace detail
@@ -53,231 +60,199 @@ T from_string(const std::string& s)
 
 #else
 
-#include <exception>
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
 #include <limits>
-#include <string>
 #include <sstream>
+#include <type_traits>
 
 namespace cli
 {
 
     namespace detail
     {
-        class bad_conversion : public std::bad_cast
-        {
-            public:
-                const char* what() const noexcept override {
-                    return "bad from_string conversion: "
-                        "source string value could not be interpreted as target";
-                }
-        };
-
-template <typename T>
-inline T from_string(const std::string& s);
 
-template <>
-inline std::string from_string(const std::string& s)
+inline bool try_from_string(const std::string& s, std::string& result)
 {
-    return s;
+    result = s;
+    return true;
 }
 
-template <>
-inline std::nullptr_t from_string(const std::string& /*s*/)
+inline bool try_from_string(const std::string& /*s*/, std::nullptr_t& result)
 {
-    return nullptr;
+    result = nullptr;
+    return true;
 }
 
 namespace detail
 {
 
 template <typename T>
-inline T unsigned_digits_from_string(const std::string& s)
+inline bool unsigned_digits_from_string(const char* first, const char* last, T& result)
 {
-    if (s.empty())
-        throw bad_conversion();
-    T result = 0;
-    for (char c: s)
+    if (first == last)
+        return false;
+    T value = 0;
+    for (; first != last; ++first)
     {
-        if (!std::isdigit(c))
-            throw bad_conversion();
+        const char c = *first;
+        if (c < '0' || c > '9')
+            return false;
         const T digit = static_cast<T>( c - '0' );
-        const T tmp = (result * 10) + digit;
-        if (result != ((tmp-digit)/10) || (tmp < result))
-            throw bad_conversion();
-        result = tmp;
+        if (value > (std::numeric_limits<T>::max() - digit) / 10)
+            return false;
+        value = static_cast<T>( value * 10 + digit );
     }
-    return result;
+    result = value;
+    return true;
 }
 
 template <typename T>
-inline T unsigned_from_string(std::string s)
+inline bool unsigned_from_string(const std::string& s, T& result)
 {
-    if (s.empty())
-        throw bad_conversion();
-    if (s[0] == '+')
-    {
-        s = s.substr(1);
-    }
-    return unsigned_digits_from_string<T>(s);
+    const char* first = s.data();
+    const char* last = first + s.size();
+    if (first != last && *first == '+')
+        ++first;
+    return unsigned_digits_from_string(first, last, result);
 }
 
 template <typename T>
-inline T signed_from_string(std::string s)
+inline bool signed_from_string(const std::string& s, T& result)
 {
-    if (s.empty())
-        throw bad_conversion();
     using U = std::make_unsigned_t<T>;
-    if (s[0] == '-')
-    {
-        s = s.substr(1);
-        const U val = unsigned_digits_from_string<U>(s);
-        auto min = std::numeric_limits<T>::min(); // this to avoid overflow warnings. Please NOTE: const auto produces warning!
-        if ( val > static_cast<U>( - min ) )
-            throw bad_conversion();
-        return (- static_cast<T>(val));
-    }
-    else if (s[0] == '+')
+    const char* first = s.data();
+    const char* last = first + s.size();
+    const bool negative = (first != last && *first == '-');
+    if (first != last && (*first == '-' || *first == '+'))
+        ++first;
+    U val = 0;
+    if (!unsigned_digits_from_string(first, last, val))
+        return false;
+    const U maxVal = static_cast<U>( std::numeric_limits<T>::max() );
+    if (negative)
     {
-        s = s.substr(1);
+        // |min| == max + 1 in two's complement
+        if (val > maxVal + 1u)
+            return false;
+        result = (val == maxVal + 1u) ? std::numeric_limits<T>::min() : static_cast<T>( - static_cast<T>(val) );
+        return true;
     }
-    const U val = unsigned_digits_from_string<U>(s);
-    if (val > static_cast<U>( std::numeric_limits<T>::max() ))
-        throw bad_conversion();
-    return static_cast<T>(val);
+    if (val > maxVal)
+        return false;
+    result = static_cast<T>(val);
+    return true;
 }
 
-} // namespace detail
-
-// signed
+inline float strto(const char* s, char** end, float) { return std::strtof(s, end); }
+inline double strto(const char* s, char** end, double) { return std::strtod(s, end); }
+inline long double strto(const char* s, char** end, long double) { return std::strtold(s, end); }
 
-template <> inline signed char 
-from_string(const std::string& s) { return detail::signed_from_string<signed char>(s); }
-
-template <> inline short int 
-from_string(const std::string& s) { return detail::signed_from_string<short int>(s); }
+template <typename T>
+inline bool floating_from_string(const std::string& s, T& result)
+{
+    // strtod would skip the leading spaces
+    if (s.empty() || std::isspace(static_cast<unsigned char>(s[0])))
+        return false;
+    const char* first = s.c_str();
+    char* end = nullptr;
+    const int savedErrno = errno;
+    errno = 0;
+    const T value = strto(first, &end, T{});
+    const bool outOfRange = (errno == ERANGE);
+    errno = savedErrno;
+    if (outOfRange || end != first + s.size())
+        return false;
+    result = value;
+    return true;
+}
 
-template <> inline int
-from_string(const std::string& s) { return detail::signed_from_string<int>(s); }
+} // namespace detail
 
-template <> inline long int
-from_string(const std::string& s) { return detail::signed_from_string<long int>(s); }
+// signed
 
-template <> inline long long int
-from_string(const std::string& s) { return detail::signed_from_string<long long int>(s); }
+inline bool try_from_string(const std::string& s, signed char& result) { return detail::signed_from_string(s, result); }
+inline bool try_from_string(const std::string& s, short int& result) { return detail::signed_from_string(s, result); }
+inline bool try_from_string(const std::string& s, int& result) { return detail::signed_from_string(s, result); }
+inline bool try_from_string(const std::string& s, long int& result) { return detail::signed_from_string(s, result); }
+inline bool try_from_string(const std::string& s, long long int& result) { return detail::signed_from_string(s, result); }
 
 // unsigned
 
-template <> inline unsigned char
-from_string(const std::string& s) { return detail::unsigned_from_string<unsigned char>(s); }
-
-template <> inline unsigned short int
-from_string(const std::string& s) { return detail::unsigned_from_string<unsigned short int>(s); }
-
-template <> inline unsigned int
-from_string(const std::string& s) { return detail::unsigned_from_string<unsigned int>(s); }
-
-template <> inline unsigned long int
-from_string(const std::string& s) { return detail::unsigned_from_string<unsigned long int>(s); }
-
-template <> inline unsigned long long int
-from_string(const std::string& s) { return detail::unsigned_from_string<unsigned long long int>(s); }
+inline bool try_from_string(const std::string& s, unsigned char& result) { return detail::unsigned_from_string(s, result); }
+inline bool try_from_string(const std::string& s, unsigned short int& result) { return detail::unsigned_from_string(s, result); }
+inline bool try_from_string(const std::string& s, unsigned int& result) { return detail::unsigned_from_string(s, result); }
+inline bool try_from_string(const std::string& s, unsigned long int& result) { return detail::unsigned_from_string(s, result); }
+inline bool try_from_string(const std::string& s, unsigned long long int& result) { return detail::unsigned_from_string(s, result); }
 
 // bool
 
-template <>
-inline bool from_string(const std::string& s)
+inline bool try_from_string(const std::string& s, bool& result)
 {
-    if (s == "true") return true;
-    else if (s == "false") return false;
-    const auto value = detail::signed_from_string<long long int>(s);
-    if (value == 1) return true;
-    else if (value == 0) return false;
-    throw bad_conversion();            
+    if (s == "true") { result = true; return true; }
+    if (s == "false") { result = false; return true; }
+    long long int value = 0;
+    if (!detail::signed_from_string(s, value) || (value != 0 && value != 1))
+        return false;
+    result = (value == 1);
+    return true;
 }
 
 // chars
 
-template <>
-inline char from_string(const std::string& s)
+inline bool try_from_string(const std::string& s, char& result)
 {
-    if (s.size() != 1) throw bad_conversion();
-    return s[0];            
+    if (s.size() != 1) return false;
+    result = s[0];
+    return true;
 }
 
 // floating points
 
-template <>
-inline float from_string(const std::string& s)
-{
-    if ( std::any_of(s.begin(), s.end(), [](char c){return std::isspace(c);} ) )
-        throw bad_conversion();
-    std::string::size_type sz;
-    float result = {};
-    try {
-        result = std::stof(s, &sz);
-    } catch (const std::exception&) {
-        throw bad_conversion();
-    }
-    if (sz != s.size())
-        throw bad_conversion();
-    return result;
-}
+inline bool try_from_string(const std::string& s, float& result) { return detail::floating_from_string(s, result); }
+inline bool try_from_string(const std::string& s, double& result) { return detail::floating_from_string(s, result); }
+inline bool try_from_string(const std::string& s, long double& result) { return detail::floating_from_string(s, result); }
 
-template <>
-inline double from_string(const std::string& s)
+// fallback: operator >>
+
+template <typename T>
+inline bool try_from_string(const std::string& s, T& result)
 {
-    if ( std::any_of(s.begin(), s.end(), [](char c){return std::isspace(c);} ) )
-        throw bad_conversion();
-    std::string::size_type sz;
-    double result = {};
-    try {
-        result = std::stod(s, &sz);
-    } catch (const std::exception&) {
-        throw bad_conversion();
-    }
-    if (sz != s.size())
-        throw bad_conversion();
-    return result;
+    std::istringstream interpreter(s);
+    return (interpreter >> result) && (interpreter >> std::ws).eof();
 }
 
-template <>
-inline long double from_string(const std::string& s)
+    } // namespace detail
+
+} // namespace cli
+
+#endif // CLI_FROMSTRING_USE_BOOST
+
+namespace cli
+{
+namespace detail
 {
-    if ( std::any_of(s.begin(), s.end(), [](char c){return std::isspace(c);} ) )
-        throw bad_conversion();
-    std::string::size_type sz;
-    long double result = {};
-    try {
-        result = std::stold(s, &sz);
-    } catch (const std::exception&) {
-        throw bad_conversion();
-    }
-    if (sz != s.size())
-        throw bad_conversion();
-    return result;
-}
 
-// fallback: operator <<
+class bad_conversion : public std::bad_cast
+{
+    public:
+        const char* what() const noexcept override {
+            return "bad from_string conversion: "
+                "source string value could not be interpreted as target";
+        }
+};
 
 template <typename T>
 inline T from_string(const std::string& s)
 {
-    std::stringstream interpreter;
-    T result;
-
-    if(!(interpreter << s) ||
-        !(interpreter >> result) ||
-        !(interpreter >> std::ws).eof())
+    T result{};
+    if (!try_from_string(s, result))
         throw bad_conversion();
-
     return result;
 }
 
-    } // namespace detail
-
+} // namespace detail
 } // namespace cli
 
-
-#endif // CLI_FROMSTRING_USE_BOOST
-
 #endif // CLI_DETAIL_FROMSTRING_H_
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_GENERICASIOKEYBOARD_H_
+#define CLI_DETAIL_GENERICASIOKEYBOARD_H_
+
+#include <array>
+#include <memory>
+#include "genericasioscheduler.h"
+#include "linuxkeyboard.h" // TerminalKeyDecoder
+
+namespace cli
+{
+namespace detail
+{
+
+// The keyboard of a terminal read by asio on the context of the scheduler,
+// instead of a dedicated thread: a read is always pending on the terminal
+// (a stream_descriptor on a copy of the file descriptor), and the keys
+// it gets are delivered to the scheduler as a single task.
+// The terminal stays without line buffering and echo as long as the object
+// exists, so the command handlers should not read the terminal themselves
+// (see LinuxKeyboard for that).
+template <typename ASIOLIB>
+class GenericAsioKeyboard : public TerminalKeyDecoder
+{
+public:
+    explicit GenericAsioKeyboard(GenericAsioScheduler<ASIOLIB>& _scheduler, int fd = STDIN_FILENO) :
+        TerminalKeyDecoder(_scheduler, fd),
+        input(_scheduler.AsioContext(), ::dup(fd))
+    {
+        ToManualMode();
+        Read();
+    }
+    ~GenericAsioKeyboard() override
+    {
+        alive.reset(); // the completion handlers still pending are ignored
+        asiolibec::error_code ignored;
+        input.close(ignored);
+        ToStandardMode();
+    }
+
+    // disable value semantics
+    GenericAsioKeyboard(const GenericAsioKeyboard&) = delete;
+    GenericAsioKeyboard& operator = (const GenericAsioKeyboard&) = delete;
+
+    // The commands run on the scheduler like the reads:
+    // the keys typed meanwhile wait in the terminal,
+    // so there is nothing to switch.
+    void ActivateInput() override {}
+    void DeactivateInput() override {}
+
+private:
+
+    void Read()
+    {
+        std::weak_ptr<bool> self = alive;
+        input.async_read_some(asiolib::buffer(buffer),
+            [this, self](const asiolibec::error_code& ec, std::size_t size)
+            {
+                if (self.expired())
+                    return;
+                if (ec == asiolib::error::operation_aborted)
+                    return;
+                for (std::size_t i = 0; i < size; ++i)
+                    Decode(buffer[i]);
+                if (ec) // terminal closed
+                    Enqueue(std::make_pair(KeyType::eof, ' '));
+                Flush();
+                if (!ec)
+                    Read();
+            });
+    }
+
+    std::array<char, 4096> buffer;
+    std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+    asiolib::posix::stream_descriptor input;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_GENERICASIOKEYBOARD_H_
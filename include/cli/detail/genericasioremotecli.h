@@ -31,12 +31,19 @@
 #define CLI_DETAIL_GENERICASIOREMOTECLI_H_
 
 #include <memory>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "../cli.h"
 #include "commandprocessor.h"
 #include "server.h"
+#include "blockpool.h"
 #include "inputdevice.h"
+#include "keylog.h"
 #include "genericasioscheduler.h"
 #include "screen.h"
+#include "telnetcompressor.h"
+#include "trace.h"
 
 namespace cli
 {
@@ -48,21 +55,48 @@ namespace detail
 class TelnetSession : public Session
 {
 public:
-    explicit TelnetSession(asiolib::ip::tcp::socket _socket) :
+    explicit TelnetSession(Session::Socket _socket) :
         Session(std::move(_socket))
     {}
 
+#if defined(CLI_TELNET_MCCP)
+    // Offer the compression of the output (MCCP2) to the client, before the session starts:
+    // it begins with the first write of at least minSize bytes after the client accepts it.
+    void Compression(int _level, std::size_t _minSize)
+    {
+        compressionLevel = _level;
+        compressionMinSize = _minSize;
+    }
+#endif
+
 protected:
 
-    std::string Encode(const std::string& _data) const override
+    // NVT encoding: "\n" becomes "\r\n" and the data byte 255 is escaped as IAC IAC.
+    // The plain runs between two special chars are appended in one go.
+    void Encode(const char* data, std::size_t size, std::string& out) const override
     {
-        std::string result;
-        for (char c: _data)
+        const char* const end = data + size;
+        const char* nl = FindChar(data, end, '\n');
+        const char* iac = FindChar(data, end, IAC);
+        while (data != end)
         {
-            if (c == '\n') result += '\r';
-            result += c;
+            const char* special = std::min(nl, iac);
+            out.append(data, special);
+            if (special == end)
+                break;
+            if (special == nl)
+            {
+                out += "\r\n";
+                nl = FindChar(special + 1, end, '\n');
+            }
+            else
+            {
+                out += IAC;
+                out += IAC;
+                iac = FindChar(special + 1, end, IAC);
+            }
+            data = special + 1;
         }
-        return result;
     }
 
     void OnConnect() override
@@ -78,14 +112,25 @@ protected:
 
         // https://www.ibm.com/support/knowledgecenter/SSLTBW_1.13.0/com.ibm.zos.r13.hald001/telcmds.htm
 
+        // telnet commands are sent as they are (i.e., without NVT encoding)
+
         static const std::string iacDoLineMode{ "\x0FF\x0FD\x022", 3 };
-        this -> OutStream() << iacDoLineMode << std::flush;
+        Send(iacDoLineMode);
 
         static const std::string iacSbLineMode0IacSe{ "\x0FF\x0FA\x022\x001\x000\x0FF\x0F0", 7 };
-        this -> OutStream() << iacSbLineMode0IacSe << std::flush;
+        Send(iacSbLineMode0IacSe);
 
         static const std::string iacWillEcho{ "\x0FF\x0FB\x001", 3 };
-        this -> OutStream() << iacWillEcho << std::flush;
+        Send(iacWillEcho);
+
+        // the client tells the size of its window (see OnWindowSize)
+        SendIacCmd(DO, NEGOTIATE_ABOUT_WIN_SIZE);
+        nawsAsked = true;
+
+#if defined(CLI_TELNET_MCCP)
+        if (compressionLevel != Z_NO_COMPRESSION)
+            SendIacCmd(WILL, COMPRESS2);
+#endif
 
 /*
         constexpr char IAC = '\x0FF'; // 255
@@ -98,75 +143,6 @@ protected:
     }
     void OnDisconnect() override {}
     void OnError() override {}
-#if 0
-    void OnDataReceived(const std::string& data) override
-    {
-        if (waitAck)
-        {
-            if ( data[0] == '\x0FF' )
-            {
-                // TODO
-                for (size_t i = 0; i < data.size(); ++i)
-                    std::cout << static_cast<int>( data[i] & 0xFF ) << ' ';
-                std::cout << std::endl;
-
-                for (size_t i = 0; i < data.size(); ++i)
-                    std::cout << "0x" << std::hex << static_cast<int>( data[i] & 0xFF ) << std::dec << ' ';
-                std::cout << std::endl;
-
-                for (size_t i = 0; i < data.size(); ++i)
-                    switch (static_cast<int>( data[i] & 0xFF ))
-                    {
-                        case 0xFF: std::cout << "IAC "; break;
-                        case 0xFE: std::cout << "DONT "; break;
-                        case 0xFD: std::cout << "DO "; break;
-                        case 0xFC: std::cout << "WONT "; break;
-                        case 0xFB: std::cout << "WILL "; break;
-                        case 0xFA: std::cout << "SB "; break;
-                        case 0xF9: std::cout << "GoAhead "; break;
-                        case 0xF8: std::cout << "EraseLine "; break;
-                        case 0xF7: std::cout << "EraseCharacter "; break;
-                        case 0xF6: std::cout << "AreYouThere "; break;
-                        case 0xF5: std::cout << "AbortOutput "; break;
-                        case 0xF4: std::cout << "InterruptProcess "; break;
-                        case 0xF3: std::cout << "Break "; break;
-                        case 0xF2: std::cout << "DataMark "; break;
-                        case 0xF1: std::cout << "NOP "; break;
-                        case 0xF0: std::cout << "SE "; break;
-                        default: std::cout << (static_cast<int>( data[i] & 0xFF )) << ' ';
-                    }
-                std::cout << std::endl;
-
-            }
-            waitAck = false;
-/*
-            std::string iacWillSuppressGoAhead{ "\x0FF\x0FB\x003", 3 };
-            if ( data == iacWillSuppressGoAhead )
-            {
-                waitAck = false;
-                cliSession.Prompt();
-            }
-
-            else
-                Disconnect();
-*/
-        }
-        else
-        {
-            for (size_t i = 0; i < data.size(); ++i)
-                Feed(data[i]);
-/*
-            auto str = data;
-            // trim trailing spaces
-            std::size_t endpos = str.find_last_not_of(" \t\r\n");
-            if( std::string::npos != endpos ) str = str.substr( 0, endpos+1 );
-
-            if ( cliSession.Feed( str ) ) cliSession.Prompt();
-            else Disconnect();
-*/
-        }
-    }
-#else
 
     /*
     See
@@ -215,17 +191,37 @@ protected:
         TERMINAL_TYPE = '\x018',
         NEGOTIATE_ABOUT_WIN_SIZE = '\x01F',
         TERMINAL_SPEED = '\x020',
-        NEW_ENV_OPTION = '\x027'
+        NEW_ENV_OPTION = '\x027',
+        COMPRESS2 = '\x056'
     };
 
-    void OnDataReceived(const std::string& _data) override
+    void OnDataReceived(const char* _data, std::size_t size) override
     {
-        for (char c: _data)
-            Consume(c);
+        const char* const end = _data + size;
+        while (_data != end)
+        {
+            if (!escape && state == State::data)
+            {
+                // the run of plain data up to the next IAC goes out in one call
+                const char* iac = FindChar(_data, end, IAC);
+                if (iac != _data)
+                    Output(_data, static_cast<std::size_t>(iac - _data));
+                _data = iac;
+                if (_data == end)
+                    break;
+            }
+            Consume(*_data++);
+        }
     }
 
 private:
 
+    static const char* FindChar(const char* first, const char* last, char c)
+    {
+        const void* found = std::memchr(first, c, static_cast<std::size_t>(last - first));
+        return found ? static_cast<const char*>(found) : last;
+    }
+
     void Consume(char c)
     {
         if (escape)
@@ -250,7 +246,7 @@ private:
         switch(state)
         {
             case State::data:
-                Output(c);
+                Output(&c, 1);
                 break;
             case State::sub:
                 RxSub(c);
@@ -276,39 +272,24 @@ private:
 
     void Command(char c)
     {
-/*
-        switch (static_cast<int>( c & 0xFF ))
-        {
-            case 0xFF: std::cout << "IAC" << std::endl; break;
-            case 0xFE: std::cout << "DONT" << std::endl; break;
-            case 0xFD: std::cout << "DO" << std::endl; break;
-            case 0xFC: std::cout << "WONT" << std::endl; break;
-            case 0xFB: std::cout << "WILL" << std::endl; break;
-            case 0xFA: std::cout << "SB" << std::endl; break;
-            case 0xF9: std::cout << "GoAhead" << std::endl; break;
-            case 0xF8: std::cout << "EraseLine" << std::endl; break;
-            case 0xF7: std::cout << "EraseCharacter" << std::endl; break;
-            case 0xF6: std::cout << "AreYouThere" << std::endl; break;
-            case 0xF5: std::cout << "AbortOutput" << std::endl; break;
-            case 0xF4: std::cout << "InterruptProcess" << std::endl; break;
-            case 0xF3: std::cout << "Break" << std::endl; break;
-            case 0xF2: std::cout << "DataMark" << std::endl; break;
-            case 0xF1: std::cout << "NOP" << std::endl; break;
-            case 0xF0: std::cout << "SE" << std::endl; break;
-            default: std::cout << (static_cast<int>( c & 0xFF )) << std::endl;;
-        }
-*/
+        CLI_TRACE(TraceLevel::protocol, "cmd", static_cast<unsigned char>(c));
         switch(c)
         {
             case SE:
                 if (state == State::sub)
+                {
                     state = State::data;
+                    EndSub();
+                }
                 else
-                    std::cerr << "ERROR: received SE when not in sub state\n";
+                    CLI_TRACE(TraceLevel::error, "SE when not in sub state", static_cast<unsigned char>(c));
+                break;
+            case InterruptProcess:
+                OnInterrupt();
+                state = State::data;
                 break;
             case DataMark: // ?
             case Break: // ?
-            case InterruptProcess:
             case AbortOutput:
             case AreYouThere:
             case EraseCharacter:
@@ -319,9 +300,12 @@ private:
                 break;
             case SB:
                 if (state != State::sub)
+                {
                     state = State::sub;
+                    sub.clear();
+                }
                 else
-                    std::cout << "ERROR: received SB when already in sub state" << std::endl;
+                    CLI_TRACE(TraceLevel::error, "SB when already in sub state", static_cast<unsigned char>(c));
                 break;
             case WILL:
                 state = State::wait_will;
@@ -344,16 +328,17 @@ private:
 
     void RxWill(char c)
     { 
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "will " << static_cast<int>(c) << std::endl;
-        #endif
+        CLI_TRACE(TraceLevel::protocol, "will", static_cast<unsigned char>(c));
         switch(c)
         {
             case SUPPRESS_GO_AHEAD:
                 SendIacCmd(WILL, SUPPRESS_GO_AHEAD);
                 break;
-            case NEGOTIATE_ABOUT_WIN_SIZE: 
-                SendIacCmd(DO, NEGOTIATE_ABOUT_WIN_SIZE);
+            case NEGOTIATE_ABOUT_WIN_SIZE:
+                // don't confirm the answer to our DO
+                if (!nawsAsked)
+                    SendIacCmd(DO, NEGOTIATE_ABOUT_WIN_SIZE);
+                nawsAsked = false;
                 break;
             default:
                 SendIacCmd(DONT, c);
@@ -361,17 +346,11 @@ private:
     }
     void RxWont(char c)
     { 
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "wont " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
-        #endif
+        CLI_TRACE(TraceLevel::protocol, "wont", static_cast<unsigned char>(c));
     }
     void RxDo(char c)
     { 
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "do " << static_cast<int>(c) << std::endl;
-        #endif
+        CLI_TRACE(TraceLevel::protocol, "do", static_cast<unsigned char>(c));
         switch (c)
         {
             case _ECHO:
@@ -380,56 +359,101 @@ private:
             case SUPPRESS_GO_AHEAD:
                 SendIacCmd(WILL, SUPPRESS_GO_AHEAD);
                 break;
+#if defined(CLI_TELNET_MCCP)
+            case COMPRESS2:
+                // the answer to our WILL: the compression starts with a big enough write
+                compressionAccepted = compressionLevel != Z_NO_COMPRESSION;
+                if (!compressionAccepted)
+                    SendIacCmd(WONT, c);
+                break;
+#endif
             default:
                 SendIacCmd(WONT, c);
         };
     }
     void RxDont(char c)
     {
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "dont " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
-        #endif
+        CLI_TRACE(TraceLevel::protocol, "dont", static_cast<unsigned char>(c));
+#if defined(CLI_TELNET_MCCP)
+        if (c == COMPRESS2)
+            compressionAccepted = false; // the stream ends with the next write
+#endif
+    }
+#if defined(CLI_TELNET_MCCP)
+    void BeforeWrite(std::string& data) override
+    {
+        if (compressor)
+        {
+            if (compressionAccepted)
+                compressor->Compress(data);
+            else
+            {
+                compressor->Finish(data);
+                compressor.reset();
+            }
+        }
+        else if (compressionAccepted && data.size() >= compressionMinSize)
+        {
+            // IAC SB COMPRESS2 IAC SE is the last uncompressed sequence
+            static const std::string iacSbCompress2IacSe{ "\x0FF\x0FA\x056\x0FF\x0F0", 5 };
+            compressor = std::make_unique<TelnetCompressor>(compressionLevel);
+            compressor->Compress(data);
+            data.insert(0, iacSbCompress2IacSe);
+        }
     }
+#endif
     void RxSub(char c)
     { 
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "sub: " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
-        #endif
+        CLI_TRACE(TraceLevel::protocol, "sub", static_cast<unsigned char>(c));
+        if (sub.size() < max_sub_length)
+            sub += c;
+    }
+    // the subnegotiation received is complete
+    void EndSub()
+    {
+        // NAWS: IAC SB NAWS <width high> <width low> <height high> <height low> IAC SE
+        if (sub.size() == 5 && sub[0] == NEGOTIATE_ABOUT_WIN_SIZE)
+        {
+            const auto byte = [this](std::size_t i){ return static_cast<unsigned short>(static_cast<unsigned char>(sub[i])); };
+            OnWindowSize(static_cast<unsigned short>(byte(1) << 8 | byte(2)), static_cast<unsigned short>(byte(3) << 8 | byte(4)));
+        }
+        sub.clear();
     }
     void SendIacCmd(char action, char op)
     {
         std::string answer("\x0FF\x000\x000", 3);
         answer[1] = action;
         answer[2] = op;
-        this -> OutStream() << answer << std::flush;
+        Send(answer);
     }
 protected:
+    // Called with the runs of data received (i.e., with the telnet commands stripped)
+    virtual void Output(const char* _data, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            Output(_data[i]);
+    }
     virtual void Output(char c)
     {
-        #ifdef CLI_TELNET_TRACE
-        std::cout << "data: " << static_cast<int>(c) << std::endl;
-        #else
-        (void)c;
-        #endif
+        CLI_TRACE(TraceLevel::data, "data", static_cast<unsigned char>(c));
     }
+    // Called when the client sends the IP (interrupt process) function
+    virtual void OnInterrupt() {}
+    // Called when the client tells the size of its window, in chars (NAWS)
+    virtual void OnWindowSize(unsigned short /*width*/, unsigned short /*height*/) {}
 private:
     enum class State { data, sub, wait_will, wait_wont, wait_do, wait_dont };
     State state = State::data;
     bool escape = false;
-
+    bool nawsAsked = false; // DO NAWS sent, waiting for WILL
+    enum { max_sub_length = 64 };
+    std::string sub; // the subnegotiation being received
+#if defined(CLI_TELNET_MCCP)
+    int compressionLevel = Z_NO_COMPRESSION; // not offered
+    std::size_t compressionMinSize = 0;
+    bool compressionAccepted = false;
+    std::unique_ptr<TelnetCompressor> compressor;
 #endif
-
-private:
-    void Feed(char c)
-    {
-        if (std::isprint(c)) std::cout << c << std::endl;
-        else std::cout << "0x" << std::hex << static_cast<int>(c) << std::dec << std::endl;
-    }
-    std::string buffer;
 };
 
 template <typename ASIOLIB>
@@ -439,7 +463,7 @@ public:
     TelnetServer(typename ASIOLIB::ContextType& ios, unsigned short port) :
         Server<ASIOLIB>(ios, port)
     {}
-    std::shared_ptr<Session> CreateSession(asiolib::ip::tcp::socket _socket) override
+    std::shared_ptr<Session> CreateSession(Session::Socket _socket) override
     {
         return std::make_shared<TelnetSession>(std::move(_socket));
     }
@@ -447,28 +471,109 @@ public:
 
 //////////////
 
-class CliTelnetSession : public InputDevice, public TelnetSession, public CliSession
+// The text written on Cli::cout() is queued to the session
+// by the scheduler of its input events (see CoutSink)
+class CliTelnetSession : public InputDevice, public TelnetSession, public CliSession, public CoutSink
 {
 public:
 
-    CliTelnetSession(Scheduler& _scheduler, asiolib::ip::tcp::socket _socket, Cli& _cli, const std::function< void(std::ostream&)>& _exitAction, std::size_t historySize ) :
+    CliTelnetSession(Scheduler& _scheduler, Session::Socket _socket, Cli& _cli, const std::function< void(std::ostream&)>& _exitAction, std::size_t historySize ) :
         InputDevice(_scheduler),
         TelnetSession(std::move(_socket)),
-        CliSession(_cli, TelnetSession::OutStream(), historySize),
-        poll(*this, *this)
+        CliSession(_cli, TelnetSession::OutStream(), historySize, false),
+        poll(*this, *this),
+        coutScheduler(_scheduler)
     {
-        ExitAction([this, _exitAction](std::ostream& _out){ _exitAction(_out), Disconnect(); } );
+        ExitAction([this, _exitAction](std::ostream& _out){ if (_exitAction) _exitAction(_out); Disconnect(); } );
     }
+
+    // The session takes the ownership of the scheduler of its input events
+    CliTelnetSession(std::unique_ptr<Scheduler> _scheduler, Session::Socket _socket, Cli& _cli, const std::function< void(std::ostream&)>& _exitAction, std::size_t historySize ) :
+        InputDevice(*_scheduler),
+        TelnetSession(std::move(_socket)),
+        CliSession(_cli, TelnetSession::OutStream(), historySize, false),
+        poll(*this, *this),
+        coutScheduler(*_scheduler),
+        ownScheduler(std::move(_scheduler))
+    {
+        ExitAction([this, _exitAction](std::ostream& _out){ if (_exitAction) _exitAction(_out); Disconnect(); } );
+    }
+
+    void MaxLineLength(std::size_t length) { poll.MaxLineLength(length); }
+
+    // Record the keys received in log, for CliReplaySession (nullptr stops)
+    void Record(std::shared_ptr<std::ostream> log) { RecordKeys(*this, std::move(log)); }
+
+    // CoutSink (called by the thread writing on Cli::cout)
+    void Write(std::shared_ptr<const std::string> data) override
+    {
+        auto self = shared_from_this();
+        coutScheduler.Post([this, self, data](){ Broadcast(data); });
+    }
+
 protected:
 
     void OnConnect() override
     {
+        RegisterCout(std::shared_ptr<CoutSink>(shared_from_this(), this));
         TelnetSession::OnConnect();
         Enter();
         Prompt();
     }
 
-    void Output(char c) override // NB: C++ does not specify wether char is signed or unsigned
+    void OnTimeout() override { Exit(); }
+
+    // the IP function is handled like ctrl+C
+    void OnInterrupt() override
+    {
+        Enqueue(std::make_pair(KeyType::interrupt, ' '));
+        Flush();
+    }
+
+    void OnWindowSize(unsigned short width, unsigned short height) override { WindowSize(width, height); }
+
+    void OnWritten() override { StreamMore(); }
+
+    // CliSession
+    void DiscardOutput() override { DiscardPending(); }
+    bool OutputBacklogged() const override { return StreamBacklogged(); }
+
+    using TelnetSession::Output;
+    void Output(const char* _data, std::size_t size) override
+    {
+        const char* const end = _data + size;
+        while (_data != end)
+        {
+            if (step == Step::_1)
+            {
+                // plain ascii chars don't need the state machine
+                const char* special = std::find_if(_data, end, [](char c){ return !IsPlainAscii(c); });
+                for (; _data != special; ++_data)
+                    Enqueue(std::make_pair(KeyType::ascii, *_data));
+                if (_data == end)
+                    break;
+            }
+            Decode(*_data++);
+        }
+        // all the keys received are processed by a single task
+        Flush();
+        // a command is being typed until the user hits enter
+        if (size != 0)
+        {
+            const char last = *(end - 1);
+            LineInProgress(last != '\r' && last != '\n' && last != '\0');
+        }
+    }
+
+private:
+
+    static bool IsPlainAscii(char c)
+    {
+        const auto uc = static_cast<unsigned char>(c);
+        return uc >= 32 && uc < 127;
+    }
+
+    void Decode(char c) // NB: C++ does not specify wether char is signed or unsigned
     {
         switch(step)
         {
@@ -477,19 +582,23 @@ protected:
                 {
                     case static_cast<char>(EOF):
                     case 4:  // EOT
-                        Notify(std::make_pair(KeyType::eof,' ')); break;
+                        Enqueue(std::make_pair(KeyType::eof,' ')); break;
+                    case 3: // ctrl+C
+                        Enqueue(std::make_pair(KeyType::interrupt, ' ')); break;
                     case 8: // Backspace
                     case 127:  // Backspace or Delete
-                        Notify(std::make_pair(KeyType::backspace, ' ')); break;
-                    //case 10: Notify(std::make_pair(KeyType::ret,' ')); break;
+                        Enqueue(std::make_pair(KeyType::backspace, ' ')); break;
+                    //case 10: Enqueue(std::make_pair(KeyType::ret,' ')); break;
                     case 12: // ctrl+L
-                        Notify(std::make_pair(KeyType::clear, ' ')); break;
+                        Enqueue(std::make_pair(KeyType::clear, ' ')); break;
+                    case 18: // ctrl+R
+                        Enqueue(std::make_pair(KeyType::search, ' ')); break;
                     case 27: step = Step::_2; break;  // symbol
                     case 13: step = Step::wait_0; break;  // wait for 0 (ENTER key)
                     default: // ascii
                     {
                         const char ch = static_cast<char>(c);
-                        Notify(std::make_pair(KeyType::ascii,ch));
+                        Enqueue(std::make_pair(KeyType::ascii,ch));
                     }
                 }
                 break;
@@ -503,7 +612,7 @@ protected:
                 else
                 {
                     step = Step::_1;
-                    Notify(std::make_pair(KeyType::ignored,' '));
+                    Enqueue(std::make_pair(KeyType::ignored,' '));
                     break; // unknown
                 }
                 break;
@@ -511,27 +620,27 @@ protected:
             case Step::_3: // got 27 and 91
                 switch( c )
                 {
-                    case 65: step = Step::_1; Notify(std::make_pair(KeyType::up,' ')); break;
-                    case 66: step = Step::_1; Notify(std::make_pair(KeyType::down,' ')); break;
-                    case 68: step = Step::_1; Notify(std::make_pair(KeyType::left,' ')); break;
-                    case 67: step = Step::_1; Notify(std::make_pair(KeyType::right,' ')); break;
-                    case 70: step = Step::_1; Notify(std::make_pair(KeyType::end,' ')); break;
-                    case 72: step = Step::_1; Notify(std::make_pair(KeyType::home,' ')); break;
+                    case 65: step = Step::_1; Enqueue(std::make_pair(KeyType::up,' ')); break;
+                    case 66: step = Step::_1; Enqueue(std::make_pair(KeyType::down,' ')); break;
+                    case 68: step = Step::_1; Enqueue(std::make_pair(KeyType::left,' ')); break;
+                    case 67: step = Step::_1; Enqueue(std::make_pair(KeyType::right,' ')); break;
+                    case 70: step = Step::_1; Enqueue(std::make_pair(KeyType::end,' ')); break;
+                    case 72: step = Step::_1; Enqueue(std::make_pair(KeyType::home,' ')); break;
                     default: step = Step::_4; break;  // not arrow keys
                 }
                 break;
 
             case Step::_4:
-                if ( c == 126 ) Notify(std::make_pair(KeyType::canc,' '));
-                else Notify(std::make_pair(KeyType::ignored,' '));
+                if ( c == 126 ) Enqueue(std::make_pair(KeyType::canc,' '));
+                else Enqueue(std::make_pair(KeyType::ignored,' '));
 
                 step = Step::_1;
 
                 break;
 
             case Step::wait_0:
-                if ( c == 0 /* linux */ || c == 10 /* win */ ) Notify(std::make_pair(KeyType::ret,' '));
-                else Notify(std::make_pair(KeyType::ignored,' '));
+                if ( c == 0 /* linux */ || c == 10 /* win */ ) Enqueue(std::make_pair(KeyType::ret,' '));
+                else Enqueue(std::make_pair(KeyType::ignored,' '));
 
                 step = Step::_1;
 
@@ -540,11 +649,39 @@ protected:
         }
     }
 
-private:
-
     enum class Step { _1, _2, _3, _4, wait_0 };
     Step step = Step::_1;
     CommandProcessor<TelnetScreen> poll;
+    Scheduler& coutScheduler;
+    std::unique_ptr<Scheduler> ownScheduler;
+};
+
+// Scheduler posting the tasks on the executor of a socket,
+// i.e., on the strand of its session.
+template <typename ASIOLIB>
+class SocketScheduler : public Scheduler
+{
+public:
+    explicit SocketScheduler(Session::Socket& socket) : executor(socket) {}
+    using Scheduler::Post;
+    void Post(const std::function<void()>& f) override { executor.Post(f); }
+    void Post(Task&& t) override { executor.Post(std::move(t)); }
+    // the timers are asio timers on the context of the socket, so a timer
+    // pending when the session is closed doesn't need the scheduler
+    void PostAt(Clock::time_point when, Task&& t) override
+    {
+        auto timer = executor.Timer();
+        ASIOLIB::ExpiresAfter(*timer, when - Clock::now());
+        auto task = std::make_shared<Task>(std::move(t)); // the handlers must be copyable with old asio versions
+        auto e = executor;
+        timer->async_wait([timer, task, e](const asiolibec::error_code& ec) mutable
+            {
+                if (!ec)
+                    e.Post(std::move(*task));
+            });
+    }
+private:
+    typename ASIOLIB::Executor executor;
 };
 
 template <typename ASIOLIB>
@@ -553,13 +690,17 @@ class CliGenericTelnetServer : public Server<ASIOLIB>
 public:
     CliGenericTelnetServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, unsigned short port, std::size_t _historySize=100 ) :
         Server<ASIOLIB>(_scheduler.AsioContext(), port),
-        scheduler(_scheduler),
         cli(_cli),
         historySize(_historySize)
     {}
     CliGenericTelnetServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, std::string address, unsigned short port, std::size_t _historySize=100 ) :
         Server<ASIOLIB>(_scheduler.AsioContext(), address, port),
-        scheduler(_scheduler),
+        cli(_cli),
+        historySize(_historySize)
+    {}
+    // Listen on a unix domain socket, for the local clients (see Server::PeerFilter)
+    CliGenericTelnetServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, const LocalSocket& local, std::size_t _historySize=100 ) :
+        Server<ASIOLIB>(_scheduler.AsioContext(), local),
         cli(_cli),
         historySize(_historySize)
     {}
@@ -573,19 +714,270 @@ public:
     {
         exitAction = action;
     }
-    std::shared_ptr<Session> CreateSession(asiolib::ip::tcp::socket _socket) override
+
+    // The chars typed beyond this length are ignored (0 means no limit)
+    void MaxLineLength(std::size_t length) { maxLineLength = length; }
+
+    // Record the keys of each new session in the log returned by logFor
+    // (or not, if it returns nullptr), for CliReplaySession
+    void RecordSessions(std::function<std::shared_ptr<std::ostream>(const CliSession&)> logFor)
+    {
+        recordLog = std::move(logFor);
+    }
+
+    // The memory of up to n closed sessions is kept for the next connections (0 disables the pool)
+    void SessionPoolSize(std::size_t n) { sessionPool->MaxFree(n); }
+
+#if defined(CLI_TELNET_MCCP)
+    // Compress the output of the sessions whose client supports MCCP2,
+    // with the zlib level given (1 to 9), starting from the first write
+    // of at least minSize bytes (so, usually, from the first big output)
+    void Compression(int level, std::size_t minSize = 512)
     {
-        return std::make_shared<CliTelnetSession>(scheduler, std::move(_socket), cli, exitAction, historySize);
+        compressionLevel = level;
+        compressionMinSize = minSize;
+    }
+#endif
+
+    std::shared_ptr<Session> CreateSession(Session::Socket _socket) override
+    {
+        // the input events of the session are handled on the strand of its socket
+        std::unique_ptr<Scheduler> sessionScheduler = std::make_unique<SocketScheduler<ASIOLIB>>(_socket);
+        auto session = std::allocate_shared<CliTelnetSession>(
+            PoolAllocator<CliTelnetSession>(sessionPool),
+            std::move(sessionScheduler), std::move(_socket), cli, exitAction, historySize
+        );
+        session->MaxLineLength(maxLineLength);
+        if (recordLog)
+            session->Record(recordLog(*session));
+#if defined(CLI_TELNET_MCCP)
+        session->Compression(compressionLevel, compressionMinSize);
+#endif
+        return session;
     }
 private:
-    Scheduler& scheduler;
     Cli& cli;
     std::function< void(std::ostream&)> enterAction;
     std::function< void(std::ostream&)> exitAction;
     std::size_t historySize;
+    std::size_t maxLineLength = 0;
+    std::function<std::shared_ptr<std::ostream>(const CliSession&)> recordLog;
+#if defined(CLI_TELNET_MCCP)
+    int compressionLevel = Z_NO_COMPRESSION;
+    std::size_t compressionMinSize = 0;
+#endif
+    // shared with the allocators of the sessions, which can outlive the server
+    std::shared_ptr<BlockPool> sessionPool = std::make_shared<BlockPool>(16);
 };
 
 
+// *******************************************************************************
+
+// How the commands are delimited on the connections of a CliGenericRawServer
+enum class RawDelimiter
+{
+    newline,  // one command per line, ending with LF or CR LF
+    netstring // "<length>:<command>," (e.g., "4:help,"), so a command can contain any byte
+};
+
+// A session without telnet negotiation and line editing, for the automation clients:
+// the commands received (many of them can arrive in the same packet) are fed
+// to the CliSession in framed mode, and the next one starts when the previous
+// one has completed, asynchronous commands included.
+// There is no echo, no prompt, no history and no output of Cli::cout,
+// so that the connection carries only frames.
+class CliRawSession : public Session, public CliSession
+{
+public:
+
+    CliRawSession(std::shared_ptr<Scheduler> _scheduler, Session::Socket _socket, Cli& _cli, RawDelimiter _delimiter, std::size_t _maxLength ) :
+        Session(std::move(_socket)),
+        CliSession(_cli, Session::OutStream(), 0, false),
+        scheduler(std::move(_scheduler)),
+        delimiter(_delimiter),
+        maxLength(_maxLength)
+    {
+        Framed(true);
+        ExitAction([this](std::ostream&){ closed = true; } );
+    }
+
+protected:
+
+    void OnConnect() override
+    {
+        // the asynchronous commands resume on the strand of the socket
+        std::weak_ptr<Session> weak = shared_from_this();
+        auto sched = scheduler;
+        ResumeAsync([weak, sched]()
+        {
+            sched->Post([weak]()
+            {
+                if (auto self = weak.lock())
+                    static_cast<CliRawSession*>(self.get())->Resume();
+            });
+        });
+    }
+    void OnDisconnect() override {}
+    void OnError() override {}
+
+    void OnTimeout() override { Exit(); Disconnect(); }
+
+    // CliSession
+    void DiscardOutput() override { DiscardPending(); }
+
+    void OnDataReceived(const char* _data, std::size_t size) override
+    {
+        if (closed)
+            return;
+        input.append(_data, size);
+        Process();
+    }
+
+private:
+
+    void Resume()
+    {
+        EndAsync();
+        Process();
+    }
+
+    // Feed the complete commands buffered, stopping at an asynchronous one
+    void Process()
+    {
+        std::size_t pos = 0;
+        std::string cmd;
+        while (!closed && !Running() && Next(pos, cmd))
+            Feed(cmd);
+        input.erase(0, pos);
+        complete = complete > pos ? complete - pos : 0;
+        // the complete commands waiting for an asynchronous one are skipped,
+        // so that only the command still arriving counts for the limit
+        if (!closed && Running())
+        {
+            scanning = true;
+            while (Next(complete, cmd)) {}
+            scanning = false;
+        }
+        else
+            complete = 0;
+        // a client that does not respect the limit is not waited for
+        if (maxLength != 0 && input.size() - complete > maxLength + MaxOverhead())
+            closed = true;
+        // the commands after exit are not executed, and the output of exit is sent
+        if (closed)
+            Disconnect();
+        LineInProgress(!input.empty());
+    }
+
+    // Extract the command starting at pos, if complete, and move pos after it
+    bool Next(std::size_t& pos, std::string& cmd)
+    {
+        if (delimiter == RawDelimiter::newline)
+        {
+            const auto nl = input.find('\n', pos);
+            if (nl == std::string::npos)
+                return false;
+            auto end = nl;
+            if (end > pos && input[end-1] == '\r')
+                --end;
+            if (maxLength != 0 && end - pos > maxLength)
+                return Malformed();
+            cmd.assign(input, pos, end - pos);
+            pos = nl + 1;
+            return true;
+        }
+
+        const auto colon = input.find(':', pos);
+        if (colon == std::string::npos)
+            return false;
+        std::size_t length = 0;
+        for (auto i = pos; i != colon; ++i)
+        {
+            const char c = input[i];
+            if (c < '0' || c > '9' || colon - pos > std::numeric_limits<std::size_t>::digits10)
+                return Malformed();
+            length = length * 10 + static_cast<std::size_t>(c - '0');
+        }
+        if (colon == pos || (maxLength != 0 && length > maxLength))
+            return Malformed();
+        if (input.size() - colon - 1 <= length) // data and comma
+            return false;
+        if (input[colon + 1 + length] != ',')
+            return Malformed();
+        cmd.assign(input, colon + 1, length);
+        pos = colon + 2 + length;
+        return true;
+    }
+
+    // the bytes of a command that don't count in its length
+    std::size_t MaxOverhead() const
+    {
+        return delimiter == RawDelimiter::newline ? 1 : std::numeric_limits<std::size_t>::digits10 + 2;
+    }
+
+    // A command too long or a netstring that can't be parsed: the rest of the stream can't be trusted
+    // (found while scanning, it's reported when its turn comes)
+    bool Malformed()
+    {
+        if (!scanning)
+            closed = true;
+        return false;
+    }
+
+    std::shared_ptr<Scheduler> scheduler;
+    const RawDelimiter delimiter;
+    const std::size_t maxLength;
+    std::string input; // received, not fed yet
+    std::size_t complete = 0; // the end of the complete commands in input, while one is running
+    bool scanning = false; // see Malformed
+    bool closed = false;
+};
+
+// Server of raw connections (see CliRawSession), the pipelined alternative
+// to CliGenericTelnetServer for the scripts and the monitoring tools
+template <typename ASIOLIB>
+class CliGenericRawServer : public Server<ASIOLIB>
+{
+public:
+    CliGenericRawServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, unsigned short port, RawDelimiter _delimiter=RawDelimiter::newline ) :
+        Server<ASIOLIB>(_scheduler.AsioContext(), port),
+        cli(_cli),
+        delimiter(_delimiter)
+    {}
+    CliGenericRawServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, std::string address, unsigned short port, RawDelimiter _delimiter=RawDelimiter::newline ) :
+        Server<ASIOLIB>(_scheduler.AsioContext(), address, port),
+        cli(_cli),
+        delimiter(_delimiter)
+    {}
+    // Listen on a unix domain socket, for the local clients (see Server::PeerFilter)
+    CliGenericRawServer(Cli& _cli, GenericAsioScheduler<ASIOLIB>& _scheduler, const LocalSocket& local, RawDelimiter _delimiter=RawDelimiter::newline ) :
+        Server<ASIOLIB>(_scheduler.AsioContext(), local),
+        cli(_cli),
+        delimiter(_delimiter)
+    {}
+
+    // The connections sending a command longer than this are closed (0 means no limit)
+    void MaxLineLength(std::size_t length) { maxLineLength = length; }
+
+    // The memory of up to n closed sessions is kept for the next connections (0 disables the pool)
+    void SessionPoolSize(std::size_t n) { sessionPool->MaxFree(n); }
+
+    std::shared_ptr<Session> CreateSession(Session::Socket _socket) override
+    {
+        auto sessionScheduler = std::make_shared<SocketScheduler<ASIOLIB>>(_socket);
+        return std::allocate_shared<CliRawSession>(
+            PoolAllocator<CliRawSession>(sessionPool),
+            std::move(sessionScheduler), std::move(_socket), cli, delimiter, maxLineLength
+        );
+    }
+private:
+    Cli& cli;
+    const RawDelimiter delimiter;
+    std::size_t maxLineLength = 0;
+    // shared with the allocators of the sessions, which can outlive the server
+    std::shared_ptr<BlockPool> sessionPool = std::make_shared<BlockPool>(16);
+};
+
 } // namespace detail
 } // namespace cli
 
@@ -31,7 +31,12 @@
 #define CLI_DETAIL_GENERICASIOSCHEDULER_H_
 
 #include "../scheduler.h"
+#include "lanes.h"
+#include <deque>
 #include <memory> // unique_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace cli
 {
@@ -47,22 +52,16 @@ public:
     using WorkGuard = typename ASIOLIB::WorkGuard;
 
     GenericAsioScheduler() :
-        owned{true},
-        context{new ContextType()},
-        executor{*context},
+        ownedContext{std::make_unique<ContextType>()},
+        context{ownedContext.get()},
+        executor{ExecutorType::Strand(*context)},
         work{std::make_unique<WorkGuard>(ASIOLIB::MakeWorkGuard(*context))}
     {}
 
-    explicit GenericAsioScheduler(ContextType& _context) : context{&_context}, executor{*context} {}
+    explicit GenericAsioScheduler(ContextType& _context) : context{&_context}, executor{ExecutorType::Strand(*context)} {}
 
-    ~GenericAsioScheduler() override
-    {
-        if (owned)
-        {
-            work.reset(); // work uses context, so it must be deleted before context
-            delete context;
-        }
-    }
+    // work and executor use context, so they're declared after it to be deleted before it
+    ~GenericAsioScheduler() override = default;
 
     // non copyable
     GenericAsioScheduler(const GenericAsioScheduler&) = delete;
@@ -80,6 +79,18 @@ public:
         context->run();
     }
 
+    // Run the context on a pool of nThreads threads (the calling one included),
+    // returning when all of them have finished.
+    void Run(std::size_t nThreads)
+    {
+        std::vector<std::thread> pool;
+        for (std::size_t i = 1; i < nThreads; ++i)
+            pool.emplace_back([this](){ context->run(); });
+        context->run();
+        for (auto& t: pool)
+            t.join();
+    }
+
     bool Stopped() const
     {
         return context->stopped();
@@ -89,9 +100,45 @@ public:
 
     void PollOne() { context->poll_one(); }
 
+    // The tasks posted run one at a time (i.e., on a strand),
+    // even when the context runs on more threads
+    using Scheduler::Post;
+
     void Post(const std::function<void()>& f) override
     {
-        executor.Post(f);
+        Post(Priority::bulk, Task(f));
+    }
+
+    void Post(Task&& t) override
+    {
+        Post(Priority::bulk, std::move(t));
+    }
+
+    // asio runs its handlers in order, so the tasks wait in the lanes
+    // and each handler posted runs the one that comes next (see Priority)
+    void Post(Priority priority, Task&& t) override
+    {
+        lanes->Push(priority, std::move(t));
+        auto l = lanes; // the handlers can outlive the scheduler, if the context is not owned
+        executor.Post([l](){ l->RunNext(); });
+    }
+
+    // Each timer is an asio steady_timer, whose task is posted
+    // in the bulk lane when it expires
+    void PostAt(Clock::time_point when, Task&& t) override
+    {
+        auto timer = std::make_shared<typename ASIOLIB::SteadyTimer>(*context);
+        ASIOLIB::ExpiresAfter(*timer, when - Clock::now());
+        auto task = std::make_shared<Task>(std::move(t)); // the handlers must be copyable with old asio versions
+        auto l = lanes;
+        ExecutorType e = executor;
+        timer->async_wait([timer, task, l, e](const auto& ec) mutable
+            {
+                if (ec)
+                    return; // the context is being destroyed
+                l->Push(Priority::bulk, std::move(*task));
+                e.Post([l](){ l->RunNext(); });
+            });
     }
 
     ContextType& AsioContext() { return *context; }
@@ -100,10 +147,38 @@ private:
 
     using ExecutorType = typename ASIOLIB::Executor;
 
-    bool owned = false;
+    class Lanes
+    {
+    public:
+        void Push(Priority priority, Task&& t)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            (priority == Priority::interactive ? interactiveTasks : tasks).push_back(std::move(t));
+        }
+        void RunNext()
+        {
+            Task task;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto& lane = selector.Interactive(!interactiveTasks.empty(), !tasks.empty()) ? interactiveTasks : tasks;
+                task = std::move(lane.front());
+                lane.pop_front();
+            }
+            if (task)
+                task();
+        }
+    private:
+        std::mutex mtx;
+        std::deque<Task> tasks; // the bulk ones
+        std::deque<Task> interactiveTasks;
+        LaneSelector selector;
+    };
+
+    std::unique_ptr<ContextType> ownedContext;
     ContextType* context;
     ExecutorType executor;
     std::unique_ptr<WorkGuard> work;
+    std::shared_ptr<Lanes> lanes = std::make_shared<Lanes>();
 };
 
 
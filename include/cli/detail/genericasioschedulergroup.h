@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_GENERICASIOSCHEDULERGROUP_H_
+#define CLI_DETAIL_GENERICASIOSCHEDULERGROUP_H_
+
+#include "genericasioscheduler.h"
+#include "platform.h"
+#include <algorithm>
+#include <memory> // unique_ptr
+#include <thread>
+#include <vector>
+#if defined(CLI_OS_LINUX)
+    #include <pthread.h>
+    #include <sched.h>
+#elif defined(CLI_OS_WIN)
+    #if !defined(NOMINMAX)
+    #define NOMINMAX 1 // prevent windows from defining min and max macros
+    #endif // !defined(NOMINMAX)
+    #include <windows.h>
+#endif
+
+namespace cli
+{
+namespace detail
+{
+
+// Bind the thread t to the core given, where the platform allows it
+// (linux and windows): elsewhere, the thread is left to the OS scheduler.
+inline void PinToCore(std::thread& t, std::size_t core)
+{
+#if defined(CLI_OS_LINUX) && defined(__GLIBC__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#elif defined(CLI_OS_WIN)
+    if (core < sizeof(DWORD_PTR) * 8)
+        SetThreadAffinityMask(t.native_handle(), DWORD_PTR(1) << core);
+#else
+    (void)t;
+    (void)core;
+#endif
+}
+
+// A set of schedulers, each one with its own context and run by its own thread,
+// to spread the sessions of a server over the cores (see Server::Shards).
+// Unlike a scheduler run on a pool of threads, the handlers of a session
+// always run on the same thread, and the contexts share nothing.
+template <typename ASIOLIB>
+class GenericAsioSchedulerGroup
+{
+public:
+
+    using SchedulerType = GenericAsioScheduler<ASIOLIB>;
+
+    // n schedulers (one for each core, when n is 0)
+    explicit GenericAsioSchedulerGroup(std::size_t n = 0)
+    {
+        if (n == 0)
+            n = Cores();
+        for (std::size_t i = 0; i < n; ++i)
+            schedulers.push_back(std::make_unique<SchedulerType>());
+    }
+
+    // non copyable
+    GenericAsioSchedulerGroup(const GenericAsioSchedulerGroup&) = delete;
+    GenericAsioSchedulerGroup& operator=(const GenericAsioSchedulerGroup&) = delete;
+
+    std::size_t Size() const { return schedulers.size(); }
+
+    SchedulerType& operator[](std::size_t i) { return *schedulers[i]; }
+
+    // Run each scheduler on a thread of its own, bound to a core when pin is true
+    // (the i-th one to the core i, modulo the cores), returning when all of them have stopped.
+    // The calling thread only waits, so its affinity is not changed.
+    void Run(bool pin = true)
+    {
+        const std::size_t cores = Cores();
+        std::vector<std::thread> threads;
+        for (auto& s: schedulers)
+        {
+            SchedulerType* scheduler = s.get();
+            threads.emplace_back([scheduler](){ scheduler->Run(); });
+            if (pin)
+                PinToCore(threads.back(), (threads.size() - 1) % cores);
+        }
+        for (auto& t: threads)
+            t.join();
+    }
+
+    void Stop()
+    {
+        for (auto& s: schedulers)
+            s->Stop();
+    }
+
+private:
+
+    static std::size_t Cores() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+    std::vector<std::unique_ptr<SchedulerType>> schedulers;
+};
+
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_GENERICASIOSCHEDULERGROUP_H_
@@ -30,23 +30,37 @@
 #ifndef CLI_DETAIL_GENERICCLIASYNCSESSION_H_
 #define CLI_DETAIL_GENERICCLIASYNCSESSION_H_
 
+#include <array>
+#include <cstring>
 #include <string>
+#include <unistd.h>
 #include "../cli.h" // CliSession
 #include "genericasioscheduler.h"
+#include "genericasiokeyboard.h"
+#include "commandprocessor.h"
+#include "keylog.h"
+#include "screen.h"
 
 namespace cli
 {
 namespace detail
 {
 
+// A session reading the standard input with asio, line by line.
+// The input is read in large chunks, and all the complete lines
+// of a chunk are fed in one pass, reusing the same string.
+// The prompt is shown only when the standard input is a terminal.
 template <typename ASIOLIB>
 class GenericCliAsyncSession : public CliSession
 {
 public:
     GenericCliAsyncSession(GenericAsioScheduler<ASIOLIB>& _scheduler, Cli& _cli) :
         CliSession(_cli, std::cout, 1),
-        input(_scheduler.AsioContext(), ::dup(STDIN_FILENO))
+        input(_scheduler.AsioContext(), ::dup(STDIN_FILENO)),
+        interactive(::isatty(STDIN_FILENO) != 0)
     {
+        if (interactive)
+            Prompt();
         Read();
     }
     ~GenericCliAsyncSession() noexcept override
@@ -58,39 +72,89 @@ private:
 
     void Read()
     {
-        Prompt();
-        // Read a line of input entered by the user.
-        asiolib::async_read_until(
-            input,
-            inputBuffer,
-            '\n',
-            std::bind( &GenericCliAsyncSession::NewLine, this,
+        input.async_read_some(
+            asiolib::buffer(buffer),
+            std::bind( &GenericCliAsyncSession::NewData, this,
                        std::placeholders::_1,
                        std::placeholders::_2 )
         );
     }
 
-    void NewLine(const asiolibec::error_code& error, std::size_t length )
+    void NewData(const asiolibec::error_code& error, std::size_t length)
     {
-        if ( !error || error == asiolib::error::not_found )
+        const char* begin = buffer.data();
+        const char* const end = begin + length;
+        while (const char* nl = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin))))
         {
-            auto bufs = inputBuffer.data();
-            auto size = static_cast<long>(length);
-            if ( !error ) --size; // remove \n
-            std::string s(asiolib::buffers_begin( bufs ), asiolib::buffers_begin( bufs ) + size);
-            inputBuffer.consume( length );
-
-            Feed( s );
-            Read();
+            if (partial.empty())
+                line.assign(begin, nl);
+            else
+            {
+                // the line started in a previous chunk
+                partial.append(begin, nl);
+                line.swap(partial);
+                partial.clear();
+            }
+            NewLine();
+            begin = nl + 1;
         }
-        else
+        partial.append(begin, end);
+
+        if (error == asiolib::error::operation_aborted)
+            return;
+        if (error)
         {
-            input.close();
+            // the last line can lack the newline
+            if (!partial.empty())
+            {
+                line.swap(partial);
+                partial.clear();
+                NewLine();
+            }
+            asiolibec::error_code ignored;
+            input.close(ignored);
+            return;
         }
+        Read();
     }
 
-    asiolib::streambuf inputBuffer;
+    void NewLine()
+    {
+        Feed(line);
+        if (interactive)
+            Prompt();
+    }
+
+    std::array<char, 16 * 1024> buffer;
+    std::string line; // the line being fed
+    std::string partial; // the start of a line, without its newline yet
     asiolib::posix::stream_descriptor input;
+    const bool interactive;
+};
+
+// An interactive session on the terminal, with the line editing, the history
+// and the completion of CliLocalTerminalSession, whose keyboard is read
+// by asio on the context of the scheduler (see GenericAsioKeyboard)
+// instead of a dedicated thread.
+template <typename ASIOLIB>
+class GenericCliAsyncTerminalSession : public CliSession
+{
+public:
+    GenericCliAsyncTerminalSession(GenericAsioScheduler<ASIOLIB>& _scheduler, Cli& _cli, std::ostream& _out = std::cout, std::size_t historySize = 100) :
+        CliSession(_cli, _out, historySize),
+        kb(_scheduler),
+        ih(*this, kb)
+    {
+        Enter();
+        Prompt();
+    }
+
+    // Record the keys typed in log, for CliReplaySession (nullptr stops)
+    void Record(std::shared_ptr<std::ostream> log) { RecordKeys(kb, std::move(log)); }
+
+private:
+    GenericAsioKeyboard<ASIOLIB> kb;
+    CommandProcessor<LocalScreen> ih;
 };
 
 } // namespace detail
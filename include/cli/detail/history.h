@@ -30,8 +30,9 @@
 #ifndef CLI_DETAIL_HISTORY_H_
 #define CLI_DETAIL_HISTORY_H_
 
-#include <deque>
-#include <limits>
+#include <cstddef>
+#include <memory>
+#include <ostream>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -42,6 +43,11 @@ namespace cli
 namespace detail
 {
 
+// The history of a session.
+// The items are kept in a ring of fixed capacity, whose strings are
+// reused when the oldest items are overwritten. The items loaded from the
+// global history are not copied: the history refers to a snapshot shared
+// by the sessions, and copies it only if the user edits one of its items.
 class History
 {
 public:
@@ -58,16 +64,16 @@ public:
         current = 0;
         if (mode == Mode::browsing)
         {
-            assert(!buffer.empty());
-            if (buffer.size() > 1 && buffer[1] == item) // try to insert an element identical to last one
-                buffer.pop_front();
+            assert(Size() != 0);
+            if (Size() > 1 && At(1) == item) // try to insert an element identical to last one
+                PopFront();
             else // the item was not identical
-                buffer[current] = item;
+                Set(current, item);
         }
         else // Mode::inserting
         {
-            if (buffer.empty() || buffer[0] != item) // insert an element not equal to last one
-                Insert(item);
+            if (Size() == 0 || At(0) != item) // insert an element not equal to last one
+                PushFront(item);
         }
         mode = Mode::inserting;
     }
@@ -77,43 +83,45 @@ public:
     // If we're already browsing the history (eg with arrow keys) the edit line is inserted
     // to the front of the container.
     // Otherwise, the line overwrites the current item.
-    std::string Previous(const std::string& line)
+    // The reference returned is valid until the history is modified.
+    const std::string& Previous(const std::string& line)
     {
         if (mode == Mode::inserting)
         {
-            Insert(line);
+            PushFront(line);
             mode = Mode::browsing;
-            current = (buffer.size() > 1) ? 1 : 0;
+            current = (Size() > 1) ? 1 : 0;
         }
         else // Mode::browsing
         {
-            assert(!buffer.empty());
-            buffer[current] = line;
-            if (current != buffer.size()-1)
+            assert(Size() != 0);
+            Set(current, line);
+            if (current != Size()-1)
                 ++current;
         }
         assert(mode == Mode::browsing);
-        assert(current < buffer.size());
-        return buffer[current];
+        assert(current < Size());
+        return At(current);
     }
 
     // Return the next item of the history, updating the current item.
-    std::string Next()
+    // The reference returned is valid until the history is modified.
+    const std::string& Next()
     {
-        if (buffer.empty() || current == 0)
-            return {};
+        if (Size() == 0 || current == 0)
+            return Empty();
         assert(current != 0);
         --current;
-        assert(current < buffer.size());
-        return buffer[current];
+        assert(current < Size());
+        return At(current);
     }
 
     // Show the whole history on the given ostream
     void Show(std::ostream& out) const
     {
         out << '\n';
-        for (auto& item: buffer)
-            out << item << '\n';
+        for (std::size_t i = 0; i < Size(); ++i)
+            out << At(i) << '\n';
         out << '\n' << std::flush;
     }
 
@@ -121,38 +129,133 @@ public:
     void LoadCommands(const std::vector<std::string>& cmds)
     {
         for (const auto& c: cmds)
-            Insert(c);
+            PushFront(c);
+    }
+
+    // Start from a snapshot of commands (*cmds)[0] is the oldest command, (*cmds)[size-1] the newer.
+    // The snapshot is shared, not copied. It must be called when the history is still empty.
+    void LoadCommands(std::shared_ptr<const std::vector<std::string>> cmds)
+    {
+        assert(Size() == 0);
+        base = std::move(cmds);
+        baseItems = base ? std::min(base->size(), maxSize) : 0;
+        snapshotFirst = base ? base->size() - baseItems : 0;
     }
 
     // result[0] is the oldest command, result[size-1] the newer
     std::vector<std::string> GetCommands() const
     {
-        auto numCmdsToReturn = std::min(commands, buffer.size());
-        auto start = buffer.begin();
+        auto numCmdsToReturn = std::min(commands, Size());
+        std::size_t start = 0;
         if (mode == Mode::browsing)
         {
-            numCmdsToReturn = std::min(commands, buffer.size()-1);
-            start = buffer.begin()+1;
+            numCmdsToReturn = std::min(commands, Size()-1);
+            start = 1;
         }
-        std::vector<std::string> result(numCmdsToReturn);
-        assert(std::distance(start, buffer.end()) >= 0);
-        assert(numCmdsToReturn <= static_cast<std::size_t>(std::distance(buffer.end(), start)));
-        assert(numCmdsToReturn <= static_cast<unsigned long>(std::numeric_limits<long>::max()));
-        std::reverse_copy(start, start+static_cast<long>(numCmdsToReturn), result.begin());
+        std::vector<std::string> result;
+        result.reserve(numCmdsToReturn);
+        for (std::size_t i = numCmdsToReturn; i > 0; --i)
+            result.push_back(At(start + i - 1));
         return result;
     }
 
+    // Returns the position of the newest item containing query, starting
+    // from the position given (0 is the newest item), or std::string::npos
+    std::size_t Find(const std::string& query, std::size_t from) const
+    {
+        for (std::size_t i = from; i < Size(); ++i)
+            if (At(i).find(query) != std::string::npos)
+                return i;
+        return std::string::npos;
+    }
+
+    // The number of items, that can be read with At(i) (0 is the newest item)
+    std::size_t Size() const { return ringItems + baseItems; }
+
+    const std::string& At(std::size_t i) const
+    {
+        assert(i < Size());
+        if (i < ringItems)
+            return ring[(head + ring.size() - i) % ring.size()];
+        return (*base)[base->size() - 1 - (i - ringItems)];
+    }
+
+    // The items of the snapshot before this position are not in the history
+    std::size_t SnapshotFirst() const { return snapshotFirst; }
+
 private:
 
-    void Insert(const std::string& item)
+    static const std::string& Empty() { static const std::string empty; return empty; }
+
+    void Set(std::size_t i, const std::string& item)
+    {
+        if (At(i) == item)
+            return;
+        if (i >= ringItems)
+            CopySnapshot();
+        ring[(head + ring.size() - i) % ring.size()] = item;
+    }
+
+    void PushFront(const std::string& item)
+    {
+        if (maxSize == 0)
+            return;
+        if (ringItems < ring.size()) // the free slots follow head
+        {
+            head = (head + 1) % ring.size();
+            ring[head] = item;
+            ++ringItems;
+        }
+        else if (ring.size() < maxSize) // the ring grows up to its capacity
+        {
+            const auto pos = ring.empty() ? 0 : head + 1;
+            ring.insert(ring.begin() + static_cast<std::ptrdiff_t>(pos), item);
+            head = pos;
+            ++ringItems;
+        }
+        else // the ring is full: overwrite the oldest item
+        {
+            head = (head + 1) % ring.size();
+            ring[head] = item;
+        }
+        if (Size() > maxSize)
+        {
+            // drop the oldest item of the snapshot
+            --baseItems;
+            ++snapshotFirst;
+        }
+    }
+
+    void PopFront()
+    {
+        assert(ringItems != 0);
+        head = (head + ring.size() - 1) % ring.size();
+        --ringItems;
+    }
+
+    // Move all the items in the ring, to modify one of the snapshot
+    void CopySnapshot()
     {
-        buffer.push_front(item);
-        if (buffer.size() > maxSize)
-            buffer.pop_back();
+        std::vector<std::string> items;
+        items.reserve(Size());
+        for (std::size_t i = Size(); i > 0; --i)
+            items.push_back(At(i - 1));
+        ring.clear();
+        head = 0;
+        ringItems = 0;
+        base.reset();
+        baseItems = 0;
+        for (const auto& item: items)
+            PushFront(item);
     }
 
     const std::size_t maxSize;
-    std::deque<std::string> buffer;
+    std::vector<std::string> ring;
+    std::size_t head = 0; // the slot of the newest item in the ring
+    std::size_t ringItems = 0;
+    std::shared_ptr<const std::vector<std::string>> base; // the snapshot of the global history
+    std::size_t baseItems = 0; // the newest items of the snapshot that are in the history
+    std::size_t snapshotFirst = 0; // the oldest item of the snapshot that is (or was) in the history
     std::size_t current = 0;
     std::size_t commands = 0; // number of commands issued
     enum class Mode { inserting, browsing };
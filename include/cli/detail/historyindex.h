@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef CLI_DETAIL_HISTORYINDEX_H_
+#define CLI_DETAIL_HISTORYINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// An index of the trigrams of a list of commands, to find the commands
+// containing a string without looking at all of them.
+// It's immutable after construction, so it can be shared by the sessions.
+class HistoryIndex
+{
+public:
+    // (*cmds)[0] is the oldest command
+    explicit HistoryIndex(std::shared_ptr<const std::vector<std::string>> cmds) :
+        commands(std::move(cmds))
+    {
+        if (!commands)
+            return;
+        const auto& c = *commands;
+        for (std::size_t i = 0; i < c.size(); ++i)
+        {
+            const auto id = static_cast<std::uint32_t>(i);
+            for (std::size_t j = 0; j + 3 <= c[i].size(); ++j)
+            {
+                auto& ids = postings[Trigram(c[i], j)];
+                if (ids.empty() || ids.back() != id)
+                    ids.push_back(id);
+            }
+        }
+    }
+
+    const std::shared_ptr<const std::vector<std::string>>& Commands() const { return commands; }
+
+    // Returns the position of the newest command before the position given
+    // that contains query, or std::string::npos if there is none.
+    std::size_t FindBefore(const std::string& query, std::size_t before) const
+    {
+        if (!commands || query.empty())
+            return std::string::npos;
+        const auto& c = *commands;
+        before = std::min(before, c.size());
+        if (query.size() < 3) // no trigrams: check all the commands
+        {
+            for (std::size_t i = before; i > 0; --i)
+                if (c[i-1].find(query) != std::string::npos)
+                    return i-1;
+            return std::string::npos;
+        }
+        // check only the commands containing the rarest trigram of query
+        const std::vector<std::uint32_t>* candidates = nullptr;
+        for (std::size_t j = 0; j + 3 <= query.size(); ++j)
+        {
+            const auto p = postings.find(Trigram(query, j));
+            if (p == postings.end())
+                return std::string::npos;
+            if (candidates == nullptr || p->second.size() < candidates->size())
+                candidates = &p->second;
+        }
+        auto i = std::lower_bound(candidates->begin(), candidates->end(), static_cast<std::uint32_t>(before));
+        while (i != candidates->begin())
+        {
+            --i;
+            if (c[*i].find(query) != std::string::npos)
+                return *i;
+        }
+        return std::string::npos;
+    }
+
+private:
+    static std::uint32_t Trigram(const std::string& s, std::size_t pos)
+    {
+        return static_cast<std::uint32_t>(static_cast<unsigned char>(s[pos])) << 16 |
+               static_cast<std::uint32_t>(static_cast<unsigned char>(s[pos+1])) << 8 |
+               static_cast<std::uint32_t>(static_cast<unsigned char>(s[pos+2]));
+    }
+
+    std::shared_ptr<const std::vector<std::string>> commands;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings; // the ids of the commands containing each trigram
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_HISTORYINDEX_H_
@@ -31,7 +31,10 @@
 #define CLI_DETAIL_INPUTDEVICE_H_
 
 #include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include "../scheduler.h"
 
 namespace cli
@@ -39,12 +42,14 @@ namespace cli
 namespace detail
 {
 
-enum class KeyType { ascii, up, down, left, right, backspace, canc, home, end, ret, eof, ignored, clear, };
+enum class KeyType { ascii, up, down, left, right, backspace, canc, home, end, ret, eof, ignored, clear, search, interrupt, };
 
 class InputDevice
 {
 public:
-    using Handler = std::function< void( std::pair<KeyType,char> ) >;
+    using KeyEvent = std::pair<KeyType,char>;
+    using KeyEvents = std::vector<KeyEvent>;
+    using Handler = std::function< void( const KeyEvents& ) >;
 
     explicit InputDevice(Scheduler& _scheduler) : scheduler(_scheduler) {}
     virtual ~InputDevice() = default;
@@ -54,17 +59,53 @@ public:
     template <typename H>
     void Register(H&& h) { handler = std::forward<H>(h); }
 
+    // The scheduler delivering the key events
+    Scheduler& EventScheduler() const { return scheduler; }
+
+    // The key events are passed to tap (if any) as they arrive, on the thread
+    // reading them, before being delivered (e.g., to record them, see KeyLogWriter).
+    // An empty tap removes the previous one.
+    void Tap(Handler _tap)
+    {
+        std::atomic_store(&tap, _tap ? std::make_shared<const Handler>(std::move(_tap)) : std::shared_ptr<const Handler>());
+    }
+
 protected:
 
-    void Notify(std::pair<KeyType,char> k)
+    // Delivers a single key event
+    void Notify(KeyEvent k)
+    {
+        Notify(KeyEvents{k});
+    }
+
+    // Delivers several key events with a single scheduler task,
+    // in the interactive lane (so the echo doesn't wait for the bulk work)
+    void Notify(KeyEvents&& keys)
+    {
+        if (const auto t = std::atomic_load(&tap))
+            (*t)(keys);
+        scheduler.Post(Priority::interactive, [this,keys=std::move(keys)](){ if (handler) handler(keys); });
+    }
+
+    // Appends a key event to the batch delivered by the next Flush
+    void Enqueue(KeyEvent k) { pending.push_back(k); }
+
+    // Delivers the key events enqueued since the last call (if any)
+    void Flush()
     {
-        scheduler.Post([this,k](){ if (handler) handler(k); });
+        if (pending.empty())
+            return;
+        KeyEvents keys;
+        keys.swap(pending);
+        Notify(std::move(keys));
     }
 
 private:
 
     Scheduler& scheduler;
     Handler handler;
+    std::shared_ptr<const Handler> tap; // accessed with atomic_load and atomic_store
+    KeyEvents pending;
 };
 
 } // namespace detail
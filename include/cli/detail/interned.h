@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_INTERNED_H_
+#define CLI_DETAIL_INTERNED_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace cli
+{
+namespace detail
+{
+
+// A value kept once in a pool shared by the whole process:
+// all the Interned built from equal values refer to the same copy,
+// so that the names and the help of large menu trees are stored once
+// and compare by address.
+// A value leaves the pool when the last Interned referring to it is destroyed
+// (e.g., the commands of a lazy menu emptied or of a menu removed).
+template <typename T>
+class Interned
+{
+public:
+    explicit Interned(const T& value) : ptr(Intern(value)) {}
+
+    const T& operator*() const { return *ptr; }
+    const T* operator->() const { return ptr.get(); }
+
+    friend bool operator==(const Interned& a, const Interned& b) { return a.ptr == b.ptr; }
+    friend bool operator!=(const Interned& a, const Interned& b) { return a.ptr != b.ptr; }
+
+    // The number of distinct values in the pool
+    static std::size_t Pooled()
+    {
+        auto& pool = ThePool();
+        std::lock_guard<std::mutex> lock(pool.mtx);
+        return pool.values.size();
+    }
+
+private:
+    struct Less
+    {
+        bool operator()(const T* a, const T* b) const { return *a < *b; }
+    };
+    // The keys are the values referred by the weak_ptr: a value is deleted
+    // only after its key has been removed
+    struct Pool
+    {
+        std::mutex mtx;
+        std::map<const T*, std::weak_ptr<const T>, Less> values;
+    };
+
+    static Pool& ThePool()
+    {
+        // never destroyed, because the static menus can outlive any other static object
+        static Pool& pool = *new Pool;
+        return pool;
+    }
+
+    static std::shared_ptr<const T> Intern(const T& value)
+    {
+        auto& pool = ThePool();
+        std::lock_guard<std::mutex> lock(pool.mtx);
+        auto i = pool.values.find(&value);
+        if (i != pool.values.end())
+        {
+            if (auto existing = i->second.lock())
+                return existing;
+            pool.values.erase(i); // expired, its Release is waiting for the lock
+        }
+        std::shared_ptr<const T> interned(new T(value), &Release);
+        pool.values.emplace(interned.get(), interned);
+        return interned;
+    }
+
+    static void Release(const T* value)
+    {
+        {
+            auto& pool = ThePool();
+            std::lock_guard<std::mutex> lock(pool.mtx);
+            auto i = pool.values.find(value);
+            if (i != pool.values.end() && i->first == value) // not replaced by Intern
+                pool.values.erase(i);
+        }
+        delete value;
+    }
+
+    std::shared_ptr<const T> ptr;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_INTERNED_H_
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_KEYLOG_H_
+#define CLI_DETAIL_KEYLOG_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string> // std::char_traits
+#include <utility>
+#include <vector>
+#include "inputdevice.h"
+
+namespace cli
+{
+namespace detail
+{
+
+/**
+ * The binary log of the key events of a session (see InputDevice::Record),
+ * replayed by CliReplaySession.
+ *
+ * After the header "CLIKEYS" and a version byte, each batch of keys delivered
+ * by the input device is written as the microseconds since the previous batch
+ * and the number of keys (both LEB128 varints), then a byte for each key:
+ * the KeyType, with the high bit set when the char of the key follows
+ * (i.e., when it isn't a blank), so a typed char costs two bytes.
+ */
+namespace keylog
+{
+    inline const char* Magic() { return "CLIKEYS"; }
+    enum : unsigned char { magicSize = 7, version = 1, withChar = 0x80 };
+}
+
+class KeyLogWriter
+{
+public:
+    explicit KeyLogWriter(std::shared_ptr<std::ostream> _log) :
+        log(std::move(_log)),
+        last(std::chrono::steady_clock::now())
+    {
+        log->write(keylog::Magic(), keylog::magicSize);
+        log->put(static_cast<char>(keylog::version));
+    }
+
+    void Write(const InputDevice::KeyEvents& keys)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+        last = now;
+        buffer.clear();
+        Varint(static_cast<std::uint64_t>(elapsed));
+        Varint(keys.size());
+        for (const auto& k: keys)
+        {
+            const auto type = static_cast<unsigned char>(k.first);
+            if (k.second == ' ')
+                buffer.push_back(static_cast<char>(type));
+            else
+            {
+                buffer.push_back(static_cast<char>(type | keylog::withChar));
+                buffer.push_back(k.second);
+            }
+        }
+        log->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        log->flush(); // a session can end at any time
+    }
+
+private:
+    void Varint(std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    std::shared_ptr<std::ostream> log;
+    std::chrono::steady_clock::time_point last;
+    std::vector<char> buffer; // the encoding of a batch, reused
+};
+
+class KeyLogReader
+{
+public:
+    // Reads the header: Valid() tells if the stream holds a key log
+    explicit KeyLogReader(std::istream& _log) : log(_log)
+    {
+        char header[keylog::magicSize + 1] = {};
+        log.read(header, sizeof(header));
+        valid = log.gcount() == static_cast<std::streamsize>(sizeof(header)) &&
+                std::equal(header, header + keylog::magicSize, keylog::Magic()) &&
+                static_cast<unsigned char>(header[keylog::magicSize]) == keylog::version;
+    }
+
+    bool Valid() const { return valid; }
+
+    // Reads the next batch of keys, with the time elapsed since the start
+    // of the recording. Returns false at the end of the log (or if it's truncated).
+    bool Next(std::chrono::microseconds& offset, InputDevice::KeyEvents& keys)
+    {
+        std::uint64_t elapsed = 0;
+        std::uint64_t count = 0;
+        if (!valid || !Varint(elapsed) || !Varint(count))
+            return false;
+        keys.clear();
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            const int type = log.get();
+            if (type == std::char_traits<char>::eof())
+                return false;
+            char c = ' ';
+            if ((type & keylog::withChar) != 0)
+            {
+                const int next = log.get();
+                if (next == std::char_traits<char>::eof())
+                    return false;
+                c = static_cast<char>(next);
+            }
+            keys.emplace_back(static_cast<KeyType>(type & ~keylog::withChar), c);
+        }
+        elapsedTotal += std::chrono::microseconds(elapsed);
+        offset = elapsedTotal;
+        return true;
+    }
+
+private:
+    bool Varint(std::uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            const int byte = log.get();
+            if (byte == std::char_traits<char>::eof())
+                return false;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    std::istream& log;
+    bool valid = false;
+    std::chrono::microseconds elapsedTotal{0};
+};
+
+// Write the keys of the device in log, or stop if log is nullptr
+inline void RecordKeys(InputDevice& device, std::shared_ptr<std::ostream> log)
+{
+    if (!log)
+    {
+        device.Tap({});
+        return;
+    }
+    auto writer = std::make_shared<KeyLogWriter>(std::move(log));
+    device.Tap([writer](const InputDevice::KeyEvents& keys){ writer->Write(keys); });
+}
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_KEYLOG_H_
@@ -0,0 +1,240 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef CLI_DETAIL_LINUXHISTORYFILE_H_
+#define CLI_DETAIL_LINUXHISTORYFILE_H_
+
+#include <cerrno>
+#include <cstdio> // std::rename
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cli
+{
+namespace detail
+{
+
+// A file of lines, shared by threads and processes through flock.
+// The lines are appended, and the file is compacted by replacing it
+// with a new one (so a writer must check it has locked the current file).
+class HistoryFile
+{
+public:
+    explicit HistoryFile(std::string _name) : name(std::move(_name)) {}
+
+    // Append data with a single write. Returns the size of the file after it.
+    std::size_t Append(const std::string& data)
+    {
+        LockedFile f(name, O_WRONLY | O_CREAT | O_APPEND, LOCK_EX);
+        if (!f)
+            return 0;
+        const char* p = data.data();
+        std::size_t left = data.size();
+        while (left > 0)
+        {
+            const auto n = write(f.fd, p, left);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        return f.Size();
+    }
+
+    // Returns the last n lines of the file
+    std::vector<std::string> Last(std::size_t n) const
+    {
+        std::vector<std::string> lines;
+        LockedFile f(name, O_RDONLY, LOCK_SH);
+        if (!f)
+            return lines;
+        const Mapping m(f);
+        const char* line = LastLines(m.begin, m.end, n);
+        while (line != m.end)
+        {
+            const char* eol = line;
+            while (eol != m.end && *eol != '\n')
+                ++eol;
+            lines.emplace_back(line, eol);
+            line = (eol == m.end ? eol : eol + 1);
+        }
+        return lines;
+    }
+
+    // Returns the size of the last n lines of the file (what Compact(n) would leave)
+    std::size_t LastSize(std::size_t n) const
+    {
+        LockedFile f(name, O_RDONLY, LOCK_SH);
+        if (!f)
+            return 0;
+        const Mapping m(f);
+        return static_cast<std::size_t>(m.end - LastLines(m.begin, m.end, n));
+    }
+
+    // Keep only the last n lines. Returns the size of the file after it.
+    std::size_t Compact(std::size_t n)
+    {
+        LockedFile f(name, O_RDONLY, LOCK_EX);
+        if (!f)
+            return 0;
+        const Mapping m(f);
+        const char* first = LastLines(m.begin, m.end, n);
+        if (first == m.begin)
+            return f.Size(); // nothing to remove
+
+        // the new file replaces the old one only when complete
+        const std::string tmpName = name + ".tmp";
+        const int tmp = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (tmp < 0)
+            return f.Size();
+        const auto size = static_cast<std::size_t>(m.end - first);
+        bool ok = true;
+        for (std::size_t done = 0; ok && done < size;)
+        {
+            const auto written = write(tmp, first + done, size - done);
+            if (written < 0 && errno == EINTR)
+                continue;
+            ok = written > 0;
+            if (ok)
+                done += static_cast<std::size_t>(written);
+        }
+        ok = (close(tmp) == 0) && ok;
+        if (!ok || std::rename(tmpName.c_str(), name.c_str()) != 0)
+        {
+            unlink(tmpName.c_str());
+            return f.Size();
+        }
+        return size;
+    }
+
+    // Remove all the lines
+    void Clear()
+    {
+        LockedFile f(name, O_WRONLY | O_CREAT, LOCK_EX);
+        if (f)
+        {
+            auto unused = ftruncate(f.fd, 0);
+            static_cast<void>(unused); // silence unused warn
+        }
+    }
+
+private:
+
+    // The current file with the name given, opened and locked
+    struct LockedFile
+    {
+        LockedFile(const std::string& fileName, int flags, int operation)
+        {
+            while ((fd = open(fileName.c_str(), flags | O_CLOEXEC, 0666)) >= 0)
+            {
+                int res = 0;
+                while ((res = flock(fd, operation)) != 0 && errno == EINTR);
+                struct stat locked;
+                struct stat current;
+                if (res == 0 &&
+                    fstat(fd, &locked) == 0 &&
+                    stat(fileName.c_str(), &current) == 0 &&
+                    locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+                    return;
+                // the file has been replaced in the meantime: try again
+                close(fd);
+                if (res != 0)
+                {
+                    fd = -1;
+                    return;
+                }
+            }
+        }
+        ~LockedFile() { if (fd >= 0) close(fd); } // releases the lock too
+        LockedFile(const LockedFile&) = delete;
+        LockedFile& operator=(const LockedFile&) = delete;
+        explicit operator bool() const { return fd >= 0; }
+        std::size_t Size() const
+        {
+            struct stat s;
+            return fstat(fd, &s) == 0 ? static_cast<std::size_t>(s.st_size) : 0;
+        }
+        int fd = -1;
+    };
+
+    // The content of a file mapped in memory (read only)
+    struct Mapping
+    {
+        explicit Mapping(const LockedFile& f) : size(f.Size())
+        {
+            if (size == 0)
+                return;
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, f.fd, 0);
+            if (p == MAP_FAILED)
+            {
+                size = 0;
+                return;
+            }
+            begin = static_cast<const char*>(p);
+            end = begin + size;
+        }
+        ~Mapping() { if (size != 0) munmap(const_cast<char*>(begin), size); }
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        std::size_t size;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+    };
+
+    // Returns the beginning of the last n lines in [begin, end)
+    static const char* LastLines(const char* begin, const char* end, std::size_t n)
+    {
+        if (n == 0)
+            return end;
+        const char* p = end;
+        if (p != begin && *(p - 1) == '\n')
+            --p; // the newline of the last line
+        for (std::size_t found = 0; p != begin; --p)
+            if (*(p - 1) == '\n' && ++found == n)
+                return p;
+        return begin;
+    }
+
+    const std::string name;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_LINUXHISTORYFILE_H_
@@ -34,10 +34,12 @@
 #include <memory>
 #include <stdexcept>
 
+#include <array>
+#include <cerrno>
 #include <cstdio>
 #include <termios.h>
 #include <unistd.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <cassert>
 #include <condition_variable>
 #include "inputdevice.h"
@@ -64,20 +66,30 @@ public:
 
     void WaitKbHit()
     {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(STDIN_FILENO, &rfds);
-        FD_SET(readPipe, &rfds);
+        pollfd fds[2];
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = readPipe;
+        fds[1].events = POLLIN;
 
-        while (select(readPipe + 1, &rfds, nullptr, nullptr, nullptr) == 0);
+        int res = 0;
+        do
+        {
+            fds[0].revents = 0;
+            fds[1].revents = 0;
+            res = poll(fds, 2, -1);
+        } while (res == 0 || (res < 0 && errno == EINTR));
+
+        if (res < 0)
+            throw std::runtime_error("InputSource poll failed");
 
-        if (FD_ISSET(readPipe, &rfds)) // stop called
+        if (fds[1].revents != 0) // stop called
         {
             close(readPipe);
             throw std::runtime_error("InputSource stop");
         }
 
-        if (FD_ISSET(STDIN_FILENO, &rfds)) // char from stdinput
+        if (fds[0].revents != 0) // chars from stdinput (or hang up)
         {
             return;
         }
@@ -101,12 +113,110 @@ private:
 
 //
 
+// Decodes the chars read from a terminal into key events,
+// and switches the terminal to the mode needed (no line buffering, no echo)
+class TerminalKeyDecoder : public InputDevice
+{
+protected:
+
+    explicit TerminalKeyDecoder(Scheduler& _scheduler, int _fd = STDIN_FILENO) :
+        InputDevice(_scheduler),
+        fd(_fd)
+    {}
+
+    // Decodes a char read from the terminal. The state is kept across reads
+    // because an escape sequence can be split between two of them.
+    void Decode(char ch)
+    {
+        switch (step)
+        {
+            case Step::_1:
+                switch(ch)
+                {
+                    case EOF:
+                    case 4:  // EOT
+                        Enqueue(std::make_pair(KeyType::eof,' ')); break;
+                    case 3: Enqueue(std::make_pair(KeyType::interrupt, ' ')); break; // ctrl+C
+                    case 127:
+                    case 8:
+                        Enqueue(std::make_pair(KeyType::backspace,' ')); break;
+                    case 10: Enqueue(std::make_pair(KeyType::ret,' ')); break;
+                    case 12: Enqueue(std::make_pair(KeyType::clear, ' ')); break;
+                    case 18: Enqueue(std::make_pair(KeyType::search, ' ')); break; // ctrl+R
+                    case 27: step = Step::_2; break; // symbol
+                    default: Enqueue(std::make_pair(KeyType::ascii,ch)); break;
+                }
+                break;
+            case Step::_2:
+                if ( ch == 91 ) // arrow keys
+                    step = Step::_3;
+                else
+                {
+                    step = Step::_1;
+                    Enqueue(std::make_pair(KeyType::ignored,' '));
+                }
+                break;
+            case Step::_3:
+                step = Step::_1;
+                switch( ch )
+                {
+                    case 51: step = Step::_4; break;
+                    case 65: Enqueue(std::make_pair(KeyType::up,' ')); break;
+                    case 66: Enqueue(std::make_pair(KeyType::down,' ')); break;
+                    case 68: Enqueue(std::make_pair(KeyType::left,' ')); break;
+                    case 67: Enqueue(std::make_pair(KeyType::right,' ')); break;
+                    case 70: Enqueue(std::make_pair(KeyType::end,' ')); break;
+                    case 72: Enqueue(std::make_pair(KeyType::home,' ')); break;
+                    default: Enqueue(std::make_pair(KeyType::ignored,' ')); break;
+                }
+                break;
+            case Step::_4:
+                step = Step::_1;
+                if ( ch == 126 ) Enqueue(std::make_pair(KeyType::canc,' '));
+                else Enqueue(std::make_pair(KeyType::ignored,' '));
+                break;
+        }
+    }
+
+    void ToManualMode()
+    {
+        constexpr tcflag_t ICANON_FLAG = ICANON;
+        constexpr tcflag_t ECHO_FLAG = ECHO;
+
+        if (tcgetattr(fd, &oldt) != 0)
+            return; // not a terminal
+        manual = true;
+        newt = oldt;
+        newt.c_lflag &= ~( ICANON_FLAG | ECHO_FLAG );
+        // ctrl+C is read as a key (see KeyType::interrupt) instead of raising SIGINT
+        newt.c_cc[VINTR] = _POSIX_VDISABLE;
+        tcsetattr(fd, TCSANOW, &newt);
+    }
+
+    void ToStandardMode()
+    {
+        if (manual)
+            tcsetattr(fd, TCSANOW, &oldt);
+        manual = false;
+    }
+
+private:
+
+    enum class Step { _1, _2, _3, _4 };
+    Step step = Step::_1;
+    const int fd;
+    bool manual = false;
+    termios oldt;
+    termios newt;
+};
+
+//
 
-class LinuxKeyboard : public InputDevice
+class LinuxKeyboard : public TerminalKeyDecoder
 {
 public:
     explicit LinuxKeyboard(Scheduler& _scheduler) :
-        InputDevice(_scheduler),
+        TerminalKeyDecoder(_scheduler),
         enabled(false),
         servant( [this]() noexcept { Read(); } )
     {
@@ -144,8 +254,16 @@ private:
                     std::unique_lock<std::mutex> lock(mtx);
                     cv.wait(lock, [this]{ return enabled; }); // release mtx, suspend thread execution until enabled becomes true
                 }
-                auto k = Get();
-                Notify(k);
+                is.WaitKbHit();
+                // read all the chars available with a single call
+                const auto size = read(STDIN_FILENO, buffer.data(), buffer.size());
+                if (size < 0 && errno == EINTR)
+                    continue;
+                if (size <= 0) // stdin closed
+                    Enqueue(std::make_pair(KeyType::eof,' '));
+                for (ssize_t i = 0; i < size; ++i)
+                    Decode(buffer[static_cast<std::size_t>(i)]);
+                Flush();
             }
         }
         catch(const std::exception&)
@@ -154,84 +272,13 @@ private:
         }
     }
 
-    char GetChar()
-    {
-        char buffer = 0;
-        auto unused = read(0, &buffer, 1);
-        static_cast<void>(unused); // silence unused warn
-        return buffer;
-    }
-
-    std::pair<KeyType,char> Get()
-    {
-        is.WaitKbHit();
-
-        auto ch = GetChar();
-        switch(ch)
-        {
-            case EOF:
-            case 4:  // EOT
-                return std::make_pair(KeyType::eof,' ');
-                break;
-            case 127:
-            case 8:
-                return std::make_pair(KeyType::backspace,' '); break;
-            case 10: return std::make_pair(KeyType::ret,' '); break;
-            case 12: return std::make_pair(KeyType::clear, ' '); break;
-            case 27: // symbol
-                ch = GetChar();
-                if ( ch == 91 ) // arrow keys
-                {
-                    ch = GetChar();
-                    switch( ch )
-                    {
-                        case 51:
-                            ch = GetChar();
-                            if ( ch == 126 ) return std::make_pair(KeyType::canc,' ');
-                            else return std::make_pair(KeyType::ignored,' ');
-                            break;
-                        case 65: return std::make_pair(KeyType::up,' ');
-                        case 66: return std::make_pair(KeyType::down,' ');
-                        case 68: return std::make_pair(KeyType::left,' ');
-                        case 67: return std::make_pair(KeyType::right,' ');
-                        case 70: return std::make_pair(KeyType::end,' ');
-                        case 72: return std::make_pair(KeyType::home,' ');
-                        default: return std::make_pair(KeyType::ignored,' ');
-                    }
-                }
-                break;
-            default: // ascii
-            {
-                const char c = static_cast<char>(ch);
-                return std::make_pair(KeyType::ascii,c);
-            }
-        }
-        return std::make_pair(KeyType::ignored,' ');
-    }
-
-    void ToManualMode()
-    {
-        constexpr tcflag_t ICANON_FLAG = ICANON;
-        constexpr tcflag_t ECHO_FLAG = ECHO;
-
-        tcgetattr(STDIN_FILENO, &oldt);
-        newt = oldt;
-        newt.c_lflag &= ~( ICANON_FLAG | ECHO_FLAG );
-        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-    }
-
-    void ToStandardMode()
-    {
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-    }
-
+    std::array<char, 4096> buffer;
     bool enabled;
-    termios oldt;
-    termios newt;
     InputSource is;
-    std::thread servant;
     std::mutex mtx;
     std::condition_variable cv;
+    std::thread servant; // must be the last one: it uses the other members
+
 };
 
 } // namespace detail
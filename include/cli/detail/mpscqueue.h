@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_MPSCQUEUE_H_
+#define CLI_DETAIL_MPSCQUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+namespace cli
+{
+namespace detail
+{
+
+/**
+ * Unbounded lock-free queue for many producers and a single consumer
+ * (Dmitry Vyukov's node based algorithm).
+ *
+ * Push can be called from any thread, Pop and Empty only from the consumer one.
+ * The queue always contains a dummy node: the last element popped.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(new Node), tail(head.load()) {}
+
+    ~MpscQueue()
+    {
+        while (tail != nullptr)
+        {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    // non copyable
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T value)
+    {
+        Node* node = new Node(std::move(value));
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        // a Pop between the exchange and the following store
+        // sees the queue empty
+        prev->next.store(node, std::memory_order_seq_cst);
+    }
+
+    // Moves the first element in value, returning false if the queue is empty
+    bool Pop(T& value)
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return tail->next.load(std::memory_order_seq_cst) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node*> head; // last pushed
+    Node* tail; // dummy node, whose next is the first element
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_MPSCQUEUE_H_
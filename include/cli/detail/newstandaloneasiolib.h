@@ -32,6 +32,7 @@
 
 #include <asio/version.hpp>
 #include <asio.hpp>
+#include <memory>
 
 namespace cli
 {
@@ -53,15 +54,36 @@ public:
     public:
         explicit Executor(ContextType& ios) :
             executor(ios.get_executor()) {}
-        explicit Executor(asio::ip::tcp::socket& socket) :
+        explicit Executor(asio::generic::stream_protocol::socket& socket) :
             executor(socket.get_executor()) {}
         template <typename T> void Post(T&& t) { asio::post(executor, std::forward<T>(t)); }
+        // An executor that runs the tasks posted one at a time,
+        // even when the context is run by more threads
+        static Executor Strand(ContextType& ios)
+        {
+#if ASIO_VERSION >= 101400
+            return Executor(AsioExecutor(asio::make_strand(ios)));
+#else
+            return Executor(AsioExecutor(asio::io_context::strand(ios)));
+#endif
+        }
+        // A timer whose handlers run on this executor
+        // (on its context, with the versions without make_strand)
+        std::shared_ptr<asio::steady_timer> Timer() const
+        {
+#if ASIO_VERSION >= 101400
+            return std::make_shared<asio::steady_timer>(executor);
+#else
+            return std::make_shared<asio::steady_timer>(static_cast<ContextType&>(executor.context()));
+#endif
+        }
     private:
 #if ASIO_VERSION >= 101700
     using AsioExecutor = asio::any_io_executor;
 #else
     using AsioExecutor = asio::executor;
 #endif
+        explicit Executor(AsioExecutor _executor) : executor(std::move(_executor)) {}
          AsioExecutor executor;
     };
 
@@ -70,11 +92,53 @@ public:
         return asio::ip::make_address(address);
     }
 
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    // The endpoint of the unix domain socket bound to path
+    static asio::generic::stream_protocol::endpoint LocalEndpoint(const std::string& path)
+    {
+        return asio::local::stream_protocol::endpoint(path);
+    }
+#endif
+
     static auto MakeWorkGuard(ContextType& context)
     {
         return asio::make_work_guard(context);
     }
 
+    // Accept a connection on a socket bound to a new strand, so the handlers
+    // of different connections can run in parallel when the context
+    // is run by more threads, while the ones of the same connection never do.
+    template <typename Handler>
+    static void AsyncAcceptOnStrand(asio::basic_socket_acceptor<asio::generic::stream_protocol>& acceptor, Handler&& handler)
+    {
+#if ASIO_VERSION >= 101400
+        acceptor.async_accept(asio::make_strand(acceptor.get_executor()), std::forward<Handler>(handler));
+#else
+        // sockets cannot be bound to a strand: the context must be run by one thread only
+        acceptor.async_accept(std::forward<Handler>(handler));
+#endif
+    }
+
+    // Like the previous one, but the socket accepted belongs to context
+    // instead of the context of the acceptor (see Server::Shards)
+    template <typename Handler>
+    static void AsyncAcceptOnStrand(asio::basic_socket_acceptor<asio::generic::stream_protocol>& acceptor, ContextType& context, Handler&& handler)
+    {
+#if ASIO_VERSION >= 101400
+        acceptor.async_accept(asio::make_strand(context), std::forward<Handler>(handler));
+#else
+        // sockets cannot be bound to a strand: the context must be run by one thread only
+        acceptor.async_accept(context, std::forward<Handler>(handler));
+#endif
+    }
+
+    using SteadyTimer = asio::steady_timer;
+
+    static void ExpiresAfter(SteadyTimer& timer, std::chrono::steady_clock::duration d)
+    {
+        timer.expires_after(d);
+    }
+
     static void Reset(WorkGuard& wg)
     {
         wg.reset();
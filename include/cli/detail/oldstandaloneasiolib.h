@@ -33,6 +33,8 @@
 #define ASIO_STANDALONE 1
 
 #include <asio.hpp>
+#include <memory>
+#include "../task.h"
 
 namespace cli
 {
@@ -54,9 +56,20 @@ public:
     public:
         explicit Executor(ContextType& _ios) :
             ios(_ios) {}
-        explicit Executor(asio::ip::tcp::socket& socket) :
+        explicit Executor(asio::generic::stream_protocol::socket& socket) :
             ios(socket.get_io_service()) {}
         template <typename T> void Post(T&& t) { ios.post(std::forward<T>(t)); }
+        // the handlers must be copyable with this version of asio
+        void Post(Task&& t)
+        {
+            auto task = std::make_shared<Task>(std::move(t));
+            ios.post([task](){ (*task)(); });
+        }
+        // With this version of asio the tasks are serialized only
+        // when the context is run by one thread
+        static Executor Strand(ContextType& _ios) { return Executor(_ios); }
+        // A timer on the context of the executor
+        std::shared_ptr<asio::steady_timer> Timer() const { return std::make_shared<asio::steady_timer>(ios); }
     private:
         ContextType& ios;
     };
@@ -66,12 +79,43 @@ public:
         return asio::ip::address::from_string(address);
     }
 
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    // The endpoint of the unix domain socket bound to path
+    static asio::generic::stream_protocol::endpoint LocalEndpoint(const std::string& path)
+    {
+        return asio::local::stream_protocol::endpoint(path);
+    }
+#endif
+
     static auto MakeWorkGuard(ContextType& context)
     {
         asio::io_service::work work(context);
         return work;
     }
 
+    // Sockets cannot be bound to a strand with this version of asio:
+    // the context must be run by one thread only.
+    template <typename Handler>
+    static void AsyncAcceptOnStrand(asio::basic_socket_acceptor<asio::generic::stream_protocol>& acceptor, Handler&& handler)
+    {
+        acceptor.async_accept(std::forward<Handler>(handler));
+    }
+
+    // Like the previous one, but the socket accepted belongs to context
+    // instead of the context of the acceptor (see Server::Shards)
+    template <typename Handler>
+    static void AsyncAcceptOnStrand(asio::basic_socket_acceptor<asio::generic::stream_protocol>& acceptor, ContextType& context, Handler&& handler)
+    {
+        acceptor.async_accept(context, std::forward<Handler>(handler));
+    }
+
+    using SteadyTimer = asio::steady_timer;
+
+    static void ExpiresAfter(SteadyTimer& timer, std::chrono::steady_clock::duration d)
+    {
+        timer.expires_from_now(d);
+    }
+
     static void Reset(WorkGuard& /*wg*/)
     {
     }
@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_OUTPUTFILTER_H_
+#define CLI_DETAIL_OUTPUTFILTER_H_
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+#include "split.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// A filter of the lines of output of a command (see OutputFilter)
+class LineFilter
+{
+public:
+    virtual ~LineFilter() = default;
+    // True if line (without its newline) goes on to the next filter
+    virtual bool Pass(const std::string& line) = 0;
+    // True when no other line can pass
+    virtual bool Exhausted() const { return false; }
+    // Appends the lines to write at the end of the output (e.g., a count)
+    virtual void End(std::vector<std::string>& /*lines*/) const {}
+};
+
+// "include text": the lines containing text
+class IncludeFilter : public LineFilter
+{
+public:
+    explicit IncludeFilter(std::string _text) : text(std::move(_text)) {}
+    bool Pass(const std::string& line) override { return line.find(text) != std::string::npos; }
+private:
+    const std::string text;
+};
+
+// "exclude text": the lines not containing text
+class ExcludeFilter : public LineFilter
+{
+public:
+    explicit ExcludeFilter(std::string _text) : text(std::move(_text)) {}
+    bool Pass(const std::string& line) override { return line.find(text) == std::string::npos; }
+private:
+    const std::string text;
+};
+
+// "head [n]": the first n lines (10 by default)
+class HeadFilter : public LineFilter
+{
+public:
+    explicit HeadFilter(std::size_t _lines) : lines(_lines) {}
+    bool Pass(const std::string& /*line*/) override
+    {
+        if (passed == lines)
+            return false;
+        ++passed;
+        return true;
+    }
+    bool Exhausted() const override { return passed == lines; }
+private:
+    const std::size_t lines;
+    std::size_t passed = 0;
+};
+
+// "count": the number of lines, in place of them
+class CountFilter : public LineFilter
+{
+public:
+    bool Pass(const std::string& /*line*/) override
+    {
+        ++lines;
+        return false;
+    }
+    void End(std::vector<std::string>& result) const override { result.push_back(std::to_string(lines)); }
+private:
+    std::size_t lines = 0;
+};
+
+// The output of a command going through a chain of line filters,
+// given after the command: "show log | include error | head 5".
+// It replaces the streambuf of the output stream of the session while the command runs,
+// and writes on the original one the lines passing all the filters.
+class OutputFilter : public std::streambuf
+{
+public:
+    // The filters after the first '|' of line (outside the quoted tokens)
+    // starting a valid chain, setting command to the line before it,
+    // or nullptr if there's no such '|'.
+    static std::unique_ptr<OutputFilter> Parse(const std::string& line, std::string& command)
+    {
+        for (auto pipe = FindUnquoted(line, '|'); pipe != std::string::npos; pipe = FindUnquoted(line, '|', pipe + 1))
+        {
+            std::unique_ptr<OutputFilter> filter(new OutputFilter);
+            if (filter->ParseChain(line, pipe))
+            {
+                const auto last = line.find_last_not_of(" \t", pipe - (pipe > 0 ? 1 : 0));
+                command = (pipe == 0 || last == std::string::npos) ? std::string{} : line.substr(0, last + 1);
+                return filter;
+            }
+        }
+        return nullptr;
+    }
+
+    // Make the output written on out go through the filters, until Detach.
+    // exhausted is called when no other line can pass the filters
+    // (the command can stop).
+    void Attach(std::ostream& out, std::function<void()> _exhausted)
+    {
+        exhausted = std::move(_exhausted);
+        target = out.rdbuf(this);
+    }
+
+    // Filter the output written so far, including the last line even without a newline
+    void Flush()
+    {
+        Drain();
+        if (!line.empty())
+            Write(0, false);
+        line.clear();
+    }
+
+    // Write the lines of the filters for the end of the output (e.g., a count)
+    void End()
+    {
+        for (std::size_t i = 0; i < filters.size(); ++i)
+        {
+            std::vector<std::string> lines;
+            filters[i]->End(lines);
+            for (auto& l: lines)
+            {
+                line = std::move(l);
+                Write(i + 1, true);
+            }
+        }
+        line.clear();
+    }
+
+    // Give out its streambuf back: the output not flushed is thrown away
+    void Detach(std::ostream& out)
+    {
+        out.rdbuf(target);
+        target->pubsync();
+    }
+
+    // The streambuf replaced
+    std::streambuf* Target() const { return target; }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        Drain();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    // the line not ended yet is kept
+    int sync() override
+    {
+        Drain();
+        return target->pubsync();
+    }
+
+    // The position of the output written on the original streambuf
+    // (e.g., to count the bytes sent by a command)
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (off != 0 || dir != std::ios_base::cur || which != std::ios_base::out)
+            return pos_type(off_type(-1));
+        Drain();
+        return target->pubseekoff(0, dir, which);
+    }
+
+private:
+    OutputFilter() { setp(buffer, buffer + sizeof(buffer)); }
+
+    bool ParseChain(const std::string& cmdLine, std::size_t pipe)
+    {
+        std::vector<std::string> tokens;
+        while (pipe != std::string::npos)
+        {
+            const auto next = FindUnquoted(cmdLine, '|', pipe + 1);
+            split(tokens, cmdLine.substr(pipe + 1, next == std::string::npos ? std::string::npos : next - pipe - 1));
+            auto f = Make(tokens);
+            if (!f)
+                return false;
+            filters.push_back(std::move(f));
+            pipe = next;
+        }
+        return true;
+    }
+
+    static std::unique_ptr<LineFilter> Make(const std::vector<std::string>& tokens)
+    {
+        if (tokens.empty())
+            return nullptr;
+        const std::string& name = tokens[0];
+        if (name == "include" && tokens.size() == 2)
+            return std::make_unique<IncludeFilter>(tokens[1]);
+        if (name == "exclude" && tokens.size() == 2)
+            return std::make_unique<ExcludeFilter>(tokens[1]);
+        if (name == "count" && tokens.size() == 1)
+            return std::make_unique<CountFilter>();
+        if (name == "head" && tokens.size() == 1)
+            return std::make_unique<HeadFilter>(10);
+        if (name == "head" && tokens.size() == 2 && tokens[1].size() < 10 &&
+            std::all_of(tokens[1].begin(), tokens[1].end(), [](char c){ return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+            return std::make_unique<HeadFilter>(std::stoul(tokens[1]));
+        return nullptr;
+    }
+
+    // Split the chars of the buffer in lines, and filter the lines completed
+    void Drain()
+    {
+        const char* p = pbase();
+        const char* const end = pptr();
+        while (p != end)
+        {
+            const char* newline = std::find(p, end, '\n');
+            line.append(p, newline);
+            if (newline == end)
+                break;
+            Write(0, true);
+            line.clear();
+            p = newline + 1;
+        }
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+    // Write line on the original streambuf if it passes the filters from the one given
+    void Write(std::size_t from, bool newline)
+    {
+        for (std::size_t i = from; i < filters.size(); ++i)
+        {
+            const bool pass = filters[i]->Pass(line);
+            if (!done && filters[i]->Exhausted())
+            {
+                done = true;
+                if (exhausted)
+                    exhausted();
+            }
+            if (!pass)
+                return;
+        }
+        target->sputn(line.data(), static_cast<std::streamsize>(line.size()));
+        if (newline)
+            target->sputc('\n');
+    }
+
+    std::vector<std::unique_ptr<LineFilter>> filters;
+    std::streambuf* target = nullptr;
+    std::function<void()> exhausted;
+    bool done = false; // exhausted has been called
+    std::string line; // the chars of the line not ended yet
+    char buffer[512];
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_OUTPUTFILTER_H_
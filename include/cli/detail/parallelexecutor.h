@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_PARALLELEXECUTOR_H_
+#define CLI_DETAIL_PARALLELEXECUTOR_H_
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../cli.h" // CliSession
+
+namespace cli
+{
+namespace detail
+{
+
+// The output buffer of a JobSession, as a base class
+// so that it's constructed before the CliSession using it
+struct JobBuffer
+{
+    std::ostringstream buffer;
+};
+
+// A session whose output goes to a buffer,
+// used to run a command line on behalf of another session
+class JobSession : private JobBuffer, public CliSession
+{
+public:
+    explicit JobSession(Cli& _cli) : CliSession(_cli, buffer, 1, false) {}
+
+    // Execute cmd in menu, writing its output in output.
+    // Returns false if the command is wrong or it threw.
+    bool Run(Menu* menu, const std::string& cmd, const std::string& location, std::string& output)
+    {
+        buffer.str({});
+        Current(menu);
+        ErrorLocation(location);
+        const bool ok = Feed(cmd);
+        output = buffer.str();
+        return ok;
+    }
+};
+
+// Executes command lines on a pool of threads, each one having its own session,
+// and gives back their results in the order of submission.
+class ParallelExecutor
+{
+public:
+    struct Result
+    {
+        std::string output;
+        bool ok = true;
+    };
+
+    ParallelExecutor(Cli& cli, std::size_t threads)
+    {
+        if (threads == 0)
+            threads = 1;
+        for (std::size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this, &cli](){ Work(cli); });
+    }
+
+    ~ParallelExecutor() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        toRun.notify_all();
+        for (auto& w: workers)
+            w.join();
+    }
+
+    // disable value semantics
+    ParallelExecutor(const ParallelExecutor&) = delete;
+    ParallelExecutor& operator = (const ParallelExecutor&) = delete;
+
+    // Run cmd in menu. The output of the error handlers is preceded by location.
+    void Submit(Menu* menu, std::string cmd, std::string location)
+    {
+        auto job = std::make_unique<Job>();
+        job->menu = menu;
+        job->cmd = std::move(cmd);
+        job->location = std::move(location);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            queue.push_back(job.get());
+            jobs.push_back(std::move(job));
+        }
+        toRun.notify_one();
+    }
+
+    // The number of jobs submitted whose result has not been taken yet
+    std::size_t Pending() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return jobs.size();
+    }
+
+    // Wait for the oldest job submitted and return its result
+    Result Next()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        assert(!jobs.empty());
+        done.wait(lock, [this](){ return jobs.front()->completed; });
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        return std::move(job->result);
+    }
+
+private:
+    struct Job
+    {
+        Menu* menu = nullptr;
+        std::string cmd;
+        std::string location;
+        Result result;
+        bool completed = false;
+    };
+
+    void Work(Cli& cli)
+    {
+        JobSession session(cli);
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            toRun.wait(lock, [this](){ return stopping || !queue.empty(); });
+            if (queue.empty())
+                return; // stopping
+            Job* job = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            job->result.ok = session.Run(job->menu, job->cmd, job->location, job->result.output);
+            lock.lock();
+            job->completed = true;
+            done.notify_all();
+        }
+    }
+
+    mutable std::mutex mtx;
+    std::condition_variable toRun;
+    std::condition_variable done;
+    std::deque<std::unique_ptr<Job>> jobs; // in submission order, until their result is taken
+    std::deque<Job*> queue; // the jobs to run
+    bool stopping = false;
+    std::vector<std::thread> workers; // last, so that a worker starts after the other members
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_PARALLELEXECUTOR_H_
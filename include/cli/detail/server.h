@@ -30,17 +30,199 @@
 #ifndef CLI_DETAIL_SERVER_H_
 #define CLI_DETAIL_SERVER_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <string>
+#include <system_error>
+#include <vector>
+#if defined(__linux__)
+    #include <sys/socket.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    #include <unistd.h>
+#endif
+#if !defined(_WIN32)
+    #include <cerrno>
+    #include <cstring>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
 
 namespace cli
 {
 namespace detail
 {
 
+// What a session does when its output queue exceeds the high-water mark
+enum class OutputOverflow
+{
+    pause, // stop reading the client input until the queue drains
+    disconnect // drop the session
+};
+
+// What a session does with the text written on Cli::cout()
+// when its output queue exceeds the broadcast high-water mark
+enum class BroadcastOverflow
+{
+    drop, // discard the text
+    coalesce, // keep only the last text, and send it when the queue drains
+    disconnect // drop the session
+};
+
+// Limits applied by a Server to each of its sessions (zero means no limit)
+struct SessionLimits
+{
+    // max time without input from the client, while no command is being typed
+    std::chrono::milliseconds idleTimeout{0};
+    // max time without input from the client, while a command is being typed
+    std::chrono::milliseconds readTimeout{0};
+    // max bytes of output waiting to be sent to the client
+    std::size_t outputHighWaterMark = 0;
+    OutputOverflow outputOverflow = OutputOverflow::pause;
+    // max bytes of output waiting to be sent to the client, to queue a broadcast
+    std::size_t broadcastHighWaterMark = 0;
+    BroadcastOverflow broadcastOverflow = BroadcastOverflow::drop;
+    // max bytes of output waiting to be sent to the client, to generate more
+    // of a streamed command (see Streamed)
+    std::size_t streamBacklog = 64 * 1024;
+};
+
+// How a Server spreads the new sessions over the schedulers of a group (see Server::Shards)
+enum class SessionPlacement
+{
+    roundRobin, // each scheduler in turn
+    leastLoaded // the scheduler with the fewest open sessions
+};
+
+// The path of a unix domain socket, for a Server listening on it instead of a TCP port
+struct LocalSocket
+{
+    explicit LocalSocket(std::string _path) : path(std::move(_path)) {}
+    std::string path;
+};
+
+// The identity of the process connected to a unix domain socket (see Server::PeerFilter)
+struct PeerCredentials
+{
+    long pid = -1; // -1 when the platform doesn't tell it
+    long uid = -1;
+    long gid = -1;
+};
+
+// Read the credentials of the peer of a unix domain socket
+// (SO_PEERCRED on linux, getpeereid on macOS and the BSDs).
+// Returns false when they are not available.
+template <typename Socket>
+bool ReadPeerCredentials(Socket& socket, PeerCredentials& credentials)
+{
+#if defined(__linux__)
+    struct ucred uc;
+    socklen_t length = sizeof(uc);
+    if (getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &uc, &length) != 0)
+        return false;
+    credentials.pid = uc.pid;
+    credentials.uid = uc.uid;
+    credentials.gid = uc.gid;
+    return true;
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(socket.native_handle(), &uid, &gid) != 0)
+        return false;
+    credentials.uid = static_cast<long>(uid);
+    credentials.gid = static_cast<long>(gid);
+    return true;
+#else
+    (void)socket;
+    (void)credentials;
+    return false;
+#endif
+}
+
+// The identity of the file at a path, to tell whether it's still the one created
+struct FileIdentity
+{
+    bool exists = false;
+    unsigned long long device = 0;
+    unsigned long long inode = 0;
+    bool operator==(const FileIdentity& other) const { return exists == other.exists && device == other.device && inode == other.inode; }
+};
+
+inline FileIdentity IdentifyFile(const std::string& path)
+{
+    FileIdentity id;
+#if !defined(_WIN32)
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0)
+    {
+        id.exists = true;
+        id.device = static_cast<unsigned long long>(st.st_dev);
+        id.inode = static_cast<unsigned long long>(st.st_ino);
+    }
+#else
+    (void)path;
+#endif
+    return id;
+}
+
+// Make room for a unix domain socket at path: a socket left by a previous run
+// (nobody accepts on it) is removed, while a file that isn't a socket
+// or a socket where a server still listens make it throw std::system_error.
+inline const std::string& ReclaimLocalPath(const std::string& path)
+{
+#if !defined(_WIN32)
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+        return path; // nothing there
+    if (!S_ISSOCK(st.st_mode))
+        throw std::system_error(std::make_error_code(std::errc::file_exists), path + " is not a socket");
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return path; // the bind reports it
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+    const bool live = connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    const int error = errno;
+    close(fd);
+    if (live)
+        throw std::system_error(std::make_error_code(std::errc::address_in_use), path);
+    if (error == ECONNREFUSED)
+        unlink(path.c_str());
+#else
+    std::remove(path.c_str());
+#endif
+    return path;
+}
+
+template <typename ASIOLIB> class Server;
+
+// A Session is also the std::streambuf of its output stream.
+// The output is collected in the streambuf put area, encoded
+// and queued when the put area is full or the stream is flushed,
+// and sent with one async_write at a time: while a write is in progress
+// the following output accumulates in the queue, that is sent as a whole
+// as soon as the write completes.
+// All the handlers of a session run on the executor of its socket
+// (a strand, when the Server can create one), so the session is never
+// accessed by two threads at the same time.
 class Session : public std::enable_shared_from_this<Session>, public std::streambuf
 {
 public:
+    // A TCP or a unix domain socket, according to the server
+    using Socket = asiolib::generic::stream_protocol::socket;
+
     ~Session() override = default;
     virtual void Start()
     {
@@ -50,12 +232,25 @@ public:
 
 protected:
 
-    explicit Session(asiolib::ip::tcp::socket _socket) : socket(std::move(_socket)), outStream( this ) {}
+    explicit Session(Socket _socket) : socket(std::move(_socket)), outStream( this )
+    {
+        setp(outBuffer, outBuffer + max_out_length);
+    }
+
+    // Tell if the client is typing a command, to choose the timeout
+    // that applies to the session (see SessionLimits)
+    void LineInProgress(bool typing) { lineInProgress = typing; }
 
+    // Called when the client has been silent longer than the timeout
+    virtual void OnTimeout() { Disconnect(); }
+
+    // Close the connection as soon as the output queued so far has been sent
     virtual void Disconnect()
     {
-        socket.shutdown(asiolib::ip::tcp::socket::shutdown_both);
-        socket.close();
+        FlushPutArea();
+        closing = true;
+        if (!writing)
+            Close();
     }
 
     virtual void Read()
@@ -70,20 +265,54 @@ protected:
                   OnError();
               else
               {
-                  OnDataReceived( std::string( data, length ));
-                  Read();
+                  lastInput = Now();
+                  OnDataReceived( data, length );
+                  if (PauseInput())
+                      readPaused = true; // Read() again when the output drains
+                  else
+                      Read();
               }
           });
     }
 
+    // Throw away the output not sent yet (the write in progress, if any, completes)
+    void DiscardPending()
+    {
+        written += static_cast<std::size_t>(pptr() - pbase());
+        setp(outBuffer, outBuffer + max_out_length);
+        pending.clear();
+    }
+
+    // Queue msg as it is (i.e., without encoding it) after the output
+    // written so far, and start sending it.
     virtual void Send(const std::string& msg)
     {
-        asiolibec::error_code ec;
-        asiolib::write(socket, asiolib::buffer(msg), ec);
-        if ((ec == asiolib::error::eof) || (ec == asiolib::error::connection_reset))
-            OnDisconnect();
-        else if (ec)
-            OnError();
+        FlushPutArea();
+        if (!socket.is_open())
+            return;
+        pending += msg;
+        Write();
+    }
+
+    // Queue the text written on Cli::cout() after the output written so far,
+    // according to the broadcast limits. Like Send, it must run on the session executor.
+    void Broadcast(std::shared_ptr<const std::string> data)
+    {
+        FlushPutArea();
+        if (!socket.is_open())
+            return;
+        if (OverBroadcastMark())
+        {
+            switch (limits.broadcastOverflow)
+            {
+                case BroadcastOverflow::drop: break;
+                case BroadcastOverflow::coalesce: heldBroadcast = std::move(data); break;
+                case BroadcastOverflow::disconnect: Drop(); break;
+            }
+            return;
+        }
+        Encode(data->data(), data->size(), pending);
+        Write();
     }
 
     virtual std::ostream& OutStream() { return outStream; }
@@ -91,27 +320,175 @@ protected:
     virtual void OnConnect() = 0;
     virtual void OnDisconnect() = 0;
     virtual void OnError() = 0;
-    virtual void OnDataReceived(const std::string& _data) = 0;
+    // Called with the bytes received by a read (valid only during the call)
+    virtual void OnDataReceived(const char* _data, std::size_t size) = 0;
+
+    // Append to out the encoded version of the size chars starting from data
+    virtual void Encode(const char* data, std::size_t size, std::string& out) const { out.append(data, size); }
 
-    virtual std::string Encode(const std::string& _data) const { return _data; }
+    // True when the output waiting to be sent is over the limit of the streamed commands
+    // (or the connection is closed, and the output would be discarded)
+    bool StreamBacklogged() const { return !socket.is_open() || Backlog() > limits.streamBacklog; }
+
+    // Called when a write completes, before sending the output queued in the meantime
+    virtual void OnWritten() {}
+
+    // Called with all the output queued, when it's about to be written
+    // (e.g., to compress it as a whole)
+    virtual void BeforeWrite(std::string& /*data*/) {}
 
 private:
 
-    // std::streambuf
-    std::streamsize xsputn( const char* s, std::streamsize n ) override
+    template <typename> friend class Server;
+
+    static std::chrono::steady_clock::rep Now() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+    std::size_t Backlog() const { return pending.size() + inFlight.size(); }
+
+    bool OverHighWaterMark() const
+    {
+        return limits.outputHighWaterMark != 0 && Backlog() > limits.outputHighWaterMark;
+    }
+
+    bool OverBroadcastMark() const
+    {
+        return limits.broadcastHighWaterMark != 0 && Backlog() > limits.broadcastHighWaterMark;
+    }
+
+    bool PauseInput() const
     {
-        Send(Encode(std::string(s, s+n)));
-        return n;
+        return limits.outputOverflow == OutputOverflow::pause && OverHighWaterMark();
     }
+
+    // Returns true (only once) when the client has been silent longer than the timeout.
+    // Unlike the other methods, it's called by the server from any thread.
+    bool Expired(std::chrono::steady_clock::time_point now)
+    {
+        const auto timeout = lineInProgress ? limits.readTimeout : limits.idleTimeout;
+        if (timeout.count() == 0)
+            return false;
+        const std::chrono::steady_clock::time_point last{std::chrono::steady_clock::duration{lastInput.load()}};
+        if (now - last < timeout)
+            return false;
+        return !expired.exchange(true);
+    }
+
+    // std::streambuf
     int overflow( int c ) override
     {
-        Send(Encode(std::string(1, static_cast< char >(c))));
-        return c;
+        FlushPutArea();
+        if (c != traits_type::eof())
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        Write();
+        return traits_type::not_eof(c);
+    }
+    int sync() override
+    {
+        FlushPutArea();
+        Write();
+        return 0;
+    }
+    // Only tells the number of chars written so far (see Cli::Metrics)
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (off != 0 || dir != std::ios_base::cur || (which & std::ios_base::out) == 0)
+            return pos_type(off_type(-1));
+        return pos_type(static_cast<off_type>(written + static_cast<std::size_t>(pptr() - pbase())));
+    }
+
+    // move the content of the put area to the queue of data to be sent
+    void FlushPutArea()
+    {
+        if (pptr() == pbase())
+            return;
+        written += static_cast<std::size_t>(pptr() - pbase());
+        if (socket.is_open())
+            Encode(pbase(), static_cast<std::size_t>(pptr() - pbase()), pending);
+        // else the session has been dropped: discard the output
+        setp(outBuffer, outBuffer + max_out_length);
+        if (limits.outputOverflow == OutputOverflow::disconnect && OverHighWaterMark())
+            Drop();
+    }
+
+    // start sending the queued data, if there is no write in progress
+    void Write()
+    {
+        if (writing || pending.empty() || !socket.is_open())
+            return;
+        writing = true;
+        inFlight.swap(pending);
+        BeforeWrite(inFlight);
+        auto self( shared_from_this() );
+        asiolib::async_write(socket, asiolib::buffer(inFlight),
+            [ this, self ]( asiolibec::error_code ec, std::size_t /*length*/ )
+            {
+                writing = false;
+                inFlight.clear();
+                if ((ec == asiolib::error::eof) || (ec == asiolib::error::connection_reset))
+                {
+                    pending.clear();
+                    OnDisconnect();
+                }
+                else if (ec)
+                {
+                    pending.clear();
+                    OnError();
+                }
+                else
+                {
+                    if (readPaused && Backlog() <= limits.outputHighWaterMark / 2)
+                    {
+                        readPaused = false;
+                        Read();
+                    }
+                    if (heldBroadcast && !OverBroadcastMark())
+                    {
+                        Encode(heldBroadcast->data(), heldBroadcast->size(), pending);
+                        heldBroadcast.reset();
+                    }
+                    OnWritten();
+                    if (!pending.empty())
+                        Write();
+                    else if (closing && !writing)
+                        Close();
+                }
+            });
+    }
+
+    // close the connection now, discarding the output not sent yet
+    void Drop()
+    {
+        pending.clear();
+        heldBroadcast.reset();
+        Close();
+    }
+
+    void Close()
+    {
+        asiolibec::error_code ec;
+        socket.shutdown(asiolib::socket_base::shutdown_both, ec);
+        socket.close(ec);
     }
 
-    asiolib::ip::tcp::socket socket;
+    Socket socket;
     enum { max_length = 1024 };
     char data[ max_length ];
+    enum { max_out_length = 4096 };
+    char outBuffer[ max_out_length ];
+    std::string pending; // output waiting for the write in progress to complete
+    std::string inFlight; // output being written
+    std::size_t written = 0; // the chars written on the stream so far
+    std::shared_ptr<const std::string> heldBroadcast; // see BroadcastOverflow::coalesce
+    bool writing = false;
+    bool closing = false;
+    bool readPaused = false;
+    SessionLimits limits; // set by the server before Start()
+    std::atomic<std::chrono::steady_clock::rep> lastInput{Now()};
+    std::atomic<bool> lineInProgress{false};
+    std::atomic<bool> expired{false};
     std::ostream outStream;
 };
 
@@ -125,28 +502,253 @@ public:
     Server& operator = ( const Server& ) = delete;
 
     Server(typename ASIOLIB::ContextType& ios, unsigned short port) :
-        acceptor(ios, asiolib::ip::tcp::endpoint(asiolib::ip::tcp::v4(), port))
+        acceptor(ios, Endpoint(asiolib::ip::tcp::endpoint(asiolib::ip::tcp::v4(), port))),
+        sweepTimer(ios)
     {
         Accept();
     }
     Server(typename ASIOLIB::ContextType& ios, std::string address, unsigned short port) :
-        acceptor(ios, asiolib::ip::tcp::endpoint(ASIOLIB::IpAddressFromString(address), port))
+        acceptor(ios, Endpoint(asiolib::ip::tcp::endpoint(ASIOLIB::IpAddressFromString(address), port))),
+        sweepTimer(ios)
     {
         Accept();
     }
-    virtual ~Server() = default;
+    // Listen on a unix domain socket (where asio supports them).
+    // A socket left at the path by a previous run is replaced (see ReclaimLocalPath),
+    // and the socket is removed when the server is destroyed, if it's still there.
+    Server(typename ASIOLIB::ContextType& ios, const LocalSocket& local) :
+        acceptor(ios, ASIOLIB::LocalEndpoint(ReclaimLocalPath(local.path))),
+        sweepTimer(ios),
+        localPath(local.path),
+        localFile(IdentifyFile(local.path))
+    {
+        Accept();
+    }
+    virtual ~Server()
+    {
+        if (!localPath.empty())
+        {
+            asiolibec::error_code ignored;
+            acceptor.close(ignored);
+            // not the socket of another server started after this one
+            if (IdentifyFile(localPath) == localFile)
+                std::remove(localPath.c_str());
+        }
+    }
     // returns shared_ptr instead of unique_ptr because Session needs to use enable_shared_from_this
-    virtual std::shared_ptr<Session> CreateSession(asiolib::ip::tcp::socket socket) = 0;
+    virtual std::shared_ptr<Session> CreateSession(Session::Socket socket) = 0;
+
+    // The following settings must be done before the scheduler runs.
+
+    // Max number of sessions open at the same time:
+    // the connections beyond it are closed as soon as they're accepted.
+    void MaxSessions(std::size_t n) { maxSessions = n; }
+
+    // Close the sessions whose client sends nothing for this time (see SessionLimits)
+    void IdleTimeout(std::chrono::milliseconds timeout) { limits.idleTimeout = timeout; }
+    void ReadTimeout(std::chrono::milliseconds timeout) { limits.readTimeout = timeout; }
+
+    // Limit the output queued by each session (see OutputOverflow)
+    void OutputHighWaterMark(std::size_t bytes, OutputOverflow policy = OutputOverflow::pause)
+    {
+        limits.outputHighWaterMark = bytes;
+        limits.outputOverflow = policy;
+    }
+
+    // Limit the output queued by each session to accept the text
+    // written on Cli::cout() (see BroadcastOverflow)
+    void BroadcastHighWaterMark(std::size_t bytes, BroadcastOverflow policy = BroadcastOverflow::drop)
+    {
+        limits.broadcastHighWaterMark = bytes;
+        limits.broadcastOverflow = policy;
+    }
+
+    // Limit the output queued by each session to generate more of a streamed command
+    // (see Streamed): the default is 64 KiB
+    void StreamBacklog(std::size_t bytes) { limits.streamBacklog = bytes; }
+
+    // Accept the connections on a unix domain socket only from the processes
+    // whose credentials satisfy filter (e.g., the uid of the server):
+    // where the credentials can't be read, all the connections are refused.
+    // It doesn't apply to TCP.
+    void PeerFilter(std::function<bool(const PeerCredentials&)> filter) { peerFilter = std::move(filter); }
+
+    // Place each new session on one of the schedulers of group, where it stays
+    // until it's closed, while the connections are still accepted on the
+    // context given to the constructor (that can be the one of a scheduler of the group).
+    // The group must outlive the server.
+    template <typename Group>
+    void Shards(Group& group, SessionPlacement _placement = SessionPlacement::leastLoaded)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            shards.clear();
+            for (std::size_t i = 0; i < group.Size(); ++i)
+                shards.push_back(&group[i].AsioContext());
+            load.assign(shards.size(), 0);
+            placement = _placement;
+            nextShard = 0;
+            for (auto& e: sessions)
+                e.shard = noShard; // they stay where they are, uncounted
+        }
+        // the accept pending (posted by the constructor) would place
+        // the next session on the context of the acceptor
+        asiolibec::error_code ignored;
+        acceptor.cancel(ignored);
+        Accept();
+    }
+
 private:
+
+    using Endpoint = asiolib::generic::stream_protocol::endpoint;
+
+    bool Refuse(Session::Socket& socket) const
+    {
+        if (maxSessions != 0 && sessions.size() >= maxSessions)
+            return true;
+        if (localPath.empty() || !peerFilter)
+            return false;
+        PeerCredentials credentials;
+        return !ReadPeerCredentials(socket, credentials) || !peerFilter(credentials);
+    }
+
+    struct Entry
+    {
+        std::weak_ptr<Session> session;
+        typename ASIOLIB::Executor executor; // the strand of the session
+        std::size_t shard; // the index of its scheduler in the group, or noShard
+    };
+
+    enum : std::size_t { noShard = std::numeric_limits<std::size_t>::max() };
+
+    // The scheduler where the next accepted session goes (see Shards)
+    std::size_t NextShard()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (shards.empty())
+            return noShard;
+        if (placement == SessionPlacement::roundRobin)
+            return nextShard++ % shards.size();
+        RemoveClosed();
+        return static_cast<std::size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+    }
+
     void Accept()
     {
-        acceptor.async_accept([this](asiolibec::error_code ec, asiolib::ip::tcp::socket socket)
+        const std::size_t shard = NextShard();
+        auto handler = [this, shard](asiolibec::error_code ec, Session::Socket socket)
             {
-                if (!ec) CreateSession(std::move(socket))->Start();
+                if (ec == asiolib::error::operation_aborted)
+                    return; // the server is being destroyed (or the accept moved to the shards)
+                if (!ec)
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    RemoveClosed();
+                    if (Refuse(socket))
+                    {
+                        asiolibec::error_code ignored;
+                        socket.close(ignored);
+                    }
+                    else
+                    {
+                        // the output is interactive: the small writes (echo, prompt)
+                        // must not wait for the ack of the previous ones (Nagle)
+                        asiolibec::error_code ignored;
+                        if (localPath.empty())
+                            socket.set_option(asiolib::ip::tcp::no_delay(true), ignored);
+                        // the session starts on its own strand too
+                        typename ASIOLIB::Executor executor(socket);
+                        auto session = CreateSession(std::move(socket));
+                        session->limits = limits;
+                        sessions.push_back(Entry{session, executor, shard});
+                        if (shard != noShard)
+                            ++load[shard];
+                        executor.Post([session](){ session->Start(); });
+                        StartSweep();
+                    }
+                }
                 Accept();
+            };
+        // each session gets its own strand (on the context of its scheduler, if any)
+        if (shard == noShard)
+            ASIOLIB::AsyncAcceptOnStrand(acceptor, handler);
+        else
+            ASIOLIB::AsyncAcceptOnStrand(acceptor, *shards[shard], handler);
+    }
+
+    void RemoveClosed()
+    {
+        for (auto i = sessions.begin(); i != sessions.end();)
+        {
+            if (i->session.expired())
+            {
+                if (i->shard != noShard)
+                    --load[i->shard];
+                i = sessions.erase(i);
+            }
+            else
+                ++i;
+        }
+    }
+
+    // Instead of having a timer for each session,
+    // a single timer checks all the sessions periodically,
+    // starting when the first session is accepted.
+    void StartSweep()
+    {
+        if (sweeping || (limits.idleTimeout.count() == 0 && limits.readTimeout.count() == 0))
+            return;
+        sweeping = true;
+        Sweep();
+    }
+
+    void Sweep()
+    {
+        ASIOLIB::ExpiresAfter(sweepTimer, SweepPeriod());
+        sweepTimer.async_wait([this](const asiolibec::error_code& ec)
+            {
+                if (ec)
+                    return; // the server is being destroyed
+                const auto now = std::chrono::steady_clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    RemoveClosed();
+                    for (auto& e: sessions)
+                    {
+                        auto session = e.session.lock();
+                        if (session && session->Expired(now))
+                            e.executor.Post([session](){ session->OnTimeout(); });
+                    }
+                }
+                Sweep();
             });
     }
-    asiolib::ip::tcp::acceptor acceptor;
+
+    // the timeouts are detected with a delay up to 1/4 of their duration
+    std::chrono::milliseconds SweepPeriod() const
+    {
+        auto period = std::chrono::milliseconds::max();
+        if (limits.idleTimeout.count() != 0)
+            period = std::min(period, limits.idleTimeout);
+        if (limits.readTimeout.count() != 0)
+            period = std::min(period, limits.readTimeout);
+        return std::max(period / 4, std::chrono::milliseconds(1));
+    }
+
+    asiolib::basic_socket_acceptor<asiolib::generic::stream_protocol> acceptor;
+    typename ASIOLIB::SteadyTimer sweepTimer;
+    const std::string localPath; // empty for TCP
+    const FileIdentity localFile; // the socket created at localPath
+    std::function<bool(const PeerCredentials&)> peerFilter;
+    bool sweeping = false;
+    std::size_t maxSessions = 0;
+    SessionLimits limits;
+    std::mutex mtx; // protects sessions, used by the accept and timer handlers
+    std::list<Entry> sessions; // Entry is not assignable with some asio versions
+    std::vector<typename ASIOLIB::ContextType*> shards; // see Shards
+    std::vector<std::size_t> load; // the open sessions of each shard
+    SessionPlacement placement = SessionPlacement::leastLoaded;
+    std::size_t nextShard = 0;
 };
 
 
@@ -41,80 +41,91 @@ namespace cli
 namespace detail
 {
 
+// Splits a line into tokens.
+// Rather than evaluating one character at a time, each state consumes
+// the whole run of characters it's interested to, so that every run of
+// plain characters is appended to its token with a single copy.
+// The input is not copied and the strings already present in the output
+// vector are reused, to save allocations when the same vector is used
+// to split many lines.
 class Text
 {
 public:
-    explicit Text(std::string _input) : input(std::move(_input))
+    explicit Text(const std::string& _input) : input(_input)
     {
     }
     void SplitInto(std::vector<std::string>& strs)
     {
-        Reset();
-        for (char c: input)
-            Eval(c);
+        Reset(strs);
+        std::size_t pos = 0;
+        while (pos < input.size())
+            pos = Eval(pos);
+        splitResult->resize(tokens);
         RemoveEmptyEntries();
-        splitResult.swap(strs); // puts the result back in strs
     }
 private:
-    void Reset()
+    void Reset(std::vector<std::string>& strs)
     {
         state = State::space;
         prev_state = State::space;
         sentence_type = SentenceType::double_quote;
-        splitResult.clear();
+        splitResult = &strs;
+        tokens = 0;
     }
 
-    void Eval(char c)
+    // Each EvalXXX method consumes the input starting from pos
+    // and returns the position of the first character not consumed.
+    std::size_t Eval(std::size_t pos)
     {
         switch(state)
         {
             case State::space:
-                EvalSpace(c);
-                break;
+                return EvalSpace(pos);
             case State::word:
-                EvalWord(c);
-                break;
+                return EvalWord(pos);
             case State::sentence:
-                EvalSentence(c);
-                break;
+                return EvalSentence(pos);
             case State::escape:
-                EvalEscape(c);
-                break;
+                return EvalEscape(pos);
         }
+        assert(false);
+        return input.size();
     }
 
-    void EvalSpace(char c)
+    std::size_t EvalSpace(std::size_t pos)
     {
-        if (c == ' ' || c == '\t' || c == '\n')
-        {
-            // do nothing
-        }
-        else if (c == '"' || c == '\'')
+        pos = input.find_first_not_of(Spaces(), pos);
+        if (pos == std::string::npos)
+            return input.size();
+
+        const char c = input[pos];
+        if (c == '"' || c == '\'')
         {
             NewSentence(c);
+            return pos+1;
         }
-        else if (c == '\\')
+        if (c == '\\')
         {
             // This is the case where the first character of a word is escaped.
             // Should come back into the word state after this.
             prev_state = State::word;
             state = State::escape;
-            splitResult.emplace_back("");
-        }
-        else
-        {
-            state = State::word;
-            splitResult.emplace_back(1, c);
+            NewToken();
+            return pos+1;
         }
+        state = State::word;
+        NewToken();
+        return EvalWord(pos);
     }
 
-    void EvalWord(char c)
+    std::size_t EvalWord(std::size_t pos)
     {
-        if (c == ' ' || c == '\t' || c == '\n')
-        {
-            state = State::space;
-        }
-        else if (c == '"' || c == '\'')
+        const auto end = Append(pos, input.find_first_of(" \t\n\"'\\", pos));
+        if (end == input.size())
+            return end;
+
+        const char c = input[end];
+        if (c == '"' || c == '\'')
         {
             NewSentence(c);
         }
@@ -123,74 +134,98 @@ private:
             prev_state = state;
             state = State::escape;
         }
-        else
+        else // space
         {
-            assert(!splitResult.empty());
-            splitResult.back() += c;
+            state = State::space;
         }
+        return end+1;
     }
 
-    void EvalSentence(char c)
+    std::size_t EvalSentence(std::size_t pos)
     {
-        if (c == '"' || c == '\'')
-        {
-            auto new_type = c == '"' ? SentenceType::double_quote : SentenceType::quote;
-            if (new_type == sentence_type)
-                state = State::space;
-            else
-            {
-                assert(!splitResult.empty());
-                splitResult.back() += c;
-            }
-        }
-        else if (c == '\\')
+        // the other kind of quote does not close the sentence
+        const char* stops = (sentence_type == SentenceType::double_quote ? "\"\\" : "'\\");
+        const auto end = Append(pos, input.find_first_of(stops, pos));
+        if (end == input.size())
+            return end;
+
+        if (input[end] == '\\')
         {
             prev_state = state;
             state = State::escape;
         }
-        else
+        else // closing quote
         {
-            assert(!splitResult.empty());
-            splitResult.back() += c;
+            state = State::space;
         }
+        return end+1;
     }
 
-    void EvalEscape(char c)
+    std::size_t EvalEscape(std::size_t pos)
     {
-        assert(!splitResult.empty());
+        const char c = input[pos];
         if (c != '"' && c != '\'' && c != '\\')
-            splitResult.back() += "\\";
-        splitResult.back() += c;
+            CurrentToken() += '\\';
+        CurrentToken() += c;
         state = prev_state;
+        return pos+1;
     }
 
     void NewSentence(char c)
     {
         state = State::sentence;
         sentence_type = ( c == '"' ? SentenceType::double_quote : SentenceType::quote);
-        splitResult.emplace_back("");
+        NewToken();
+    }
+
+    void NewToken()
+    {
+        if (tokens < splitResult->size())
+            (*splitResult)[tokens].clear();
+        else
+            splitResult->emplace_back();
+        ++tokens;
+    }
+
+    std::string& CurrentToken()
+    {
+        assert(tokens > 0);
+        return (*splitResult)[tokens-1];
+    }
+
+    // Append to the current token the characters in [pos, end)
+    // and returns end (the input size if end is npos)
+    std::size_t Append(std::size_t pos, std::size_t end)
+    {
+        if (end == std::string::npos)
+            end = input.size();
+        CurrentToken().append(input, pos, end-pos);
+        return end;
     }
 
     void RemoveEmptyEntries()
     {
         // remove null entries from the vector:
-        splitResult.erase(
+        splitResult->erase(
             std::remove_if(
-                splitResult.begin(),
-                splitResult.end(),
+                splitResult->begin(),
+                splitResult->end(),
                 [](const std::string& s){ return s.empty(); }
             ),
-            splitResult.end()
+            splitResult->end()
         );
     }
 
+    static const char* Spaces() { return " \t\n"; }
+
     enum class State { space, word, sentence, escape };
     enum class SentenceType { quote, double_quote };
     State state = State::space;
     State prev_state = State::space;
     SentenceType sentence_type = SentenceType::double_quote;
-    const std::string input;
-    std::vector<std::string> splitResult;
+    const std::string& input;
+    std::vector<std::string>* splitResult = nullptr;
+    std::size_t tokens = 0; // number of tokens in splitResult used so far
 };
 
 // Split the string input into a vector of strings.
@@ -233,6 +268,30 @@ inline void split(std::vector<std::string>& strs, const std::string& input)
     sentence.SplitInto(strs);
 }
 
+// The position of the first char c of input from pos that split would not take
+// as part of a quoted or escaped token (e.g., '|' in: a "b|c" d\|e | f),
+// or npos if there's none.
+inline std::size_t FindUnquoted(const std::string& input, char c, std::size_t pos = 0)
+{
+    char quote = 0; // the quote of the current sentence, if any
+    for (; pos < input.size(); ++pos)
+    {
+        const char x = input[pos];
+        if (x == '\\')
+            ++pos; // the next char is escaped
+        else if (quote != 0)
+        {
+            if (x == quote)
+                quote = 0;
+        }
+        else if (x == '"' || x == '\'')
+            quote = x;
+        else if (x == c)
+            return pos;
+    }
+    return std::string::npos;
+}
+
 } // namespace detail
 } // namespace cli
 
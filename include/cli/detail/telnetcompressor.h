@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TELNETCOMPRESSOR_H_
+#define CLI_DETAIL_TELNETCOMPRESSOR_H_
+
+/**
+ * Compression of the telnet output (MCCP2, telnet option 86).
+ *
+ * It's compiled only when the symbol CLI_TELNET_MCCP is defined,
+ * and then the application must be linked with zlib.
+ */
+
+#if defined(CLI_TELNET_MCCP)
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+namespace cli
+{
+namespace detail
+{
+
+// The zlib stream of the output of a telnet session.
+// Each chunk is compressed and flushed at once, so that the client
+// can show it without waiting for the following output.
+class TelnetCompressor
+{
+public:
+    explicit TelnetCompressor(int level)
+    {
+        std::memset(&zs, 0, sizeof(zs));
+        if (deflateInit(&zs, level) != Z_OK)
+            throw std::runtime_error("TelnetCompressor: deflateInit failed");
+    }
+    ~TelnetCompressor() { deflateEnd(&zs); }
+
+    // disable value semantics
+    TelnetCompressor(const TelnetCompressor&) = delete;
+    TelnetCompressor& operator = (const TelnetCompressor&) = delete;
+
+    // Replace data with its compressed version
+    void Compress(std::string& data) { Deflate(data, Z_SYNC_FLUSH); }
+
+    // Replace data with its compressed version, ending the stream
+    void Finish(std::string& data) { Deflate(data, Z_FINISH); }
+
+private:
+
+    void Deflate(std::string& data, int flush)
+    {
+        zs.next_in = reinterpret_cast<Bytef*>(&data[0]);
+        zs.avail_in = static_cast<uInt>(data.size());
+        const std::size_t chunk = data.size() / 2 + 64;
+        std::size_t used = 0;
+        do
+        {
+            out.resize(used + chunk);
+            zs.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            zs.avail_out = static_cast<uInt>(chunk);
+            deflate(&zs, flush);
+            used += chunk - zs.avail_out;
+        } while (zs.avail_out == 0);
+        out.resize(used);
+        data.swap(out); // the buffers are reused by the next calls
+    }
+
+    z_stream zs;
+    std::string out;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // defined(CLI_TELNET_MCCP)
+
+#endif // CLI_DETAIL_TELNETCOMPRESSOR_H_
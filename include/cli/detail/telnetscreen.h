@@ -31,6 +31,7 @@
 #define CLI_DETAIL_TELNETSCREEN_H_
 
 #include <ostream>
+#include <string>
 
 namespace cli
 {
@@ -40,6 +41,31 @@ namespace detail
 struct TelnetScreen
 {
     static void Clear(std::ostream& out) { out << "\033[H\033[J" << std::flush; }
+
+    // Appends to buffer the sequence that moves the cursor n chars back
+    static void CursorBack(std::string& buffer, std::size_t n)
+    {
+        if (n <= 3) // shorter than the CSI sequence
+            buffer.append(n, '\b');
+        else
+        {
+            buffer += "\033[";
+            buffer += std::to_string(n);
+            buffer += 'D';
+        }
+    }
+
+    // Moves the cursor to the start of a row of the screen (0 is the top one)
+    static void CursorTo(std::ostream& out, std::size_t row) { out << "\033[" << row + 1 << ";1H"; }
+
+    // Appends to buffer the sequence that erases the n chars after the cursor
+    static void EraseToEnd(std::string& buffer, std::size_t n)
+    {
+        if (n == 1) // shorter than the CSI sequence
+            buffer += " \b";
+        else
+            buffer += "\033[K";
+    }
 };
 
 } // namespace detail
@@ -30,6 +30,7 @@
 #ifndef CLI_DETAIL_TERMINAL_H_
 #define CLI_DETAIL_TERMINAL_H_
 
+#include <algorithm>
 #include <string>
 #include "../colorprofile.h"
 #include "inputdevice.h"
@@ -47,40 +48,52 @@ enum class Symbol
     down,
     tab,
     eof,
-    clear
+    clear,
+    search,
+    interrupt
 };
 
+/**
+ * @brief Terminal keeps the line being edited and renders it on the screen.
+ *
+ * Each edit is rendered as the difference between the line on the screen
+ * and the new one: the cursor moves to the first changed char, the rest of
+ * the line is rewritten and the leftovers are erased. The control sequences
+ * come from SCREEN and are collected in a buffer reused by all the edits.
+ */
 template <typename SCREEN>
 class Terminal
 {
   public:
-    explicit Terminal(std::ostream &_out) : out(_out) {}
+    explicit Terminal(std::ostream &_out) : out(_out) { buffer.reserve(256); }
+
+    // The line on the screen has been wiped out (e.g., a new prompt has been printed)
+    void ResetCursor()
+    {
+        currentLine.clear();
+        position = 0;
+    }
 
-    void ResetCursor() { position = 0; }
+    // The chars typed beyond this length are ignored (0 means no limit)
+    void MaxLineLength(std::size_t length) { maxLineLength = length; }
+
+    // Without echo the line is edited as usual, but nothing is written
+    void Echo(bool e) { echo = e; }
 
     void Clear() const { SCREEN::Clear(out); }
 
     void SetLine(const std::string &newLine)
     {
-        out << beforeInput
-            << std::string(position, '\b') << newLine
-            << afterInput << std::flush;
-
-        // if newLine is shorter than currentLine, we have
-        // to clear the rest of the string
-        if (newLine.size() < currentLine.size())
-        {
-            out << std::string(currentLine.size() - newLine.size(), ' ');
-            // and go back
-            out << std::string(currentLine.size() - newLine.size(), '\b') << std::flush;
-        }
-
-        currentLine = newLine;
-        position = currentLine.size();
+        Render(newLine, newLine.size());
+        out.flush();
     }
 
     std::string GetLine() const { return currentLine; }
 
+    // Keypressed does not flush the output, so that a batch of keys
+    // can be echoed at once: call Flush after the last one.
+    void Flush() { out.flush(); }
+
     std::pair<Symbol, std::string> Keypressed(std::pair<KeyType, char> k)
     {
         switch (k.first)
@@ -92,20 +105,9 @@ class Terminal
             {
                 if (position == 0)
                     break;
-
-                --position;
-
-                const auto pos = static_cast<std::string::difference_type>(position);
-                // remove the char from buffer
-                currentLine.erase(currentLine.begin() + pos);
-                // go back to the previous char
-                out << '\b';
-                // output the rest of the line
-                out << std::string(currentLine.begin() + pos, currentLine.end());
-                // remove last char
-                out << ' ';
-                // go back to the original position
-                out << std::string(currentLine.size() - position + 1, '\b') << std::flush;
+                std::string newLine(currentLine);
+                newLine.erase(position - 1, 1);
+                Render(newLine, position - 1);
                 break;
             }
             case KeyType::up:
@@ -116,23 +118,16 @@ class Terminal
                 break;
             case KeyType::left:
                 if (position > 0)
-                {
-                    out << '\b' << std::flush;
-                    --position;
-                }
+                    MoveTo(position - 1);
                 break;
             case KeyType::right:
                 if (position < currentLine.size())
-                {
-                    out << beforeInput
-                        << currentLine[position]
-                        << afterInput << std::flush;
-                    ++position;
-                }
+                    MoveTo(position + 1);
                 break;
             case KeyType::ret:
             {
-                out << "\r\n";
+                if (echo)
+                    out << "\r\n";
                 auto cmd = currentLine;
                 currentLine.clear();
                 position = 0;
@@ -144,22 +139,13 @@ class Terminal
                 const char c = static_cast<char>(k.second);
                 if (c == '\t')
                     return std::make_pair(Symbol::tab, std::string());
+                else if (maxLineLength != 0 && currentLine.size() >= maxLineLength)
+                    break;
                 else
                 {
-                    const auto pos = static_cast<std::string::difference_type>(position);
-
-                    // output the new char:
-                    out << beforeInput << c;
-                    // and the rest of the string:
-                    out << std::string(currentLine.begin() + pos, currentLine.end())
-                        << afterInput;
-
-                    // go back to the original position
-                    out << std::string(currentLine.size() - position, '\b') << std::flush;
-
-                    // update the buffer and cursor position:
-                    currentLine.insert(currentLine.begin() + pos, c);
-                    ++position;
+                    std::string newLine(currentLine);
+                    newLine.insert(position, 1, c);
+                    Render(newLine, position + 1);
                 }
 
                 break;
@@ -168,38 +154,26 @@ class Terminal
             {
                 if (position == currentLine.size())
                     break;
-
-                const auto pos = static_cast<std::string::difference_type>(position);
-
-                // output the rest of the line
-                out << std::string(currentLine.begin() + pos + 1, currentLine.end());
-                // remove last char
-                out << ' ';
-                // go back to the original position
-                out << std::string(currentLine.size() - position, '\b') << std::flush;
-                // remove the char from buffer
-                currentLine.erase(currentLine.begin() + pos);
+                std::string newLine(currentLine);
+                newLine.erase(position, 1);
+                Render(newLine, position);
                 break;
             }
             case KeyType::end:
-            {
-                const auto pos = static_cast<std::string::difference_type>(position);
-
-                out << beforeInput
-                    << std::string(currentLine.begin() + pos, currentLine.end())
-                    << afterInput << std::flush;
-                position = currentLine.size();
+                MoveTo(currentLine.size());
                 break;
-            }
             case KeyType::home:
-            {
-                out << std::string(position, '\b') << std::flush;
-                position = 0;
+                MoveTo(0);
                 break;
-            }
             case KeyType::clear:
                 return std::make_pair(Symbol::clear, std::string());
                 break;
+            case KeyType::search:
+                return std::make_pair(Symbol::search, std::string());
+                break;
+            case KeyType::interrupt:
+                return std::make_pair(Symbol::interrupt, std::string());
+                break;
             case KeyType::ignored:
                 // TODO
                 break;
@@ -209,8 +183,82 @@ class Terminal
     }
 
   private:
-    std::string currentLine;
+
+    // Moves the cursor without changing the line
+    void MoveTo(std::size_t newPosition)
+    {
+        Render(currentLine, newPosition);
+    }
+
+    // Updates the screen from currentLine to newLine, leaving the cursor at newPosition
+    void Render(const std::string& newLine, std::size_t newPosition)
+    {
+        if (!echo)
+        {
+            currentLine = newLine;
+            position = newPosition;
+            return;
+        }
+        buffer.clear();
+
+        // first char to rewrite, and the end of the chars to rewrite
+        std::size_t from = position;
+        std::size_t to = newPosition;
+        if (newLine != currentLine)
+        {
+            const auto diff = std::mismatch(
+                currentLine.begin(),
+                currentLine.begin() + static_cast<std::string::difference_type>(std::min(currentLine.size(), newLine.size())),
+                newLine.begin()
+            );
+            from = std::min(position, static_cast<std::size_t>(diff.first - currentLine.begin()));
+            to = newLine.size();
+        }
+        else if (newPosition <= position)
+            from = to = newPosition;
+
+        // go back to the first char to rewrite
+        SCREEN::CursorBack(buffer, position - from);
+        const std::size_t textBegin = buffer.size();
+        // rewrite the chars (moving the cursor forward)
+        buffer.append(newLine, from, to - from);
+        const std::size_t textEnd = buffer.size();
+        if (to == newLine.size())
+        {
+            // remove what is left of the old line
+            if (currentLine.size() > newLine.size())
+                SCREEN::EraseToEnd(buffer, currentLine.size() - newLine.size());
+            SCREEN::CursorBack(buffer, newLine.size() - newPosition);
+        }
+
+        // the typed chars are written in the input color
+        if (textEnd == textBegin || !Color())
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        else if (AnsiColors())
+        {
+            // in a single write
+            buffer.insert(textEnd, Codes().reset);
+            buffer.insert(textBegin, Codes().input);
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+        else
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(textBegin));
+            out << beforeInput;
+            out.write(buffer.data() + textBegin, static_cast<std::streamsize>(textEnd - textBegin));
+            out << afterInput;
+            out.write(buffer.data() + textEnd, static_cast<std::streamsize>(buffer.size() - textEnd));
+        }
+
+        currentLine = newLine;
+        position = newPosition;
+    }
+
+    std::string currentLine; // the line on the screen
     std::size_t position = 0; // next writing position in currentLine
+    std::size_t maxLineLength = 0;
+    bool echo = true;
+    std::string buffer; // the output of an edit
     std::ostream &out;
 };
 
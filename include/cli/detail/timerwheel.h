@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TIMERWHEEL_H_
+#define CLI_DETAIL_TIMERWHEEL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../task.h"
+
+namespace cli
+{
+namespace detail
+{
+
+inline unsigned LowestBit(std::uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    for (; (x & 1) == 0; x >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+// A hierarchical timing wheel with a resolution of 1 ms, holding the tasks
+// of the timers of a scheduler: 4 levels of 64 slots cover about 4.6 hours
+// (the later tasks wait in a list, entering the wheel at each turn of the last level).
+// Adding a task takes constant time, and a task moves down at most once per level.
+// The occupied slots are tracked by a bitmap per level, so the next deadline
+// is found without scanning the empty slots.
+// Not thread safe.
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(Clock::time_point _origin = Clock::now()) : origin(_origin) {}
+
+    // non copyable
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    bool Empty() const { return size == 0; }
+    std::size_t Size() const { return size; }
+
+    // t is due at the time given (or at the next Expire, if it's past)
+    void Add(Clock::time_point when, Task&& t)
+    {
+        ++size;
+        Entry e{TickOf(when), std::move(t)};
+        if (e.tick <= current)
+            due.push_back(std::move(e));
+        else
+            Place(std::move(e));
+    }
+
+    // The time when the wheel must be checked again
+    // (a deadline or the time some tasks move to a lower level),
+    // or time_point::max() if it's empty.
+    Clock::time_point NextDeadline() const
+    {
+        if (!due.empty())
+            return TimeOf(current);
+        const std::uint64_t next = NextTick();
+        return next == NoTick() ? Clock::time_point::max() : TimeOf(next);
+    }
+
+    // Call out with each task due at the time now (in order of deadline, at the resolution of the wheel)
+    template <typename F>
+    void Expire(Clock::time_point now, F&& out)
+    {
+        for (auto& e: due)
+            Out(e, out);
+        due.clear();
+        const std::uint64_t target = now <= origin ? 0 : static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - origin).count());
+        while (size != 0)
+        {
+            const std::uint64_t next = NextTick();
+            if (next > target)
+                break;
+            current = next;
+            Turn(out);
+        }
+        // nothing happens up to target, so the wheel can skip there
+        current = std::max(current, target);
+    }
+
+private:
+
+    enum : unsigned { bits = 6, slots = 1u << bits, levels = 4 };
+
+    static std::uint64_t NoTick() { return std::numeric_limits<std::uint64_t>::max(); }
+
+    struct Entry
+    {
+        std::uint64_t tick;
+        Task task;
+    };
+
+    // the ticks are the milliseconds from origin, rounded up
+    std::uint64_t TickOf(Clock::time_point when) const
+    {
+        if (when <= origin)
+            return 0;
+        const auto d = when - origin;
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
+        if (ms < d)
+            ++ms;
+        return static_cast<std::uint64_t>(ms.count());
+    }
+
+    Clock::time_point TimeOf(std::uint64_t tick) const
+    {
+        return origin + std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(tick));
+    }
+
+    static unsigned Slot(std::uint64_t tick, unsigned level) { return static_cast<unsigned>(tick >> (bits * level)) & (slots - 1); }
+
+    // a task goes in the lowest level where its tick has the same
+    // higher bits of the current one (and a later slot)
+    void Place(Entry&& e)
+    {
+        for (unsigned l = 0; l < levels; ++l)
+        {
+            const unsigned shift = bits * (l + 1);
+            if ((e.tick >> shift) == (current >> shift))
+            {
+                const unsigned s = Slot(e.tick, l);
+                wheel[l][s].push_back(std::move(e));
+                occupied[l] |= std::uint64_t(1) << s;
+                return;
+            }
+        }
+        overflow.push_back(std::move(e));
+    }
+
+    // The first tick after current when a slot must be emptied
+    std::uint64_t NextTick() const
+    {
+        std::uint64_t next = NoTick();
+        for (unsigned l = 0; l < levels; ++l)
+        {
+            const unsigned s = Slot(current, l);
+            const std::uint64_t later = s == slots - 1 ? 0 : occupied[l] & (~std::uint64_t(0) << (s + 1));
+            if (later == 0)
+                continue;
+            const unsigned shift = bits * (l + 1);
+            const std::uint64_t tick = ((current >> shift) << shift) | (std::uint64_t(LowestBit(later)) << (bits * l));
+            next = std::min(next, tick);
+        }
+        if (!overflow.empty())
+            next = std::min(next, ((current >> (bits * levels)) + 1) << (bits * levels));
+        return next;
+    }
+
+    // Empty the slots that start at current, from the highest level
+    template <typename F>
+    void Turn(F& out)
+    {
+        if (!overflow.empty() && (current & Mask(levels)) == 0)
+        {
+            spare.swap(overflow);
+            for (auto& e: spare)
+                Reinsert(std::move(e), out);
+            spare.clear();
+        }
+        for (unsigned l = levels; l-- > 0;)
+        {
+            if ((current & Mask(l)) != 0)
+                continue;
+            const unsigned s = Slot(current, l);
+            if ((occupied[l] & (std::uint64_t(1) << s)) == 0)
+                continue;
+            occupied[l] &= ~(std::uint64_t(1) << s);
+            // the tasks go in the lower levels, never in this slot
+            auto& slot = wheel[l][s];
+            for (auto& e: slot)
+                Reinsert(std::move(e), out);
+            slot.clear(); // keeping its memory
+        }
+    }
+
+    template <typename F>
+    void Reinsert(Entry&& e, F& out)
+    {
+        if (e.tick <= current)
+            Out(e, out);
+        else
+            Place(std::move(e));
+    }
+
+    template <typename F>
+    void Out(Entry& e, F& out)
+    {
+        --size;
+        out(std::move(e.task));
+    }
+
+    static std::uint64_t Mask(unsigned level) { return (std::uint64_t(1) << (bits * level)) - 1; }
+
+    const Clock::time_point origin;
+    std::uint64_t current = 0; // the tasks up to this tick have been expired
+    std::size_t size = 0;
+    std::vector<Entry> wheel[levels][slots];
+    std::uint64_t occupied[levels] = {};
+    std::vector<Entry> overflow; // beyond the last level
+    std::vector<Entry> spare; // to move the overflow
+    std::vector<Entry> due; // added when already past
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_TIMERWHEEL_H_
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TRACE_H_
+#define CLI_DETAIL_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Tracing of the telnet protocol.
+ *
+ * The trace points are compiled only up to the level given by the symbol
+ * CLI_TRACE_LEVEL (0 = no tracing, the default; 1 = protocol errors;
+ * 2 = also the option negotiation; 3 = also every data byte).
+ * Defining the old symbol CLI_TELNET_TRACE enables every level.
+ *
+ * The trace records are written to a TraceSink, that by default is an
+ * in-memory lock-free ring buffer (see DefaultTraceSink()), and can be
+ * replaced with SetTraceSink().
+ */
+
+#ifndef CLI_TRACE_LEVEL
+    #ifdef CLI_TELNET_TRACE
+        #define CLI_TRACE_LEVEL 3
+    #else
+        #define CLI_TRACE_LEVEL 0
+    #endif
+#endif
+
+// event must be a string literal
+#define CLI_TRACE(level, event, value) \
+    do { \
+        if (static_cast<int>(level) <= CLI_TRACE_LEVEL) \
+            ::cli::detail::Trace(level, event, static_cast<int>(value)); \
+    } while (false)
+
+namespace cli
+{
+namespace detail
+{
+
+enum class TraceLevel { error = 1, protocol = 2, data = 3 };
+
+struct TraceRecord
+{
+    TraceLevel level;
+    const char* event;
+    int value;
+};
+
+class TraceSink
+{
+public:
+    virtual ~TraceSink() = default;
+    // Can be called concurrently from any thread.
+    // event points to a string literal.
+    virtual void Write(TraceLevel level, const char* event, int value) noexcept = 0;
+};
+
+/**
+ * A TraceSink that keeps the last N records in a fixed size ring.
+ * Writers never block and never allocate: each one reserves a slot
+ * with an atomic increment and publishes it with a per-slot sequence number,
+ * so that readers can skip the slots being overwritten.
+ */
+template <std::size_t N>
+class TraceRingBuffer : public TraceSink
+{
+public:
+    void Write(TraceLevel level, const char* event, int value) noexcept override
+    {
+        const std::uint64_t seq = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[seq % N];
+        slot.seq.store(2*seq + 1, std::memory_order_relaxed); // odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.level.store(static_cast<int>(level), std::memory_order_relaxed);
+        slot.event.store(event, std::memory_order_relaxed);
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.seq.store(2*seq + 2, std::memory_order_release);
+    }
+
+    // Returns the records still in the ring, the oldest first
+    std::vector<TraceRecord> Records() const
+    {
+        std::vector<TraceRecord> result;
+        const std::uint64_t last = head.load(std::memory_order_acquire);
+        const std::uint64_t first = (last > N ? last - N : 0);
+        for (std::uint64_t seq = first; seq < last; ++seq)
+        {
+            const Slot& slot = slots[seq % N];
+            const std::uint64_t before = slot.seq.load(std::memory_order_acquire);
+            if (before != 2*seq + 2)
+                continue; // not yet written or already overwritten
+            TraceRecord r{
+                static_cast<TraceLevel>(slot.level.load(std::memory_order_relaxed)),
+                slot.event.load(std::memory_order_relaxed),
+                slot.value.load(std::memory_order_relaxed)
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == before)
+                result.push_back(r);
+        }
+        return result;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<int> level{0};
+        std::atomic<const char*> event{nullptr};
+        std::atomic<int> value{0};
+    };
+    std::atomic<std::uint64_t> head{0};
+    Slot slots[N];
+};
+
+using DefaultTraceRingBuffer = TraceRingBuffer<1024>;
+
+inline DefaultTraceRingBuffer& DefaultTraceSink()
+{
+    static DefaultTraceRingBuffer sink;
+    return sink;
+}
+
+inline std::atomic<TraceSink*>& CurrentTraceSink()
+{
+    static std::atomic<TraceSink*> sink{&DefaultTraceSink()};
+    return sink;
+}
+
+// Replace the sink of the trace records (nullptr discards them)
+inline void SetTraceSink(TraceSink* sink)
+{
+    CurrentTraceSink().store(sink, std::memory_order_release);
+}
+
+inline void Trace(TraceLevel level, const char* event, int value) noexcept
+{
+    if (auto* sink = CurrentTraceSink().load(std::memory_order_acquire))
+        sink->Write(level, event, value);
+}
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_TRACE_H_
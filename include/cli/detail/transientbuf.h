@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_TRANSIENTBUF_H_
+#define CLI_DETAIL_TRANSIENTBUF_H_
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include "../memoryresource.h"
+
+namespace cli
+{
+namespace detail
+{
+
+// A streambuf collecting the output of a command in blocks taken from a MemoryResource
+// (the frame memory of a session, see CliSession::FrameMemory),
+// so that the output is never copied to grow a buffer.
+class TransientBuf : public std::streambuf
+{
+public:
+    explicit TransientBuf(MemoryResource* _resource) : resource(_resource) {}
+    ~TransientBuf() override { Clear(); }
+
+    // disable value semantics
+    TransientBuf(const TransientBuf&) = delete;
+    TransientBuf& operator = (const TransientBuf&) = delete;
+
+    // Forget the output, giving back the blocks
+    void Clear()
+    {
+        Block* b = first;
+        while (b != nullptr)
+        {
+            Block* next = b->next;
+            resource->Deallocate(b, sizeof(Block) + b->capacity, alignof(Block));
+            b = next;
+        }
+        first = last = nullptr;
+        full = 0;
+        setp(nullptr, nullptr);
+    }
+
+    // The bytes collected
+    std::size_t Size() const { return full + static_cast<std::size_t>(pptr() - pbase()); }
+
+    void WriteTo(std::ostream& out) const
+    {
+        for (const Block* b = first; b != nullptr; b = b->next)
+        {
+            const std::size_t size = (b == last) ? static_cast<std::size_t>(pptr() - pbase()) : b->capacity;
+            out.write(b->Data(), static_cast<std::streamsize>(size));
+        }
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        if (pptr() == epptr())
+            Grow();
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+        return c;
+    }
+
+private:
+    struct Block
+    {
+        Block* next;
+        std::size_t capacity;
+        char* Data() { return reinterpret_cast<char*>(this + 1); }
+        const char* Data() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    void Grow()
+    {
+        std::size_t capacity = initialCapacity;
+        if (last != nullptr)
+            capacity = last->capacity < maxCapacity ? last->capacity * 2 : last->capacity;
+        if (last != nullptr)
+            full += last->capacity;
+        void* memory = resource->Allocate(sizeof(Block) + capacity, alignof(Block));
+        Block* block = ::new (memory) Block{ nullptr, capacity };
+        if (last == nullptr)
+            first = block;
+        else
+            last->next = block;
+        last = block;
+        setp(block->Data(), block->Data() + capacity);
+    }
+
+    enum : std::size_t { initialCapacity = 256, maxCapacity = 64 * 1024 };
+
+    MemoryResource* resource;
+    Block* first = nullptr;
+    Block* last = nullptr; // the one being written
+    std::size_t full = 0; // the bytes in the blocks before last
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_TRANSIENTBUF_H_
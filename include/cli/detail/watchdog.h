@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_DETAIL_WATCHDOG_H_
+#define CLI_DETAIL_WATCHDOG_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// Calls functions at given times, from a thread started at the first request.
+class Watchdog
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Watchdog& Instance()
+    {
+        static Watchdog watchdog;
+        return watchdog;
+    }
+
+    ~Watchdog() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_one();
+        if (servant.joinable())
+            servant.join();
+    }
+
+    // disable value semantics
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator = (const Watchdog&) = delete;
+
+    // f is called at time t (or later)
+    void At(Clock::time_point t, std::function<void()> f)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!servant.joinable())
+                servant = std::thread([this](){ Run(); });
+            alarms.push(Alarm{t, std::move(f)});
+        }
+        cv.notify_one();
+    }
+
+private:
+    Watchdog() = default;
+
+    struct Alarm
+    {
+        Clock::time_point when;
+        std::function<void()> f;
+        bool operator > (const Alarm& other) const { return when > other.when; }
+    };
+
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping)
+        {
+            if (alarms.empty())
+            {
+                cv.wait(lock);
+                continue;
+            }
+            const auto next = alarms.top().when;
+            if (Clock::now() < next)
+            {
+                cv.wait_until(lock, next);
+                continue;
+            }
+            auto f = std::move(const_cast<Alarm&>(alarms.top()).f);
+            alarms.pop();
+            lock.unlock();
+            f();
+            lock.lock();
+        }
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::priority_queue<Alarm, std::vector<Alarm>, std::greater<Alarm>> alarms;
+    bool stopping = false;
+    std::thread servant;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_WATCHDOG_H_
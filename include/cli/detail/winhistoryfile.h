@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef CLI_DETAIL_WINHISTORYFILE_H_
+#define CLI_DETAIL_WINHISTORYFILE_H_
+
+#include <cstdio> // std::remove, std::rename
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+namespace detail
+{
+
+// A file of lines, with the same interface of the POSIX version.
+// The accesses are serialized by a mutex, so the file can be shared
+// by the threads of a process (but not by several processes).
+class HistoryFile
+{
+public:
+    explicit HistoryFile(std::string _name) : name(std::move(_name)) {}
+
+    // Append data with a single write. Returns the size of the file after it.
+    std::size_t Append(const std::string& data)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::ofstream f(name, std::ios_base::out | std::ios_base::app);
+        f.write(data.data(), static_cast<std::streamsize>(data.size()));
+        f.seekp(0, std::ios_base::end);
+        const auto size = f.tellp();
+        return size < 0 ? 0 : static_cast<std::size_t>(size);
+    }
+
+    // Returns the last n lines of the file
+    std::vector<std::string> Last(std::size_t n) const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return Read(n);
+    }
+
+    // Returns the size of the last n lines of the file (what Compact(n) would leave)
+    std::size_t LastSize(std::size_t n) const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::size_t size = 0;
+        for (const auto& line: Read(n))
+            size += line.size() + 1;
+        return size;
+    }
+
+    // Keep only the last n lines. Returns the size of the file after it.
+    std::size_t Compact(std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto lines = Read(n);
+        const std::string tmpName = name + ".tmp";
+        std::size_t size = 0;
+        {
+            std::ofstream f(tmpName, std::ios_base::out | std::ios_base::trunc);
+            for (const auto& line: lines)
+            {
+                f << line << '\n';
+                size += line.size() + 1;
+            }
+            if (!f)
+                return size;
+        }
+        std::remove(name.c_str()); // rename does not overwrite on windows
+        std::rename(tmpName.c_str(), name.c_str());
+        return size;
+    }
+
+    // Remove all the lines
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::ofstream f(name, std::ios_base::out | std::ios_base::trunc);
+    }
+
+private:
+
+    std::vector<std::string> Read(std::size_t n) const
+    {
+        std::vector<std::string> lines;
+        std::ifstream in(name, std::ios_base::in);
+        std::string line;
+        while (std::getline(in, line))
+            lines.push_back(line);
+        if (lines.size() > n)
+            lines.erase(lines.begin(), lines.end() - static_cast<std::vector<std::string>::difference_type>(n));
+        return lines;
+    }
+
+    const std::string name;
+    mutable std::mutex mtx;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_DETAIL_WINHISTORYFILE_H_
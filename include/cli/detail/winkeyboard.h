@@ -30,14 +30,17 @@
 #ifndef CLI_DETAIL_WINKEYBOARD_H_
 #define CLI_DETAIL_WINKEYBOARD_H_
 
+#include <array>
 #include <functional>
 #include <string>
 #include <thread>
 #include <memory>
 #include <conio.h>
 #include <cassert>
+#include <stdexcept>
 
 #include "inputdevice.h"
+#include "consolekeydecoder.h"
 
 #if !defined(NOMINMAX)
 #define NOMINMAX 1 // prevent windows from defining min and max macros
@@ -90,6 +93,9 @@ public:
         SetEvent(events[0]);
     }
 
+    // The handle of the keyboard input
+    HANDLE Input() const { return events[1]; }
+
 private:
     HANDLE events[2];
 };
@@ -101,6 +107,8 @@ class WinKeyboard : public InputDevice
 public:
     explicit WinKeyboard(Scheduler& _scheduler) :
         InputDevice(_scheduler),
+        decoder(CodePage),
+        console(GetConsoleMode(is.Input(), &oldMode) != 0),
         servant([this]() noexcept { Read(); })
     {
     }
@@ -108,6 +116,8 @@ public:
     {
         is.Stop();
         servant.join();
+        if (console)
+            SetConsoleMode(is.Input(), oldMode);
     }
 
 private:
@@ -116,6 +126,38 @@ private:
     {
         try
         {
+            if (console)
+            {
+                // like _getch: no line buffering, no echo, and CTRL-C read as a key
+                SetConsoleMode(is.Input(), oldMode & ~static_cast<DWORD>(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT));
+                while (true)
+                {
+                    is.WaitKbHit();
+                    // read all the records available with a single call
+                    DWORD count = 0;
+                    if (!ReadConsoleInputW(is.Input(), records.data(), static_cast<DWORD>(records.size()), &count))
+                    {
+                        Enqueue(std::make_pair(KeyType::eof, ' '));
+                        Flush();
+                        return;
+                    }
+                    KeyEvents keys;
+                    for (DWORD i = 0; i < count; ++i)
+                    {
+                        // mouse, focus and resize are ignored
+                        if (records[i].EventType != KEY_EVENT)
+                            continue;
+                        const KEY_EVENT_RECORD& key = records[i].Event.KeyEvent;
+                        decoder.Decode(
+                            ConsoleKeyEvent{ key.bKeyDown != FALSE, key.wRepeatCount, key.wVirtualKeyCode, static_cast<char16_t>(key.uChar.UnicodeChar) },
+                            keys
+                        );
+                    }
+                    if (!keys.empty())
+                        Notify(std::move(keys));
+                }
+            }
+            // the input is not a console (e.g., a pipe)
             while (true)
             {
                 auto k = Get();
@@ -128,6 +170,15 @@ private:
         }
     }
 
+    // The bytes of a char in the code page of the console, as _getch gave them
+    static std::string CodePage(const char16_t* units, std::size_t length)
+    {
+        WCHAR wide[2] = { static_cast<WCHAR>(units[0]), length == 2 ? static_cast<WCHAR>(units[1]) : WCHAR(0) };
+        char bytes[8];
+        const int n = WideCharToMultiByte(GetConsoleCP(), 0, wide, static_cast<int>(length), bytes, sizeof(bytes), nullptr, nullptr);
+        return std::string(bytes, n > 0 ? static_cast<std::size_t>(n) : 0);
+    }
+
     std::pair<KeyType, char> Get()
     {
         is.WaitKbHit();
@@ -138,9 +189,11 @@ private:
             case EOF:
             case 4:  // EOT ie CTRL-D
             case 26: // CTRL-Z
-            case 3:  // CTRL-C
                 return std::make_pair(KeyType::eof, ' ');
                 break;
+            case 3:  // CTRL-C
+                return std::make_pair(KeyType::interrupt, ' ');
+                break;
 
             case 224: // symbol
             {
@@ -163,6 +216,9 @@ private:
             case 12: // CTRL-L
                 return std::make_pair(KeyType::clear, ' ');
                 break;
+            case 18: // CTRL-R
+                return std::make_pair(KeyType::search, ' ');
+                break;
             case 13:
                 return std::make_pair(KeyType::ret, c);
                 break;
@@ -175,8 +231,12 @@ private:
         return std::make_pair(KeyType::ignored, ' ');
     }
 
+    ConsoleKeyDecoder decoder;
     InputSource is;
-    std::thread servant;
+    DWORD oldMode = 0;
+    const bool console;
+    std::array<INPUT_RECORD, 512> records;
+    std::thread servant; // must be the last one: it uses the other members
 };
 
 } // namespace detail
@@ -34,6 +34,8 @@
 #define NOMINMAX 1 // prevent windows from defining min and max macros
 #endif // !defined(NOMINMAX)
 #include <windows.h>
+#include <ostream>
+#include <string>
 
 namespace cli
 {
@@ -54,6 +56,25 @@ struct WinScreen
         FillConsoleOutputCharacter(hStdOut, ' ', csbi.dwSize.X * csbi.dwSize.Y, coord, &count);
         SetConsoleCursorPosition(hStdOut, coord);
     }
+
+    // Moves the cursor to the start of a row of the screen (0 is the top one)
+    static void CursorTo(std::ostream& out, std::size_t row)
+    {
+        out.flush(); // the chars before go where the cursor was
+        COORD coord = { 0, static_cast<SHORT>(row) };
+        SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
+    }
+
+    // The console could not support the VT sequences,
+    // so we only use backspaces and spaces
+
+    static void CursorBack(std::string& buffer, std::size_t n) { buffer.append(n, '\b'); }
+
+    static void EraseToEnd(std::string& buffer, std::size_t n)
+    {
+        buffer.append(n, ' ');
+        buffer.append(n, '\b');
+    }
 };
 
 } // namespace detail
@@ -31,54 +31,64 @@
 #define CLI_FILEHISTORYSTORAGE_H_
 
 #include "historystorage.h"
-#include <fstream>
+#include "detail/historyfile.h"
+#include <atomic>
+#include <string>
 #include <utility>
 
 namespace cli
 {
 
+/**
+ * @brief FileHistoryStorage keeps the history in a file, shared by all the
+ * sessions and by all the processes using the same file name.
+ *
+ * Every Store appends its commands to the file with a single write.
+ * The file is compacted to the last @c size commands when it has grown by
+ * @c compactionFactor times since the last compaction (or since it has been
+ * opened, for the part holding the last @c size commands). The accesses to
+ * the file are guarded by file locks (on Windows by a mutex, so there the
+ * file can't be shared by several processes).
+ */
 class FileHistoryStorage : public HistoryStorage
 {
 public:
-    explicit FileHistoryStorage(std::string _fileName, std::size_t size = 1000) : 
+    explicit FileHistoryStorage(std::string fileName, std::size_t size = 1000, std::size_t _compactionFactor = 2) :
         maxSize(size),
-        fileName(std::move(_fileName))
+        compactionFactor(_compactionFactor < 2 ? 2 : _compactionFactor),
+        file(std::move(fileName)),
+        compactedSize(file.LastSize(maxSize)) // as if the file had just been compacted
     {
     }
     void Store(const std::vector<std::string>& cmds) override
     {
-        using dt = std::vector<std::string>::difference_type;
-        auto commands = Commands();
-        commands.insert(commands.end(), cmds.begin(), cmds.end());
-        if (commands.size() > maxSize)
-            commands.erase(
-                commands.begin(), 
-                commands.begin() + static_cast<dt>(commands.size() - maxSize)
-            );
-        std::ofstream f(fileName, std::ios_base::out);
-            for (const auto& line: commands)
-                f << line << '\n';
+        if (cmds.empty())
+            return;
+        std::string record;
+        for (const auto& cmd: cmds)
+        {
+            record += cmd;
+            record += '\n';
+        }
+        const auto fileSize = file.Append(record);
+        if (fileSize > compactionFactor * compactedSize)
+            compactedSize = file.Compact(maxSize);
     }
     std::vector<std::string> Commands() const override
     {
-        std::vector<std::string> commands;
-        std::ifstream in(fileName);
-        if (in)
-        {
-            std::string line;
-            while (std::getline(in, line))
-                commands.push_back(line);
-        }
-        return commands;
+        return file.Last(maxSize);
     }
     void Clear() override
     {
-        std::ofstream f(fileName, std::ios_base::out | std::ios_base::trunc);
+        file.Clear();
+        compactedSize = 0;
     }
 
 private:
     const std::size_t maxSize;
-    const std::string fileName;
+    const std::size_t compactionFactor;
+    detail::HistoryFile file;
+    std::atomic<std::size_t> compactedSize; // the size of the file after the last compaction
 };
 
 } // namespace cli
@@ -36,6 +36,8 @@
 namespace cli
 {
 
+// The methods of a HistoryStorage can be called concurrently
+// by sessions running on different threads.
 class HistoryStorage
 {
 public:
@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_LOCKFREELOOPSCHEDULER_H_
+#define CLI_LOCKFREELOOPSCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include "scheduler.h"
+#include "detail/lanes.h"
+#include "detail/mpscqueue.h"
+#include "detail/timerwheel.h"
+
+namespace cli
+{
+
+/**
+ * @brief The LockFreeLoopScheduler is a LoopScheduler whose tasks
+ * are posted in a lock-free queue.
+ *
+ * Post can be called from any thread and takes no lock, unless
+ * the thread running the loop is waiting for tasks and must be woken up.
+ * Unlike LoopScheduler, the methods running the tasks
+ * (Run, RunBatch, ExecOne and PollOne) must be called always by the same thread.
+ * The timers (see Scheduler::PostAt) are kept in a timer wheel protected by the lock,
+ * that the loop takes only when there are timers.
+ */
+class LockFreeLoopScheduler : public Scheduler
+{
+public:
+    LockFreeLoopScheduler() = default;
+    ~LockFreeLoopScheduler() override
+    {
+        Stop();
+    }
+
+    // non copyable
+    LockFreeLoopScheduler(const LockFreeLoopScheduler&) = delete;
+    LockFreeLoopScheduler& operator=(const LockFreeLoopScheduler&) = delete;
+
+    void Stop()
+    {
+        running = false;
+        std::lock_guard<std::mutex> lck (mtx);
+        cv.notify_all();
+    }
+
+    void Run()
+    {
+        while( RunBatch() != 0 ) {};
+    }
+
+    bool Stopped() const
+    {
+        return !running;
+    }
+
+    using Scheduler::Post;
+
+    void Post(const std::function<void()>& f) override
+    {
+        Post(Task(f));
+    }
+
+    void Post(Task&& t) override
+    {
+        Post(Priority::bulk, std::move(t));
+    }
+
+    void Post(Priority priority, Task&& t) override
+    {
+        (priority == Priority::interactive ? interactiveTasks : tasks).Push(std::move(t));
+        // seq_cst: either we see the loop waiting, or the loop sees the new task
+        if (waiting)
+        {
+            std::lock_guard<std::mutex> lck (mtx);
+            cv.notify_one();
+        }
+    }
+
+    void PostAt(Clock::time_point when, Task&& t) override
+    {
+        std::lock_guard<std::mutex> lck (mtx);
+        timers.Add(when, std::move(t));
+        timerCount = timers.Size();
+        cv.notify_one(); // the loop could be waiting for a later deadline
+    }
+
+    // Waits for a task, then runs all the tasks posted so far.
+    // Returns the number of tasks run (0 if the scheduler has been stopped).
+    std::size_t RunBatch()
+    {
+        if (!Wait())
+            return 0;
+        std::size_t count = 0;
+        Task task;
+        while (running && Pop(task))
+        {
+            ++count;
+            if (task)
+                task();
+        }
+        return count;
+    }
+
+    bool ExecOne()
+    {
+        if (!Wait())
+            return false;
+        return PollOne();
+    }
+
+    bool PollOne()
+    {
+        if (!running)
+            return false;
+        ExpireTimers();
+        Task task;
+        if (!Pop(task))
+            return false;
+
+        if (task)
+            task();
+
+        return true;
+    }
+
+private:
+
+    // Returns when there is a task (true) or the scheduler is stopped (false)
+    bool Wait()
+    {
+        if (!running)
+            return false;
+        ExpireTimers();
+        if (!Empty())
+            return true;
+        std::unique_lock<std::mutex> lck(mtx);
+        waiting = true;
+        while (running && Empty())
+        {
+            ExpireTimersLocked();
+            if (!Empty())
+                break;
+            if (timers.Empty())
+                cv.wait(lck);
+            else
+                cv.wait_until(lck, timers.NextDeadline());
+        }
+        waiting = false;
+        return running;
+    }
+
+    // the timers due go in the bulk lane
+    void ExpireTimers()
+    {
+        if (timerCount == 0)
+            return;
+        std::lock_guard<std::mutex> lck(mtx);
+        ExpireTimersLocked();
+    }
+
+    void ExpireTimersLocked()
+    {
+        if (timers.Empty())
+            return;
+        timers.Expire(Clock::now(), [this](Task&& t){ tasks.Push(std::move(t)); });
+        timerCount = timers.Size();
+    }
+
+    bool Empty() const { return tasks.Empty() && interactiveTasks.Empty(); }
+
+    // Moves the next task in t (see Priority), returning false if there are none
+    bool Pop(Task& t)
+    {
+        if (selector.Interactive(!interactiveTasks.Empty(), !tasks.Empty()))
+            return interactiveTasks.Pop(t);
+        return tasks.Pop(t);
+    }
+
+    detail::MpscQueue<Task> tasks; // the bulk ones
+    detail::MpscQueue<Task> interactiveTasks;
+    detail::LaneSelector selector;
+    detail::TimerWheel timers; // protected by mtx
+    std::atomic<std::size_t> timerCount{ 0 };
+    std::atomic<bool> running{ true };
+    std::atomic<bool> waiting{ false };
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+} // namespace cli
+
+#endif // CLI_LOCKFREELOOPSCHEDULER_H_
@@ -34,14 +34,19 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
 #include "scheduler.h"
+#include "detail/lanes.h"
+#include "detail/timerwheel.h"
 
 namespace cli
 {
 
 /**
  * @brief The LoopScheduler is a simple thread-safe scheduler
- * 
+ *
+ * The tasks posted with a deadline (see Scheduler::PostAt) are kept
+ * in a timer wheel, and the loop waits until the next one is due.
  */
 class LoopScheduler : public Scheduler
 {
@@ -74,23 +79,50 @@ public:
         return !running;
     }
 
+    using Scheduler::Post;
+
     void Post(const std::function<void()>& f) override
+    {
+        Post(Task(f));
+    }
+
+    void Post(Task&& t) override
+    {
+        Post(Priority::bulk, std::move(t));
+    }
+
+    void Post(Priority priority, Task&& t) override
     {
         std::lock_guard<std::mutex> lck (mtx);
-        tasks.push(f);
+        (priority == Priority::interactive ? interactiveTasks : tasks).push(std::move(t));
         cv.notify_all();
     }
 
+    void PostAt(Clock::time_point when, Task&& t) override
+    {
+        std::lock_guard<std::mutex> lck (mtx);
+        timers.Add(when, std::move(t));
+        cv.notify_all(); // the loop could be waiting for a later deadline
+    }
+
     bool ExecOne()
     {
-        std::function<void()> task;
+        Task task;
         {
             std::unique_lock<std::mutex> lck(mtx);
-            cv.wait(lck, [this](){ return !running || !tasks.empty(); });
-            if (!running)
-                return false;
-            task = tasks.front();
-            tasks.pop();
+            for (;;)
+            {
+                if (!running)
+                    return false;
+                ExpireTimers();
+                if (!Empty())
+                    break;
+                if (timers.Empty())
+                    cv.wait(lck);
+                else
+                    cv.wait_until(lck, timers.NextDeadline());
+            }
+            Pop(task);
         }
 
         if (task)
@@ -101,13 +133,15 @@ public:
 
     bool PollOne()
     {
-        std::function<void()> task;
+        Task task;
         {
             std::lock_guard<std::mutex> lck(mtx);
-            if (!running || tasks.empty())
+            if (!running)
+                return false;
+            ExpireTimers();
+            if (Empty())
                 return false;
-            task = tasks.front();
-            tasks.pop();
+            Pop(task);
         }
 
         if (task)
@@ -117,7 +151,30 @@ public:
     }
 
 private:
-    std::queue<std::function<void()>> tasks;
+
+    // the following methods must be called with mtx locked
+
+    bool Empty() const { return tasks.empty() && interactiveTasks.empty(); }
+
+    // Moves the next task in t (see Priority)
+    void Pop(Task& t)
+    {
+        auto& lane = selector.Interactive(!interactiveTasks.empty(), !tasks.empty()) ? interactiveTasks : tasks;
+        t = std::move(lane.front());
+        lane.pop();
+    }
+
+    // the timers due go in the bulk lane
+    void ExpireTimers()
+    {
+        if (!timers.Empty())
+            timers.Expire(Clock::now(), [this](Task&& t){ tasks.push(std::move(t)); });
+    }
+
+    std::queue<Task> tasks; // the bulk ones
+    std::queue<Task> interactiveTasks;
+    detail::LaneSelector selector;
+    detail::TimerWheel timers;
     bool running{ true };
     mutable std::mutex mtx;
     std::condition_variable cv;
@@ -0,0 +1,245 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_MEMORYRESOURCE_H_
+#define CLI_MEMORYRESOURCE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace cli
+{
+
+/**
+ * @brief A source of memory: the one of the framed output of the sessions
+ * (see Cli::FrameMemory and CliSession::FrameMemory), or of the containers
+ * of the handlers (see Allocator).
+ *
+ * It follows the model of std::pmr::memory_resource, that needs C++17:
+ * derive from it to give the sessions the memory of a pool of your own
+ * (e.g., on a real-time target).
+ */
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() = default;
+
+    void* Allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        return DoAllocate(bytes, alignment);
+    }
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        DoDeallocate(p, bytes, alignment);
+    }
+    bool IsEqual(const MemoryResource& other) const noexcept
+    {
+        return this == &other || DoIsEqual(other);
+    }
+
+private:
+    virtual void* DoAllocate(std::size_t bytes, std::size_t alignment) = 0;
+    virtual void DoDeallocate(void* p, std::size_t bytes, std::size_t alignment) = 0;
+    virtual bool DoIsEqual(const MemoryResource& /*other*/) const noexcept { return false; }
+};
+
+/**
+ * @brief The resource using the global operator new and operator delete
+ * (the alignment can't exceed the one of std::max_align_t).
+ */
+inline MemoryResource* NewDeleteResource()
+{
+    class NewDelete : public MemoryResource
+    {
+        void* DoAllocate(std::size_t bytes, std::size_t alignment) override
+        {
+            assert(alignment <= alignof(std::max_align_t));
+            (void)alignment;
+            return ::operator new(bytes);
+        }
+        void DoDeallocate(void* p, std::size_t /*bytes*/, std::size_t /*alignment*/) override
+        {
+            ::operator delete(p);
+        }
+        bool DoIsEqual(const MemoryResource& other) const noexcept override
+        {
+            return dynamic_cast<const NewDelete*>(&other) != nullptr;
+        }
+    };
+    // never destroyed, because the sessions can outlive any other static object
+    static MemoryResource* resource = new NewDelete;
+    return resource;
+}
+
+/**
+ * @brief A resource handing out the memory of blocks taken from its upstream resource,
+ * that frees nothing until Release.
+ *
+ * Release keeps the largest block for the next round (the next blocks are
+ * twice as large as the previous ones): after a few rounds of the same size,
+ * a round doesn't take memory from the upstream resource anymore.
+ */
+class MonotonicBufferResource : public MemoryResource
+{
+public:
+    explicit MonotonicBufferResource(MemoryResource* _upstream = NewDeleteResource(), std::size_t _initialSize = 1024) :
+        upstream(_upstream),
+        nextSize(std::max(_initialSize, sizeof(Block)))
+    {}
+    ~MonotonicBufferResource() override { FreeBlocks(nullptr); }
+
+    // disable value semantics
+    MonotonicBufferResource(const MonotonicBufferResource&) = delete;
+    MonotonicBufferResource& operator = (const MonotonicBufferResource&) = delete;
+
+    // Give back at once all the memory handed out
+    void Release()
+    {
+        Block* largest = blocks;
+        for (Block* b = blocks; b != nullptr; b = b->next)
+            if (b->size > largest->size)
+                largest = b;
+        FreeBlocks(largest);
+        blocks = largest;
+        if (largest != nullptr)
+        {
+            largest->next = nullptr;
+            Reset(largest);
+        }
+    }
+
+    MemoryResource* Upstream() const { return upstream; }
+
+    // Take the next blocks from another resource: all the memory
+    // handed out so far is given back
+    void Upstream(MemoryResource* _upstream)
+    {
+        FreeBlocks(nullptr);
+        blocks = nullptr;
+        current = end = nullptr;
+        upstream = _upstream;
+    }
+
+private:
+    // at the start of each block taken from upstream
+    struct Block
+    {
+        Block* next;
+        std::size_t size; // including this header
+    };
+
+    void* DoAllocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* p = Carve(bytes, alignment);
+        if (p != nullptr)
+            return p;
+        const std::size_t size = std::max(nextSize, sizeof(Block) + bytes + alignment);
+        void* memory = upstream->Allocate(size, alignof(std::max_align_t));
+        Block* block = ::new (memory) Block{ blocks, size };
+        blocks = block;
+        Reset(block);
+        nextSize = size * 2;
+        return Carve(bytes, alignment);
+    }
+
+    void DoDeallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override {}
+
+    // The memory at current, if it fits in the block
+    void* Carve(std::size_t bytes, std::size_t alignment)
+    {
+        if (current == nullptr)
+            return nullptr;
+        const auto address = reinterpret_cast<std::uintptr_t>(current);
+        const auto aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+        if (aligned - address > static_cast<std::uintptr_t>(end - current) ||
+            bytes > static_cast<std::size_t>(end - current) - (aligned - address))
+            return nullptr;
+        current += (aligned - address) + bytes;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void Reset(Block* block)
+    {
+        current = reinterpret_cast<char*>(block) + sizeof(Block);
+        end = reinterpret_cast<char*>(block) + block->size;
+    }
+
+    // frees all the blocks but keep
+    void FreeBlocks(Block* keep)
+    {
+        Block* b = blocks;
+        while (b != nullptr)
+        {
+            Block* next = b->next;
+            if (b != keep)
+                upstream->Deallocate(b, b->size, alignof(std::max_align_t));
+            b = next;
+        }
+    }
+
+    MemoryResource* upstream;
+    std::size_t nextSize;
+    Block* blocks = nullptr; // the last taken first
+    char* current = nullptr; // the free memory of the last block
+    char* end = nullptr;
+};
+
+/**
+ * @brief An allocator drawing from a MemoryResource, like std::pmr::polymorphic_allocator.
+ */
+template <typename T>
+class Allocator
+{
+public:
+    using value_type = T;
+
+    Allocator(MemoryResource* _resource = NewDeleteResource()) noexcept : resource(_resource) {}
+    template <typename U>
+    Allocator(const Allocator<U>& other) noexcept : resource(other.Resource()) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(resource->Allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, std::size_t n) { resource->Deallocate(p, n * sizeof(T), alignof(T)); }
+
+    MemoryResource* Resource() const noexcept { return resource; }
+
+private:
+    MemoryResource* resource;
+};
+
+template <typename T, typename U>
+bool operator==(const Allocator<T>& a, const Allocator<U>& b) noexcept { return a.Resource()->IsEqual(*b.Resource()); }
+template <typename T, typename U>
+bool operator!=(const Allocator<T>& a, const Allocator<U>& b) noexcept { return !(a == b); }
+
+} // namespace cli
+
+#endif // CLI_MEMORYRESOURCE_H_
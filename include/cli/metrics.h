@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_METRICS_H_
+#define CLI_METRICS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cli
+{
+
+/**
+ * @brief A histogram of durations with logarithmic buckets (HDR-style):
+ * each power of two is split in 8 buckets, so that the quantiles
+ * have an error below 12.5%, from nanoseconds to minutes.
+ */
+class LatencyHistogram
+{
+public:
+    void Record(std::chrono::nanoseconds d)
+    {
+        const auto ns = d.count() < 0 ? std::uint64_t{0} : static_cast<std::uint64_t>(d.count());
+        ++buckets[Index(ns)];
+        ++count;
+        sum += ns;
+        if (ns > max)
+            max = ns;
+    }
+
+    void Merge(const LatencyHistogram& other)
+    {
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+        sum += other.sum;
+        if (other.max > max)
+            max = other.max;
+    }
+
+    std::uint64_t Count() const { return count; }
+
+    std::chrono::nanoseconds Max() const { return Ns(max); }
+
+    std::chrono::nanoseconds Mean() const { return Ns(count == 0 ? 0 : sum / count); }
+
+    // The duration below which fall the fraction q (0 to 1) of the samples
+    // (the middle of its bucket, at most the max)
+    std::chrono::nanoseconds Quantile(double q) const
+    {
+        if (count == 0)
+            return Ns(0);
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                const auto lower = Lower(i);
+                const auto value = lower + (Lower(i + 1) - lower) / 2;
+                return Ns(value < max ? value : max);
+            }
+        }
+        return Ns(max);
+    }
+
+private:
+    enum { subBits = 3, sub = 1 << subBits, maxExponent = 40, bucketCount = (maxExponent - subBits + 2) * sub };
+
+    static std::chrono::nanoseconds Ns(std::uint64_t ns) { return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(ns)); }
+
+    static std::size_t Index(std::uint64_t v)
+    {
+        if (v < sub)
+            return static_cast<std::size_t>(v);
+        unsigned e = subBits;
+        while (e < maxExponent && (v >> (e + 1)) != 0)
+            ++e;
+        if ((v >> (e + 1)) != 0) // beyond the range: the last bucket
+            return bucketCount - 1;
+        return (e - subBits + 1) * sub + static_cast<std::size_t>((v >> (e - subBits)) & (sub - 1));
+    }
+
+    // the lowest value of the bucket i
+    static std::uint64_t Lower(std::size_t i)
+    {
+        if (i < sub)
+            return i;
+        const auto e = static_cast<unsigned>(i / sub) + subBits - 1;
+        return (std::uint64_t{1} << e) + (static_cast<std::uint64_t>(i % sub) << (e - subBits));
+    }
+
+    std::array<std::uint32_t, bucketCount> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0; // ns
+    std::uint64_t max = 0; // ns
+};
+
+// The metrics of a command, or of the wrong commands (see Cli::Metrics)
+struct CommandStats
+{
+    std::string name; // the first word of the command lines
+    std::uint64_t errors = 0; // wrong commands and exceptions
+    std::uint64_t outputBytes = 0; // only counted when the output stream tells its position
+    LatencyHistogram tokenize; // the split of the line in words
+    LatencyHistogram dispatch; // the search of the command, out of the handler
+    LatencyHistogram handler; // the execution of the handler (just the synchronous part, for the asynchronous commands)
+    LatencyHistogram total;
+
+    std::uint64_t Count() const { return total.Count(); }
+
+    void Merge(const CommandStats& other)
+    {
+        errors += other.errors;
+        outputBytes += other.outputBytes;
+        tokenize.Merge(other.tokenize);
+        dispatch.Merge(other.dispatch);
+        handler.Merge(other.handler);
+        total.Merge(other.total);
+    }
+};
+
+namespace detail
+{
+
+// The timings of a command line, measured by CliSession::Feed
+struct CommandSample
+{
+    std::chrono::nanoseconds tokenize;
+    std::chrono::nanoseconds dispatch;
+    std::chrono::nanoseconds handler;
+    std::uint64_t outputBytes;
+    bool error;
+};
+
+// The metrics of the commands, kept in shards chosen by the id of the thread
+// recording them, so that the sessions running on different threads
+// do not contend for the same lock. The shards are merged when they are read.
+class MetricsStore
+{
+public:
+    void Record(const std::string& name, const CommandSample& sample)
+    {
+        auto& shard = shards[std::hash<std::thread::id>{}(std::this_thread::get_id()) % shards.size()];
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto i = shard.stats.find(name);
+        if (i == shard.stats.end())
+            i = shard.stats.emplace(name, CommandStats{}).first;
+        auto& s = i->second;
+        s.tokenize.Record(sample.tokenize);
+        s.dispatch.Record(sample.dispatch);
+        s.handler.Record(sample.handler);
+        s.total.Record(sample.tokenize + sample.dispatch + sample.handler);
+        s.outputBytes += sample.outputBytes;
+        if (sample.error)
+            ++s.errors;
+    }
+
+    // sorted by name
+    std::vector<CommandStats> Get() const
+    {
+        std::map<std::string, CommandStats> merged;
+        for (const auto& shard: shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (const auto& s: shard.stats)
+                merged[s.first].Merge(s.second);
+        }
+        std::vector<CommandStats> result;
+        result.reserve(merged.size());
+        for (auto& s: merged)
+        {
+            s.second.name = s.first;
+            result.push_back(std::move(s.second));
+        }
+        return result;
+    }
+
+    void Reset()
+    {
+        for (auto& shard: shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            shard.stats.clear();
+        }
+    }
+
+private:
+    struct Shard
+    {
+        mutable std::mutex mtx;
+        std::map<std::string, CommandStats> stats;
+    };
+    std::array<Shard, 16> shards;
+};
+
+} // namespace detail
+} // namespace cli
+
+#endif // CLI_METRICS_H_
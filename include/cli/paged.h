@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_PAGED_H_
+#define CLI_PAGED_H_
+
+#include <functional>
+#include <ostream>
+#include <utility>
+
+namespace cli
+{
+
+/**
+ * @brief The output of a command, generated on demand a line at a time.
+ *
+ * A command handler returning a Paged writes its output through a function
+ * that writes the next line on the stream at each call, and returns false
+ * after the last one.
+ * With the pager of the session enabled (see CliSession::Pager) the function
+ * is called only for the lines that fit the screen, then the session waits
+ * for the user: space shows the next screen, enter the next line,
+ * and q (or ctrl+C) ends the command, so the lines never shown are never generated.
+ * Otherwise the function is called up to the last line.
+ *
+ * @code
+ * menu->Insert("routes", [](std::ostream&)
+ * {
+ *     auto i = std::make_shared<std::size_t>(0);
+ *     return cli::Paged([i](std::ostream& out)
+ *     {
+ *         out << table.Row(*i) << '\n';
+ *         return ++*i < table.Size();
+ *     });
+ * });
+ * @endcode
+ */
+class Paged
+{
+public:
+    using Next = std::function<bool(std::ostream&)>;
+
+    explicit Paged(Next _next) : next(std::move(_next)) {}
+
+    // Writes the next line, returning false after the last one
+    bool operator()(std::ostream& out) const { return next(out); }
+
+private:
+    Next next;
+};
+
+} // namespace cli
+
+#endif // CLI_PAGED_H_
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_RECORD_H_
+#define CLI_RECORD_H_
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace cli
+{
+
+namespace detail
+{
+    // The flag of the output streams of the sessions in framed mode (see CliSession::Framed)
+    inline int FramedIndex()
+    {
+        static const int index = std::ios_base::xalloc();
+        return index;
+    }
+} // namespace detail
+
+/**
+ * @brief Writes a record of named fields, for the users and for the automation clients.
+ *
+ * On a session in framed mode (see CliSession::Framed) a record is a single line
+ * of "name=value" fields separated by tabs, with the backslash, tab, CR and LF
+ * of the values escaped as \\, \t, \r and \n. Otherwise, each field is a "name: value"
+ * line. In both cases, the record ends with a newline when the writer is destroyed.
+ *
+ * @code
+ * menu->Insert("iface", [](std::ostream& out, const std::string& name)
+ * {
+ *     cli::RecordWriter{out}("name", name)("mtu", 1500)("state", "up");
+ * });
+ * @endcode
+ */
+class RecordWriter
+{
+public:
+    explicit RecordWriter(std::ostream& _out) :
+        out(_out),
+        framed(_out.iword(detail::FramedIndex()) != 0)
+    {}
+
+    ~RecordWriter() { out << '\n'; }
+
+    // disable value semantics
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    template <typename T>
+    RecordWriter& operator()(const char* name, const T& value)
+    {
+        std::ostringstream text;
+        text << value;
+        if (!framed)
+        {
+            out << name << ": " << text.str() << '\n';
+            return *this;
+        }
+        if (fields++ > 0)
+            out << '\t';
+        out << name << '=';
+        for (const char c: text.str())
+            switch (c)
+            {
+                case '\\': out << "\\\\"; break;
+                case '\t': out << "\\t"; break;
+                case '\r': out << "\\r"; break;
+                case '\n': out << "\\n"; break;
+                default: out << c;
+            }
+        return *this;
+    }
+
+private:
+    std::ostream& out;
+    const bool framed;
+    std::size_t fields = 0;
+};
+
+} // namespace cli
+
+#endif // CLI_RECORD_H_
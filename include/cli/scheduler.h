@@ -30,11 +30,45 @@
 #ifndef CLI_SCHEDULER_H_
 #define CLI_SCHEDULER_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "task.h"
+#include "detail/watchdog.h"
 
 namespace cli
 {
 
+/// The lane of a task posted to a @c Scheduler (see @c Scheduler::Post).
+enum class Priority
+{
+    interactive, ///< the reaction to the user input (e.g., echo and line editing)
+    bulk ///< everything else (the default)
+};
+
+/// The handle of a task posted with @c Scheduler::PostAfter or @c Scheduler::PostEvery.
+/// Copies of a @c Timer refer to the same task.
+class Timer
+{
+public:
+    Timer() = default;
+
+    /// The task won't run any more (but a run already in progress completes).
+    /// It can be called from any thread: the scheduler discards the task when it's due.
+    void Cancel() { if (cancelled) *cancelled = true; }
+
+    bool Cancelled() const { return cancelled && *cancelled; }
+
+private:
+    friend class Scheduler;
+    explicit Timer(std::shared_ptr<std::atomic<bool>> _cancelled) : cancelled(std::move(_cancelled)) {}
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
 /**
  * A `Scheduler` represents an engine capable of running a task.
  * Its method `Post` can be safely called from any thread to submit the task
@@ -48,6 +82,125 @@ public:
 
     /// Submits a completion token or function object for execution.
     virtual void Post(const std::function<void()>& f) = 0;
+
+    /// Submits a task for execution, without copying it.
+    /// The schedulers of the library override it to store the task
+    /// without allocating memory, while the default implementation
+    /// moves the task on the heap and posts it as a @c std::function .
+    virtual void Post(Task&& t)
+    {
+        auto task = std::make_shared<Task>(std::move(t));
+        Post(std::function<void()>([task](){ (*task)(); }));
+    }
+
+    /// Submits a task for execution in the lane given.
+    /// The schedulers of the library run the interactive tasks before the bulk ones
+    /// (but let a bulk task pass after a few interactive ones in a row,
+    /// so that the bulk tasks still progress), while the default implementation
+    /// ignores the priority.
+    virtual void Post(Priority priority, Task&& t)
+    {
+        (void)priority;
+        Post(std::move(t));
+    }
+
+    /// Submits a function object for execution in the lane given.
+    template <
+        typename F,
+        typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>
+    >
+    void Post(Priority priority, F&& f)
+    {
+        Post(priority, Task(std::forward<F>(f)));
+    }
+
+    /// Submits a function object for execution, moving it in a @c Task
+    /// (so that it can be move-only).
+    /// The derived classes need a <tt>using Scheduler::Post;</tt> to expose it.
+    template <
+        typename F,
+        typename = std::enable_if_t<
+            !std::is_same<std::decay_t<F>, Task>::value &&
+            !std::is_same<std::decay_t<F>, std::function<void()>>::value
+        >
+    >
+    void Post(F&& f)
+    {
+        Post(Task(std::forward<F>(f)));
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    /// Submits a task for execution at the time given (or as soon as possible after it),
+    /// in the bulk lane. The schedulers of the library keep the timers themselves,
+    /// while the default implementation waits on a thread shared by all the schedulers,
+    /// and then posts the task. In any case, the scheduler must outlive its timers.
+    virtual void PostAt(Clock::time_point when, Task&& t)
+    {
+        auto task = std::make_shared<Task>(std::move(t));
+        detail::Watchdog::Instance().At(when, [this, task](){ Post(std::move(*task)); });
+    }
+
+    /// Submits a function object for execution after the delay given,
+    /// returning the handle to cancel it.
+    template <typename F>
+    Timer PostAfter(Clock::duration delay, F&& f)
+    {
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        PostAt(Clock::now() + delay, Task([cancelled, f = std::forward<F>(f)]() mutable
+            {
+                if (!*cancelled)
+                    f();
+            }));
+        return Timer(std::move(cancelled));
+    }
+
+    /// Submits a function object for execution every period (the first time after one period),
+    /// until the timer returned is cancelled. The runs keep the original cadence:
+    /// when a run is late, the times already past are skipped.
+    template <typename F>
+    Timer PostEvery(Clock::duration period, F&& f)
+    {
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        period = std::max<Clock::duration>(period, std::chrono::milliseconds(1));
+        auto p = std::make_shared<Periodic<std::decay_t<F>>>(std::forward<F>(f), period, Clock::now() + period, cancelled);
+        Repeat(std::move(p));
+        return Timer(std::move(cancelled));
+    }
+
+private:
+
+    template <typename F>
+    struct Periodic
+    {
+        Periodic(F&& _f, Clock::duration _period, Clock::time_point _next, std::shared_ptr<std::atomic<bool>> _cancelled) :
+            f(std::move(_f)), period(_period), next(_next), cancelled(std::move(_cancelled)) {}
+        Periodic(const F& _f, Clock::duration _period, Clock::time_point _next, std::shared_ptr<std::atomic<bool>> _cancelled) :
+            f(_f), period(_period), next(_next), cancelled(std::move(_cancelled)) {}
+        F f;
+        Clock::duration period;
+        Clock::time_point next;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    template <typename F>
+    void Repeat(std::shared_ptr<Periodic<F>> p)
+    {
+        const auto when = p->next;
+        PostAt(when, Task([this, p]()
+            {
+                if (*p->cancelled)
+                    return;
+                p->f();
+                if (*p->cancelled)
+                    return;
+                const auto now = Clock::now();
+                p->next += p->period;
+                if (p->next <= now)
+                    p->next += p->period * ((now - p->next) / p->period + 1);
+                Repeat(p);
+            }));
+    }
 };
 
 } // namespace cli
@@ -35,6 +35,7 @@
 
 
 namespace cli { using StandaloneAsioCliAsyncSession = detail::GenericCliAsyncSession<detail::StandaloneAsioLib>; }
+namespace cli { using StandaloneAsioCliAsyncTerminalSession = detail::GenericCliAsyncTerminalSession<detail::StandaloneAsioLib>; }
 
 #endif // CLI_STANDALONEASIOCLIASYNCSESSION_H_
 
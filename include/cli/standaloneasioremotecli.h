@@ -34,6 +34,7 @@
 #include "detail/genericasioremotecli.h"
 
 namespace cli { using StandaloneAsioCliTelnetServer = detail::CliGenericTelnetServer<detail::StandaloneAsioLib>; }
+namespace cli { using StandaloneAsioCliRawServer = detail::CliGenericRawServer<detail::StandaloneAsioLib>; }
 
 
 #endif // CLI_STANDALONEASIOREMOTECLI_H_
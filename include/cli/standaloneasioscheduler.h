@@ -31,8 +31,13 @@
 #define CLI_STANDALONEASIOSCHEDULER_H_
 
 #include "detail/genericasioscheduler.h"
+#include "detail/genericasioschedulergroup.h"
 #include "detail/standaloneasiolib.h"
 
-namespace cli { using StandaloneAsioScheduler = detail::GenericAsioScheduler<detail::StandaloneAsioLib>; }
+namespace cli
+{
+using StandaloneAsioScheduler = detail::GenericAsioScheduler<detail::StandaloneAsioLib>;
+using StandaloneAsioSchedulerGroup = detail::GenericAsioSchedulerGroup<detail::StandaloneAsioLib>;
+}
 
 #endif // CLI_STANDALONEASIOSCHEDULER_H_
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_STREAMED_H_
+#define CLI_STREAMED_H_
+
+#include <functional>
+#include <ostream>
+#include <utility>
+
+namespace cli
+{
+
+/**
+ * @brief The output of a command, generated while it's being sent.
+ *
+ * A command handler returning a Streamed writes its output through a function
+ * that writes the next chunk (e.g., a row) on the stream at each call,
+ * and returns false after the last one.
+ * The remote sessions call it only while the output waiting to be sent
+ * is under a limit (see Server::StreamBacklog), and again as the client reads:
+ * the memory stays bounded, and ctrl+C, the command timeout or the disconnection
+ * of the client stop the generation at once. Meanwhile the session doesn't run
+ * other commands, as for the asynchronous ones (see Completion).
+ * The other sessions, and the framed mode, call it up to the last chunk.
+ *
+ * @code
+ * menu->Insert("dump", [](std::ostream&)
+ * {
+ *     auto i = std::make_shared<std::size_t>(0);
+ *     return cli::Streamed([i](std::ostream& out)
+ *     {
+ *         out << table.Row(*i) << '\n';
+ *         return ++*i < table.Size();
+ *     });
+ * });
+ * @endcode
+ */
+class Streamed
+{
+public:
+    using Next = std::function<bool(std::ostream&)>;
+
+    explicit Streamed(Next _next) : next(std::move(_next)) {}
+
+    // The elements of [first, last) written by write(out, element), one at each call.
+    // The range must be valid until the command ends.
+    template <typename It, typename W>
+    static Streamed Range(It first, It last, W write)
+    {
+        return Streamed([first, last, write](std::ostream& out) mutable
+        {
+            if (first == last)
+                return false;
+            write(out, *first);
+            return ++first != last;
+        });
+    }
+
+    // The elements of [first, last) written by operator<<, a line each
+    template <typename It>
+    static Streamed Range(It first, It last)
+    {
+        return Range(first, last, [](std::ostream& out, const decltype(*first)& e){ out << e << '\n'; });
+    }
+
+    // Writes the next chunk, returning false after the last one
+    bool operator()(std::ostream& out) const { return next(out); }
+
+private:
+    Next next;
+};
+
+} // namespace cli
+
+#endif // CLI_STREAMED_H_
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CLI_TASK_H_
+#define CLI_TASK_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cli
+{
+
+/**
+ * @brief A move-only function object taking no parameters and returning void.
+ *
+ * Unlike @c std::function, a @c Task can hold move-only callables,
+ * and stores the callables up to @c InlineSize bytes (e.g., all the lambdas
+ * used by the library) in an internal buffer, without allocating memory.
+ * The bigger ones are allocated on the heap.
+ */
+class Task
+{
+public:
+    static constexpr std::size_t InlineSize = 64;
+
+    Task() noexcept = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+    explicit Task(F&& f)
+    {
+        using Fn = std::decay_t<F>;
+        Construct<Fn>(std::forward<F>(f), IsInline<Fn>{});
+    }
+
+    Task(Task&& other) noexcept { MoveFrom(other); }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    ~Task() { Reset(); }
+
+    // non copyable
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    // precondition: the task is not empty
+    void operator()() { ops->invoke(&buffer); }
+
+private:
+
+    template <typename Fn>
+    using IsInline = std::integral_constant<bool,
+        sizeof(Fn) <= InlineSize &&
+        alignof(Fn) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<Fn>::value
+    >;
+
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to) noexcept; // to is uninitialized, from is destroyed
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    // the callable is constructed in the buffer
+    template <typename Fn>
+    struct InlineOps
+    {
+        static Fn& Get(void* s) { return *static_cast<Fn*>(s); }
+        static void Invoke(void* s) { Get(s)(); }
+        static void Move(void* from, void* to) noexcept
+        {
+            ::new (to) Fn(std::move(Get(from)));
+            Get(from).~Fn();
+        }
+        static void Destroy(void* s) noexcept { Get(s).~Fn(); }
+        static constexpr Ops ops{ &Invoke, &Move, &Destroy };
+    };
+
+    // the buffer contains a pointer to the callable
+    template <typename Fn>
+    struct HeapOps
+    {
+        static Fn*& Get(void* s) { return *static_cast<Fn**>(s); }
+        static void Invoke(void* s) { (*Get(s))(); }
+        static void Move(void* from, void* to) noexcept { ::new (to) Fn*(Get(from)); }
+        static void Destroy(void* s) noexcept { delete Get(s); }
+        static constexpr Ops ops{ &Invoke, &Move, &Destroy };
+    };
+
+    template <typename Fn, typename F>
+    void Construct(F&& f, std::true_type /*inline*/)
+    {
+        ::new (static_cast<void*>(&buffer)) Fn(std::forward<F>(f));
+        ops = &InlineOps<Fn>::ops;
+    }
+
+    template <typename Fn, typename F>
+    void Construct(F&& f, std::false_type /*inline*/)
+    {
+        ::new (static_cast<void*>(&buffer)) Fn*(new Fn(std::forward<F>(f)));
+        ops = &HeapOps<Fn>::ops;
+    }
+
+    void MoveFrom(Task& other) noexcept
+    {
+        if (other.ops)
+        {
+            other.ops->move(&other.buffer, &buffer);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    void Reset() noexcept
+    {
+        if (ops)
+        {
+            ops->destroy(&buffer);
+            ops = nullptr;
+        }
+    }
+
+    std::aligned_storage_t<InlineSize, alignof(std::max_align_t)> buffer;
+    const Ops* ops = nullptr;
+};
+
+template <typename Fn>
+constexpr Task::Ops Task::InlineOps<Fn>::ops;
+
+template <typename Fn>
+constexpr Task::Ops Task::HeapOps<Fn>::ops;
+
+} // namespace cli
+
+#endif // CLI_TASK_H_
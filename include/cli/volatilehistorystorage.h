@@ -31,36 +31,102 @@
 #define CLI_VOLATILEHISTORYSTORAGE_H_
 
 #include "historystorage.h"
-#include <deque>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace cli
 {
 
+/**
+ * @brief VolatileHistoryStorage keeps the history in memory.
+ *
+ * The commands are kept in an immutable list of batches (one for each Store),
+ * from the newest to the oldest, whose head is replaced atomically:
+ * Store never waits for the other stores, and Commands never waits for them.
+ * When the list holds twice the size of the history, a Store replaces it
+ * with a single batch of the newest commands.
+ */
 class VolatileHistoryStorage : public HistoryStorage
 {
     public:
         explicit VolatileHistoryStorage(std::size_t size = 1000) : maxSize(size) {}
         void Store(const std::vector<std::string>& cmds) override
         {
-            using dt = std::deque<std::string>::difference_type;
-            commands.insert(commands.end(), cmds.begin(), cmds.end());
-            if (commands.size() > maxSize)
-                commands.erase(
-                    commands.begin(),
-                    commands.begin()+static_cast<dt>(commands.size()-maxSize)
-                );
+            if (cmds.empty())
+                return;
+            auto head = std::atomic_load(&newest);
+            std::shared_ptr<const Batch> batch;
+            do
+            {
+                auto b = std::make_shared<Batch>();
+                b->commands = cmds;
+                b->older = head;
+                b->total = cmds.size() + (head ? head->total : 0);
+                if (b->total > 2 * maxSize)
+                {
+                    // compaction
+                    b->commands = Newest(b);
+                    b->older.reset();
+                    b->total = b->commands.size();
+                }
+                batch = std::move(b);
+            } while (!std::atomic_compare_exchange_weak(&newest, &head, batch));
         }
         std::vector<std::string> Commands() const override
         {
-            return std::vector<std::string>(commands.begin(), commands.end());
+            return Newest(std::atomic_load(&newest));
         }
         void Clear() override
         {
-            commands.clear();
+            std::atomic_store(&newest, std::shared_ptr<const Batch>());
         }
     private:
+        struct Batch
+        {
+            Batch() = default;
+            Batch(const Batch&) = delete;
+            Batch& operator=(const Batch&) = delete;
+            ~Batch()
+            {
+                // destroy the older batches iteratively, to avoid a deep recursion
+                auto b = std::move(older);
+                while (b && b.use_count() == 1)
+                    b = std::move(b->older);
+            }
+            std::vector<std::string> commands;
+            mutable std::shared_ptr<const Batch> older;
+            std::size_t total = 0; // the commands in this batch and in the older ones
+        };
+
+        // the maxSize newest commands of the list starting with batch
+        std::vector<std::string> Newest(std::shared_ptr<const Batch> batch) const
+        {
+            std::vector<const Batch*> batches;
+            std::size_t n = 0;
+            for (const Batch* b = batch.get(); b != nullptr && n < maxSize; b = b->older.get())
+            {
+                batches.push_back(b);
+                n += b->commands.size();
+            }
+            std::vector<std::string> result;
+            result.reserve(std::min(n, maxSize));
+            for (auto i = batches.rbegin(); i != batches.rend(); ++i)
+            {
+                const auto& c = (*i)->commands;
+                // skip the oldest commands beyond maxSize
+                const auto skip = (n > maxSize) ? std::min(n - maxSize, c.size()) : 0;
+                n -= skip;
+                result.insert(result.end(), c.begin() + static_cast<std::ptrdiff_t>(skip), c.end());
+            }
+            return result;
+        }
+
         const std::size_t maxSize;
-        std::deque<std::string> commands;
+        std::shared_ptr<const Batch> newest;
 };
 
 } // namespace cli
@@ -31,7 +31,14 @@
 #define SCHEDULER_TEST_TEMPLATES_H_
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
+#include "cli/scheduler.h"
 
 template <typename S>
 void SchedulingTest()
@@ -77,4 +84,122 @@ void ExceptionTest()
     BOOST_CHECK_THROW( scheduler.ExecOne(), int );
 }
 
+template <typename S>
+void MoveOnlyTest()
+{
+    S scheduler;
+    int result = 0;
+    auto value = std::make_unique<int>(42);
+    scheduler.Post( [&result, v = std::move(value)]() noexcept { result = *v; } );
+    scheduler.ExecOne();
+    BOOST_CHECK_EQUAL(result, 42);
+
+    // through the base class
+    cli::Scheduler& base = scheduler;
+    base.Post( cli::Task([&result, v = std::make_unique<int>(7)]() noexcept { result = *v; }) );
+    scheduler.ExecOne();
+    BOOST_CHECK_EQUAL(result, 7);
+}
+
+// the tasks posted to a scheduler run one at a time even on a pool of threads
+template <typename S>
+void ThreadPoolTest()
+{
+    S scheduler;
+    std::atomic<int> running{0};
+    std::atomic<bool> overlap{false};
+    int count = 0;
+    const int tasks = 1000;
+    for (int i = 0; i < tasks; ++i)
+        scheduler.Post( [&]()
+            {
+                if (running++ != 0) overlap = true;
+                if (++count == tasks) scheduler.Stop();
+                --running;
+            }
+        );
+    scheduler.Run(4);
+    BOOST_CHECK(!overlap);
+    BOOST_CHECK_EQUAL(count, tasks);
+}
+
+template <typename S>
+void PriorityTest()
+{
+    S scheduler;
+    std::vector<int> order;
+    for (int i = 0; i < 3; ++i)
+        scheduler.Post( [&order, i]() { order.push_back(i); } );
+    for (int i = 10; i < 12; ++i)
+        scheduler.Post( cli::Priority::interactive, [&order, i]() { order.push_back(i); } );
+    scheduler.Post( [&scheduler]() { scheduler.Stop(); } );
+    scheduler.Run();
+    const std::vector<int> expected{10, 11, 0, 1, 2};
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+
+    // the bulk tasks progress under a steady interactive load
+    S loaded;
+    int interactive = 0;
+    int passedAfter = -1;
+    loaded.Post( [&]() { passedAfter = interactive; } );
+    for (int i = 0; i < 100; ++i)
+        loaded.Post( cli::Priority::interactive, [&]() { ++interactive; } );
+    loaded.Post( cli::Priority::interactive, [&loaded]() { loaded.Stop(); } );
+    loaded.Run();
+    BOOST_CHECK_GT(passedAfter, 0);
+    BOOST_CHECK_LT(passedAfter, 100);
+    BOOST_CHECK_EQUAL(interactive, 100);
+}
+
+template <typename S>
+void TimerTest()
+{
+    using namespace std::chrono;
+    S scheduler;
+    const auto start = steady_clock::now();
+    std::vector<int> order;
+    steady_clock::time_point fired;
+    scheduler.PostAfter(milliseconds(40), [&]() { order.push_back(2); fired = steady_clock::now(); });
+    scheduler.PostAfter(milliseconds(10), [&]() { order.push_back(1); });
+    auto cancelled = scheduler.PostAfter(milliseconds(20), [&]() { order.push_back(-1); });
+    cancelled.Cancel();
+    BOOST_CHECK(cancelled.Cancelled());
+    int ticks = 0;
+    cli::Timer periodic;
+    periodic = scheduler.PostEvery(milliseconds(5), [&]()
+        {
+            if (++ticks == 3)
+                periodic.Cancel();
+        });
+    scheduler.PostAfter(milliseconds(60), [&scheduler]() { scheduler.Stop(); });
+    scheduler.Post( [&order]() { order.push_back(0); } );
+    scheduler.Run();
+    const std::vector<int> expected{0, 1, 2};
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+    BOOST_CHECK(fired - start >= milliseconds(40));
+    BOOST_CHECK_EQUAL(ticks, 3);
+}
+
+template <typename G>
+void SchedulerGroupTest()
+{
+    G group(3);
+    BOOST_CHECK_EQUAL(group.Size(), 3u);
+    std::mutex mtx;
+    std::vector<std::thread::id> threads;
+    for (std::size_t i = 0; i < group.Size(); ++i)
+        group[i].Post( [&]()
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                threads.push_back(std::this_thread::get_id());
+                if (threads.size() == group.Size()) group.Stop();
+            }
+        );
+    group.Run();
+    BOOST_REQUIRE_EQUAL(threads.size(), 3u);
+    std::sort(threads.begin(), threads.end());
+    BOOST_CHECK(std::unique(threads.begin(), threads.end()) == threads.end());
+    BOOST_CHECK(std::find(threads.begin(), threads.end(), std::this_thread::get_id()) == threads.end());
+}
+
 #endif // SCHEDULER_TEST_TEMPLATES_H_
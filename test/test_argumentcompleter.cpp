@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/argumentcompleter.h"
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace cli;
+
+namespace
+{
+    using Values = ArgumentCompleter::Values;
+
+    void CheckValues(const Values& values, const Values& expected)
+    {
+        BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(), expected.begin(), expected.end());
+    }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ArgumentCompleterSuite)
+
+BOOST_AUTO_TEST_CASE(Cache)
+{
+    size_t calls = 0;
+    auto completer = ArgumentCompleter::Immediate([&](const string&)
+    {
+        ++calls;
+        return Values{"eth1", "eth0", "lo", "eth0"};
+    }, milliseconds(100));
+
+    // sorted, without duplicates, starting with the prefix
+    CheckValues(completer.Get(""), {"eth0", "eth1", "lo"});
+    CheckValues(completer.Get("e"), {"eth0", "eth1"});
+    CheckValues(completer.Get("eth1"), {"eth1"});
+    BOOST_CHECK(completer.Get("x").empty());
+    // the answer for "" gives the values of the longer prefixes
+    BOOST_CHECK_EQUAL(calls, 1u);
+
+    // the copies share the cache
+    ArgumentCompleter copy = completer;
+    CheckValues(copy.Get("l"), {"lo"});
+    BOOST_CHECK_EQUAL(calls, 1u);
+
+    // the time to live
+    this_thread::sleep_for(milliseconds(150));
+    CheckValues(completer.Get("lo"), {"lo"});
+    BOOST_CHECK_EQUAL(calls, 2u);
+    // a shorter prefix is not covered by the answer for "lo"
+    CheckValues(completer.Get("e"), {"eth0", "eth1"});
+    BOOST_CHECK_EQUAL(calls, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(Deadline)
+{
+    vector<ArgumentCompleter::Reply> replies;
+    ArgumentCompleter completer([&](const string&, ArgumentCompleter::Reply reply)
+    {
+        reply.Add({"dev2", "dev1"});
+        replies.push_back(reply);
+    }, seconds(30), milliseconds(20));
+
+    // the deadline expires: the partial answer
+    const auto start = steady_clock::now();
+    CheckValues(completer.Get("dev"), {"dev1", "dev2"});
+    BOOST_CHECK(steady_clock::now() - start >= milliseconds(20));
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+
+    // the provider is not called again while it's answering
+    CheckValues(completer.Get("dev"), {"dev1", "dev2"});
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+
+    // the answer, from another thread
+    thread answer([&](){ replies[0]({"dev3"}); });
+    answer.join();
+    CheckValues(completer.Get("dev"), {"dev1", "dev2", "dev3"});
+    CheckValues(completer.Get("dev3"), {"dev3"});
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+
+    // the values added after the answer are ignored
+    replies[0].Add({"dev4"});
+    replies[0].Done();
+    CheckValues(completer.Get("dev"), {"dev1", "dev2", "dev3"});
+}
+
+BOOST_AUTO_TEST_CASE(AnswerBeforeDeadline)
+{
+    thread answer;
+    ArgumentCompleter completer([&answer](const string& prefix, ArgumentCompleter::Reply reply)
+    {
+        answer = thread([prefix, reply](){
+            this_thread::sleep_for(milliseconds(5));
+            reply({prefix + "a", prefix + "b"});
+        });
+    }, seconds(30), seconds(10));
+
+    const auto start = steady_clock::now();
+    CheckValues(completer.Get("x"), {"xa", "xb"});
+    BOOST_CHECK(steady_clock::now() - start < seconds(10));
+    answer.join();
+}
+
+BOOST_AUTO_TEST_CASE(ExpiredValues)
+{
+    bool slow = false;
+    vector<ArgumentCompleter::Reply> replies;
+    ArgumentCompleter completer([&](const string&, ArgumentCompleter::Reply reply)
+    {
+        if (slow)
+            replies.push_back(reply);
+        else
+            reply({"a1", "a2"});
+    }, milliseconds(10), milliseconds(10));
+
+    CheckValues(completer.Get("a"), {"a1", "a2"});
+    this_thread::sleep_for(milliseconds(20));
+    // the provider misses the deadline: the values expired
+    slow = true;
+    CheckValues(completer.Get("a"), {"a1", "a2"});
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+    replies[0]({"a3"});
+    CheckValues(completer.Get("a"), {"a3"});
+}
+
+BOOST_AUTO_TEST_CASE(ProviderThrowing)
+{
+    size_t calls = 0;
+    ArgumentCompleter completer([&](const string&, ArgumentCompleter::Reply) -> void
+    {
+        ++calls;
+        throw runtime_error("no database");
+    }, milliseconds(0), seconds(10));
+    // an empty answer, without waiting for the deadline
+    const auto start = steady_clock::now();
+    BOOST_CHECK(completer.Get("a").empty());
+    BOOST_CHECK(steady_clock::now() - start < seconds(10));
+    BOOST_CHECK(completer.Get("a").empty());
+    BOOST_CHECK_EQUAL(calls, 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
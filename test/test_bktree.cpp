@@ -0,0 +1,162 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/bktree.h"
+#include <map>
+#include <random>
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+    using Found = vector<pair<size_t, string>>;
+
+    Found Find(const BkTree& tree, const string& word, size_t maxDistance)
+    {
+        Found found;
+        tree.Find(word, maxDistance, found);
+        sort(found.begin(), found.end());
+        return found;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BkTreeSuite)
+
+BOOST_AUTO_TEST_CASE(Distance)
+{
+    BOOST_CHECK_EQUAL( EditDistance("", ""), 0u );
+    BOOST_CHECK_EQUAL( EditDistance("help", "help"), 0u );
+    BOOST_CHECK_EQUAL( EditDistance("", "help"), 4u );
+    BOOST_CHECK_EQUAL( EditDistance("help", ""), 4u );
+    BOOST_CHECK_EQUAL( EditDistance("hlep", "help"), 2u );
+    BOOST_CHECK_EQUAL( EditDistance("hel", "help"), 1u );
+    BOOST_CHECK_EQUAL( EditDistance("helpp", "help"), 1u );
+    BOOST_CHECK_EQUAL( EditDistance("kitten", "sitting"), 3u );
+    BOOST_CHECK_EQUAL( EditDistance("sitting", "kitten"), 3u );
+}
+
+BOOST_AUTO_TEST_CASE(InsertEraseFind)
+{
+    BkTree tree;
+    BOOST_CHECK(Find(tree, "help", 2).empty());
+
+    for (const char* w: {"help", "hello", "exit", "show", "shout", "help"})
+        tree.Insert(w);
+    BOOST_CHECK_EQUAL(tree.Size(), 5u);
+
+    Found expected{ {1, "hello"}, {1, "help"} };
+    auto found = Find(tree, "helo", 1);
+    BOOST_CHECK(found == expected);
+
+    expected = { {0, "show"}, {2, "shout"} };
+    found = Find(tree, "show", 2);
+    BOOST_CHECK(found == expected);
+
+    // inserted twice: found until erased twice
+    tree.Erase("help");
+    BOOST_CHECK_EQUAL(Find(tree, "help", 0).size(), 1u);
+    tree.Erase("help");
+    BOOST_CHECK(Find(tree, "help", 0).empty());
+    tree.Erase("help"); // nothing happens
+    tree.Erase("none");
+    BOOST_CHECK_EQUAL(tree.Size(), 4u);
+    expected = { {1, "hello"} };
+    found = Find(tree, "helo", 1);
+    BOOST_CHECK(found == expected);
+
+    // inserted again
+    tree.Insert("help");
+    BOOST_CHECK_EQUAL(Find(tree, "help", 0).size(), 1u);
+
+    // erasing most of the words rebuilds the tree
+    for (const char* w: {"help", "hello", "exit", "show"})
+        tree.Erase(w);
+    BOOST_CHECK_EQUAL(tree.Size(), 1u);
+    expected = { {2, "shout"} };
+    found = Find(tree, "show", 3);
+    BOOST_CHECK(found == expected);
+}
+
+// the same words found by the tree and by computing all the distances
+BOOST_AUTO_TEST_CASE(Random)
+{
+    mt19937 gen(42);
+    uniform_int_distribution<int> len(1, 8);
+    uniform_int_distribution<int> letter('a', 'e');
+    auto word = [&]()
+    {
+        string w(static_cast<size_t>(len(gen)), 'a');
+        for (auto& c: w)
+            c = static_cast<char>(letter(gen));
+        return w;
+    };
+
+    BkTree tree;
+    map<string, size_t> words;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const string w = word();
+        if (i % 3 == 0 && !words.empty())
+        {
+            // erase one of the words
+            auto victim = words.lower_bound(w);
+            if (victim == words.end())
+                victim = words.begin();
+            tree.Erase(victim->first);
+            if (--victim->second == 0)
+                words.erase(victim);
+        }
+        else
+        {
+            tree.Insert(w);
+            ++words[w];
+        }
+    }
+    BOOST_CHECK_EQUAL(tree.Size(), words.size());
+
+    for (int i = 0; i < 200; ++i)
+    {
+        const string w = word();
+        const size_t maxDistance = static_cast<size_t>(i % 4);
+        Found expected;
+        for (const auto& e: words)
+        {
+            const auto d = EditDistance(w, e.first);
+            if (d <= maxDistance)
+                expected.emplace_back(d, e.first);
+        }
+        sort(expected.begin(), expected.end());
+        const auto found = Find(tree, w, maxDistance);
+        BOOST_CHECK(found == expected);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
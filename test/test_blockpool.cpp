@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/blockpool.h"
+#include <string>
+
+using namespace cli::detail;
+
+namespace
+{
+struct Probe
+{
+    explicit Probe(int& _alive) : alive(_alive) { ++alive; }
+    ~Probe() { --alive; }
+    int& alive;
+    char payload[512];
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BlockPoolSuite)
+
+BOOST_AUTO_TEST_CASE(Recycling)
+{
+    auto pool = std::make_shared<BlockPool>(2);
+    int alive = 0;
+
+    auto a = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    auto b = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    auto c = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    BOOST_CHECK_EQUAL(alive, 3);
+    BOOST_CHECK_EQUAL(pool->Free(), 0u);
+
+    const void* addressOfA = a.get();
+    a.reset();
+    b.reset();
+    c.reset();
+    BOOST_CHECK_EQUAL(alive, 0);
+    // only two blocks are kept
+    BOOST_CHECK_EQUAL(pool->Free(), 2u);
+
+    auto d = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    auto e = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    BOOST_CHECK_EQUAL(pool->Reused(), 2u);
+    BOOST_CHECK_EQUAL(pool->Free(), 0u);
+    BOOST_CHECK(d.get() == addressOfA || e.get() == addressOfA);
+
+    // a different size does not use the pool
+    auto s = std::allocate_shared<std::string>(PoolAllocator<std::string>(pool), "x");
+    s.reset();
+    BOOST_CHECK_EQUAL(pool->Free(), 0u);
+
+    // the pool can be disabled
+    d.reset();
+    BOOST_CHECK_EQUAL(pool->Free(), 1u);
+    pool->MaxFree(0);
+    BOOST_CHECK_EQUAL(pool->Free(), 0u);
+    e.reset();
+    BOOST_CHECK_EQUAL(pool->Free(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(PoolOutlivesOwner)
+{
+    int alive = 0;
+    std::shared_ptr<Probe> p;
+    {
+        auto pool = std::make_shared<BlockPool>(4);
+        p = std::allocate_shared<Probe>(PoolAllocator<Probe>(pool), alive);
+    }
+    // the object keeps the pool alive through its allocator
+    BOOST_CHECK_EQUAL(alive, 1);
+    p.reset();
+    BOOST_CHECK_EQUAL(alive, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/platform.h"
+
+#if defined(CLI_OS_LINUX) || defined(CLI_OS_MAC)
+
+#include <unistd.h>
+#include "cli/boostasioscheduler.h"
+#include "cli/detail/genericasiokeyboard.h"
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(BoostAsioKeyboardSuite)
+
+BOOST_AUTO_TEST_CASE(KeysFromDescriptor)
+{
+    int pipes[2];
+    BOOST_REQUIRE(pipe(pipes) == 0);
+
+    BoostAsioScheduler scheduler;
+    vector<InputDevice::KeyEvents> batches;
+    {
+        GenericAsioKeyboard<BoostAsioLib> kb(scheduler, pipes[0]);
+        kb.Register([&](const InputDevice::KeyEvents& keys){ batches.push_back(keys); });
+
+        // the keys read together are delivered together,
+        // and an escape sequence can span two reads
+        const string first = "ab\x1b[";
+        BOOST_REQUIRE(write(pipes[1], first.data(), first.size()) == static_cast<ssize_t>(first.size()));
+        while (batches.empty())
+            scheduler.ExecOne();
+        BOOST_REQUIRE_EQUAL(batches.size(), 1u);
+        BOOST_REQUIRE_EQUAL(batches[0].size(), 2u);
+        BOOST_CHECK(batches[0][0] == make_pair(KeyType::ascii, 'a'));
+        BOOST_CHECK(batches[0][1] == make_pair(KeyType::ascii, 'b'));
+
+        const string second = "A\n";
+        BOOST_REQUIRE(write(pipes[1], second.data(), second.size()) == static_cast<ssize_t>(second.size()));
+        while (batches.size() < 2)
+            scheduler.ExecOne();
+        BOOST_REQUIRE_EQUAL(batches[1].size(), 2u);
+        BOOST_CHECK(batches[1][0].first == KeyType::up);
+        BOOST_CHECK(batches[1][1].first == KeyType::ret);
+
+        // the end of the input is a key too
+        close(pipes[1]);
+        while (batches.size() < 3)
+            scheduler.ExecOne();
+        BOOST_REQUIRE_EQUAL(batches[2].size(), 1u);
+        BOOST_CHECK(batches[2][0].first == KeyType::eof);
+    }
+    // the keyboard reads a copy of the descriptor
+    BOOST_CHECK(close(pipes[0]) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // defined(CLI_OS_LINUX) || defined(CLI_OS_MAC)
@@ -0,0 +1,629 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/boostasioscheduler.h"
+#include "cli/boostasioremotecli.h"
+#include "cli/detail/server.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace cli;
+
+namespace
+{
+
+// A telnet session without a connection, to feed its decoder
+// and to look at its encoder
+class TelnetProbe : public detail::TelnetSession
+{
+public:
+    explicit TelnetProbe(boost::asio::io_context& ioc) : detail::TelnetSession(ClosedSocket(ioc)) {}
+    string Encoded(const string& text, string out = {}) const
+    {
+        Encode(text.data(), text.size(), out);
+        return out;
+    }
+    void Receive(const string& bytes) { OnDataReceived(bytes.data(), bytes.size()); }
+
+    string data; // received, without the telnet commands
+    vector<pair<unsigned short, unsigned short>> sizes; // of the window
+    int interrupts = 0;
+private:
+    using detail::TelnetSession::Output;
+    void Output(const char* _data, size_t size) override { data.append(_data, size); }
+    void OnWindowSize(unsigned short width, unsigned short height) override { sizes.emplace_back(width, height); }
+    void OnInterrupt() override { ++interrupts; }
+    // the answers to the client are discarded
+    static Socket ClosedSocket(boost::asio::io_context& ioc)
+    {
+        Socket socket(ioc, boost::asio::generic::stream_protocol(boost::asio::ip::tcp::v4()));
+        socket.close();
+        return socket;
+    }
+};
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+// Read from the client, appending to received, until the condition is true
+// or 5 seconds pass: returns false if the connection is closed in the meantime
+template <typename F>
+bool ReadUntil(boost::asio::local::stream_protocol::socket& client, string& received, F done)
+{
+    client.non_blocking(true);
+    bool open = true;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (!done(received) && chrono::steady_clock::now() < deadline)
+    {
+        char buffer[4096];
+        boost::system::error_code ec;
+        const auto n = client.read_some(boost::asio::buffer(buffer), ec);
+        if (ec == boost::asio::error::would_block)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        else if (ec)
+        {
+            open = false;
+            break;
+        }
+        else
+            received.append(buffer, n);
+    }
+    client.non_blocking(false);
+    return open;
+}
+
+// True if the server has closed the connection (the data received is discarded)
+bool Closed(boost::asio::local::stream_protocol::socket& client)
+{
+    client.non_blocking(true);
+    char buffer[256];
+    boost::system::error_code ec;
+    while (!ec)
+        client.read_some(boost::asio::buffer(buffer), ec);
+    client.non_blocking(false);
+    return ec != boost::asio::error::would_block;
+}
+
+// Send the text on a raw connection, and return what is received
+// until the condition is true, the connection is closed or 5 seconds pass
+template <typename F>
+string Exchange(const string& path, const string& text, F done)
+{
+    boost::asio::io_context ioc;
+    boost::asio::local::stream_protocol::socket client(ioc);
+    client.connect(boost::asio::local::stream_protocol::endpoint(path));
+    boost::asio::write(client, boost::asio::buffer(text));
+    string received;
+    ReadUntil(client, received, done);
+    return received;
+}
+
+// A session running a script on the data it receives, with access
+// to the output methods of detail::Session
+class ScriptedSession : public detail::Session
+{
+public:
+    using Script = function<void(ScriptedSession&, const string&)>;
+    ScriptedSession(Socket socket, Script _script) : detail::Session(std::move(socket)), script(std::move(_script)) {}
+    ostream& Out() { return OutStream(); }
+    void Queue(const string& msg) { Send(msg); }
+    void Spread(const string& text) { Broadcast(make_shared<const string>(text)); }
+private:
+    void OnConnect() override {}
+    void OnDisconnect() override {}
+    void OnError() override {}
+    void OnDataReceived(const char* data, size_t size) override { script(*this, string(data, size)); }
+    Script script;
+};
+
+class ScriptedServer : public detail::Server<detail::BoostAsioLib>
+{
+public:
+    ScriptedServer(detail::BoostAsioLib::ContextType& ioc, const string& path, ScriptedSession::Script _script) :
+        detail::Server<detail::BoostAsioLib>(ioc, detail::LocalSocket(path)),
+        script(std::move(_script))
+    {}
+    shared_ptr<detail::Session> CreateSession(detail::Session::Socket socket) override
+    {
+        return make_shared<ScriptedSession>(std::move(socket), script);
+    }
+private:
+    ScriptedSession::Script script;
+};
+
+// Records the thread where each session starts, and how many sessions are alive
+struct Placements
+{
+    std::mutex mtx;
+    std::vector<std::thread::id> threads;
+    std::atomic<int> alive{0};
+    std::size_t Started()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return threads.size();
+    }
+};
+
+class PlacedSession : public detail::Session
+{
+public:
+    PlacedSession(Socket socket, Placements& _placements) : detail::Session(std::move(socket)), placements(_placements) { ++placements.alive; }
+    ~PlacedSession() override { --placements.alive; }
+private:
+    void OnConnect() override
+    {
+        std::lock_guard<std::mutex> lock(placements.mtx);
+        placements.threads.push_back(std::this_thread::get_id());
+    }
+    void OnDisconnect() override {}
+    void OnError() override {}
+    void OnDataReceived(const char*, std::size_t) override {}
+    Placements& placements;
+};
+
+class PlacingServer : public detail::Server<detail::BoostAsioLib>
+{
+public:
+    PlacingServer(detail::BoostAsioLib::ContextType& ioc, const std::string& path, Placements& _placements) :
+        detail::Server<detail::BoostAsioLib>(ioc, detail::LocalSocket(path)),
+        placements(_placements)
+    {}
+    std::shared_ptr<detail::Session> CreateSession(detail::Session::Socket socket) override
+    {
+        return std::make_shared<PlacedSession>(std::move(socket), placements);
+    }
+private:
+    Placements& placements;
+};
+
+template <typename F>
+bool WaitFor(F condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// The output queued when the client stops reading: more than the socket buffers can hold
+const string backlog(4 * 1024 * 1024, '.');
+
+// Broadcast to a client that stops reading, with the policy given: a first broadcast
+// is sent at once, then the backlog is queued and three more are broadcast,
+// followed by "end\n" (not a broadcast). Returns what the client receives
+// when it catches up (up to size bytes), and if the connection is still open.
+string BroadcastToSlowReader(detail::BroadcastOverflow policy, size_t size, bool& open)
+{
+    const string path = "cli_test_broadcast.sock";
+    BoostAsioScheduler scheduler;
+    atomic<int> handled{0};
+    ScriptedServer server(scheduler.AsioContext(), path, [&handled](ScriptedSession& session, const string& received)
+    {
+        for (char c: received)
+        {
+            if (c == 'q')
+                session.Queue(backlog);
+            else if (c == 'e')
+                session.Queue("end\n");
+            else
+                session.Spread(string(1, c) + '\n');
+            ++handled;
+        }
+    });
+    server.BroadcastHighWaterMark(1024, policy);
+    thread runner([&scheduler](){ scheduler.Run(); });
+
+    boost::asio::io_context ioc;
+    boost::asio::local::stream_protocol::socket client(ioc);
+    client.connect(boost::asio::local::stream_protocol::endpoint(path));
+    boost::asio::write(client, boost::asio::buffer("0q", 2));
+    BOOST_CHECK(WaitFor([&handled](){ return handled == 2; }));
+    boost::asio::write(client, boost::asio::buffer("ABCe", 4));
+    BOOST_CHECK(WaitFor([&handled](){ return handled == 6; }));
+    string received;
+    open = ReadUntil(client, received, [size](const string& r){ return r.size() >= size; });
+
+    scheduler.Stop();
+    runner.join();
+    return received;
+}
+
+// Connect 3 clients, close the second one and connect 2 more,
+// returning the index of the scheduler of each session
+std::vector<std::size_t> Place(detail::SessionPlacement placement)
+{
+    const std::string path = "cli_test_shards.sock";
+    BoostAsioSchedulerGroup group(2);
+    std::vector<std::thread::id> ids(group.Size());
+    for (std::size_t i = 0; i < group.Size(); ++i)
+        group[i].Post([&ids, i](){ ids[i] = std::this_thread::get_id(); });
+    Placements placements;
+    PlacingServer server(group[0].AsioContext(), path, placements);
+    server.Shards(group, placement);
+    std::thread runner([&group](){ group.Run(false); });
+
+    boost::asio::io_context clientContext;
+    std::vector<std::unique_ptr<boost::asio::local::stream_protocol::socket>> clients;
+    auto connect = [&]()
+    {
+        clients.push_back(std::make_unique<boost::asio::local::stream_protocol::socket>(clientContext));
+        clients.back()->connect(boost::asio::local::stream_protocol::endpoint(path));
+        const std::size_t n = clients.size();
+        BOOST_CHECK(WaitFor([&](){ return placements.Started() == n; }));
+    };
+    connect();
+    connect();
+    connect();
+    clients[1]->close();
+    BOOST_CHECK(WaitFor([&](){ return placements.alive == 2; }));
+    connect();
+    connect();
+
+    group.Stop();
+    runner.join();
+    std::vector<std::size_t> shards;
+    for (auto& t: placements.threads)
+        shards.push_back(static_cast<std::size_t>(std::find(ids.begin(), ids.end(), t) - ids.begin()));
+    return shards;
+}
+
+#endif // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BoostAsioRemoteCliSuite)
+
+BOOST_AUTO_TEST_CASE(TelnetEncoding)
+{
+    boost::asio::io_context ioc;
+    TelnetProbe session(ioc);
+    const string iac("\xff", 1);
+
+    // the data byte 255 is doubled, also at the edges of the buffer and in a row
+    BOOST_CHECK(session.Encoded(iac) == iac + iac);
+    BOOST_CHECK(session.Encoded(iac + "abc" + iac) == iac + iac + "abc" + iac + iac);
+    BOOST_CHECK(session.Encoded(iac + iac + iac) == string(6, '\xff'));
+
+    // LF becomes CR LF, also next to an IAC
+    BOOST_CHECK(session.Encoded("\n") == "\r\n");
+    BOOST_CHECK(session.Encoded("a\nb\n\n") == "a\r\nb\r\n\r\n");
+    BOOST_CHECK(session.Encoded("\n" + iac + "\n") == "\r\n" + iac + iac + "\r\n");
+    BOOST_CHECK(session.Encoded(iac + "\n" + iac) == iac + iac + "\r\n" + iac + iac);
+
+    // a lone CR goes as it is (it moves the cursor of the terminal)
+    BOOST_CHECK(session.Encoded("\r") == "\r");
+    BOOST_CHECK(session.Encoded("50%\r60%") == "50%\r60%");
+
+    // the plain text is unchanged, and appended to the output
+    BOOST_CHECK(session.Encoded("") == "");
+    BOOST_CHECK(session.Encoded("hello", "> ") == "> hello");
+    const string text(10000, 'x');
+    BOOST_CHECK(session.Encoded(text + "\n") == text + "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(TelnetDecoding)
+{
+    boost::asio::io_context ioc;
+    const string iac("\xff", 1);
+    using Size = pair<unsigned short, unsigned short>;
+
+    // an escaped data byte 255 split across two reads
+    {
+        TelnetProbe session(ioc);
+        session.Receive("ab" + iac);
+        session.Receive(iac + "cd");
+        BOOST_CHECK(session.data == "ab" + iac + "cd");
+    }
+    // a command split across two reads is stripped from the data
+    {
+        TelnetProbe session(ioc);
+        session.Receive("x" + iac);
+        session.Receive("\xf1y"); // NOP
+        session.Receive(iac);
+        session.Receive("\xf4"); // IP
+        BOOST_CHECK(session.data == "xy");
+        BOOST_CHECK_EQUAL(session.interrupts, 1);
+    }
+    // a subnegotiation split across reads: NAWS with the window 80x24
+    {
+        TelnetProbe session(ioc);
+        session.Receive("a" + iac + "\xfa\x1f" + string(1, '\0'));
+        session.Receive(string("P\0", 2));
+        session.Receive("\x18" + iac);
+        session.Receive("\xf0" "b");
+        BOOST_CHECK(session.data == "ab");
+        BOOST_CHECK(session.sizes == vector<Size>{Size(80, 24)});
+    }
+    // the window resized, with a byte 255 (escaped) in the width, and each byte in its own read
+    {
+        TelnetProbe session(ioc);
+        const string naws = iac + "\xfa\x1f" + string(1, '\0') + "P" + string(1, '\0') + "\x18" + iac + "\xf0";
+        const string resize = iac + "\xfa\x1f" + string(1, '\0') + iac + iac + string(1, '\0') + "\x2b" + iac + "\xf0";
+        const string stream = naws + "ls\r\n" + resize + "cd";
+        for (char c: stream)
+            session.Receive(string(1, c));
+        BOOST_CHECK(session.data == "ls\r\ncd");
+        BOOST_CHECK((session.sizes == vector<Size>{Size(80, 24), Size(255, 43)}));
+
+        // the same stream in one read
+        TelnetProbe whole(ioc);
+        whole.Receive(stream);
+        BOOST_CHECK(whole.data == session.data);
+        BOOST_CHECK(whole.sizes == session.sizes);
+    }
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+BOOST_AUTO_TEST_CASE(RawPipelining)
+{
+    const string path = "cli_test_raw.sock";
+    auto rootMenu = make_unique<Menu>("cli");
+    vector<thread> workers;
+    rootMenu->Insert("slow", [&workers](ostream&)
+    {
+        Completion done;
+        workers.emplace_back([done]()
+        {
+            this_thread::sleep_for(chrono::milliseconds(100));
+            done.Complete([](ostream& out){ out << "slow\n"; });
+        });
+        return done;
+    });
+    rootMenu->Insert("echo", [](ostream& out, int n){ out << n << '\n'; });
+    Cli cli(move(rootMenu));
+    BoostAsioScheduler scheduler;
+    BoostAsioCliRawServer server(cli, scheduler, detail::LocalSocket(path));
+    server.MaxLineLength(16);
+    thread runner([&scheduler](){ scheduler.Run(); });
+
+    // the commands waiting for the slow one are far more than the limit, each one is shorter
+    string commands = "slow\n";
+    for (int i = 0; i < 20; ++i)
+        commands += "echo " + to_string(i) + '\n';
+    const auto received = Exchange(path, commands, [](const string& r){ return r.find("19\n") != string::npos; });
+    BOOST_CHECK(received.find("#1 ok 5\nslow\n") == 0);
+    for (int i = 0; i < 20; ++i)
+    {
+        const auto n = to_string(i);
+        const string frame = "#" + to_string(i + 2) + " ok " + to_string(n.size() + 1) + '\n' + n + '\n';
+        BOOST_CHECK(received.find(frame) != string::npos);
+    }
+
+    // the limit still applies to the command being received
+    const auto closed = Exchange(path, "slow\n" + string(40, 'x'), [](const string&){ return false; });
+    BOOST_CHECK(closed.find("slow\n") == string::npos);
+
+    scheduler.Stop();
+    runner.join();
+    for (auto& w: workers)
+        w.join();
+}
+
+BOOST_AUTO_TEST_CASE(BufferedOutput)
+{
+    // many times the put area of the session, with the writes on the stream
+    // and the ones queued directly interleaved, and flushed now and then
+    auto lines = [](ostream& out, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            out << "line " << i << '\n';
+            if (i % 1000 == 500)
+                out << flush;
+        }
+    };
+    const string path = "cli_test_buffered.sock";
+    BoostAsioScheduler scheduler;
+    ScriptedServer server(scheduler.AsioContext(), path, [&lines](ScriptedSession& session, const string&)
+    {
+        lines(session.Out(), 0, 50000);
+        session.Queue("sent\n");
+        lines(session.Out(), 50000, 100000);
+        session.Out() << flush;
+    });
+    thread runner([&scheduler](){ scheduler.Run(); });
+
+    ostringstream expected;
+    lines(expected, 0, 50000);
+    expected << "sent\n";
+    lines(expected, 50000, 100000);
+    const auto size = expected.str().size();
+    const auto received = Exchange(path, "go", [size](const string& r){ return r.size() >= size; });
+    BOOST_CHECK(received == expected.str());
+
+    scheduler.Stop();
+    runner.join();
+}
+
+BOOST_AUTO_TEST_CASE(BroadcastOverflow)
+{
+    bool open = false;
+
+    // the broadcasts beyond the mark are lost
+    const string dropped = "0\n" + backlog + "end\n";
+    BOOST_CHECK(BroadcastToSlowReader(detail::BroadcastOverflow::drop, dropped.size(), open) == dropped);
+    BOOST_CHECK(open);
+
+    // only the last one is sent, when the backlog has been written
+    const string coalesced = "0\n" + backlog + "end\nC\n";
+    BOOST_CHECK(BroadcastToSlowReader(detail::BroadcastOverflow::coalesce, coalesced.size(), open) == coalesced);
+    BOOST_CHECK(open);
+
+    // the slow reader is dropped, with the output not sent yet
+    const auto received = BroadcastToSlowReader(detail::BroadcastOverflow::disconnect, dropped.size(), open);
+    BOOST_CHECK(!open);
+    BOOST_CHECK(received.size() < 2 + backlog.size());
+    BOOST_CHECK(received.compare(0, 2, "0\n") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(SessionPlacement)
+{
+    // the second session is closed before the fourth one is accepted
+    const std::vector<std::size_t> roundRobin{0, 1, 0, 1, 0};
+    const auto rr = Place(detail::SessionPlacement::roundRobin);
+    BOOST_CHECK_EQUAL_COLLECTIONS(rr.begin(), rr.end(), roundRobin.begin(), roundRobin.end());
+    // the fifth goes where the second was closed (the choice for a session
+    // is made when the previous one is accepted)
+    const std::vector<std::size_t> leastLoaded{0, 1, 0, 1, 1};
+    const auto ll = Place(detail::SessionPlacement::leastLoaded);
+    BOOST_CHECK_EQUAL_COLLECTIONS(ll.begin(), ll.end(), leastLoaded.begin(), leastLoaded.end());
+}
+
+BOOST_AUTO_TEST_CASE(SessionLimit)
+{
+    const std::string path = "cli_test_limit.sock";
+    BoostAsioScheduler scheduler;
+    Placements placements;
+    PlacingServer server(scheduler.AsioContext(), path, placements);
+    server.MaxSessions(2);
+    std::thread runner([&scheduler](){ scheduler.Run(); });
+
+    boost::asio::io_context clientContext;
+    using Client = boost::asio::local::stream_protocol::socket;
+    auto connect = [&]()
+    {
+        auto client = std::make_unique<Client>(clientContext);
+        client->connect(boost::asio::local::stream_protocol::endpoint(path));
+        return client;
+    };
+    auto first = connect();
+    auto second = connect();
+    BOOST_CHECK(WaitFor([&](){ return placements.Started() == 2; }));
+
+    // the connection over the limit is closed without a session
+    auto third = connect();
+    std::string received;
+    BOOST_CHECK(!ReadUntil(*third, received, [](const std::string&){ return false; }));
+    BOOST_CHECK(received.empty());
+    BOOST_CHECK_EQUAL(placements.Started(), 2u);
+    BOOST_CHECK(!Closed(*first));
+    BOOST_CHECK(!Closed(*second));
+
+    // a session closed makes room for the next connection
+    first->close();
+    BOOST_CHECK(WaitFor([&](){ return placements.alive == 1; }));
+    auto fourth = connect();
+    BOOST_CHECK(WaitFor([&](){ return placements.Started() == 3; }));
+    BOOST_CHECK(!Closed(*fourth));
+
+    scheduler.Stop();
+    runner.join();
+}
+
+BOOST_AUTO_TEST_CASE(IdleSession)
+{
+    const std::string path = "cli_test_idle.sock";
+    BoostAsioScheduler scheduler;
+    Placements placements;
+    PlacingServer server(scheduler.AsioContext(), path, placements);
+    server.IdleTimeout(std::chrono::milliseconds(200));
+    std::thread runner([&scheduler](){ scheduler.Run(); });
+
+    boost::asio::io_context clientContext;
+    boost::asio::local::stream_protocol::socket idle(clientContext);
+    idle.connect(boost::asio::local::stream_protocol::endpoint(path));
+    boost::asio::local::stream_protocol::socket active(clientContext);
+    active.connect(boost::asio::local::stream_protocol::endpoint(path));
+    BOOST_CHECK(WaitFor([&](){ return placements.Started() == 2; }));
+
+    // only the client that sends nothing is closed, once the timeout expires
+    auto keepAlive = [&active]()
+    {
+        boost::asio::write(active, boost::asio::buffer("x", 1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    };
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100))
+        keepAlive();
+    BOOST_CHECK(!Closed(idle));
+    BOOST_CHECK(WaitFor([&](){ keepAlive(); return Closed(idle); }));
+    BOOST_CHECK(WaitFor([&](){ return placements.alive == 1; }));
+    BOOST_CHECK(!Closed(active));
+
+    scheduler.Stop();
+    runner.join();
+}
+
+BOOST_AUTO_TEST_CASE(LocalSocketPath)
+{
+    const std::string path = "cli_test_path.sock";
+    auto exists = [&path](){ return detail::IdentifyFile(path).exists; };
+    boost::asio::io_context ioc;
+    Placements placements;
+
+    // a file that isn't a socket is not removed
+    std::ofstream(path) << "data";
+    BOOST_CHECK_THROW(PlacingServer(ioc, path, placements), std::system_error);
+    BOOST_CHECK(exists());
+    std::remove(path.c_str());
+
+    // a socket left by a previous run is replaced
+    {
+        boost::asio::local::stream_protocol::acceptor stale(ioc, boost::asio::local::stream_protocol::endpoint(path));
+    }
+    BOOST_CHECK(exists());
+    {
+        PlacingServer server(ioc, path, placements);
+
+        // the socket of a server listening is kept
+        BOOST_CHECK_THROW(PlacingServer(ioc, path, placements), std::system_error);
+        boost::asio::local::stream_protocol::socket client(ioc);
+        client.connect(boost::asio::local::stream_protocol::endpoint(path));
+    }
+    // and removed by its server
+    BOOST_CHECK(!exists());
+
+    // unless it has been replaced in the meantime
+    {
+        PlacingServer server(ioc, path, placements);
+        std::remove(path.c_str());
+        std::ofstream(path) << "data";
+    }
+    BOOST_CHECK(exists());
+    std::remove(path.c_str());
+}
+#endif // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -50,6 +50,31 @@ BOOST_AUTO_TEST_CASE(Exceptions)
     ExceptionTest<BoostAsioScheduler>();
 }
 
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+    MoveOnlyTest<BoostAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Priorities)
+{
+    PriorityTest<BoostAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Timers)
+{
+    TimerTest<BoostAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPool)
+{
+    ThreadPoolTest<BoostAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Group)
+{
+    SchedulerGroupTest<BoostAsioSchedulerGroup>();
+}
+
 BOOST_AUTO_TEST_CASE(BoostAsioNonOwner)
 {
     detail::BoostAsioLib::ContextType ioc;
@@ -30,6 +30,16 @@
 #include <boost/test/unit_test.hpp>
 #include "cli/cli.h"
 #include "cli/clifilesession.h"
+#include "cli/loopscheduler.h"
+#include "cli/detail/commandprocessor.h"
+#include "cli/detail/telnetscreen.h"
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <type_traits>
 
 using namespace std;
 using namespace cli;
@@ -87,10 +97,83 @@ void UserInput(Cli& cli, stringstream& oss, const string& input)
     session.Start();
 }
 
+void StaticHello(ostream& out) { out << "hello\n"; }
+void StaticSet(ostream& out, int x) { out << "int " << x << "\n"; }
+void StaticSetString(ostream& out, const string& x) { out << "string " << x << "\n"; }
+void StaticCount(ostream& out, const vector<string>& pars) { out << pars.size() << "\n"; }
+void StaticSquare(ostream& out, int x) { out << x*x << "\n"; }
+
+constexpr StaticCommand staticSubCmds[] = {
+    StaticCmd<decltype(&StaticSet), &StaticSet>("set", "set an int", "value")
+};
+constexpr StaticMenu staticSub = MakeStaticMenu("ssub", staticSubCmds, "static submenu", "sprompt");
+constexpr StaticCommand staticCmds[] = {
+    StaticCmd<decltype(&StaticHello), &StaticHello>("hello", "says hello"),
+    StaticCmd<decltype(&StaticSet), &StaticSet>("set", "set an int"),
+    StaticCmd<decltype(&StaticSetString), &StaticSetString>("set", "set a string"),
+    StaticCmd<decltype(&StaticCount), &StaticCount>("count", "count the parameters"),
+    StaticSubmenu(staticSub)
+};
+constexpr StaticMenu staticRoot = MakeStaticMenu("cli", staticCmds);
+
+// a keyboard typing strings
+class TestKeyboard : public cli::detail::InputDevice
+{
+public:
+    using cli::detail::InputDevice::InputDevice;
+    void Type(const string& keys)
+    {
+        for (char c: keys)
+        {
+            if (c == '\n')
+                Enqueue(make_pair(cli::detail::KeyType::ret, ' '));
+            else if (c == '\x03') // ctrl+C
+                Enqueue(make_pair(cli::detail::KeyType::interrupt, ' '));
+            else
+                Enqueue(make_pair(cli::detail::KeyType::ascii, c));
+        }
+        Flush();
+    }
+};
+
+// an interactive session
+class TestInteractiveSession : public CliSession
+{
+public:
+    TestInteractiveSession(Cli& _cli, Scheduler& scheduler, ostream& _out) :
+        CliSession(_cli, _out, 10),
+        kb(scheduler),
+        processor(*this, kb)
+    {
+        Prompt();
+    }
+    void Type(const string& keys) { kb.Type(keys); }
+private:
+    TestKeyboard kb;
+    cli::detail::CommandProcessor<cli::detail::TelnetScreen> processor;
+};
+
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(CliSuite)
 
+static_assert(std::is_move_constructible<Cli>::value, "Cli must be movable");
+static_assert(std::is_move_assignable<Cli>::value, "Cli must be movable");
+
+BOOST_AUTO_TEST_CASE(Move)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("int_cmd", [](ostream& out, int par){ out << par << "\n"; }, "int_cmd help", {"int_par"} );
+    Cli original(move(rootMenu));
+    original.CollectMetrics(true);
+    Cli cli(move(original));
+
+    stringstream oss;
+    UserInput(cli, oss, "int_cmd 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "42");
+    BOOST_CHECK_EQUAL(cli.Metrics().size(), 1u);
+}
+
 BOOST_AUTO_TEST_CASE(Basics)
 {
     auto rootMenu = make_unique<Menu>("cli");
@@ -370,6 +453,1246 @@ BOOST_AUTO_TEST_CASE(Submenus)
     BOOST_CHECK_EQUAL(ExtractContent(oss), "foo");
 }
 
+BOOST_AUTO_TEST_CASE(ParameterLimits)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("int_cmd", [](ostream& out, int par){ out << par << "\n"; } );
+    rootMenu->Insert("signed_char_cmd", [](ostream& out, signed char par){ out << static_cast<int>(par) << "\n"; } );
+    rootMenu->Insert("unsigned_char_cmd", [](ostream& out, unsigned char par){ out << static_cast<unsigned int>(par) << "\n"; } );
+    rootMenu->Insert("bool_cmd", [](ostream& out, bool par){ out << boolalpha << par << "\n"; } );
+    rootMenu->Insert("double_cmd", [](ostream& out, double par){ out << par << "\n"; } );
+
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    const auto wrong = [&](const string& input)
+    {
+        UserInput(cli, oss, input);
+        return ExtractContent(oss).find("wrong command:") != string::npos;
+    };
+
+    UserInput(cli, oss, "int_cmd " + to_string(numeric_limits<int>::max()));
+    BOOST_CHECK_EQUAL(ExtractContent(oss), to_string(numeric_limits<int>::max()));
+    UserInput(cli, oss, "int_cmd " + to_string(numeric_limits<int>::min()));
+    BOOST_CHECK_EQUAL(ExtractContent(oss), to_string(numeric_limits<int>::min()));
+    UserInput(cli, oss, "int_cmd +42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "42");
+    BOOST_CHECK(wrong("int_cmd " + to_string(static_cast<long long>(numeric_limits<int>::max()) + 1)));
+    BOOST_CHECK(wrong("int_cmd " + to_string(static_cast<long long>(numeric_limits<int>::min()) - 1)));
+    BOOST_CHECK(wrong("int_cmd -"));
+    BOOST_CHECK(wrong("int_cmd +-1"));
+    BOOST_CHECK(wrong("int_cmd 4x"));
+
+    UserInput(cli, oss, "signed_char_cmd -128");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "-128");
+    BOOST_CHECK(wrong("signed_char_cmd -129"));
+    BOOST_CHECK(wrong("signed_char_cmd 128"));
+    UserInput(cli, oss, "unsigned_char_cmd 255");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "255");
+    BOOST_CHECK(wrong("unsigned_char_cmd 256"));
+
+    UserInput(cli, oss, "bool_cmd true");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "true");
+    UserInput(cli, oss, "bool_cmd 0");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "false");
+    BOOST_CHECK(wrong("bool_cmd 2"));
+
+    UserInput(cli, oss, "double_cmd -1.5e3");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "-1500");
+    BOOST_CHECK(wrong("double_cmd 1e99999"));
+    BOOST_CHECK(wrong("double_cmd 1.5x"));
+}
+
+BOOST_AUTO_TEST_CASE(Overloads)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("cmd", [](ostream& out, int par){ out << "int " << par << "\n"; } );
+    auto stringCmd = rootMenu->Insert("cmd", [](ostream& out, const string& par){ out << "string " << par << "\n"; } );
+    rootMenu->Insert("cmd", [](ostream& out, int par1, int par2){ out << "int int " << par1 << par2 << "\n"; } );
+    auto otherCmd = rootMenu->Insert("other", [](ostream& out){ out << "other\n"; } );
+
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    // overloads are tried in insertion order
+    UserInput(cli, oss, "cmd 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "int 42");
+    UserInput(cli, oss, "cmd foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "string foo");
+    UserInput(cli, oss, "cmd 4 2");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "int int 42");
+    // no overload is called when any parameter doesn't match
+    UserInput(cli, oss, "cmd 4 x");
+    BOOST_CHECK(ExtractContent(oss).find("wrong command:") != string::npos);
+
+    stringCmd.Disable();
+    UserInput(cli, oss, "cmd foo");
+    BOOST_CHECK(ExtractContent(oss).find("wrong command:") != string::npos);
+    stringCmd.Enable();
+    UserInput(cli, oss, "cmd foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "string foo");
+
+    stringCmd.Remove();
+    UserInput(cli, oss, "cmd foo");
+    BOOST_CHECK(ExtractContent(oss).find("wrong command:") != string::npos);
+    UserInput(cli, oss, "cmd 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "int 42");
+
+    otherCmd.Remove();
+    UserInput(cli, oss, "other");
+    BOOST_CHECK(ExtractContent(oss).find("wrong command:") != string::npos);
+    // removing twice has no effect
+    otherCmd.Remove();
+}
+
+BOOST_AUTO_TEST_CASE(StaticMenus)
+{
+    auto rootMenu = make_unique<Menu>(staticRoot);
+    // mixed with dynamic commands, that are tried first
+    rootMenu->Insert("dynamic", [](ostream& out){ out << "dynamic\n"; } );
+    rootMenu->Insert("hello", [](ostream& out, int x){ out << "dynamic " << x << "\n"; } );
+
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    UserInput(cli, oss, "hello");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "hello");
+    UserInput(cli, oss, "hello 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "dynamic 42");
+    UserInput(cli, oss, "dynamic");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "dynamic");
+
+    // overloads are tried in table order
+    UserInput(cli, oss, "set 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "int 42");
+    UserInput(cli, oss, "set foo");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "string foo");
+    UserInput(cli, oss, "set 4 2");
+    BOOST_CHECK(ExtractContent(oss).find("wrong command:") != string::npos);
+
+    UserInput(cli, oss, "count a b c");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "3");
+
+    UserInput(cli, oss, "ssub set 42");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "int 42");
+    UserInput(cli, oss, "ssub");
+    BOOST_CHECK_EQUAL(oss.str(), "cli> sprompt> ");
+    UserInput(cli, oss, "ssub\n..");
+    BOOST_CHECK_EQUAL(oss.str(), "cli> sprompt> cli> ");
+
+    UserInput(cli, oss, "help");
+    const auto help = oss.str();
+    BOOST_CHECK(help.find(" - hello\n\tsays hello\n") != string::npos);
+    BOOST_CHECK(help.find(" - set <int>\n\tset an int\n") != string::npos);
+    BOOST_CHECK(help.find(" - count <list of strings>\n") != string::npos);
+    BOOST_CHECK(help.find(" - ssub\n\tstatic submenu\n") != string::npos);
+    BOOST_CHECK(help.find(" - dynamic") < help.find(" - hello\n"));
+    UserInput(cli, oss, "ssub\nhelp");
+    BOOST_CHECK(oss.str().find(" - set <value>\n\tset an int\n") != string::npos);
+
+    // the help of the commands starting with a prefix, in table order
+    UserInput(cli, oss, "help s");
+    const auto prefixed = oss.str();
+    BOOST_CHECK(prefixed.find(" - set <int>\n") < prefixed.find(" - set <string>\n"));
+    BOOST_CHECK(prefixed.find(" - set <string>\n") < prefixed.find(" - ssub\n"));
+    BOOST_CHECK(prefixed.find(" - hello") == string::npos);
+
+    // the completions, of the names and of the static submenus
+    stringstream out;
+    CliSession session(cli, out);
+    auto completions = session.GetCompletions("s");
+    for (const string c: {"set", "ssub"})
+        BOOST_CHECK(find(completions.begin(), completions.end(), c) != completions.end());
+    BOOST_CHECK(find(completions.begin(), completions.end(), "hello") == completions.end());
+    completions = session.GetCompletions("ssub s");
+    const vector<string> expected{"ssub set"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+    BOOST_CHECK(session.GetCompletions("set s").empty());
+}
+
+BOOST_AUTO_TEST_CASE(Batch)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    std::size_t count = 0;
+    rootMenu->Insert("inc", [&](ostream&){ ++count; } );
+    rootMenu->Insert("echo", [](ostream& out, const string& s){ out << s << "\n"; } );
+    rootMenu->Insert("throw", [](ostream&){ throw std::logic_error("myerror"); } );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("echo", [](ostream& out, int x){ out << "sub " << x << "\n"; } );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+
+    {
+        stringstream iss("echo foo\nwrong\n\nthrow\nsub\necho 42\necho 7");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartBatch();
+        // no prompts, errors with line numbers, last line without newline
+        BOOST_CHECK_EQUAL(oss.str(), "foo\nline 2: wrong command: wrong\nline 4: myerror\nsub 42\nsub 7\n");
+        BOOST_CHECK_EQUAL(result.lines, 7u);
+        BOOST_CHECK_EQUAL(result.errors, 2u);
+        BOOST_CHECK_EQUAL(result.firstError, 2u);
+    }
+
+    {
+        stringstream iss("echo foo\nwrong\necho bar\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartBatch(true);
+        BOOST_CHECK_EQUAL(oss.str(), "foo\nline 2: wrong command: wrong\n");
+        BOOST_CHECK_EQUAL(result.lines, 2u);
+        BOOST_CHECK_EQUAL(result.errors, 1u);
+    }
+
+    {
+        stringstream iss("echo foo\nexit\necho bar\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartBatch();
+        BOOST_CHECK_EQUAL(oss.str(), "foo\n");
+        BOOST_CHECK_EQUAL(result.lines, 2u);
+        BOOST_CHECK_EQUAL(result.errors, 0u);
+    }
+
+    {
+        // lines across the input blocks
+        string script;
+        for (int i = 0; i < 50000; ++i)
+            script += "inc\n";
+        script += "echo " + string(100000, 'x') + "\n";
+        stringstream iss(script);
+        stringstream oss;
+        count = 0;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartBatch();
+        BOOST_CHECK_EQUAL(count, 50000u);
+        BOOST_CHECK_EQUAL(result.lines, 50001u);
+        BOOST_CHECK_EQUAL(oss.str(), string(100000, 'x') + "\n");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ParallelBatch)
+{
+    constexpr static StaticCommand parallelCmds[] = {
+        Parallel(StaticCmd<decltype(&StaticSquare), &StaticSquare>("square"))
+    };
+    constexpr static StaticMenu parallelMenu = MakeStaticMenu("cli", parallelCmds);
+
+    auto rootMenu = make_unique<Menu>(parallelMenu);
+    std::atomic<int> value{0};
+    std::mutex mtx;
+    std::set<std::thread::id> threads;
+    rootMenu->Insert("set", [&](ostream&, int x){ value = x; } );
+    rootMenu->Insert("show", [&](ostream& out, int x)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            threads.insert(std::this_thread::get_id());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(x));
+        out << "show " << value << "\n";
+    } ).Parallel();
+    rootMenu->Insert("fail", [](ostream&){ throw std::logic_error("myerror"); } ).Parallel();
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("show", [](ostream& out, int){ out << "sub show\n"; } ).Parallel();
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+
+    {
+        stringstream iss;
+        CliFileSession session(cli, iss, cout);
+        BOOST_CHECK(session.IsParallel("show 1"));
+        BOOST_CHECK(session.IsParallel("square 1"));
+        BOOST_CHECK(session.IsParallel("sub show 1"));
+        BOOST_CHECK(session.IsParallel(""));
+        BOOST_CHECK(!session.IsParallel("set 1"));
+        BOOST_CHECK(!session.IsParallel("sub"));
+        BOOST_CHECK(!session.IsParallel("help"));
+        BOOST_CHECK(!session.IsParallel("exit"));
+    }
+
+    {
+        // the parallel lines are written in input order,
+        // and the sequential ones wait for the previous parallel lines
+        string script = "set 1\n";
+        string expected;
+        for (int i = 0; i < 20; ++i)
+        {
+            script += "show " + to_string(20-i) + "\n";
+            expected += "show 1\n";
+        }
+        script += "square 3\nset 2\nshow 0\nwrong\nsub\nshow 0\n..\nshow 0\n";
+        expected += "9\nshow 2\nline 25: wrong command: wrong\nsub show\nshow 2\n";
+        stringstream iss(script);
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartParallel(4);
+        BOOST_CHECK_EQUAL(oss.str(), expected);
+        BOOST_CHECK_EQUAL(result.lines, 29u);
+        BOOST_CHECK_EQUAL(result.errors, 1u);
+        BOOST_CHECK_EQUAL(result.firstError, 25u);
+        BOOST_CHECK_GT(threads.size(), 1u);
+    }
+
+    {
+        stringstream iss("show 0\nfail\nshow 0\nshow 0\nset 3\n");
+        stringstream oss;
+        value = 0;
+        CliFileSession session(cli, iss, oss);
+        const auto result = session.StartParallel(2, true);
+        BOOST_CHECK_EQUAL(oss.str(), "show 0\nline 2: myerror\n");
+        BOOST_CHECK_EQUAL(result.lines, 2u);
+        BOOST_CHECK_EQUAL(result.firstError, 2u);
+        BOOST_CHECK_EQUAL(value, 0); // set not executed
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AsyncCommands)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Completion pending;
+    rootMenu->Insert("slow", [&](ostream& out)
+    {
+        out << "started\n";
+        pending = Completion();
+        return pending;
+    } );
+    rootMenu->Insert("thread", [](ostream&, int ms)
+    {
+        Completion done;
+        thread([done, ms]()
+        {
+            this_thread::sleep_for(chrono::milliseconds(ms));
+            done.Complete([ms](ostream& out){ out << "after " << ms << "\n"; });
+        }).detach();
+        return done;
+    } );
+    rootMenu->Insert("throw", [](ostream&)
+    {
+        Completion done;
+        done.Complete([](ostream&){ throw std::logic_error("myerror"); });
+        return done;
+    } );
+    rootMenu->Insert("fast", [](ostream& out){ out << "fast!\n"; } );
+
+    Cli cli(move(rootMenu));
+
+    {
+        // the file sessions wait for the completion
+        stringstream iss("thread 20\nfast\nthrow\nfast\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        session.StartBatch();
+        BOOST_CHECK_EQUAL(oss.str(), "after 20\nfast!\nline 3: myerror\nfast!\n");
+    }
+
+    {
+        // an interactive session keeps reading the keyboard
+        LoopScheduler scheduler;
+        stringstream oss;
+        TestInteractiveSession session(cli, scheduler, oss);
+        auto poll = [&](){ while (scheduler.PollOne()) {} };
+
+        session.Type("slow\n");
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "cli> slow\r\nstarted\n");
+
+        // the line is echoed, the return is held
+        session.Type("fast\n");
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "cli> slow\r\nstarted\nfast");
+
+        oss.str("");
+        pending.Complete([](ostream& out){ out << "slow done\n"; });
+        poll();
+        const auto out = oss.str();
+        const auto done = out.find("slow done\ncli> fast\r\nfast!\ncli> ");
+        BOOST_CHECK(done != string::npos);
+        // the line typed has been erased before the output
+        BOOST_CHECK(out.substr(0, done).find("\033[K") != string::npos);
+
+        // completed before returning
+        oss.str("");
+        session.Type("throw\n");
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "throw\r\nmyerror\ncli> ");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Cancellation)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Completion pending;
+    rootMenu->Insert("wait", [&](ostream& out)
+    {
+        out << "waiting\n";
+        pending = Completion();
+        return pending;
+    } );
+    rootMenu->Insert("loop", [](ostream& out)
+    {
+        const auto token = CliSession::Cancellation();
+        while (!token.Cancelled())
+            this_thread::sleep_for(chrono::milliseconds(1));
+        out << "stopped\n";
+    } ).Timeout(chrono::milliseconds(20));
+    rootMenu->Insert("cancelled", [](ostream& out){ out << CliSession::Cancellation().Cancelled() << "\n"; } );
+
+    Cli cli(move(rootMenu));
+
+    BOOST_CHECK(!CliSession::Cancellation().Cancelled());
+
+    {
+        // the timeout of the command
+        stringstream iss("loop\ncancelled\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        session.StartBatch();
+        BOOST_CHECK_EQUAL(oss.str(), "stopped\n0\n");
+    }
+
+    {
+        // the timeout of the cli completes an asynchronous command, without epilogue
+        cli.CommandTimeout(chrono::milliseconds(20));
+        stringstream iss("wait\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        session.StartBatch();
+        BOOST_CHECK(session.TimedOut());
+        pending.Complete([](ostream& out){ out << "late\n"; });
+        BOOST_CHECK_EQUAL(oss.str(), "waiting\n");
+        cli.CommandTimeout(chrono::milliseconds(0));
+    }
+
+    {
+        LoopScheduler scheduler;
+        stringstream oss;
+        TestInteractiveSession session(cli, scheduler, oss);
+        auto poll = [&](){ while (scheduler.PollOne()) {} };
+
+        // ctrl+C drops the line
+        oss.str("");
+        session.Type("ab\x03");
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "ab^C\r\ncli> ");
+
+        // and cancels the asynchronous command, with the keys held
+        oss.str("");
+        session.Type("wait\nx\n\x03");
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "wait\r\nwaiting\nx^C\r\ncli> x");
+        BOOST_CHECK(session.Cancelled());
+        BOOST_CHECK(!session.TimedOut());
+        oss.str("");
+        pending.Complete([](ostream& out){ out << "late\n"; });
+        poll();
+        BOOST_CHECK_EQUAL(oss.str(), "");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RenewedToken)
+{
+    CancellationToken token;
+    token.CancelAfter(chrono::milliseconds(10));
+    // without copies the state is reused, without the deadline
+    token.Renew();
+    this_thread::sleep_for(chrono::milliseconds(50));
+    BOOST_CHECK(!token.Cancelled());
+    token.Stop();
+    BOOST_CHECK(token.Cancelled());
+    BOOST_CHECK(token.Stopped());
+
+    // the copies keep the old state
+    const auto copy = token;
+    token.Renew();
+    BOOST_CHECK(!token.Cancelled());
+    BOOST_CHECK(!token.Stopped());
+    BOOST_CHECK(copy.Cancelled());
+    token.CancelAfter(chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(50));
+    BOOST_CHECK(token.TimedOut());
+    BOOST_CHECK(!copy.TimedOut());
+}
+
+BOOST_AUTO_TEST_CASE(Metrics)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream& out){ out << "hello\n"; } );
+    rootMenu->Insert("fail", [](ostream&){ throw std::logic_error("myerror"); } );
+    rootMenu->Insert("wait", [](ostream&, int ms){ this_thread::sleep_for(chrono::milliseconds(ms)); } );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("hello", [](ostream& out){ out << "sub hello\n"; } );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+    // disabled by default
+    {
+        stringstream oss;
+        UserInput(cli, oss, "hello");
+    }
+    BOOST_CHECK(cli.Metrics().empty());
+    cli.CollectMetrics(true);
+
+    {
+        stringstream iss("hello\nhello\nfail\nwrong 1\nwait 5\nwait x\nsub hello\n\n");
+        stringstream oss;
+        CliFileSession session(cli, iss, oss);
+        session.StartBatch();
+    }
+
+    const auto stats = cli.Metrics();
+    // by the path of the command
+    BOOST_REQUIRE_EQUAL(stats.size(), 5u);
+    BOOST_CHECK_EQUAL(stats[0].name, "(wrong command)");
+    BOOST_CHECK_EQUAL(stats[0].Count(), 2u); // with the wrong parameter
+    BOOST_CHECK_EQUAL(stats[0].errors, 2u);
+    BOOST_CHECK_EQUAL(stats[1].name, "cli/fail");
+    BOOST_CHECK_EQUAL(stats[1].errors, 1u);
+    BOOST_CHECK_EQUAL(stats[2].name, "cli/hello");
+    BOOST_CHECK_EQUAL(stats[2].Count(), 2u);
+    BOOST_CHECK_EQUAL(stats[2].errors, 0u);
+    BOOST_CHECK_EQUAL(stats[2].outputBytes, 12u);
+    BOOST_CHECK_EQUAL(stats[3].name, "cli/sub/hello");
+    BOOST_CHECK_EQUAL(stats[3].Count(), 1u);
+    BOOST_CHECK_EQUAL(stats[4].name, "cli/wait");
+    BOOST_CHECK_EQUAL(stats[4].Count(), 1u);
+    BOOST_CHECK(stats[4].handler.Max() >= chrono::milliseconds(5));
+    BOOST_CHECK(stats[4].dispatch.Max() < chrono::milliseconds(5));
+
+    // the stats command
+    stringstream oss;
+    UserInput(cli, oss, "stats");
+    const auto out = oss.str();
+    BOOST_CHECK(out.find("command") != string::npos);
+    BOOST_CHECK(out.find("p99") != string::npos);
+    BOOST_CHECK(out.find("cli/sub/hello") != string::npos);
+    BOOST_CHECK(cli.Metrics().back().name == "stats"); // the built-ins have no menu
+
+    cli.ResetMetrics();
+    cli.CollectMetrics(false);
+    UserInput(cli, oss, "hello");
+    BOOST_CHECK(cli.Metrics().empty());
+}
+
+BOOST_AUTO_TEST_CASE(CommandTrace)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream& out){ out << "hello\n"; } );
+    rootMenu->Insert("fail", [](ostream&){ throw std::logic_error("myerror"); } );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("world", [](ostream& out){ out << "world\n"; } );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+    stringstream oss;
+    UserInput(cli, oss, "hello");
+    BOOST_CHECK(cli.RecentCommands().empty()); // disabled by default
+    UserInput(cli, oss, "debug trace");
+    BOOST_CHECK(oss.str().find("wrong command") != string::npos);
+
+    cli.TraceCommands(16);
+    cli.DebugCommands(true);
+    uint64_t id = 0;
+    {
+        stringstream iss("hello\nfail\nwrong\nsub\nworld | count\n");
+        stringstream out;
+        CliFileSession session(cli, iss, out);
+        id = session.Id();
+        session.StartBatch();
+    }
+    const auto records = cli.RecentCommands();
+    BOOST_REQUIRE_EQUAL(records.size(), 5u);
+    for (const auto& r: records)
+        BOOST_CHECK_EQUAL(r.session, id);
+    BOOST_CHECK_EQUAL(records[0].command, "hello");
+    BOOST_CHECK_EQUAL(records[0].menu, "cli");
+    BOOST_CHECK(records[0].outcome == CommandOutcome::ok);
+    BOOST_CHECK_EQUAL(records[0].outputBytes, 6u);
+    BOOST_CHECK(records[1].outcome == CommandOutcome::exception);
+    BOOST_CHECK(records[2].outcome == CommandOutcome::wrong);
+    BOOST_CHECK_EQUAL(records[3].menu, "cli"); // where it's been typed
+    BOOST_CHECK_EQUAL(records[4].menu, "cli/sub");
+    BOOST_CHECK_EQUAL(records[4].command, "world | count");
+
+    UserInput(cli, oss, "help");
+    BOOST_CHECK(oss.str().find(" - debug <trace> <[format]>") != string::npos);
+    UserInput(cli, oss, "debug trace");
+    BOOST_CHECK(oss.str().find("outcome") != string::npos);
+    BOOST_CHECK(oss.str().find("exception  fail") != string::npos);
+    UserInput(cli, oss, "debug trace chrome");
+    BOOST_CHECK(oss.str().find("\"traceEvents\"") != string::npos);
+    UserInput(cli, oss, "debug trace otel");
+    BOOST_CHECK(oss.str().find("\"resourceSpans\"") != string::npos);
+    UserInput(cli, oss, "debug trace xml");
+    BOOST_CHECK(oss.str().find("wrong command") != string::npos);
+
+    cli.TraceCommands(0);
+    BOOST_CHECK(cli.RecentCommands().empty());
+}
+
+BOOST_AUTO_TEST_CASE(GlobalCommands)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream& out){ out << "hello\n"; } );
+    Cli cli(move(rootMenu));
+
+    // the built-in commands are shared by the sessions, but act on their own session
+    stringstream oss1;
+    stringstream oss2;
+    CliSession s1(cli, oss1);
+    CliSession s2(cli, oss2);
+    BOOST_CHECK(s1.Feed("help"));
+    const auto help = oss1.str();
+    BOOST_CHECK(help.find(" - help\n\tThis help message\n") != string::npos);
+    BOOST_CHECK(help.find(" - exit\n\tQuit the session\n") != string::npos);
+    BOOST_CHECK(help.find(" - stats") != string::npos);
+    BOOST_CHECK(help.find(" - hello") != string::npos);
+    BOOST_CHECK(oss2.str().empty());
+
+    BOOST_CHECK(!s2.Feed("exit now"));
+    bool exited = false;
+    s2.ExitAction([&](ostream&){ exited = true; });
+    BOOST_CHECK(s2.Feed("exit"));
+    BOOST_CHECK(exited);
+
+    const auto completions = s1.GetCompletions("e");
+    BOOST_CHECK(find(completions.begin(), completions.end(), "exit") != completions.end());
+}
+
+BOOST_AUTO_TEST_CASE(BuiltinsAfterUserCommands)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("stats", [](ostream& out){ out << "app stats\n"; } );
+    rootMenu->Insert("help", [](ostream& out, const string& topic){ out << "app help " << topic << "\n"; } );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("watch", [](ostream& out, int a, int b){ out << "app watch " << a + b << "\n"; } );
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+    stringstream oss;
+    CliSession session(cli, oss);
+
+    // the commands of the application with the name of a built-in take precedence
+    auto feed = [&](const string& line){ oss.str(""); session.Feed(line); return oss.str(); };
+    BOOST_CHECK_EQUAL(feed("stats"), "app stats\n");
+    BOOST_CHECK_EQUAL(feed("help me"), "app help me\n");
+    BOOST_CHECK_EQUAL(feed("sub watch 1 2"), "app watch 3\n");
+    BOOST_CHECK_EQUAL(feed("sub"), "");
+    BOOST_CHECK_EQUAL(feed("watch 1 2"), "app watch 3\n");
+
+    // the built-ins are still there for the other command lines
+    BOOST_CHECK(feed("pager on").empty());
+    BOOST_CHECK(feed("subscribe nothing").find("unknown topic: nothing") != string::npos);
+    // and help is still the one of the session
+    BOOST_CHECK(feed("help").find(" - exit\n") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalCompletions)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("show", [](ostream&){});
+    auto shout = rootMenu->Insert("shout", [](ostream&){});
+    rootMenu->Insert("set", [](ostream&){});
+    auto subMenu = make_unique<Menu>("sh");
+    auto foo = subMenu->Insert("foo", [](ostream&){});
+    subMenu->Insert("fob", [](ostream&){});
+    subMenu->Insert(make_unique<Menu>("fo"));
+    rootMenu->Insert(move(subMenu));
+    Menu* root = rootMenu.get();
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    // the completions of a session that has never seen a line
+    auto fresh = [&](const string& line)
+    {
+        stringstream o;
+        CliSession s(cli, o);
+        s.Current(session.Current());
+        return s.GetCompletions(line);
+    };
+    auto check = [&](const string& line)
+    {
+        const auto completions = session.GetCompletions(line);
+        const auto expected = fresh(line);
+        BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+        return completions;
+    };
+
+    // typing, up to the names of the menus (that complete their commands)
+    for (const string line: {"", "s", "sh", "sh ", "sh f", "sh fo", "sh foo", "sh f", "sho", "show", "shox", "x"})
+        check(line);
+    auto completions = check("sh fo");
+    vector<string> expected({"sh fo sh", "sh fob", "sh foo"});
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+    // a menu completes only the lines whose first token is its name
+    BOOST_CHECK(session.GetCompletions("shx").empty());
+
+    // the commands changed
+    check("sho");
+    root->Insert("shot", [](ostream&){});
+    completions = check("shou");
+    expected = {"shout"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+    check("sho");
+    shout.Disable();
+    completions = check("sho");
+    expected = {"shot", "show"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+    // in a submenu
+    check("sh f");
+    foo.Disable();
+    completions = check("sh f");
+    BOOST_CHECK(find(completions.begin(), completions.end(), "sh foo") == completions.end());
+    foo.Enable();
+    check("sh f");
+
+    // another menu, with the parent shortcut
+    BOOST_CHECK(session.Feed("sh"));
+    for (const string line: {"", ".", "..", ".. s", ".. sh", "f", "fo", "foo"})
+        check(line);
+}
+
+BOOST_AUTO_TEST_CASE(ArgumentCompletions)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    auto ifconfig = rootMenu->Insert("ifconfig", [](ostream&, const string&, int){}, "", {"name", "mtu"});
+    ifconfig.CompleteArgument(0, ArgumentCompleter::Immediate([](const string&){ return vector<string>{"eth0", "eth1", "lo"}; }));
+    vector<ArgumentCompleter::Reply> replies;
+    auto subMenu = make_unique<Menu>("dev");
+    auto reboot = subMenu->Insert("reboot", [](ostream&, const string&){});
+    reboot.CompleteArgument(0, ArgumentCompleter([&](const string&, ArgumentCompleter::Reply reply)
+    {
+        reply.Add({"d1"});
+        replies.push_back(reply);
+    }, chrono::seconds(30), chrono::milliseconds(1)));
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    auto check = [&](const string& line, const vector<string>& expected)
+    {
+        const auto completions = session.GetCompletions(line);
+        BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+    };
+
+    check("ifc", {"ifconfig"});
+    check("ifconfig ", {"ifconfig eth0", "ifconfig eth1", "ifconfig lo"});
+    check("ifconfig e", {"ifconfig eth0", "ifconfig eth1"});
+    check("ifconfig eth1", {"ifconfig eth1"});
+    check("ifconfig x", {});
+    check("ifconfig eth0 ", {}); // the mtu has no completer
+    check("ifconfigx", {});
+
+    // in a submenu, with the partial answer when the provider misses the deadline
+    check("dev reboot ", {"dev reboot d1"});
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+    replies[0]({"d2"});
+    // the answer is used by the next completion of the same line
+    check("dev reboot ", {"dev reboot d1", "dev reboot d2"});
+    BOOST_CHECK(session.Feed("dev"));
+    check("reboot d", {"reboot d1", "reboot d2"});
+    BOOST_CHECK_EQUAL(replies.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Suggestions)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("show", [](ostream&){});
+    auto shout = rootMenu->Insert("shout", [](ostream&){});
+    rootMenu->Insert("shot", [](ostream&){});
+    auto subMenu = make_unique<Menu>("net");
+    subMenu->Insert("ifconfig", [](ostream&, int){});
+    subMenu->Insert("route", [](ostream&){});
+    rootMenu->Insert(move(subMenu));
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    auto check = [&](const string& line, const vector<string>& expected, size_t max = 3)
+    {
+        const auto suggestions = session.Suggestions(line, max);
+        BOOST_CHECK_EQUAL_COLLECTIONS(suggestions.begin(), suggestions.end(), expected.begin(), expected.end());
+    };
+
+    // from the most similar, then by name
+    check("shoe", {"shot", "show", "shout"});
+    check("shoe", {"shot"}, 1);
+    check("hlep", {"help"}); // a global command
+    check("xyz", {});
+    // the tokens after the wrong one are kept
+    check("shwo now", {"shot now", "show now"});
+    // the names exist: the parameters are wrong
+    check("show 3", {});
+    check("net ifconfig x", {});
+    // the commands of a submenu
+    check("net rute", {"net route"});
+    check("net ifconfg 3", {"net ifconfig 3"});
+    check("nte", {"net"});
+    // the disabled commands are not suggested
+    shout.Disable();
+    check("shoe", {"shot", "show"});
+    shout.Enable();
+
+    // from a submenu: its commands and the parent
+    BOOST_CHECK(session.Feed("net"));
+    check("rute", {"route"});
+    check("cl", {"cli"});
+    check(".. shw", {".. show", ".. shot"});
+    check("cli shw", {"cli show", "cli shot"});
+
+    // the wrong command handler with the suggestions
+    cli.WrongCommandHandler([](ostream& out, const string& cmd, const vector<string>& suggestions)
+    {
+        out << "wrong " << cmd << ':';
+        for (const auto& s: suggestions)
+            out << ' ' << s;
+        out << '\n';
+    }, 2);
+    oss.str("");
+    BOOST_CHECK(!session.Feed("rote"));
+    BOOST_CHECK(!session.Feed(".. shoe"));
+    BOOST_CHECK_EQUAL(oss.str(), "wrong rote: route\nwrong .. shoe: .. shot .. show\n");
+}
+
+BOOST_AUTO_TEST_CASE(ColoredPrompt)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert(make_unique<Menu>("sub", "(menu)", "sub-prompt"));
+    Cli cli(move(rootMenu));
+    stringstream oss;
+    CliSession session(cli, oss);
+
+    session.Prompt();
+    BOOST_CHECK_EQUAL(oss.str(), "cli> ");
+    SetColor();
+    oss.str("");
+    session.Prompt();
+    BOOST_CHECK_EQUAL(oss.str(), "\033[32m\033[1mcli\033[0m> ");
+    session.Feed("sub");
+    oss.str("");
+    session.Prompt();
+    BOOST_CHECK_EQUAL(oss.str(), "\033[32m\033[1msub-prompt\033[0m> ");
+    SetNoColor();
+}
+
+BOOST_AUTO_TEST_CASE(FramedMode)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream& out){ out << "hello\n"; });
+    rootMenu->Insert("fail", [](ostream&){ throw runtime_error("boom"); });
+    rootMenu->Insert("iface", [](ostream& out){ RecordWriter{out}("name", "eth0")("descr", "a\tb\\c"); });
+    Completion pending;
+    rootMenu->Insert("wait", [&](ostream&){ return pending; });
+    Cli cli(move(rootMenu));
+    cli.StdExceptionHandler([](ostream& out, const string&, const exception& e){ out << e.what() << '\n'; });
+    cli.WrongCommandHandler([](ostream& out, const string& cmd){ out << "no " << cmd << '\n'; });
+    stringstream oss;
+    CliSession session(cli, oss);
+
+    auto feed = [&](const string& line)
+    {
+        oss.str("");
+        session.Feed(line);
+        return oss.str();
+    };
+
+    BOOST_CHECK_EQUAL(feed("iface"), "name: eth0\ndescr: a\tb\\c\n\n");
+    BOOST_CHECK_EQUAL(feed("framing on"), "");
+    BOOST_CHECK(session.Framed());
+    oss.str("");
+    session.Prompt();
+    BOOST_CHECK(oss.str().empty());
+
+    BOOST_CHECK_EQUAL(feed("hello"), "#1 ok 6\nhello\n");
+    BOOST_CHECK_EQUAL(feed("@a7 nope 1"), "#a7 wrong 10\nno nope 1\n");
+    BOOST_CHECK_EQUAL(feed("fail"), "#3 error 5\nboom\n");
+    BOOST_CHECK_EQUAL(feed("iface"), "#4 ok 24\nname=eth0\tdescr=a\\tb\\\\c\n");
+    BOOST_CHECK_EQUAL(feed("   "), "");
+    BOOST_CHECK_EQUAL(feed("@ping"), "#ping ok 0\n");
+
+    // the frame of an asynchronous command is written when it completes
+    session.ResumeAsync([](){});
+    BOOST_CHECK_EQUAL(feed("@w wait"), "");
+    BOOST_CHECK(session.Running());
+    pending.Complete([](ostream& out){ out << "done\n"; });
+    oss.str("");
+    session.EndAsync();
+    BOOST_CHECK_EQUAL(oss.str(), "#w ok 5\ndone\n");
+
+    pending = Completion{};
+    BOOST_CHECK_EQUAL(feed("wait"), "");
+    session.Cancel();
+    oss.str("");
+    session.EndAsync();
+    BOOST_CHECK_EQUAL(oss.str(), "#7 cancelled 0\n");
+    session.ResumeAsync({});
+
+    // the mode changes after the line
+    BOOST_CHECK_EQUAL(feed("framing off"), "#8 ok 0\n");
+    BOOST_CHECK(!session.Framed());
+    BOOST_CHECK_EQUAL(feed("hello"), "hello\n");
+    BOOST_CHECK(!session.Feed("framing maybe"));
+}
+
+BOOST_AUTO_TEST_CASE(Pager)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    size_t generated = 0;
+    rootMenu->Insert("rows", [&](ostream&, size_t n)
+    {
+        auto i = make_shared<size_t>(0);
+        return Paged([&generated, i, n](ostream& out)
+        {
+            ++generated;
+            out << "row " << (*i)++ << '\n';
+            return *i < n;
+        });
+    } );
+    Cli cli(move(rootMenu));
+
+    {
+        // without the pager, all the output at once
+        stringstream oss;
+        CliSession session(cli, oss, 1);
+        session.Feed("rows 5");
+        BOOST_CHECK_EQUAL(oss.str(), "row 0\nrow 1\nrow 2\nrow 3\nrow 4\n");
+    }
+
+    LoopScheduler scheduler;
+    stringstream oss;
+    TestInteractiveSession session(cli, scheduler, oss);
+    auto poll = [&](){ while (scheduler.PollOne()) {} };
+    session.WindowSize(80, 4);
+    session.Type("pager on\n");
+    poll();
+    BOOST_CHECK(session.Pager());
+
+    // a screen (less the line of --More--) and the rows not shown are not generated
+    oss.str("");
+    generated = 0;
+    session.Type("rows 100000\n");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "rows 100000\r\nrow 0\nrow 1\nrow 2\n--More--");
+    BOOST_CHECK_EQUAL(generated, 3u);
+    BOOST_CHECK(session.Paging());
+
+    // enter: one more line; space: one more screen
+    oss.str("");
+    session.Type("\n ");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "\r        \rrow 3\n--More--\r        \rrow 4\nrow 5\nrow 6\n--More--");
+
+    // q ends the command
+    oss.str("");
+    session.Type("q");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "\r        \rcli> ");
+    BOOST_CHECK(!session.Paging());
+    BOOST_CHECK_EQUAL(generated, 7u);
+
+    // the output shorter than a screen doesn't wait
+    oss.str("");
+    session.Type("rows 2\n");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "rows 2\r\nrow 0\nrow 1\ncli> ");
+
+    // ctrl+C ends the command
+    oss.str("");
+    session.Type("rows 10\n\x03");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "rows 10\r\nrow 0\nrow 1\nrow 2\n--More--\r        \rcli> ");
+}
+
+BOOST_AUTO_TEST_CASE(StreamedOutput)
+{
+    // a session whose output is sent by Drain: the backlog is the output since the last Drain
+    class StreamingSession : public TestInteractiveSession
+    {
+    public:
+        StreamingSession(Cli& _cli, Scheduler& scheduler, stringstream& _out) :
+            TestInteractiveSession(_cli, scheduler, _out), oss(_out) {}
+        void Drain() { sent = oss.str().size(); StreamMore(); }
+        bool OutputBacklogged() const override { return oss.str().size() > sent + 14; }
+    private:
+        stringstream& oss;
+        size_t sent = 0;
+    };
+
+    auto rootMenu = make_unique<Menu>("cli");
+    size_t generated = 0;
+    rootMenu->Insert("rows", [&](ostream&, size_t n)
+    {
+        auto i = make_shared<size_t>(0);
+        return cli::Streamed([&generated, i, n](ostream& out)
+        {
+            ++generated;
+            out << "row " << (*i)++ << '\n';
+            return *i < n;
+        });
+    } );
+    vector<int> values{1, 2, 3};
+    rootMenu->Insert("values", [&](ostream&){ return cli::Streamed::Range(values.begin(), values.end()); } );
+    Cli cli(move(rootMenu));
+
+    {
+        // without an asynchronous continuation, all the output at once
+        stringstream oss;
+        CliSession session(cli, oss, 1);
+        session.Feed("rows 5");
+        session.Feed("values");
+        BOOST_CHECK_EQUAL(oss.str(), "row 0\nrow 1\nrow 2\nrow 3\nrow 4\n1\n2\n3\n");
+    }
+
+    LoopScheduler scheduler;
+    stringstream oss;
+    StreamingSession session(cli, scheduler, oss);
+    auto poll = [&](){ while (scheduler.PollOne()) {} };
+    session.Drain();
+
+    // the rows are generated while the backlog is under the limit
+    generated = 0;
+    session.Type("rows 8\n");
+    poll();
+    BOOST_CHECK_EQUAL(oss.str(), "cli> rows 8\r\nrow 0\nrow 1\n");
+    BOOST_CHECK_EQUAL(generated, 2u);
+    BOOST_CHECK(session.Running());
+
+    // more rows as the output is sent, then the prompt
+    session.Drain();
+    BOOST_CHECK_EQUAL(generated, 5u);
+    session.Drain();
+    BOOST_CHECK_EQUAL(generated, 8u);
+    poll();
+    BOOST_CHECK(!session.Running());
+    BOOST_CHECK_EQUAL(oss.str(), "cli> rows 8\r\nrow 0\nrow 1\nrow 2\nrow 3\nrow 4\nrow 5\nrow 6\nrow 7\ncli> ");
+
+    // ctrl+C stops the generation
+    session.Drain();
+    oss.str("");
+    session.Drain();
+    generated = 0;
+    session.Type("rows 1000000\n");
+    poll();
+    session.Type("\x03");
+    poll();
+    session.Drain();
+    BOOST_CHECK_EQUAL(generated, 1u);
+    BOOST_CHECK(!session.Running());
+    BOOST_CHECK_EQUAL(oss.str(), "rows 1000000\r\nrow 0\n^C\r\ncli> ");
+}
+
+BOOST_AUTO_TEST_CASE(OutputFilters)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("log", [](ostream& out, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            out << "line " << i << (i % 3 == 0 ? " error" : " ok") << '\n';
+        out << "end";
+    } );
+    size_t generated = 0;
+    rootMenu->Insert("rows", [&](ostream&)
+    {
+        return cli::Streamed([&generated](ostream& out)
+        {
+            out << "row " << generated++ << '\n';
+            return true; // endless
+        });
+    } );
+    rootMenu->Insert("echo", [](ostream& out, const string& s){ out << s << '\n'; } );
+    rootMenu->Insert("fail", [](ostream& out){ out << "partial\n"; throw runtime_error("boom"); } );
+    Cli cli(move(rootMenu));
+    cli.WrongCommandHandler([](ostream& out, const string& cmd){ out << "no " << cmd << '\n'; });
+    cli.StdExceptionHandler([](ostream& out, const string&, const exception& e){ out << e.what() << '\n'; });
+
+    stringstream oss;
+    CliSession session(cli, oss);
+    auto feed = [&](const string& line)
+    {
+        oss.str("");
+        session.Feed(line);
+        return oss.str();
+    };
+
+    BOOST_CHECK_EQUAL(feed("log 7 | include error"), "line 0 error\nline 3 error\nline 6 error\n");
+    BOOST_CHECK_EQUAL(feed("log 7 | exclude error | exclude end"), "line 1 ok\nline 2 ok\nline 4 ok\nline 5 ok\n");
+    BOOST_CHECK_EQUAL(feed("log 7|head 2"), "line 0 error\nline 1 ok\n");
+    BOOST_CHECK_EQUAL(feed("log 7 | count"), "8\n");
+    BOOST_CHECK_EQUAL(feed("log 7 | include ok | count"), "4\n");
+    BOOST_CHECK_EQUAL(feed("log 2 | include \"0 err\""), "line 0 error\n");
+    BOOST_CHECK_EQUAL(feed("log 30 | head"), feed("log 10 | exclude end"));
+    // the last line, without newline
+    BOOST_CHECK_EQUAL(feed("log 1 | include e"), "line 0 error\nend");
+
+    // head stops the command, that is not cancelled
+    BOOST_CHECK(session.Feed("rows | include 7 | head 2"));
+    BOOST_CHECK(!session.Cancelled());
+    BOOST_CHECK(generated >= 18u && generated < 100u);
+
+    // the '|' quoted, escaped or not followed by filters is part of the command
+    BOOST_CHECK_EQUAL(feed("echo \"a | count\""), "a | count\n");
+    BOOST_CHECK_EQUAL(feed("echo a\\|count"), "a\\|count\n");
+    BOOST_CHECK_EQUAL(feed("echo a|b | count"), "1\n");
+    BOOST_CHECK_EQUAL(feed("log 2 | grep x"), "no log 2 | grep x\n");
+    BOOST_CHECK_EQUAL(feed("log 2 | head x"), "no log 2 | head x\n");
+
+    // the errors are not filtered
+    BOOST_CHECK_EQUAL(feed("lgo 2 | count"), "no lgo 2\n");
+    BOOST_CHECK_EQUAL(feed("fail | exclude partial"), "boom\n");
+
+    BOOST_CHECK(session.IsParallel("log 3 | count") == session.IsParallel("log 3"));
+
+    // in framed mode, the frame has the output filtered
+    session.Framed(true);
+    BOOST_CHECK_EQUAL(feed("@1 log 5 | include ok"), "#1 ok 30\nline 1 ok\nline 2 ok\nline 4 ok\n");
+    generated = 0;
+    BOOST_CHECK_EQUAL(feed("@2 rows | head 1"), "#2 ok 6\nrow 0\n");
+}
+
+BOOST_AUTO_TEST_CASE(WatchMode)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    int runs = 0;
+    rootMenu->Insert("status", [&](ostream& out)
+    {
+        ++runs;
+        out << "name: eth0\n" << "packets: " << runs * 11 << '\n';
+        if (runs < 3)
+            out << "state: up\n";
+    } );
+    Cli cli(move(rootMenu));
+
+    {
+        // without an asynchronous continuation, the command is executed once
+        stringstream oss;
+        CliSession session(cli, oss, 1);
+        BOOST_CHECK(session.Feed("watch 1 status | include pack"));
+        BOOST_CHECK_EQUAL(oss.str(), "packets: 11\n");
+        BOOST_CHECK(!session.Watching());
+        BOOST_CHECK(!session.Feed("watch 0 status"));
+        BOOST_CHECK(!session.Feed("watch x status"));
+        BOOST_CHECK(!session.Feed("watch 1"));
+    }
+
+    runs = 0;
+    LoopScheduler scheduler;
+    stringstream oss;
+    TestInteractiveSession session(cli, scheduler, oss);
+    auto poll = [&](){ while (scheduler.PollOne()) {} };
+    session.WindowSize(18, 10);
+    oss.str("");
+    session.Type("watch 0.05 status\n");
+    poll();
+    BOOST_CHECK(session.Watching());
+    BOOST_CHECK_EQUAL(session.WatchLine(), "status");
+    // the screen cleared, a header (cut to the width) and the output
+    BOOST_CHECK_EQUAL(oss.str(), "watch 0.05 status\r\n\033[H\033[J"
+        "\033[1;1HEvery 0.05s: statu\033[2;1Hname: eth0\033[3;1Hpackets: 11\033[4;1Hstate: up\033[5;1H");
+
+    // then only the rows changed
+    oss.str("");
+    scheduler.ExecOne();
+    BOOST_CHECK_EQUAL(oss.str(), "\033[3;1Hpackets: 22\033[5;1H");
+    oss.str("");
+    scheduler.ExecOne();
+    BOOST_CHECK_EQUAL(oss.str(), "\033[3;1Hpackets: 33\033[4;1H\033[K\033[4;1H");
+    BOOST_CHECK_EQUAL(runs, 3);
+
+    // a key ends the watch, and the refresh scheduled is ignored
+    oss.str("");
+    session.Type("q");
+    poll();
+    BOOST_CHECK(!session.Watching());
+    BOOST_CHECK_EQUAL(oss.str(), "cli> ");
+    this_thread::sleep_for(chrono::milliseconds(100));
+    poll();
+    BOOST_CHECK_EQUAL(runs, 3);
+    BOOST_CHECK_EQUAL(oss.str(), "cli> ");
+}
+
+BOOST_AUTO_TEST_CASE(CachedHelp)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream&){}, "say hello");
+    auto hi = rootMenu->Insert("hi", [](ostream&, int){}, "say hi");
+    auto subMenu = make_unique<Menu>("sub", "a submenu");
+    subMenu->Insert("foo", [](ostream&){}, "foo help");
+    Menu* sub = subMenu.get();
+    rootMenu->Insert(move(subMenu));
+    Menu* root = rootMenu.get();
+    Cli cli(move(rootMenu));
+
+    auto help = [&](const string& line)
+    {
+        stringstream oss;
+        CliSession s(cli, oss);
+        BOOST_CHECK(s.Feed(line));
+        return oss.str();
+    };
+
+    const auto full = help("help");
+    BOOST_CHECK(full.find(" - hello\n\tsay hello\n - hi <int>\n\tsay hi\n - sub\n\ta submenu\n") != string::npos);
+    BOOST_CHECK_EQUAL(help("help"), full);
+
+    // the help follows the changes of the commands
+    hi.Disable();
+    BOOST_CHECK(help("help").find(" - hi") == string::npos);
+    hi.Enable();
+    BOOST_CHECK_EQUAL(help("help"), full);
+    auto bye = root->Insert("bye", [](ostream&){}, "say bye");
+    BOOST_CHECK(help("help").find(" - bye\n\tsay bye\n") != string::npos);
+    bye.Remove();
+    BOOST_CHECK_EQUAL(help("help"), full);
+
+    // only the commands starting with the prefix
+    auto filtered = help("help h");
+    BOOST_CHECK(filtered.find(" - hello") != string::npos);
+    BOOST_CHECK(filtered.find(" - hi") != string::npos);
+    BOOST_CHECK(filtered.find(" - help") != string::npos);
+    BOOST_CHECK(filtered.find(" - sub") == string::npos);
+    BOOST_CHECK(filtered.find(" - exit") == string::npos);
+    filtered = help("help su");
+    BOOST_CHECK(filtered.find(" - sub\n\ta submenu\n") != string::npos);
+    BOOST_CHECK(filtered.find(" - hello") == string::npos);
+
+    // in a submenu, the parent is listed as well
+    stringstream oss;
+    CliSession s(cli, oss);
+    s.Current(sub);
+    BOOST_CHECK(s.Feed("help"));
+    BOOST_CHECK(oss.str().find(" - foo\n\tfoo help\n") != string::npos);
+    BOOST_CHECK(oss.str().find(" - cli\n") != string::npos);
+    BOOST_CHECK(!s.Feed("help a b"));
+}
+
+BOOST_AUTO_TEST_CASE(ParentShortcut)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("root_cmd", [](ostream& out){ out << "root\n"; } );
+    auto subMenu = make_unique<Menu>("sub");
+    subMenu->Insert("sub_cmd", [](ostream& out){ out << "sub\n"; } );
+    rootMenu->Insert(move(subMenu));
+
+    Cli cli(move(rootMenu));
+
+    stringstream oss;
+
+    UserInput(cli, oss, "sub\n.. root_cmd");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "root");
+    UserInput(cli, oss, "sub\n..\nroot_cmd");
+    BOOST_CHECK_EQUAL(ExtractLastPrompt(oss), "cli");
+    BOOST_CHECK(ExtractContent(oss).find("root") != string::npos);
+    UserInput(cli, oss, "sub\ncli sub sub_cmd");
+    BOOST_CHECK_EQUAL(ExtractLastPrompt(oss), "sub");
+    BOOST_CHECK_EQUAL(ExtractContent(oss), "sub");
+}
+
 BOOST_AUTO_TEST_CASE(EnterActions)
 {
     auto rootMenu = make_unique<Menu>("cli");
@@ -414,6 +1737,7 @@ BOOST_AUTO_TEST_CASE(Exceptions)
     auto rootMenu = make_unique<Menu>("cli");
     rootMenu->Insert("stdexception", [](ostream&){ throw std::logic_error("myerror"); } );
     rootMenu->Insert("customexception", [](ostream&){ throw 42; } );
+    rootMenu->Insert("badcast", [](ostream&, int){ throw std::bad_cast(); } );
 
     Cli cli(move(rootMenu));
 
@@ -431,6 +1755,159 @@ BOOST_AUTO_TEST_CASE(Exceptions)
 
     // custom exception
     BOOST_CHECK_NO_THROW( UserInput(cli, oss, "customexception") );
+
+    // an exception thrown by the handler is not a parameter mismatch
+    excActionDone = false;
+    BOOST_CHECK_NO_THROW( UserInput(cli, oss, "badcast 42") );
+    BOOST_CHECK(excActionDone);
+}
+
+BOOST_AUTO_TEST_CASE(CoutSinks)
+{
+    struct Sink : CoutSink
+    {
+        void Write(std::shared_ptr<const std::string> data) override { received.push_back(data); }
+        std::vector<std::shared_ptr<const std::string>> received;
+    };
+    auto s1 = make_shared<Sink>();
+    auto s2 = make_shared<Sink>();
+    stringstream oss;
+    Cli::cout().Register(oss);
+    Cli::cout().Register(s1);
+    Cli::cout().Register(s2);
+
+    // the text goes to the sinks at the end of the line
+    Cli::cout() << "alarm " << 42;
+    BOOST_CHECK(s1->received.empty());
+    BOOST_CHECK_EQUAL(oss.str(), "alarm 42");
+    Cli::cout() << '\n';
+    BOOST_REQUIRE_EQUAL(s1->received.size(), 1u);
+    BOOST_REQUIRE_EQUAL(s2->received.size(), 1u);
+    BOOST_CHECK_EQUAL(*s1->received[0], "alarm 42\n");
+    // the buffer is shared
+    BOOST_CHECK(s1->received[0] == s2->received[0]);
+
+    // ... or when the stream is flushed
+    Cli::cout() << "partial" << flush;
+    BOOST_REQUIRE_EQUAL(s1->received.size(), 2u);
+    BOOST_CHECK_EQUAL(*s1->received[1], "partial");
+
+    // a sink destroyed is unregistered
+    s2.reset();
+    Cli::cout() << "after" << endl;
+    BOOST_REQUIRE_EQUAL(s1->received.size(), 3u);
+    BOOST_CHECK_EQUAL(*s1->received[2], "after\n");
+
+    s1.reset();
+    Cli::cout().UnRegister(oss);
+    BOOST_CHECK_EQUAL(oss.str(), "alarm 42\npartialafter\n");
+}
+
+BOOST_AUTO_TEST_CASE(Topics)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Cli cli(std::move(rootMenu));
+    stringstream out1;
+    stringstream out2;
+    CliSession s1(cli, out1);
+    CliSession s2(cli, out2);
+
+    // only the topics created by the application can be subscribed
+    BOOST_CHECK(!s1.Subscribe("typed by a user"));
+    BOOST_CHECK(s1.Feed("subscribe typo"));
+    BOOST_CHECK_EQUAL(out1.str(), "unknown topic: typo\n");
+    BOOST_CHECK(s1.Subscriptions().empty());
+    Cli::Topic("alarms");
+    Cli::Topic("events");
+
+    // only the sessions subscribed get the text of a topic
+    BOOST_CHECK(s1.Feed("subscribe alarms"));
+    BOOST_CHECK(!s1.Feed("subscribe alarms events"));
+    BOOST_CHECK(s2.Subscribe("events"));
+    out1.str("");
+    Cli::Topic("alarms") << "fan failure" << endl;
+    Cli::Topic("events") << "login" << endl;
+    Cli::Topic("nobody") << "lost" << endl;
+    BOOST_CHECK_EQUAL(out1.str(), "fan failure\n");
+    BOOST_CHECK_EQUAL(out2.str(), "login\n");
+
+    s1.Subscribe("events");
+    s1.Subscribe("events"); // once
+    out1.str("");
+    BOOST_CHECK(s1.Feed("subscribe"));
+    BOOST_CHECK_EQUAL(out1.str(), "alarms\nevents\n");
+    BOOST_CHECK(s1.Subscriptions() == vector<string>({ "alarms", "events" }));
+
+    BOOST_CHECK(s1.Feed("unsubscribe alarms"));
+    BOOST_CHECK(!s1.Feed("unsubscribe"));
+    s1.Unsubscribe("unknown");
+    out1.str("");
+    out2.str("");
+    Cli::Topic("alarms") << "fan failure" << endl;
+    Cli::Topic("events") << "logout" << endl;
+    BOOST_CHECK_EQUAL(out1.str(), "logout\n");
+    BOOST_CHECK_EQUAL(out2.str(), "logout\n");
+    BOOST_CHECK(s1.Subscriptions() == vector<string>({ "events" }));
+}
+
+BOOST_AUTO_TEST_CASE(TopicSinks)
+{
+    // a session receiving Cli::cout() by a sink (as the remote ones)
+    struct SinkSession : CliSession, CoutSink
+    {
+        SinkSession(Cli& _cli, ostream& _out) : CliSession(_cli, _out, 100, false) {}
+        void Connect(const shared_ptr<CoutSink>& self) { RegisterCout(self); }
+        void Write(std::shared_ptr<const std::string> data) override { received.push_back(*data); }
+        vector<string> received;
+    };
+    auto rootMenu = make_unique<Menu>("cli");
+    Cli cli(std::move(rootMenu));
+    stringstream oss;
+    auto session = make_shared<SinkSession>(cli, oss);
+    Cli::Topic("alarms");
+    Cli::Topic("events");
+
+    // subscribed before the sink is registered
+    session->Subscribe("alarms");
+    Cli::Topic("alarms") << "early" << endl;
+    session->Connect(session);
+    Cli::Topic("alarms") << "fan failure" << endl;
+    session->Subscribe("events");
+    Cli::Topic("events") << "login" << endl;
+    session->Unsubscribe("alarms");
+    Cli::Topic("alarms") << "fan failure" << endl;
+    BOOST_CHECK(session->received == vector<string>({ "fan failure\n", "login\n" }));
+    BOOST_CHECK(oss.str().empty());
+}
+
+BOOST_AUTO_TEST_CASE(SearchHistory)
+{
+    auto storage = make_unique<VolatileHistoryStorage>();
+    storage->Store({ "show ip", "ping", "show route", "traceroute", "show version" });
+    Cli cli(make_unique<Menu>("cli"), move(storage));
+
+    stringstream oss;
+    // the session history keeps only the 2 newest commands
+    CliSession session(cli, oss, 2);
+    session.Feed("show clock");
+
+    auto search = [&](const string& query, size_t from, size_t& pos)
+    {
+        pos = from;
+        string result;
+        return session.SearchHistory(query, pos, result) ? result : string("<none>");
+    };
+    size_t pos = 0;
+    BOOST_CHECK_EQUAL(search("show", 0, pos), "show clock");
+    BOOST_CHECK_EQUAL(search("show", pos+1, pos), "show version");
+    // from the global history
+    BOOST_CHECK_EQUAL(search("show", pos+1, pos), "show route");
+    BOOST_CHECK_EQUAL(search("show", pos+1, pos), "show ip");
+    BOOST_CHECK_EQUAL(search("show", pos+1, pos), "<none>");
+    BOOST_CHECK_EQUAL(search("ro", 0, pos), "traceroute");
+    BOOST_CHECK_EQUAL(search("ro", pos+1, pos), "show route");
+    BOOST_CHECK_EQUAL(search("xyz", 0, pos), "<none>");
+    BOOST_CHECK_EQUAL(search("", 0, pos), "<none>");
 }
 
 BOOST_AUTO_TEST_SUITE_END()
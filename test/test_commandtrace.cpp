@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cli/commandtrace.h"
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(CommandTraceSuite)
+
+namespace
+{
+    void Add(CommandTraceRing& ring, uint64_t session, const string& menu, const string& command, CommandOutcome outcome = CommandOutcome::ok)
+    {
+        ring.Record(session, menu.data(), menu.size(), command, chrono::steady_clock::now(), chrono::microseconds(5), 6, outcome);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Ring)
+{
+    CommandTraceRing ring(4);
+    BOOST_CHECK(ring.Records().empty());
+
+    Add(ring, 1, "cli", "hello");
+    Add(ring, 2, "cli/sub", "world | count", CommandOutcome::wrong);
+    auto records = ring.Records();
+    BOOST_REQUIRE_EQUAL(records.size(), 2u);
+    BOOST_CHECK_EQUAL(records[0].sequence, 0u);
+    BOOST_CHECK_EQUAL(records[0].session, 1u);
+    BOOST_CHECK_EQUAL(records[0].menu, "cli");
+    BOOST_CHECK_EQUAL(records[0].command, "hello");
+    BOOST_CHECK(records[0].outcome == CommandOutcome::ok);
+    BOOST_CHECK_EQUAL(records[0].duration.count(), 5000);
+    BOOST_CHECK_EQUAL(records[0].outputBytes, 6u);
+    BOOST_CHECK_EQUAL(records[1].menu, "cli/sub");
+    BOOST_CHECK_EQUAL(records[1].command, "world | count");
+    BOOST_CHECK(records[1].outcome == CommandOutcome::wrong);
+    BOOST_CHECK(records[0].start <= records[1].start);
+    const auto age = chrono::system_clock::now() - records[1].start;
+    BOOST_CHECK(age >= chrono::system_clock::duration::zero() && age < chrono::seconds(10));
+
+    // only the last ones are kept
+    for (int i = 0; i < 5; ++i)
+        Add(ring, 1, "cli", "cmd" + to_string(i));
+    records = ring.Records();
+    BOOST_REQUIRE_EQUAL(records.size(), 4u);
+    BOOST_CHECK_EQUAL(records[0].sequence, 3u);
+    BOOST_CHECK_EQUAL(records[0].command, "cmd1");
+    BOOST_CHECK_EQUAL(records[3].command, "cmd4");
+
+    // the long texts are truncated
+    Add(ring, 1, string(100, 'm'), string(200, 'c'));
+    records = ring.Records();
+    BOOST_CHECK_EQUAL(records.back().menu, string(CommandTraceRing::menuSize, 'm'));
+    BOOST_CHECK_EQUAL(records.back().command, string(CommandTraceRing::commandSize, 'c'));
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentWriters)
+{
+    CommandTraceRing ring(64);
+    vector<thread> writers;
+    for (uint64_t s = 1; s <= 4; ++s)
+        writers.emplace_back([&ring, s]{
+            const string command = "command of " + to_string(s);
+            for (int i = 0; i < 10000; ++i)
+                Add(ring, s, "cli", command);
+        });
+    // the records read meanwhile are never torn
+    for (int i = 0; i < 100; ++i)
+        for (const auto& r: ring.Records())
+            BOOST_REQUIRE_EQUAL(r.command, "command of " + to_string(r.session));
+    for (auto& w: writers)
+        w.join();
+    const auto records = ring.Records();
+    BOOST_REQUIRE_EQUAL(records.size(), 64u);
+    BOOST_CHECK_EQUAL(records.back().sequence, 39999u);
+}
+
+BOOST_AUTO_TEST_CASE(Exports)
+{
+    CommandTraceRing ring(8);
+    Add(ring, 3, "cli", "say \"hi\"\\");
+    Add(ring, 3, "cli", "fail", CommandOutcome::exception);
+    const auto records = ring.Records();
+
+    ostringstream chrome;
+    WriteChromeTrace(chrome, records);
+    const string c = chrome.str();
+    BOOST_CHECK(c.find("{\"traceEvents\":[") == 0);
+    BOOST_CHECK(c.find("\"name\":\"say \\\"hi\\\"\\\\\"") != string::npos);
+    BOOST_CHECK(c.find("\"ph\":\"X\"") != string::npos);
+    BOOST_CHECK(c.find("\"dur\":5.000") != string::npos);
+    BOOST_CHECK(c.find("\"tid\":3") != string::npos);
+    BOOST_CHECK(c.find("\"outcome\":\"exception\"") != string::npos);
+
+    ostringstream otel;
+    WriteOtlpTrace(otel, records);
+    const string o = otel.str();
+    BOOST_CHECK(o.find("{\"resourceSpans\":[") == 0);
+    BOOST_CHECK(o.find("\"traceId\":\"00000000000000000000000000000003\"") != string::npos);
+    BOOST_CHECK(o.find("\"spanId\":\"0000000000000001\"") != string::npos);
+    BOOST_CHECK(o.find("\"name\":\"say\"") != string::npos);
+    BOOST_CHECK(o.find("\"name\":\"fail\"") != string::npos);
+    BOOST_CHECK(o.find("\"status\":{\"code\":2}") != string::npos);
+    const auto start = UnixNanos(records[0].start);
+    BOOST_CHECK(o.find("\"endTimeUnixNano\":\"" + to_string(start + 5000) + "\"") != string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
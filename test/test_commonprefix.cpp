@@ -41,6 +41,27 @@ BOOST_AUTO_TEST_CASE(Everything)
     BOOST_CHECK_EQUAL( CommonPrefix({"foo", "bar"}), "" );
     BOOST_CHECK_EQUAL( CommonPrefix({"prefix_foo", "prefix_bar"}), "prefix_" );
     BOOST_CHECK_EQUAL( CommonPrefix({"prefix foo", "prefix bar"}), "prefix " );
+    BOOST_CHECK_EQUAL( CommonPrefix({"foo", "foo"}), "foo" );
+    BOOST_CHECK_EQUAL( CommonPrefix({"foo", "foobar", "fo"}), "fo" );
+    BOOST_CHECK_EQUAL( CommonPrefix({"", "foo"}), "" );
+}
+
+BOOST_AUTO_TEST_CASE(Length)
+{
+    BOOST_CHECK_EQUAL( CommonPrefixLength({"foo"}), 3 );
+    BOOST_CHECK_EQUAL( CommonPrefixLength({"foo", "bar"}), 0 );
+    BOOST_CHECK_EQUAL( CommonPrefixLength({"prefix_foo", "prefix_bar"}), 7 );
+
+    // strings longer than a machine word, differing before, at and after word boundaries
+    const string base = "0123456789abcdefghijklmnopqrstuvwxyz";
+    for (size_t i = 0; i < base.size(); ++i)
+    {
+        string other = base;
+        other[i] = '*';
+        BOOST_CHECK_EQUAL( CommonPrefixLength({base, other}), i );
+        BOOST_CHECK_EQUAL( CommonPrefixLength({base, base.substr(0, i)}), i );
+        BOOST_CHECK_EQUAL( CommonPrefixLength({base, base, other}), i );
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/consolekeydecoder.h"
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+
+ConsoleKeyEvent Down(char16_t c, unsigned short repeat = 1, unsigned short virtualKey = 0)
+{
+    return ConsoleKeyEvent{ true, repeat, virtualKey, c };
+}
+
+ConsoleKeyEvent Up(char16_t c)
+{
+    return ConsoleKeyEvent{ false, 1, 0, c };
+}
+
+// The bytes of the ascii keys
+string Chars(const InputDevice::KeyEvents& keys)
+{
+    string result;
+    for (const auto& k: keys)
+        if (k.first == KeyType::ascii)
+            result += k.second;
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ConsoleKeyDecoderSuite)
+
+BOOST_AUTO_TEST_CASE(Keys)
+{
+    ConsoleKeyDecoder decoder;
+    InputDevice::KeyEvents keys;
+    decoder.Decode(Down(u'a'), keys);
+    decoder.Decode(Up(u'a'), keys); // ignored
+    decoder.Decode(Down(13), keys);
+    decoder.Decode(Down(8), keys);
+    decoder.Decode(Down(3), keys);
+    decoder.Decode(Down(26), keys);
+    decoder.Decode(Down(18), keys);
+    decoder.Decode(Down(0, 1, consoleUp), keys);
+    decoder.Decode(Down(0, 1, consoleDelete), keys);
+    decoder.Decode(Down(0, 1, consoleNext), keys);
+    decoder.Decode(Down(0, 1, 0x10), keys); // shift: nothing
+    const InputDevice::KeyEvents expected = {
+        { KeyType::ascii, 'a' }, { KeyType::ret, '\r' }, { KeyType::backspace, '\b' },
+        { KeyType::interrupt, ' ' }, { KeyType::eof, ' ' }, { KeyType::search, ' ' },
+        { KeyType::up, ' ' }, { KeyType::canc, ' ' }, { KeyType::ignored, ' ' }
+    };
+    BOOST_CHECK(keys == expected);
+}
+
+BOOST_AUTO_TEST_CASE(RepeatCount)
+{
+    ConsoleKeyDecoder decoder;
+    InputDevice::KeyEvents keys;
+    decoder.Decode(Down(u'x', 3), keys);
+    decoder.Decode(Down(0, 2, consoleLeft), keys);
+    decoder.Decode(Down(u'y', 0), keys);
+    BOOST_CHECK_EQUAL(Chars(keys), "xxx");
+    BOOST_REQUIRE_EQUAL(keys.size(), 5u);
+    BOOST_CHECK(keys[3].first == KeyType::left);
+    BOOST_CHECK(keys[4].first == KeyType::left);
+}
+
+BOOST_AUTO_TEST_CASE(Unicode)
+{
+    ConsoleKeyDecoder decoder;
+    InputDevice::KeyEvents keys;
+    decoder.Decode(Down(u'\u00E9'), keys); // é
+    BOOST_CHECK_EQUAL(Chars(keys), "\xC3\xA9");
+
+    // a surrogate pair comes in two events
+    keys.clear();
+    decoder.Decode(Down(0xD83D), keys);
+    BOOST_CHECK(keys.empty());
+    decoder.Decode(Up(0xD83D), keys);
+    decoder.Decode(Down(0xDE00), keys); // U+1F600
+    BOOST_CHECK_EQUAL(Chars(keys), "\xF0\x9F\x98\x80");
+
+    // the end of a pair without its start is dropped
+    keys.clear();
+    decoder.Decode(Down(0xDE00), keys);
+    decoder.Decode(Down(u'a'), keys);
+    BOOST_CHECK_EQUAL(Chars(keys), "a");
+
+    // the chars are given to the encoder of the console
+    ConsoleKeyDecoder latin1([](const char16_t* units, std::size_t length)
+    {
+        return length == 1 && units[0] < 0x100 ? string(1, static_cast<char>(units[0])) : string("?");
+    });
+    keys.clear();
+    latin1.Decode(Down(u'\u00E9'), keys);
+    latin1.Decode(Down(0xD83D), keys);
+    latin1.Decode(Down(0xDE00), keys);
+    BOOST_CHECK_EQUAL(Chars(keys), "\xE9?");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,9 +29,25 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/filehistorystorage.h"
+#include <fstream>
+#include <set>
+#include <thread>
 
 using namespace cli;
 
+namespace
+{
+std::size_t FileLines(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    std::size_t lines = 0;
+    std::string line;
+    while (std::getline(in, line))
+        ++lines;
+    return lines;
+}
+} // namespace
+
 BOOST_AUTO_TEST_SUITE(FileHistoryStorageSuite)
 
 BOOST_AUTO_TEST_CASE(Basics)
@@ -83,4 +99,76 @@ BOOST_AUTO_TEST_CASE(Persistence)
     BOOST_CHECK(s2.Commands().empty()); // check clear
 }
 
+BOOST_AUTO_TEST_CASE(Compaction)
+{
+    FileHistoryStorage s("cli_test_history", 10, 3);
+    s.Clear();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        s.Store({ "cmd" + std::to_string(i) });
+        // the file grows up to about three times the size of the history
+        BOOST_CHECK(FileLines("cli_test_history") <= 31);
+    }
+    const auto result = s.Commands();
+    BOOST_REQUIRE_EQUAL(result.size(), 10u);
+    BOOST_CHECK_EQUAL(result.front(), "cmd90");
+    BOOST_CHECK_EQUAL(result.back(), "cmd99");
+    s.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(Reopen)
+{
+    // a file left by a previous run, with more lines than the history
+    {
+        std::ofstream f("cli_test_history", std::ios_base::trunc);
+        for (int i = 0; i < 15; ++i)
+            f << "cmd" << i << '\n';
+    }
+    FileHistoryStorage s("cli_test_history", 10);
+    // the first store appends, without compacting the file
+    s.Store({ "cmd15" });
+    BOOST_CHECK_EQUAL(FileLines("cli_test_history"), 16u);
+    const auto result = s.Commands();
+    BOOST_REQUIRE_EQUAL(result.size(), 10u);
+    BOOST_CHECK_EQUAL(result.front(), "cmd6");
+    BOOST_CHECK_EQUAL(result.back(), "cmd15");
+
+    // until the file doubles
+    for (int i = 16; i < 30; ++i)
+        s.Store({ "cmd" + std::to_string(i) });
+    BOOST_CHECK(FileLines("cli_test_history") <= 21);
+    s.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(Concurrency)
+{
+    // two objects on the same file behave like two processes
+    FileHistoryStorage s1("cli_test_history", 1000);
+    FileHistoryStorage s2("cli_test_history", 1000);
+    s1.Clear();
+
+    auto writer = [](FileHistoryStorage& s, const std::string& prefix)
+    {
+        for (int i = 0; i < 200; ++i)
+            s.Store({ prefix + std::to_string(i) + "a", prefix + std::to_string(i) + "b" });
+    };
+    std::thread t1([&]{ writer(s1, "x"); });
+    std::thread t2([&]{ writer(s2, "y"); });
+    t1.join();
+    t2.join();
+
+    const auto result = s1.Commands();
+    BOOST_CHECK_EQUAL(result.size(), 800u);
+    const std::set<std::string> all(result.begin(), result.end());
+    BOOST_CHECK_EQUAL(all.size(), 800u);
+    // the commands of a Store are not interleaved with the ones of another
+    for (std::size_t i = 0; i < result.size(); i += 2)
+    {
+        BOOST_REQUIRE_EQUAL(result[i].back(), 'a');
+        BOOST_CHECK_EQUAL(result[i].substr(0, result[i].size()-1) + 'b', result[i+1]);
+    }
+    s1.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
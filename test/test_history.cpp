@@ -29,6 +29,9 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/detail/history.h"
+#include "cli/detail/historyindex.h"
+#include <deque>
+#include <random>
 
 using namespace cli;
 using namespace cli::detail;
@@ -204,4 +207,198 @@ BOOST_AUTO_TEST_CASE(Copies)
     BOOST_CHECK_EQUAL_COLLECTIONS(cmds2.begin(), cmds2.end(), expected2.begin(), expected2.end());
 }
 
+BOOST_AUTO_TEST_CASE(SharedSnapshot)
+{
+    auto snapshot = std::make_shared<const std::vector<std::string>>(std::vector<std::string>{ "item1", "item2", "item3" });
+
+    History history1(10);
+    History history2(10);
+    history1.LoadCommands(snapshot);
+    history2.LoadCommands(snapshot);
+
+    BOOST_CHECK_EQUAL(history1.Previous(""), "item3");
+    // modify an item of the snapshot
+    BOOST_CHECK_EQUAL(history1.Previous("foo"), "item2");
+    BOOST_CHECK_EQUAL(history1.Next(), "foo");
+
+    // the other history and the snapshot are not affected
+    BOOST_CHECK_EQUAL(history2.Previous(""), "item3");
+    BOOST_CHECK_EQUAL(history2.Previous("item3"), "item2");
+    BOOST_CHECK_EQUAL(history2.Next(), "item3");
+    BOOST_CHECK_EQUAL((*snapshot)[2], "item3");
+
+    // a short history uses only the newest items of the snapshot
+    History history3(2);
+    history3.LoadCommands(snapshot);
+    BOOST_CHECK_EQUAL(history3.Previous(""), "item3");
+    BOOST_CHECK_EQUAL(history3.Previous("item3"), "item3");
+}
+
+namespace
+{
+// the reference implementation, based on a deque
+class DequeHistory
+{
+public:
+    explicit DequeHistory(std::size_t size) : maxSize(size) {}
+    void NewCommand(const std::string& item)
+    {
+        ++commands;
+        current = 0;
+        if (mode == Mode::browsing)
+        {
+            if (buffer.size() > 1 && buffer[1] == item)
+                buffer.pop_front();
+            else
+                buffer[current] = item;
+        }
+        else if (buffer.empty() || buffer[0] != item)
+            Insert(item);
+        mode = Mode::inserting;
+    }
+    std::string Previous(const std::string& line)
+    {
+        if (mode == Mode::inserting)
+        {
+            Insert(line);
+            mode = Mode::browsing;
+            current = (buffer.size() > 1) ? 1 : 0;
+        }
+        else
+        {
+            buffer[current] = line;
+            if (current != buffer.size()-1)
+                ++current;
+        }
+        return buffer[current];
+    }
+    std::string Next()
+    {
+        if (buffer.empty() || current == 0)
+            return {};
+        --current;
+        return buffer[current];
+    }
+    void LoadCommands(const std::vector<std::string>& cmds)
+    {
+        for (const auto& c: cmds)
+            Insert(c);
+    }
+    std::vector<std::string> GetCommands() const
+    {
+        auto n = std::min(commands, buffer.size());
+        auto start = buffer.begin();
+        if (mode == Mode::browsing)
+        {
+            n = std::min(commands, buffer.size()-1);
+            start = buffer.begin()+1;
+        }
+        std::vector<std::string> result(start, start + static_cast<long>(n));
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+private:
+    void Insert(const std::string& item)
+    {
+        buffer.push_front(item);
+        if (buffer.size() > maxSize)
+            buffer.pop_back();
+    }
+    const std::size_t maxSize;
+    std::deque<std::string> buffer;
+    std::size_t current = 0;
+    std::size_t commands = 0;
+    enum class Mode { inserting, browsing };
+    Mode mode = Mode::inserting;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SameAsDeque)
+{
+    std::mt19937 gen(42);
+    for (std::size_t size: { 1, 2, 3, 5, 10 })
+    {
+        std::vector<std::string> global;
+        const auto globalSize = gen() % 8;
+        for (std::size_t i = 0; i < globalSize; ++i)
+            global.push_back("g" + std::to_string(gen() % 4));
+
+        History history(size);
+        history.LoadCommands(std::make_shared<const std::vector<std::string>>(global));
+        DequeHistory expected(size);
+        expected.LoadCommands(global);
+
+        std::string line;
+        for (int i = 0; i < 3000; ++i)
+        {
+            switch (gen() % 4)
+            {
+                case 0:
+                {
+                    // the user edits the line, sometimes
+                    if (gen() % 3 == 0)
+                        line = "e" + std::to_string(gen() % 4);
+                    const std::string result = history.Previous(line);
+                    BOOST_REQUIRE_EQUAL(result, expected.Previous(line));
+                    line = result;
+                    break;
+                }
+                case 1:
+                {
+                    const std::string result = history.Next();
+                    BOOST_REQUIRE_EQUAL(result, expected.Next());
+                    line = result;
+                    break;
+                }
+                default:
+                {
+                    const std::string cmd = "c" + std::to_string(gen() % 6);
+                    history.NewCommand(cmd);
+                    expected.NewCommand(cmd);
+                    line.clear();
+                    break;
+                }
+            }
+            const auto cmds = history.GetCommands();
+            const auto expectedCmds = expected.GetCommands();
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(cmds.begin(), cmds.end(), expectedCmds.begin(), expectedCmds.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Index)
+{
+    std::mt19937 gen(7);
+    auto cmds = std::make_shared<std::vector<std::string>>();
+    const char* words[] = { "show", "ip", "route", "set", "interface", "eth0", "eth1", "up", "down", "ping" };
+    for (int i = 0; i < 100000; ++i)
+    {
+        std::string cmd = words[gen() % 10];
+        for (auto n = gen() % 3; n > 0; --n)
+            cmd += std::string(" ") + words[gen() % 10] + std::to_string(gen() % 100);
+        cmds->push_back(cmd);
+    }
+    const HistoryIndex index(cmds);
+
+    auto linear = [&](const std::string& query, std::size_t before) -> std::size_t
+    {
+        for (std::size_t i = std::min(before, cmds->size()); i > 0; --i)
+            if ((*cmds)[i-1].find(query) != std::string::npos)
+                return i-1;
+        return std::string::npos;
+    };
+    for (const std::string query: { "p", "up", "eth", "eth19", "route42 ", "face", "show set", "zzz", "" })
+    {
+        std::size_t before = cmds->size();
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto found = index.FindBefore(query, before);
+            BOOST_REQUIRE_EQUAL(found, query.empty() ? std::string::npos : linear(query, before));
+            if (found == std::string::npos)
+                break;
+            before = found;
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/cli.h"
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(InternedSuite)
+
+BOOST_AUTO_TEST_CASE(SameStorage)
+{
+    const Interned<string> a(string("interned foo"));
+    const Interned<string> b(string("interned ") + "foo");
+    const Interned<string> c(string("interned bar"));
+    BOOST_CHECK_EQUAL( *a, "interned foo" );
+    BOOST_CHECK_EQUAL( *c, "interned bar" );
+    BOOST_CHECK( a == b );
+    BOOST_CHECK( &*a == &*b );
+    BOOST_CHECK( a != c );
+
+    const Interned<vector<string>> v1(vector<string>{ "value", "unit" });
+    const Interned<vector<string>> v2(vector<string>{ "value", "unit" });
+    const Interned<vector<string>> v3(vector<string>{ "value" });
+    BOOST_CHECK( v1 == v2 );
+    BOOST_CHECK( v1 != v3 );
+    BOOST_CHECK_EQUAL( v1->size(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE(CommandNames)
+{
+    Menu root("root");
+    auto menu1 = make_unique<Menu>("device");
+    auto menu2 = make_unique<Menu>("device");
+    const Command* m1 = menu1.get();
+    const Command* m2 = menu2.get();
+    menu1->Insert("set", [](ostream& out, int x){ out << "set " << x << "\n"; }, "Sets the value");
+    menu2->Insert("set", [](ostream& out, int x){ out << "set " << x << "\n"; }, "Sets the value");
+    root.Insert(move(menu1));
+    root.Insert(move(menu2));
+
+    // the menus with the same name share its storage
+    BOOST_CHECK( &m1->Name() == &m2->Name() );
+    BOOST_CHECK_EQUAL( m1->Name(), "device" );
+
+    // the help is unchanged
+    stringstream help;
+    m1->Help(help);
+    BOOST_CHECK_EQUAL( help.str(), " - device\n\t(menu)\n" );
+}
+
+BOOST_AUTO_TEST_CASE(Released)
+{
+    const auto before = Interned<string>::Pooled();
+    {
+        const Interned<string> a(string("interned released"));
+        const Interned<string> b(string("interned released"));
+        BOOST_CHECK_EQUAL( Interned<string>::Pooled(), before + 1 );
+    }
+    BOOST_CHECK_EQUAL( Interned<string>::Pooled(), before );
+
+    // interned again after the release
+    const Interned<string> c(string("interned released"));
+    BOOST_CHECK_EQUAL( *c, "interned released" );
+    BOOST_CHECK_EQUAL( Interned<string>::Pooled(), before + 1 );
+}
+
+BOOST_AUTO_TEST_CASE(LazyMenusEvicted)
+{
+    auto budget = make_shared<cli::LazyMenuBudget>(2);
+    auto rootMenu = make_unique<Menu>("cli");
+    for (int i = 0; i < 2; ++i)
+        rootMenu->Insert(Menu::Lazy("dev" + to_string(i), [i](Menu& m)
+        {
+            // help texts used only by this menu
+            m.Insert("status", [](ostream& out){ out << "up\n"; }, "Status of the device " + to_string(i));
+            m.Insert("reboot", [](ostream&){}, "Reboot the device " + to_string(i));
+        }, "(menu)", budget));
+    Cli cli(move(rootMenu));
+    ostringstream out;
+    CliSession session(cli, out);
+
+    // each one empties the other (the snapshot of the commands
+    // of an emptied menu is released when it's read again)
+    BOOST_CHECK(session.Feed("dev0 status"));
+    BOOST_CHECK(session.Feed("dev1 status"));
+    BOOST_CHECK(session.Feed("dev0 status"));
+    const auto pooled = Interned<string>::Pooled();
+    for (int i = 0; i < 10; ++i)
+    {
+        BOOST_CHECK(session.Feed("dev1 status"));
+        BOOST_CHECK(session.Feed("dev0 status"));
+    }
+    BOOST_CHECK_EQUAL( Interned<string>::Pooled(), pooled );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
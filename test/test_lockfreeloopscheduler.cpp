@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "scheduler_test_templates.h"
+#include "cli/lockfreeloopscheduler.h"
+#include <vector>
+
+using namespace std;
+using namespace cli;
+
+BOOST_AUTO_TEST_SUITE(LockFreeLoopSchedulerSuite)
+
+BOOST_AUTO_TEST_CASE(Basics)
+{
+    SchedulingTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(SameThread)
+{
+    SameThreadTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Exceptions)
+{
+    ExceptionTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+    MoveOnlyTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Priorities)
+{
+    PriorityTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Timers)
+{
+    TimerTest<LockFreeLoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Batch)
+{
+    LockFreeLoopScheduler scheduler;
+    vector<int> done;
+    for (int i = 0; i < 5; ++i)
+        scheduler.Post( [&done, i]() noexcept { done.push_back(i); } );
+    BOOST_CHECK_EQUAL(scheduler.RunBatch(), 5);
+    BOOST_CHECK(done == vector<int>({0, 1, 2, 3, 4}));
+    BOOST_CHECK(!scheduler.PollOne());
+
+    // a stop interrupts the batch
+    scheduler.Post( [&scheduler]() noexcept { scheduler.Stop(); } );
+    scheduler.Post( [&done]() noexcept { done.push_back(5); } );
+    BOOST_CHECK_EQUAL(scheduler.RunBatch(), 1);
+    BOOST_CHECK_EQUAL(done.size(), 5);
+    BOOST_CHECK(scheduler.Stopped());
+    BOOST_CHECK_EQUAL(scheduler.RunBatch(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Producers)
+{
+    LockFreeLoopScheduler scheduler;
+    const int producers = 4;
+    const int tasksPerProducer = 10000;
+    vector<int> last(producers, -1);
+    bool ordered = true;
+    int count = 0;
+    vector<thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back( [&, p]()
+            {
+                for (int i = 0; i < tasksPerProducer; ++i)
+                    scheduler.Post( [&, p, i]()
+                        {
+                            // the tasks of each producer run in order
+                            if (last[static_cast<size_t>(p)] != i-1) ordered = false;
+                            last[static_cast<size_t>(p)] = i;
+                            if (++count == producers*tasksPerProducer) scheduler.Stop();
+                        }
+                    );
+            }
+        );
+    scheduler.Run();
+    for (auto& t: threads)
+        t.join();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(count, producers*tasksPerProducer);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
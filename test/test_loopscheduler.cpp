@@ -50,4 +50,19 @@ BOOST_AUTO_TEST_CASE(Exceptions)
     ExceptionTest<LoopScheduler>();
 }
 
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+    MoveOnlyTest<LoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Priorities)
+{
+    PriorityTest<LoopScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Timers)
+{
+    TimerTest<LoopScheduler>();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/cli.h"
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+using namespace std;
+using namespace cli;
+
+namespace
+{
+
+// Counts the memory taken and given back
+class CountingResource : public MemoryResource
+{
+public:
+    std::size_t allocations = 0;
+    std::size_t outstanding = 0; // the bytes not given back
+private:
+    void* DoAllocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++allocations;
+        outstanding += bytes;
+        return NewDeleteResource()->Allocate(bytes, alignment);
+    }
+    void DoDeallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        outstanding -= bytes;
+        NewDeleteResource()->Deallocate(p, bytes, alignment);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MemoryResourceSuite)
+
+BOOST_AUTO_TEST_CASE(Monotonic)
+{
+    CountingResource upstream;
+    {
+        MonotonicBufferResource arena(&upstream, 64);
+        for (int round = 0; round < 5; ++round)
+        {
+            for (std::size_t i = 1; i < 100; ++i)
+            {
+                void* p = arena.Allocate(i, alignof(std::uint64_t));
+                BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p) % alignof(std::uint64_t), 0u);
+                std::memset(p, 0xAA, i);
+            }
+            arena.Release();
+        }
+        // after the first rounds, the largest block is enough
+        const auto allocations = upstream.allocations;
+        for (std::size_t i = 1; i < 100; ++i)
+            arena.Allocate(i, 1);
+        arena.Release();
+        BOOST_CHECK_EQUAL(upstream.allocations, allocations);
+        BOOST_CHECK(upstream.outstanding > 0);
+    }
+    BOOST_CHECK_EQUAL(upstream.outstanding, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Allocators)
+{
+    CountingResource upstream;
+    {
+        vector<int, cli::Allocator<int>> v{ cli::Allocator<int>(&upstream) };
+        for (int i = 0; i < 100; ++i)
+            v.push_back(i);
+        BOOST_CHECK_EQUAL(v[99], 99);
+        BOOST_CHECK(upstream.allocations > 0);
+        BOOST_CHECK(cli::Allocator<int>(&upstream) == cli::Allocator<char>(&upstream));
+        BOOST_CHECK(cli::Allocator<int>(&upstream) != cli::Allocator<int>());
+        BOOST_CHECK(cli::Allocator<int>() == cli::Allocator<char>());
+    }
+    BOOST_CHECK_EQUAL(upstream.outstanding, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(SessionFrameMemory)
+{
+    CountingResource upstream;
+    {
+        auto rootMenu = make_unique<Menu>("cli");
+        rootMenu->Insert("lines", [](ostream& out, int n){ for (int i = 0; i < n; ++i) out << "line " << i << '\n'; });
+        Cli cli(move(rootMenu));
+        cli.FrameMemory(&upstream);
+        stringstream out;
+        CliSession session(cli, out);
+        session.Framed(true);
+
+        // the output of a command is collected in the frame memory
+        BOOST_CHECK(session.Feed("lines 2"));
+        BOOST_CHECK_EQUAL(out.str(), "#1 ok 14\nline 0\nline 1\n");
+        BOOST_CHECK(upstream.allocations > 0);
+
+        // also when it's larger than a block
+        string expected;
+        for (int i = 0; i < 20000; ++i)
+            expected += "line " + to_string(i) + '\n';
+        out.str("");
+        BOOST_CHECK(session.Feed("lines 20000"));
+        BOOST_CHECK_EQUAL(out.str(), "#2 ok " + to_string(expected.size()) + '\n' + expected);
+
+        // then reused by the next commands
+        for (int i = 0; i < 5; ++i)
+            session.Feed("lines 20000");
+        const auto allocations = upstream.allocations;
+        session.Feed("lines 20000");
+        session.Feed("lines 10");
+        BOOST_CHECK_EQUAL(upstream.allocations, allocations);
+    }
+    BOOST_CHECK_EQUAL(upstream.outstanding, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
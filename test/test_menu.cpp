@@ -29,11 +29,30 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/cli.h"
+#include <atomic>
+#include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace cli;
 using namespace cli::detail;
 
+namespace
+{
+    void NoOp(ostream&) {}
+
+    constexpr StaticCommand staticSubCmds[] = {
+        StaticCmd<decltype(&NoOp), &NoOp>("foo")
+    };
+    constexpr StaticMenu staticSub = MakeStaticMenu("ssub", staticSubCmds);
+    constexpr StaticCommand staticCmds[] = {
+        StaticCmd<decltype(&NoOp), &NoOp>("saaa"),
+        StaticCmd<decltype(&NoOp), &NoOp>("sbbb"),
+        StaticSubmenu(staticSub)
+    };
+    constexpr StaticMenu staticMenu = MakeStaticMenu("smenu", staticCmds);
+} // namespace
+
 BOOST_AUTO_TEST_SUITE(MenuSuite)
 
 BOOST_AUTO_TEST_CASE(Basics)
@@ -121,4 +140,266 @@ BOOST_AUTO_TEST_CASE(Basics)
     BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(StaticCompletions)
+{
+    Menu menu("menu");
+    menu.Insert("saaa_dyn", [](ostream&){});
+    menu.Insert(staticMenu);
+
+    // the dynamic commands come first
+    auto completions = menu.GetCompletions("s");
+    vector<string> expected({"saaa_dyn", "saaa", "sbbb", "ssub"});
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    completions = menu.GetCompletions("ssub");
+    expected = {"ssub foo", "ssub menu"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    Menu fromStatic(staticMenu);
+    BOOST_CHECK_EQUAL(fromStatic.Name(), "smenu");
+    BOOST_CHECK_EQUAL(fromStatic.Prompt(), "smenu");
+    completions = fromStatic.GetCompletionRecursive("smenu sb");
+    expected = {"smenu sbbb"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(CompletionsAfterInsertAndRemove)
+{
+    Menu menu("menu");
+    menu.Insert("zzz", [](ostream&){});
+    auto aaa = menu.Insert("aaa", [](ostream&){});
+    menu.Insert("aaa", [](ostream&, int){}); // overload
+    menu.Insert("aab", [](ostream&){});
+    auto subMenu = make_unique<Menu>("aa");
+    subMenu->Insert("foo", [](ostream&){});
+    menu.Insert(move(subMenu));
+
+    // completions keep the insertion order
+    auto completions = menu.GetCompletions("a");
+    vector<string> expected({"aaa", "aaa", "aab", "aa"});
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    // "aa" is both a prefix of the line (a submenu) and of other names
+    completions = menu.GetCompletions("aa f");
+    expected = {"aa foo"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    completions = menu.GetCompletions("aa");
+    expected = {"aaa", "aaa", "aab", "aa foo", "aa menu"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    aaa.Remove();
+    completions = menu.GetCompletions("aaa");
+    expected = {"aaa"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    aaa.Disable(); // already removed: nothing happens
+    menu.Insert("aaaa", [](ostream&){});
+    completions = menu.GetCompletions("aaa");
+    expected = {"aaa", "aaaa"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    completions = menu.GetCompletions("b");
+    BOOST_CHECK(completions.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE(HandlesAfterSlotReuse)
+{
+    Menu menu("menu");
+    vector<CmdHandler> handlers;
+    for (int i = 0; i < 6; ++i)
+        handlers.push_back(menu.Insert("c" + to_string(i), [](ostream&){}));
+
+    handlers[1].Remove();
+    handlers[4].Remove();
+    handlers[5].Remove(); // the last slots are released
+    // the new commands take the freed slots, but come last
+    auto n1 = menu.Insert("n1", [](ostream&){});
+    auto n2 = menu.Insert("n2", [](ostream&){});
+
+    auto completions = menu.GetCompletions("");
+    vector<string> expected({"c0", "c2", "c3", "n1", "n2"});
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    // the handles of the removed commands don't touch the commands in their slots
+    handlers[1].Remove();
+    handlers[4].Remove();
+    handlers[5].Remove();
+    completions = menu.GetCompletions("");
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    n1.Remove();
+    handlers[0].Remove();
+    n2.Remove();
+    completions = menu.GetCompletions("");
+    expected = {"c2", "c3"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+
+    handlers[2].Remove();
+    handlers[3].Remove();
+    BOOST_CHECK(menu.GetCompletions("").empty());
+    menu.Insert("last", [](ostream&){});
+    completions = menu.GetCompletions("");
+    expected = {"last"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(completions.begin(), completions.end(), expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE(ChangesWhileSessionRuns)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Menu* root = rootMenu.get();
+    atomic<int> calls{0};
+    root->Insert("stable", [&](ostream&){ ++calls; });
+    Cli cli(move(rootMenu));
+    ostringstream out;
+    CliSession session(cli, out);
+
+    // a plugin thread inserts and removes commands while the session dispatches them
+    atomic<bool> done{false};
+    thread writer([&]()
+    {
+        for (int i = 0; i < 2000; ++i)
+        {
+            auto h = root->Insert("plugin" + to_string(i % 10), [](ostream&){});
+            if (i % 3 != 0)
+                h.Remove();
+        }
+        done = true;
+    });
+    int fed = 0;
+    while (!done || fed == 0)
+    {
+        BOOST_CHECK(session.Feed("stable"));
+        ++fed;
+        session.Feed("plugin1");
+        // "stable" is always there
+        const auto completions = root->GetCompletions("st");
+        BOOST_CHECK(find(completions.begin(), completions.end(), "stable") != completions.end());
+        ostringstream help;
+        root->MainHelp(help);
+    }
+    writer.join();
+    BOOST_CHECK_EQUAL(calls, fed);
+
+    // the changes are visible once the writer is done
+    const auto completions = root->GetCompletions("plugin");
+    BOOST_CHECK_EQUAL(completions.size(), 667u); // the commands inserted with i % 3 == 0
+}
+
+BOOST_AUTO_TEST_CASE(LazyMenus)
+{
+    auto rootMenu = make_unique<Menu>("cli");
+    Menu* root = rootMenu.get();
+    int built = 0;
+    const auto device = [&built](Menu& m)
+    {
+        ++built;
+        m.Insert("status", [](ostream& out){ out << "up\n"; });
+        m.Insert("reboot", [](ostream&){});
+    };
+    root->Insert(Menu::Lazy("dev1", device, "device 1"));
+    root->Insert(Menu::Lazy("dev2", device, "device 2"));
+    Cli cli(move(rootMenu));
+    ostringstream out;
+    CliSession session(cli, out);
+
+    // the help and the completions of the parent don't build them
+    root->MainHelp(out);
+    BOOST_CHECK(out.str().find(" - dev1\n\tdevice 1\n") != string::npos);
+    auto completions = root->GetCompletions("de");
+    BOOST_CHECK_EQUAL(completions.size(), 2u);
+    BOOST_CHECK_EQUAL(built, 0);
+
+    // completing into a menu builds it
+    completions = root->GetCompletions("dev1 st");
+    BOOST_REQUIRE_EQUAL(completions.size(), 1u);
+    BOOST_CHECK_EQUAL(completions[0], "dev1 status");
+    BOOST_CHECK_EQUAL(built, 1);
+
+    // and so executing one of its commands, or entering it
+    out.str("");
+    BOOST_CHECK(session.Feed("dev2 status"));
+    BOOST_CHECK_EQUAL(out.str(), "up\n");
+    BOOST_CHECK_EQUAL(built, 2);
+    BOOST_CHECK(session.Feed("dev1"));
+    BOOST_CHECK_EQUAL(session.Current()->Name(), "dev1");
+    BOOST_CHECK(session.Feed("reboot"));
+    BOOST_CHECK_EQUAL(built, 2); // once
+    BOOST_CHECK(!session.Feed("dev3"));
+}
+
+BOOST_AUTO_TEST_CASE(LazyMenuBudget)
+{
+    auto budget = make_shared<cli::LazyMenuBudget>(4);
+    auto rootMenu = make_unique<Menu>("cli");
+    vector<Menu*> devices;
+    int built = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        auto dev = Menu::Lazy("dev" + to_string(i), [&built](Menu& m)
+        {
+            ++built;
+            m.Insert("status", [](ostream& out){ out << "up\n"; });
+            m.Insert("reboot", [](ostream&){});
+        }, "(menu)", budget);
+        devices.push_back(dev.get());
+        rootMenu->Insert(move(dev));
+    }
+    Cli cli(move(rootMenu));
+    ostringstream out;
+    CliSession session(cli, out);
+
+    BOOST_CHECK(session.Feed("dev0 status"));
+    BOOST_CHECK(session.Feed("dev1 status"));
+    BOOST_CHECK_EQUAL(budget->Commands(), 4u);
+    BOOST_CHECK_EQUAL(budget->Menus(), 2u);
+    BOOST_CHECK(session.Feed("dev0 reboot")); // dev1 is now the least recently used
+
+    // over budget: the least recently used menu is emptied
+    BOOST_CHECK(session.Feed("dev2 status"));
+    BOOST_CHECK_EQUAL(built, 3);
+    BOOST_CHECK(devices[0]->Built());
+    BOOST_CHECK(!devices[1]->Built());
+    BOOST_CHECK(devices[2]->Built());
+    BOOST_CHECK_EQUAL(budget->Commands(), 4u);
+
+    // and built again when needed
+    BOOST_CHECK(session.Feed("dev1 status"));
+    BOOST_CHECK_EQUAL(built, 4);
+    BOOST_CHECK(!devices[0]->Built());
+
+    // a menu with a session in it is kept
+    BOOST_CHECK(session.Feed("dev2"));
+    BOOST_CHECK(session.Feed(".. dev0 status")); // evicts dev1, the only one without sessions
+    BOOST_CHECK(devices[2]->Built());
+    BOOST_CHECK(!devices[1]->Built());
+    BOOST_CHECK(session.Feed("status"));
+    BOOST_CHECK(session.Feed(".."));
+    BOOST_CHECK(session.Feed("dev1 status")); // dev2 has been used after dev0
+    BOOST_CHECK(!devices[0]->Built());
+    BOOST_CHECK(session.Feed("dev0 status")); // now dev2 can go
+    BOOST_CHECK(!devices[2]->Built());
+    BOOST_CHECK_EQUAL(budget->Menus(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(LazyMenuFactoryThrows)
+{
+    bool fail = true;
+    auto menu = Menu::Lazy("dev", [&fail](Menu& m)
+    {
+        m.Insert("status", [](ostream&){});
+        if (fail)
+            throw std::runtime_error("unreachable device");
+    });
+    BOOST_CHECK_THROW(menu->GetCompletions(""), std::runtime_error);
+    BOOST_CHECK(!menu->Built());
+    fail = false;
+    const auto completions = menu->GetCompletions("");
+    BOOST_REQUIRE_EQUAL(completions.size(), 1u); // not twice
+    BOOST_CHECK_EQUAL(completions[0], "status");
+    BOOST_CHECK(menu->Built());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/metrics.h"
+#include <thread>
+
+using namespace cli;
+using namespace std::chrono;
+
+BOOST_AUTO_TEST_SUITE(MetricsSuite)
+
+BOOST_AUTO_TEST_CASE(Histogram)
+{
+    LatencyHistogram h;
+    BOOST_CHECK_EQUAL(h.Count(), 0u);
+    BOOST_CHECK_EQUAL(h.Quantile(0.5).count(), 0);
+
+    // the small values are exact
+    for (int i = 1; i <= 5; ++i)
+        h.Record(nanoseconds(i));
+    BOOST_CHECK_EQUAL(h.Count(), 5u);
+    BOOST_CHECK_EQUAL(h.Quantile(0.0).count(), 1);
+    BOOST_CHECK_EQUAL(h.Quantile(0.5).count(), 3);
+    BOOST_CHECK_EQUAL(h.Quantile(1.0).count(), 5);
+    BOOST_CHECK_EQUAL(h.Max().count(), 5);
+    BOOST_CHECK_EQUAL(h.Mean().count(), 3);
+
+    // the others within 12.5%
+    LatencyHistogram l;
+    for (int i = 1; i <= 1000; ++i)
+        l.Record(microseconds(i));
+    const auto p50 = duration_cast<microseconds>(l.Quantile(0.5)).count();
+    const auto p99 = duration_cast<microseconds>(l.Quantile(0.99)).count();
+    BOOST_CHECK(p50 >= 500*7/8 && p50 <= 500*9/8);
+    BOOST_CHECK(p99 >= 990*7/8 && p99 <= 990*9/8);
+    BOOST_CHECK(l.Quantile(1.0) <= l.Max());
+    BOOST_CHECK_EQUAL(duration_cast<microseconds>(l.Max()).count(), 1000);
+
+    // out of range and negative values
+    l.Record(hours(1000));
+    l.Record(nanoseconds(-1));
+    BOOST_CHECK_EQUAL(l.Count(), 1002u);
+    BOOST_CHECK(l.Max() == hours(1000));
+
+    h.Merge(l);
+    BOOST_CHECK_EQUAL(h.Count(), 1007u);
+    BOOST_CHECK(h.Max() == hours(1000));
+}
+
+BOOST_AUTO_TEST_CASE(Store)
+{
+    detail::MetricsStore store;
+    BOOST_CHECK(store.Get().empty());
+
+    detail::CommandSample sample{nanoseconds(10), nanoseconds(20), nanoseconds(30), 5, false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 100; ++i)
+                store.Record(i % 2 ? "odd" : "even", sample);
+        });
+    for (auto& t: threads)
+        t.join();
+    sample.error = true;
+    store.Record("odd", sample);
+
+    const auto stats = store.Get();
+    BOOST_REQUIRE_EQUAL(stats.size(), 2u);
+    BOOST_CHECK_EQUAL(stats[0].name, "even");
+    BOOST_CHECK_EQUAL(stats[0].Count(), 200u);
+    BOOST_CHECK_EQUAL(stats[0].errors, 0u);
+    BOOST_CHECK_EQUAL(stats[0].outputBytes, 1000u);
+    BOOST_CHECK_EQUAL(stats[1].name, "odd");
+    BOOST_CHECK_EQUAL(stats[1].Count(), 201u);
+    BOOST_CHECK_EQUAL(stats[1].errors, 1u);
+    BOOST_CHECK_EQUAL(stats[1].total.Max().count(), 60);
+    BOOST_CHECK_EQUAL(stats[1].handler.Max().count(), 30);
+
+    store.Reset();
+    BOOST_CHECK(store.Get().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cli/clireplaysession.h"
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(ReplaySuite)
+
+namespace
+{
+    InputDevice::KeyEvents Line(const string& line)
+    {
+        InputDevice::KeyEvents keys;
+        for (const char c: line)
+            keys.emplace_back(KeyType::ascii, c);
+        keys.emplace_back(KeyType::ret, ' ');
+        return keys;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(KeyLog)
+{
+    auto log = make_shared<stringstream>();
+    const InputDevice::KeyEvents special{ {KeyType::up, ' '}, {KeyType::ascii, ' '}, {KeyType::canc, ' '}, {KeyType::ascii, '\xC3'} };
+    {
+        KeyLogWriter writer(log);
+        writer.Write(Line("hello"));
+        writer.Write(special);
+        writer.Write({});
+    }
+    // the header, then the time and the count of each batch (a byte or more each)
+    // with 2 bytes for a char, and 1 for a blank or another key
+    const auto size = log->str().size();
+    BOOST_CHECK(size >= 8u + (2 + 11) + (2 + 5) + 2);
+    BOOST_CHECK(size <= 8u + (2 + 11) + (2 + 5) + 2 + 6);
+
+    KeyLogReader reader(*log);
+    BOOST_REQUIRE(reader.Valid());
+    chrono::microseconds offset{-1};
+    InputDevice::KeyEvents keys;
+    BOOST_REQUIRE(reader.Next(offset, keys));
+    BOOST_CHECK(keys == Line("hello"));
+    BOOST_CHECK(offset.count() >= 0);
+    const auto first = offset;
+    BOOST_REQUIRE(reader.Next(offset, keys));
+    BOOST_CHECK(keys == special);
+    BOOST_CHECK(offset >= first);
+    BOOST_REQUIRE(reader.Next(offset, keys));
+    BOOST_CHECK(keys.empty());
+    BOOST_CHECK(!reader.Next(offset, keys));
+
+    // a truncated log ends early
+    stringstream truncated(log->str().substr(0, 12));
+    KeyLogReader r(truncated);
+    BOOST_REQUIRE(r.Valid());
+    BOOST_CHECK(!r.Next(offset, keys));
+
+    stringstream other("not a log");
+    BOOST_CHECK(!KeyLogReader(other).Valid());
+}
+
+BOOST_AUTO_TEST_CASE(RecordAndReplay)
+{
+    // the keys delivered by a device are recorded
+    auto log = make_shared<stringstream>();
+    {
+        LoopScheduler scheduler;
+        ReplayDevice device(scheduler);
+        RecordKeys(device, log);
+        device.Deliver(Line("hello"));
+        device.Deliver(Line("hel"));
+        device.Deliver({ {KeyType::backspace, ' '}, {KeyType::backspace, ' '}, {KeyType::backspace, ' '} });
+        device.Deliver(Line("wrong"));
+        device.Deliver(Line("exit"));
+        RecordKeys(device, nullptr);
+        device.Deliver(Line("hello")); // not recorded
+    }
+
+    auto rootMenu = make_unique<Menu>("cli");
+    rootMenu->Insert("hello", [](ostream& out){ out << "hello world\n"; } );
+    Cli cli(move(rootMenu));
+    cli.CollectMetrics(true);
+
+    stringstream sink;
+    CliReplaySession session(cli, &sink);
+    const auto events = session.Replay(*log);
+    BOOST_REQUIRE_EQUAL(events.size(), 5u);
+    BOOST_CHECK(session.Exited());
+    BOOST_CHECK_EQUAL(events[0].keys, 6u);
+    BOOST_CHECK(events[0].outputBytes >= string("hello world\n").size());
+    for (const auto& e: events)
+        BOOST_CHECK(e.latency.count() >= 0);
+    const auto out = sink.str();
+    BOOST_CHECK(out.find("hello world\n") != string::npos);
+    BOOST_CHECK(out.find("wrong") != string::npos);
+
+    // the metrics see the output of the commands
+    const auto stats = cli.Metrics();
+    const auto hello = find_if(stats.begin(), stats.end(), [](const CommandStats& c){ return c.name == "cli/hello"; });
+    BOOST_REQUIRE(hello != stats.end());
+    BOOST_CHECK_EQUAL(hello->Count(), 1u);
+    BOOST_CHECK_EQUAL(hello->outputBytes, string("hello world\n").size());
+
+    // at the recorded speed, without a sink
+    log->clear();
+    log->seekg(0);
+    CliReplaySession again(cli);
+    const auto replayed = again.Replay(*log, ReplaySpeed::recorded);
+    BOOST_CHECK_EQUAL(replayed.size(), 5u);
+
+    stringstream other("not a log");
+    BOOST_CHECK_THROW(again.Replay(other), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
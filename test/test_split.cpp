@@ -241,4 +241,61 @@ BOOST_AUTO_TEST_CASE(EscapedCases)
     BOOST_CHECK_EQUAL(strs[0], R"(foo\"bar)");
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(Reuse)
+{
+    // the output vector can be reused for many lines
+    VS strs;
+
+    split(strs, "first second third fourth");
+    BOOST_CHECK_EQUAL(strs.size(), 4);
+
+    split(strs, "foo 'bar foo'");
+    BOOST_CHECK_EQUAL(strs.size(), 2);
+    BOOST_CHECK_EQUAL(strs[0], "foo");
+    BOOST_CHECK_EQUAL(strs[1], "bar foo");
+
+    split(strs, "a \"\" b");
+    BOOST_CHECK_EQUAL(strs.size(), 2);
+    BOOST_CHECK_EQUAL(strs[0], "a");
+    BOOST_CHECK_EQUAL(strs[1], "b");
+
+    split(strs, "");
+    BOOST_CHECK_EQUAL(strs.size(), 0);
+
+    const string longWord(10000, 'x');
+    split(strs, longWord + " \"" + longWord + " " + longWord + "\"");
+    BOOST_CHECK_EQUAL(strs.size(), 2);
+    BOOST_CHECK_EQUAL(strs[0], longWord);
+    BOOST_CHECK_EQUAL(strs[1], longWord + " " + longWord);
+}
+
+BOOST_AUTO_TEST_CASE(TrailingEscape)
+{
+    VS strs;
+
+    split(strs, R"(foo\)");
+    BOOST_CHECK_EQUAL(strs.size(), 1);
+    BOOST_CHECK_EQUAL(strs[0], "foo");
+
+    split(strs, R"(foo \)");
+    BOOST_CHECK_EQUAL(strs.size(), 1);
+    BOOST_CHECK_EQUAL(strs[0], "foo");
+
+    split(strs, R"("foo\)");
+    BOOST_CHECK_EQUAL(strs.size(), 1);
+    BOOST_CHECK_EQUAL(strs[0], "foo");
+}
+
+BOOST_AUTO_TEST_CASE(FindUnquotedChar)
+{
+    BOOST_CHECK_EQUAL(FindUnquoted("", '|'), string::npos);
+    BOOST_CHECK_EQUAL(FindUnquoted("a | b", '|'), 2u);
+    BOOST_CHECK_EQUAL(FindUnquoted("a | b | c", '|', 3), 6u);
+    BOOST_CHECK_EQUAL(FindUnquoted("a|b", '|'), 1u);
+    BOOST_CHECK_EQUAL(FindUnquoted(R"("a|b" 'c|d' e\|f)", '|'), string::npos);
+    BOOST_CHECK_EQUAL(FindUnquoted(R"("a\"|b" 'c"|d' | e)", '|'), 15u);
+    BOOST_CHECK_EQUAL(FindUnquoted(R"(a\\|b)", '|'), 3u);
+    BOOST_CHECK_EQUAL(FindUnquoted("\"unterminated | x", '|'), string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -50,6 +50,31 @@ BOOST_AUTO_TEST_CASE(Exceptions)
     ExceptionTest<StandaloneAsioScheduler>();
 }
 
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+    MoveOnlyTest<StandaloneAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Priorities)
+{
+    PriorityTest<StandaloneAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Timers)
+{
+    TimerTest<StandaloneAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPool)
+{
+    ThreadPoolTest<StandaloneAsioScheduler>();
+}
+
+BOOST_AUTO_TEST_CASE(Group)
+{
+    SchedulerGroupTest<StandaloneAsioSchedulerGroup>();
+}
+
 BOOST_AUTO_TEST_CASE(StandaloneAsioNonOwner)
 {
     detail::StandaloneAsioLib::ContextType ioc;
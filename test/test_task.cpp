@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include <boost/test/unit_test.hpp>
+#include <array>
+#include <memory>
+#include <utility>
+#include "cli/task.h"
+
+using namespace std;
+using namespace cli;
+
+BOOST_AUTO_TEST_SUITE(TaskSuite)
+
+struct Counted
+{
+    explicit Counted(int& _alive) : alive(&_alive) { ++*alive; }
+    Counted(const Counted& other) : alive(other.alive) { ++*alive; }
+    Counted(Counted&& other) noexcept : alive(other.alive) { ++*alive; }
+    ~Counted() { --*alive; }
+    int* alive;
+};
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+    Task t;
+    BOOST_CHECK(!t);
+    Task moved(std::move(t));
+    BOOST_CHECK(!moved);
+}
+
+BOOST_AUTO_TEST_CASE(Call)
+{
+    int calls = 0;
+    Task t([&calls](){ ++calls; });
+    BOOST_REQUIRE(t);
+    t();
+    t();
+    BOOST_CHECK_EQUAL(calls, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+    int result = 0;
+    Task t([&result, p = make_unique<int>(42)](){ result = *p; });
+    Task other(std::move(t));
+    BOOST_CHECK(!t);
+    other();
+    BOOST_CHECK_EQUAL(result, 42);
+}
+
+BOOST_AUTO_TEST_CASE(Lifetime)
+{
+    int alive = 0;
+    int calls = 0;
+    {
+        // small callable, stored inline
+        Task t([c = Counted(alive), &calls](){ ++calls; });
+        BOOST_CHECK_EQUAL(alive, 1);
+        Task other(std::move(t));
+        BOOST_CHECK_EQUAL(alive, 1);
+        other();
+        Task assigned;
+        assigned = std::move(other);
+        BOOST_CHECK_EQUAL(alive, 1);
+        assigned();
+    }
+    BOOST_CHECK_EQUAL(alive, 0);
+    {
+        // big callable, stored in the heap
+        array<char, Task::InlineSize+1> big{};
+        Task t([c = Counted(alive), &calls, big](){ calls += big[0] + 1; });
+        BOOST_CHECK_EQUAL(alive, 1);
+        Task other(std::move(t));
+        BOOST_CHECK_EQUAL(alive, 1);
+        other();
+        other = Task([&calls](){ ++calls; }); // the big one is destroyed
+        BOOST_CHECK_EQUAL(alive, 0);
+        other();
+    }
+    BOOST_CHECK_EQUAL(alive, 0);
+    BOOST_CHECK_EQUAL(calls, 4);
+}
+
+BOOST_AUTO_TEST_CASE(Exception)
+{
+    Task t([](){ throw 42; });
+    BOOST_CHECK_THROW(t(), int);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
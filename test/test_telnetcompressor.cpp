@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include "cli/detail/telnetcompressor.h"
+
+#if defined(CLI_TELNET_MCCP)
+
+#include <string>
+
+using namespace std;
+using namespace cli::detail;
+
+namespace
+{
+
+// Inflate the chunks compressed so far by the stream
+string Inflate(z_stream& zs, string& data)
+{
+    string out(64 * 1024, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(&data[0]);
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    const int result = inflate(&zs, Z_SYNC_FLUSH);
+    BOOST_CHECK(result == Z_OK || result == Z_STREAM_END);
+    BOOST_CHECK_EQUAL(zs.avail_in, 0u);
+    out.resize(out.size() - zs.avail_out);
+    return out;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TelnetCompressorSuite)
+
+BOOST_AUTO_TEST_CASE(ChunksReadableAtOnce)
+{
+    TelnetCompressor compressor(6);
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    BOOST_REQUIRE(inflateInit(&zs) == Z_OK);
+
+    string table;
+    for (int i = 0; i < 1000; ++i)
+        table += "| eth" + to_string(i % 48) + " | up | 1500 |\n";
+    string data = table;
+    compressor.Compress(data);
+    BOOST_CHECK_LT(data.size() * 4, table.size());
+    // every chunk is flushed: the client gets it without waiting for the next one
+    BOOST_CHECK_EQUAL(Inflate(zs, data), table);
+
+    string prompt = "cli> ";
+    compressor.Compress(prompt);
+    BOOST_CHECK_EQUAL(Inflate(zs, prompt), "cli> ");
+
+    string last = "bye\n";
+    compressor.Finish(last);
+    BOOST_CHECK_EQUAL(Inflate(zs, last), "bye\n");
+    inflateEnd(&zs);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // defined(CLI_TELNET_MCCP)
@@ -0,0 +1,233 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <sstream>
+#include "cli/detail/terminal.h"
+#include "cli/detail/telnetscreen.h"
+
+using namespace std;
+using namespace cli;
+using namespace cli::detail;
+
+namespace
+{
+
+// a screen without the VT sequences (like WinScreen)
+struct PlainScreen
+{
+    static void Clear(std::ostream&) {}
+    static void CursorBack(std::string& buffer, std::size_t n) { buffer.append(n, '\b'); }
+    static void EraseToEnd(std::string& buffer, std::size_t n)
+    {
+        buffer.append(n, ' ');
+        buffer.append(n, '\b');
+    }
+};
+
+// Emulates a single line of a terminal
+struct ScreenLine
+{
+    void Feed(const string& data)
+    {
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const char c = data[i];
+            if (c == '\b')
+            {
+                BOOST_REQUIRE(cursor > 0);
+                --cursor;
+            }
+            else if (c == '\033')
+            {
+                BOOST_REQUIRE(data[++i] == '[');
+                size_t n = 0;
+                while (isdigit(data[++i]))
+                    n = n*10 + static_cast<size_t>(data[i]-'0');
+                if (data[i] == 'D')
+                {
+                    BOOST_REQUIRE(cursor >= n);
+                    cursor -= n;
+                }
+                else
+                {
+                    BOOST_REQUIRE(data[i] == 'K');
+                    text.resize(cursor);
+                }
+            }
+            else
+            {
+                if (cursor == text.size())
+                    text += c;
+                else
+                    text[cursor] = c;
+                ++cursor;
+            }
+        }
+    }
+    string Text() const
+    {
+        // trailing spaces are not visible
+        const auto end = text.find_last_not_of(' ');
+        return end == string::npos ? string() : text.substr(0, end+1);
+    }
+    string text;
+    size_t cursor = 0;
+};
+
+template <typename SCREEN>
+void RandomEdits()
+{
+    stringstream out;
+    Terminal<SCREEN> terminal(out);
+    ScreenLine screen;
+    string line; // the expected line
+    size_t position = 0; // the expected cursor
+    mt19937 gen(1234);
+    const KeyType keys[] = { KeyType::ascii, KeyType::ascii, KeyType::ascii, KeyType::backspace, KeyType::canc,
+                             KeyType::left, KeyType::right, KeyType::home, KeyType::end };
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (gen() % 50 == 0)
+        {
+            // e.g., history recall
+            line = string(gen() % 20, static_cast<char>('a' + gen() % 3));
+            terminal.SetLine(line);
+            position = line.size();
+        }
+        else
+        {
+            const KeyType k = keys[gen() % (sizeof(keys)/sizeof(keys[0]))];
+            const char c = static_cast<char>('a' + gen() % 3);
+            switch (k)
+            {
+                case KeyType::ascii: line.insert(position++, 1, c); break;
+                case KeyType::backspace: if (position > 0) line.erase(--position, 1); break;
+                case KeyType::canc: if (position < line.size()) line.erase(position, 1); break;
+                case KeyType::left: if (position > 0) --position; break;
+                case KeyType::right: if (position < line.size()) ++position; break;
+                case KeyType::home: position = 0; break;
+                case KeyType::end: position = line.size(); break;
+                default: break;
+            }
+            terminal.Keypressed(make_pair(k, c));
+        }
+        screen.Feed(out.str());
+        out.str("");
+        BOOST_REQUIRE_EQUAL(terminal.GetLine(), line);
+        BOOST_REQUIRE_EQUAL(screen.Text(), line);
+        BOOST_REQUIRE_EQUAL(screen.cursor, position);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TerminalSuite)
+
+BOOST_AUTO_TEST_CASE(Echo)
+{
+    stringstream out;
+    Terminal<TelnetScreen> terminal(out);
+    for (char c: string("helo"))
+        terminal.Keypressed(make_pair(KeyType::ascii, c));
+    BOOST_CHECK_EQUAL(out.str(), "helo");
+    out.str("");
+    terminal.Keypressed(make_pair(KeyType::left, ' '));
+    terminal.Keypressed(make_pair(KeyType::ascii, 'l'));
+    BOOST_CHECK_EQUAL(out.str(), "\blo\b");
+    out.str("");
+    const auto s = terminal.Keypressed(make_pair(KeyType::ret, ' '));
+    BOOST_CHECK(s.first == Symbol::command);
+    BOOST_CHECK_EQUAL(s.second, "hello");
+    BOOST_CHECK_EQUAL(out.str(), "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(ColoredEcho)
+{
+    SetColor();
+    stringstream out;
+    Terminal<TelnetScreen> terminal(out);
+    terminal.Keypressed(make_pair(KeyType::ascii, 'a'));
+    terminal.Keypressed(make_pair(KeyType::ascii, 'b'));
+    terminal.Keypressed(make_pair(KeyType::left, ' '));
+    out.str("");
+    // only the typed chars are in the input color, the cursor moves are not
+    terminal.Keypressed(make_pair(KeyType::ascii, 'x'));
+    BOOST_CHECK_EQUAL(out.str(), "\033[97mxb\033[0m\b");
+    out.str("");
+    terminal.Keypressed(make_pair(KeyType::left, ' '));
+    BOOST_CHECK_EQUAL(out.str(), "\b");
+    SetNoColor();
+    out.str("");
+    terminal.Keypressed(make_pair(KeyType::ascii, 'y'));
+    BOOST_CHECK_EQUAL(out.str(), "yxb\b\b");
+}
+
+BOOST_AUTO_TEST_CASE(SetLine)
+{
+    stringstream out;
+    Terminal<TelnetScreen> terminal(out);
+    terminal.SetLine("show interfaces");
+    out.str("");
+    // only the different part is rewritten
+    terminal.SetLine("show ip");
+    BOOST_CHECK_EQUAL(out.str(), "\033[9Dp\033[K");
+    out.str("");
+    terminal.SetLine("show ip");
+    BOOST_CHECK_EQUAL(out.str(), "");
+    // after a new prompt, the whole line is written
+    terminal.ResetCursor();
+    terminal.SetLine("show ip");
+    BOOST_CHECK_EQUAL(out.str(), "show ip");
+}
+
+BOOST_AUTO_TEST_CASE(MaxLineLength)
+{
+    stringstream out;
+    Terminal<TelnetScreen> terminal(out);
+    terminal.MaxLineLength(3);
+    for (char c: string("hello"))
+        terminal.Keypressed(make_pair(KeyType::ascii, c));
+    BOOST_CHECK_EQUAL(terminal.GetLine(), "hel");
+    BOOST_CHECK_EQUAL(out.str(), "hel");
+}
+
+BOOST_AUTO_TEST_CASE(RandomEditsVt)
+{
+    RandomEdits<TelnetScreen>();
+}
+
+BOOST_AUTO_TEST_CASE(RandomEditsPlain)
+{
+    RandomEdits<PlainScreen>();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
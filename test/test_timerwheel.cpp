@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+#include "cli/detail/timerwheel.h"
+
+using namespace cli;
+using namespace cli::detail;
+using namespace std::chrono;
+
+BOOST_AUTO_TEST_SUITE(TimerWheelSuite)
+
+BOOST_AUTO_TEST_CASE(Deadlines)
+{
+    const auto origin = TimerWheel::Clock::now();
+    TimerWheel wheel(origin);
+    BOOST_CHECK(wheel.Empty());
+    BOOST_CHECK(wheel.NextDeadline() == TimerWheel::Clock::time_point::max());
+
+    std::vector<int> fired;
+    auto add = [&](milliseconds when, int id){ wheel.Add(origin + when, Task([&fired, id](){ fired.push_back(id); })); };
+    auto expire = [&](milliseconds now){ wheel.Expire(origin + now, [](Task&& t){ t(); }); };
+
+    add(milliseconds(300), 3);
+    add(milliseconds(10), 1);
+    add(milliseconds(5000), 4); // on the second level
+    add(milliseconds(70), 2);
+    add(hours(10), 5); // beyond the wheel
+    BOOST_CHECK_EQUAL(wheel.Size(), 5u);
+    BOOST_CHECK(wheel.NextDeadline() == origin + milliseconds(10));
+
+    expire(milliseconds(9));
+    BOOST_CHECK(fired.empty());
+    expire(milliseconds(10));
+    BOOST_REQUIRE_EQUAL(fired.size(), 1u);
+    BOOST_CHECK_EQUAL(fired[0], 1);
+    expire(milliseconds(4999));
+    const std::vector<int> three{1, 2, 3};
+    BOOST_CHECK_EQUAL_COLLECTIONS(fired.begin(), fired.end(), three.begin(), three.end());
+    BOOST_CHECK(wheel.NextDeadline() <= origin + milliseconds(5000));
+    expire(hours(1));
+    BOOST_CHECK_EQUAL(fired.size(), 4u);
+    expire(hours(10) - milliseconds(1));
+    BOOST_CHECK_EQUAL(fired.size(), 4u);
+    expire(hours(11));
+    BOOST_CHECK_EQUAL(fired.size(), 5u);
+    BOOST_CHECK(wheel.Empty());
+
+    // a deadline already past is due at the next check
+    add(hours(1), 6);
+    BOOST_CHECK(wheel.NextDeadline() <= origin + hours(11));
+    expire(hours(11));
+    BOOST_CHECK_EQUAL(fired.back(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(NeverEarlyNeverMissed)
+{
+    const auto origin = TimerWheel::Clock::now();
+    TimerWheel wheel(origin);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<long> deadline(0, 6 * 3600 * 1000L); // beyond the wheel, too
+    std::uniform_int_distribution<long> step(0, 200000);
+    std::multimap<long, int> pending;
+    long now = 0;
+    int id = 0;
+    std::vector<std::pair<int, long>> fired; // id, time of expire
+    for (int round = 0; round < 2000; ++round)
+    {
+        for (int i = 0; i < 5; ++i, ++id)
+        {
+            const long when = now + deadline(gen) / (1 + round % 7);
+            pending.emplace(when, id);
+            const int thisId = id;
+            wheel.Add(origin + milliseconds(when), Task([&fired, &now, thisId](){ fired.emplace_back(thisId, now); }));
+        }
+        // the wheel must be checked again no later than the first deadline
+        const auto next = duration_cast<milliseconds>(wheel.NextDeadline() - origin).count();
+        BOOST_REQUIRE_LE(next, pending.begin()->first);
+        now += std::min<long>(step(gen), std::max<long>(next - now, 0));
+        fired.clear();
+        wheel.Expire(origin + milliseconds(now), [](Task&& t){ t(); });
+        std::size_t expected = 0;
+        for (auto i = pending.begin(); i != pending.end() && i->first <= now;)
+        {
+            ++expected;
+            i = pending.erase(i);
+        }
+        BOOST_REQUIRE_EQUAL(fired.size(), expected);
+        BOOST_REQUIRE_EQUAL(wheel.Size(), pending.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
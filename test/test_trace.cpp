@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+#include "cli/detail/trace.h"
+
+using namespace std;
+using namespace cli::detail;
+
+BOOST_AUTO_TEST_SUITE(TraceSuite)
+
+BOOST_AUTO_TEST_CASE(RingBuffer)
+{
+    TraceRingBuffer<4> ring;
+    BOOST_CHECK(ring.Records().empty());
+
+    ring.Write(TraceLevel::protocol, "will", 1);
+    ring.Write(TraceLevel::error, "err", 2);
+    auto records = ring.Records();
+    BOOST_REQUIRE_EQUAL(records.size(), 2);
+    BOOST_CHECK(records[0].level == TraceLevel::protocol);
+    BOOST_CHECK_EQUAL(string(records[0].event), "will");
+    BOOST_CHECK_EQUAL(records[0].value, 1);
+    BOOST_CHECK(records[1].level == TraceLevel::error);
+    BOOST_CHECK_EQUAL(records[1].value, 2);
+
+    // wraparound: only the last 4 records are kept, the oldest first
+    for (int i = 3; i <= 10; ++i)
+        ring.Write(TraceLevel::data, "data", i);
+    records = ring.Records();
+    BOOST_REQUIRE_EQUAL(records.size(), 4);
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK_EQUAL(records[i].value, 7+i);
+}
+
+BOOST_AUTO_TEST_CASE(Sink)
+{
+    struct TestSink : TraceSink
+    {
+        void Write(TraceLevel, const char* event, int value) noexcept override
+        {
+            events.push_back(string(event) + ' ' + to_string(value));
+        }
+        vector<string> events;
+    };
+
+    TestSink sink;
+    SetTraceSink(&sink);
+    Trace(TraceLevel::protocol, "do", 3);
+    Trace(TraceLevel::data, "data", 65);
+    SetTraceSink(nullptr);
+    Trace(TraceLevel::error, "lost", 0); // discarded
+    SetTraceSink(&DefaultTraceSink());
+
+    BOOST_REQUIRE_EQUAL(sink.events.size(), 2);
+    BOOST_CHECK_EQUAL(sink.events[0], "do 3");
+    BOOST_CHECK_EQUAL(sink.events[1], "data 65");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,6 +29,9 @@
 
 #include <boost/test/unit_test.hpp>
 #include "cli/volatilehistorystorage.h"
+#include <deque>
+#include <set>
+#include <thread>
 
 using namespace cli;
 
@@ -56,4 +59,61 @@ BOOST_AUTO_TEST_CASE(Basics)
     BOOST_CHECK(s.Commands().empty()); // check clear
 }
 
+BOOST_AUTO_TEST_CASE(Compaction)
+{
+    VolatileHistoryStorage s(50);
+    std::deque<std::string> expected;
+
+    for (int i = 0; i < 500; ++i)
+    {
+        std::vector<std::string> v;
+        for (int j = 0; j < i % 7; ++j)
+            v.push_back(std::to_string(i) + '.' + std::to_string(j));
+        s.Store(v);
+        expected.insert(expected.end(), v.begin(), v.end());
+        while (expected.size() > 50)
+            expected.pop_front();
+
+        const auto result = s.Commands();
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(expected.begin(), expected.end(), result.begin(), result.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Concurrency)
+{
+    VolatileHistoryStorage s(1000);
+
+    auto writer = [&s](const std::string& prefix)
+    {
+        for (int i = 0; i < 200; ++i)
+            s.Store({ prefix + std::to_string(i) + "a", prefix + std::to_string(i) + "b" });
+    };
+    bool ordered = true;
+    std::thread reader([&]{
+        for (int i = 0; i < 200; ++i)
+        {
+            const auto result = s.Commands();
+            for (std::size_t j = 0; j + 1 < result.size(); j += 2)
+                ordered = ordered && result[j].back() == 'a' && result[j+1].back() == 'b';
+        }
+    });
+    std::thread t1([&]{ writer("x"); });
+    std::thread t2([&]{ writer("y"); });
+    t1.join();
+    t2.join();
+    reader.join();
+
+    BOOST_CHECK(ordered);
+    const auto result = s.Commands();
+    BOOST_CHECK_EQUAL(result.size(), 800u);
+    const std::set<std::string> all(result.begin(), result.end());
+    BOOST_CHECK_EQUAL(all.size(), 800u);
+    // the commands of a Store are not interleaved with the ones of another
+    for (std::size_t i = 0; i < result.size(); i += 2)
+    {
+        BOOST_REQUIRE_EQUAL(result[i].back(), 'a');
+        BOOST_CHECK_EQUAL(result[i].substr(0, result[i].size()-1) + 'b', result[i+1]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
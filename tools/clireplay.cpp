@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+// Replays the key logs recorded by the interactive sessions
+// (see CliSession::Record and the RecordSessions of the telnet servers)
+// through CliReplaySession, and reports the latency of the batches of keys
+// (p50, p99, max) and the output.
+//
+// The logs are replayed against the menu of the tool (the commands echo and table),
+// so the other commands of a recording measure the line editing and the error path:
+// to replay against the menus of an application, use CliReplaySession in the application.
+//
+// With --self it replays a log of the --cmd lines typed one key at a time,
+// and works as a smoke test: the exit code is not zero if the latency is over the limit.
+//
+//     clireplay --speed recorded --echo session1.keys session2.keys
+//     clireplay --self --repeat 1000 --max-p99 5
+
+#include <cli/cli.h>
+#include <cli/clireplaysession.h>
+#include <cli/metrics.h>
+#include <cli/detail/keylog.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace cli;
+using namespace cli::detail;
+
+namespace
+{
+
+struct Options
+{
+    std::vector<std::string> logs;
+    ReplaySpeed speed = ReplaySpeed::fastest;
+    bool echo = false; // write the output of the sessions on stdout
+    std::size_t repeat = 1;
+    bool self = false;
+    std::vector<std::string> commands;
+    double maxP99 = 0; // ms, 0 for no limit
+};
+
+struct Stats
+{
+    LatencyHistogram batch; // the processing of a batch of keys
+    std::uint64_t keys = 0;
+    std::uint64_t bytes = 0;
+    std::size_t sessions = 0;
+};
+
+void PrintLatency(const char* name, const LatencyHistogram& h)
+{
+    using std::chrono::duration_cast;
+    using Ms = std::chrono::duration<double, std::milli>;
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+              << " count " << std::setw(9) << h.Count()
+              << "  p50 " << std::setw(9) << duration_cast<Ms>(h.Quantile(0.5)).count()
+              << "  p99 " << std::setw(9) << duration_cast<Ms>(h.Quantile(0.99)).count()
+              << "  max " << std::setw(9) << duration_cast<Ms>(h.Max()).count() << " ms\n";
+}
+
+bool ParseOptions(int argc, char* argv[], Options& o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--self") o.self = true;
+        else if (arg == "--echo") o.echo = true;
+        else if (arg == "--speed" && hasValue)
+        {
+            const std::string speed = argv[++i];
+            if (speed == "recorded") o.speed = ReplaySpeed::recorded;
+            else if (speed == "fastest") o.speed = ReplaySpeed::fastest;
+            else return false;
+        }
+        else if (arg == "--repeat" && hasValue) o.repeat = static_cast<std::size_t>(std::atol(argv[++i]));
+        else if (arg == "--cmd" && hasValue) o.commands.push_back(argv[++i]);
+        else if (arg == "--max-p99" && hasValue) o.maxP99 = std::atof(argv[++i]);
+        else if (!arg.empty() && arg[0] != '-') o.logs.push_back(arg);
+        else return false;
+    }
+    if (o.commands.empty())
+        o.commands = { "echo hello", "table 50", "help" };
+    return o.repeat > 0 && (o.self || !o.logs.empty());
+}
+
+// the menu the logs are replayed against
+std::unique_ptr<Menu> ReplayMenu()
+{
+    auto menu = std::make_unique<Menu>("replay");
+    menu->Insert("echo", [](std::ostream& out, const std::vector<std::string>& args)
+    {
+        for (const auto& a: args)
+            out << a << ' ';
+        out << '\n';
+    }, "Print the parameters");
+    menu->Insert("table", [](std::ostream& out, unsigned rows)
+    {
+        for (unsigned i = 0; i < rows; ++i)
+            out << std::setw(8) << i << std::setw(12) << i * i << std::setw(40) << "row of the output table" << '\n';
+    }, "Print a table with the given rows");
+    return menu;
+}
+
+// the log of the commands typed one key at a time, for --self
+std::string SelfLog(const std::vector<std::string>& commands)
+{
+    auto log = std::make_shared<std::ostringstream>();
+    KeyLogWriter writer(log);
+    for (const auto& c: commands)
+    {
+        for (char key: c)
+            writer.Write({ { KeyType::ascii, key } });
+        writer.Write({ { KeyType::ret, ' ' } });
+    }
+    return log->str();
+}
+
+void Replay(Cli& cli, std::istream& log, const Options& options, Stats& stats)
+{
+    CliReplaySession session(cli, options.echo ? &std::cout : nullptr);
+    for (const auto& e: session.Replay(log, options.speed))
+    {
+        stats.batch.Record(e.latency);
+        stats.keys += e.keys;
+        stats.bytes += e.outputBytes;
+    }
+    ++stats.sessions;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " [--speed recorded|fastest] [--echo] [--repeat <n>] [--max-p99 <ms>]"
+                     " (--self [--cmd <command>]... | <log>...)\n";
+        return 2;
+    }
+
+    Cli cli(ReplayMenu());
+    Stats stats;
+    const auto begin = std::chrono::steady_clock::now();
+    try
+    {
+        const std::string self = options.self ? SelfLog(options.commands) : std::string();
+        for (std::size_t r = 0; r < options.repeat; ++r)
+        {
+            if (options.self)
+            {
+                std::istringstream log(self);
+                Replay(cli, log, options, stats);
+            }
+            for (const auto& name: options.logs)
+            {
+                std::ifstream log(name, std::ios::binary);
+                if (!log)
+                    throw std::runtime_error("cannot open " + name);
+                Replay(cli, log, options, stats);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "sessions " << stats.sessions << ", keys " << stats.keys << '\n';
+    PrintLatency("batch", stats.batch);
+    std::cout << "output    " << stats.bytes << " bytes, "
+              << std::setprecision(3) << static_cast<double>(stats.bytes) / elapsed / 1e6 << " MB/s\n";
+
+    const double p99 = std::chrono::duration<double, std::milli>(stats.batch.Quantile(0.99)).count();
+    return (options.maxP99 == 0 || p99 <= options.maxP99) ? 0 : 1;
+}
@@ -0,0 +1,450 @@
+/*******************************************************************************
+ * CLI - A simple command line interface.
+ * Copyright (C) 2016-2021 Daniele Pallastrelli
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+
+// Load generator for the telnet server of the library.
+//
+// It opens N telnet connections, answers the negotiation of the server,
+// types the commands one key at a time (waiting for the echo of each key)
+// and reports the connection setup time, the echo and command latencies
+// and the output throughput.
+//
+// With --self it starts a server in the same process and works as a soak test:
+// the exit code is not zero if a session fails or the latency is over the limit.
+//
+//     telnetload --port 5000 --sessions 100 --duration 30 --cmd "show" --cmd "status"
+//     telnetload --self --sessions 200 --duration 10 --max-echo-p99 50
+
+#ifdef CLI_TELNETLOAD_USE_STANDALONEASIO
+    #include <cli/standaloneasioscheduler.h>
+    #include <cli/standaloneasioremotecli.h>
+    namespace cli
+    {
+        using MainScheduler = StandaloneAsioScheduler;
+        using CliTelnetServer = StandaloneAsioCliTelnetServer;
+        namespace detail { using AsioLib = StandaloneAsioLib; }
+    } // namespace cli
+#elif defined(CLI_TELNETLOAD_USE_BOOSTASIO)
+    #include <cli/boostasioscheduler.h>
+    #include <cli/boostasioremotecli.h>
+    namespace cli
+    {
+        using MainScheduler = BoostAsioScheduler;
+        using CliTelnetServer = BoostAsioCliTelnetServer;
+        namespace detail { using AsioLib = BoostAsioLib; }
+    } // namespace cli
+#else
+    #error either CLI_TELNETLOAD_USE_STANDALONEASIO or CLI_TELNETLOAD_USE_BOOSTASIO must be defined
+#endif
+
+#include <cli/cli.h>
+#include <cli/metrics.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cli;
+using namespace cli::detail;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    unsigned short port = 5000;
+    std::size_t sessions = 10;
+    std::chrono::seconds duration{10};
+    std::chrono::milliseconds think{0}; // between two keys
+    std::string prompt = "> "; // the end of the prompt
+    std::vector<std::string> commands;
+    bool self = false;
+    std::size_t serverThreads = 1;
+    double maxEchoP99 = 0; // ms, 0 for no limit
+};
+
+struct Stats
+{
+    LatencyHistogram setup; // from the connect to the first prompt
+    LatencyHistogram echo; // from a key to its echo
+    LatencyHistogram command; // from the return to the prompt
+    std::uint64_t bytes = 0;
+    std::size_t completed = 0;
+    std::size_t failed = 0;
+};
+
+// A telnet client typing the commands until the end of the test
+class Client : public std::enable_shared_from_this<Client>
+{
+public:
+    Client(AsioLib::ContextType& context, const Options& _options, Stats& _stats, Clock::time_point _end) :
+        socket(context), timer(context), options(_options), stats(_stats), end(_end)
+    {}
+
+    void Start(const asiolib::ip::tcp::endpoint& endpoint)
+    {
+        auto self = shared_from_this();
+        started = Clock::now();
+        socket.async_connect(endpoint, [this, self](asiolibec::error_code ec)
+        {
+            if (ec)
+                return Fail("connect", ec);
+            Read();
+        });
+    }
+
+    void Abort()
+    {
+        asiolibec::error_code ec;
+        socket.close(ec);
+    }
+
+private:
+    enum class Phase { prompt, echo, closing, done };
+    enum class Telnet { data, iac, option, sub, subIac };
+
+    void Read()
+    {
+        auto self = shared_from_this();
+        socket.async_read_some(asiolib::buffer(data), [this, self](asiolibec::error_code ec, std::size_t n)
+        {
+            if (ec)
+            {
+                if (phase == Phase::closing && ec == asiolib::error::eof)
+                {
+                    phase = Phase::done;
+                    ++stats.completed;
+                    return;
+                }
+                return Fail("read", ec);
+            }
+            for (std::size_t i = 0; i < n; ++i)
+                Decode(data[i]);
+            Read();
+        });
+    }
+
+    // strips the telnet commands, answering the negotiation of the server
+    void Decode(char c)
+    {
+        const char IAC = '\xFF', WILL = '\xFB', WONT = '\xFC', DO = '\xFD', DONT = '\xFE', SB = '\xFA', SE = '\xF0';
+        switch (telnet)
+        {
+            case Telnet::data:
+                if (c == IAC)
+                    telnet = Telnet::iac;
+                else
+                    Data(c);
+                break;
+            case Telnet::iac:
+                if (c == IAC) { telnet = Telnet::data; Data(c); }
+                else if (c == WILL || c == WONT || c == DO || c == DONT) { verb = c; telnet = Telnet::option; }
+                else if (c == SB) telnet = Telnet::sub;
+                else telnet = Telnet::data;
+                break;
+            case Telnet::option:
+                // we only agree to the server echo
+                if (verb == WILL)
+                    Send(std::string{IAC, c == '\x01' ? DO : DONT, c});
+                else if (verb == DO)
+                    Send(std::string{IAC, WONT, c});
+                telnet = Telnet::data;
+                break;
+            case Telnet::sub:
+                if (c == IAC) telnet = Telnet::subIac;
+                break;
+            case Telnet::subIac:
+                telnet = (c == SE) ? Telnet::data : Telnet::sub;
+                break;
+        }
+    }
+
+    void Data(char c)
+    {
+        ++stats.bytes;
+        switch (phase)
+        {
+            case Phase::prompt:
+                tail.push_back(c);
+                if (tail.size() > options.prompt.size())
+                    tail.erase(0, tail.size() - options.prompt.size());
+                if (tail == options.prompt)
+                    Prompt();
+                break;
+            case Phase::echo:
+                if (c == expected)
+                {
+                    stats.echo.Record(Clock::now() - keyTime);
+                    NextKey();
+                }
+                break;
+            case Phase::closing:
+            case Phase::done:
+                break;
+        }
+    }
+
+    void Prompt()
+    {
+        tail.clear();
+        const auto now = Clock::now();
+        if (first)
+        {
+            stats.setup.Record(now - started);
+            first = false;
+        }
+        else
+            stats.command.Record(now - cmdTime);
+        if (now >= end)
+        {
+            phase = Phase::closing;
+            Send("exit\r\n");
+            return;
+        }
+        line = options.commands[next++ % options.commands.size()];
+        pos = 0;
+        NextKey();
+    }
+
+    void NextKey()
+    {
+        if (options.think.count() == 0)
+            return Type();
+        phase = Phase::closing; // ignore the data until the key is typed
+        AsioLib::ExpiresAfter(timer, options.think);
+        auto self = shared_from_this();
+        timer.async_wait([this, self](asiolibec::error_code ec){ if (!ec && socket.is_open()) Type(); });
+    }
+
+    void Type()
+    {
+        if (pos < line.size())
+        {
+            expected = line[pos++];
+            phase = Phase::echo;
+            keyTime = Clock::now();
+            Send(std::string(1, expected));
+            return;
+        }
+        phase = Phase::prompt;
+        cmdTime = Clock::now();
+        Send("\r\n");
+    }
+
+    // the writes are queued, so that there is only one in progress
+    void Send(const std::string& s)
+    {
+        pending += s;
+        if (!writing)
+            Write();
+    }
+
+    void Write()
+    {
+        writing = true;
+        inFlight.swap(pending);
+        pending.clear();
+        auto self = shared_from_this();
+        asiolib::async_write(socket, asiolib::buffer(inFlight), [this, self](asiolibec::error_code ec, std::size_t)
+        {
+            writing = false;
+            if (ec)
+                return Fail("write", ec);
+            if (!pending.empty())
+                Write();
+        });
+    }
+
+    void Fail(const char* what, const asiolibec::error_code& ec)
+    {
+        if (phase == Phase::done)
+            return;
+        if (stats.failed == 0)
+            std::cerr << what << " error: " << ec.message() << '\n';
+        phase = Phase::done;
+        ++stats.failed;
+        Abort();
+    }
+
+    asiolib::ip::tcp::socket socket;
+    AsioLib::SteadyTimer timer;
+    const Options& options;
+    Stats& stats;
+    const Clock::time_point end;
+    char data[4096];
+    Telnet telnet = Telnet::data;
+    char verb = 0;
+    Phase phase = Phase::prompt;
+    bool first = true;
+    std::string tail; // the last chars received, to find the prompt
+    std::string line; // the command being typed
+    std::size_t pos = 0;
+    std::size_t next = 0; // the next command to type
+    char expected = 0; // the echo to wait for
+    Clock::time_point started, keyTime, cmdTime;
+    std::string pending, inFlight;
+    bool writing = false;
+};
+
+void PrintLatency(const char* name, const LatencyHistogram& h)
+{
+    using std::chrono::duration_cast;
+    using Ms = std::chrono::duration<double, std::milli>;
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+              << " count " << std::setw(9) << h.Count()
+              << "  p50 " << std::setw(9) << duration_cast<Ms>(h.Quantile(0.5)).count()
+              << "  p99 " << std::setw(9) << duration_cast<Ms>(h.Quantile(0.99)).count()
+              << "  max " << std::setw(9) << duration_cast<Ms>(h.Max()).count() << " ms\n";
+}
+
+bool ParseOptions(int argc, char* argv[], Options& o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--self") o.self = true;
+        else if (arg == "--host" && hasValue) o.host = argv[++i];
+        else if (arg == "--port" && hasValue) o.port = static_cast<unsigned short>(std::atoi(argv[++i]));
+        else if (arg == "--sessions" && hasValue) o.sessions = static_cast<std::size_t>(std::atol(argv[++i]));
+        else if (arg == "--duration" && hasValue) o.duration = std::chrono::seconds(std::atol(argv[++i]));
+        else if (arg == "--think" && hasValue) o.think = std::chrono::milliseconds(std::atol(argv[++i]));
+        else if (arg == "--prompt" && hasValue) o.prompt = argv[++i];
+        else if (arg == "--cmd" && hasValue) o.commands.push_back(argv[++i]);
+        else if (arg == "--server-threads" && hasValue) o.serverThreads = static_cast<std::size_t>(std::atol(argv[++i]));
+        else if (arg == "--max-echo-p99" && hasValue) o.maxEchoP99 = std::atof(argv[++i]);
+        else return false;
+    }
+    if (o.commands.empty())
+        o.commands = { "echo hello", "table 50", "help" };
+    return o.sessions > 0 && o.serverThreads > 0;
+}
+
+// the menu of the server started by --self
+std::unique_ptr<Menu> ServerMenu()
+{
+    auto menu = std::make_unique<Menu>("load");
+    menu->Insert("echo", [](std::ostream& out, const std::vector<std::string>& args)
+    {
+        for (const auto& a: args)
+            out << a << ' ';
+        out << '\n';
+    }, "Print the parameters");
+    menu->Insert("table", [](std::ostream& out, unsigned rows)
+    {
+        for (unsigned i = 0; i < rows; ++i)
+            out << std::setw(8) << i << std::setw(12) << i * i << std::setw(40) << "row of the output table" << '\n';
+    }, "Print a table with the given rows");
+    return menu;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " [--self] [--host <address>] [--port <port>] [--sessions <n>] [--duration <s>]"
+                     " [--think <ms>] [--prompt <end of prompt>] [--cmd <command>]..."
+                     " [--server-threads <n>] [--max-echo-p99 <ms>]\n";
+        return 2;
+    }
+
+    // the server under test, if requested
+    std::unique_ptr<Cli> cli;
+    std::unique_ptr<MainScheduler> scheduler;
+    std::unique_ptr<CliTelnetServer> server;
+    std::thread serverThread;
+    if (options.self)
+    {
+        cli = std::make_unique<Cli>(ServerMenu());
+        scheduler = std::make_unique<MainScheduler>();
+        server = std::make_unique<CliTelnetServer>(*cli, *scheduler, options.port);
+        serverThread = std::thread([&](){ scheduler->Run(options.serverThreads); });
+    }
+
+    AsioLib::ContextType context;
+    const asiolib::ip::tcp::endpoint endpoint(AsioLib::IpAddressFromString(options.host), options.port);
+    const auto begin = Clock::now();
+    const auto end = begin + options.duration;
+    Stats stats;
+    std::vector<std::shared_ptr<Client>> clients;
+    clients.reserve(options.sessions);
+    for (std::size_t i = 0; i < options.sessions; ++i)
+    {
+        clients.push_back(std::make_shared<Client>(context, options, stats, end));
+        clients.back()->Start(endpoint);
+    }
+
+    // the sessions still open long after the end are hung
+    AsioLib::SteadyTimer deadline(context);
+    AsioLib::ExpiresAfter(deadline, options.duration + std::chrono::seconds(10));
+    deadline.async_wait([&](asiolibec::error_code ec)
+    {
+        if (ec)
+            return;
+        for (auto& c: clients)
+            c->Abort();
+    });
+    // the timer is cancelled when all the clients are done
+    while (context.run_one())
+    {
+        if (stats.completed + stats.failed == options.sessions)
+            deadline.cancel();
+    }
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    if (options.self)
+    {
+        scheduler->Stop();
+        serverThread.join();
+    }
+
+    std::cout << "sessions " << options.sessions << ": completed " << stats.completed
+              << ", failed " << stats.failed
+              << ", hung " << (options.sessions - stats.completed - stats.failed) << '\n';
+    PrintLatency("setup", stats.setup);
+    PrintLatency("echo", stats.echo);
+    PrintLatency("command", stats.command);
+    std::cout << "output    " << stats.bytes << " bytes, "
+              << std::setprecision(3) << static_cast<double>(stats.bytes) / elapsed / 1e6 << " MB/s\n";
+
+    const double echoP99 = std::chrono::duration<double, std::milli>(stats.echo.Quantile(0.99)).count();
+    const bool ok = stats.completed == options.sessions &&
+                    (options.maxEchoP99 == 0 || echoP99 <= options.maxEchoP99);
+    return ok ? 0 : 1;
+}